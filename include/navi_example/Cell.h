@@ -1,3 +1,6 @@
+#ifndef CELL_H
+#define CELL_H
+
 #include <vector>
 #include <ostream>
 #include <boost/shared_ptr.hpp>
@@ -159,3 +162,5 @@ Cell operator+(Cell lhs, const Direction& rhs);
  * @brief operator overload for << and printing out Directions
  */
 ostream& operator<<(ostream& os, const Direction& dir);
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef CONNECTIVITY_INDEX_H
+#define CONNECTIVITY_INDEX_H
+
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "navi_example/Cell.h"
+#include "navi_example/MapSnapshot.h"
+
+using namespace std;
+
+/**
+ * @brief Connected components of the free cells inside one ObstacleTile
+ *
+ * Cells are 8-connected, since the planner may cut corners.
+ */
+struct TileLabels{
+  typedef boost::shared_ptr<TileLabels> Ptr;
+  typedef boost::shared_ptr<const TileLabels> ConstPtr;
+  /**
+   * @brief the tile the labels were computed from
+   */
+  ObstacleTile::ConstPtr source;
+  /**
+   * @brief row major component of every cell, 0 for occupied cells and 1..count otherwise
+   */
+  boost::uint16_t labels[ObstacleTile::SIZE*ObstacleTile::SIZE];
+  /**
+   * @brief number of components in the tile
+   */
+  int count;
+  /**
+   * @brief Constructor, labels the free cells of a tile
+   * @param tile the tile to label
+   */
+  TileLabels( const ObstacleTile::ConstPtr& tile );
+};
+
+/**
+ * @brief Connected components of the free space, for rejecting unreachable queries
+ *
+ * Every non-empty tile is labeled on its own, in parallel, and the tile
+ * components are then joined with union-find. Each tile row of the box
+ * around the obstacles is a sorted list of segments: a non-empty tile, or
+ * a run of empty tiles between two of them, which is a single node however
+ * long it is. Consecutive tile rows without obstacles form one band node.
+ * So the join costs in the number of tiles, not in the area of the box,
+ * and obstacles far apart in the unbounded grid stay cheap. The free space
+ * outside the box is one component with the runs and bands it touches.
+ *
+ * An index for the next map version reuses the labels of every tile the
+ * update left untouched, so only changed tiles are relabeled.
+ */
+class ConnectivityIndex{
+  public:
+    typedef boost::shared_ptr<ConnectivityIndex> Ptr;
+    typedef boost::shared_ptr<const ConnectivityIndex> ConstPtr;
+
+    /**
+     * @brief Constructor, computes the components
+     * @param blocked the occupied tiles, the obstacles or an inflated layer
+     * @param threads number of threads for labeling tiles
+     * @param previous index of an earlier version of the tiles whose labels may be reused
+     */
+    ConnectivityIndex( const TileTable& blocked, int threads, ConstPtr previous = ConstPtr() );
+    /**
+     * @brief gets the component of a cell
+     * @param cell the cell
+     * @return the component, or -1 if the cell is occupied
+     */
+    int getComponent( const Cell& cell ) const;
+    /**
+     * @brief checks if a path can exist between two cells
+     * @param a one cell
+     * @param b the other cell
+     * @return whether both are free and in the same component
+     */
+    bool isConnected( const Cell& a, const Cell& b ) const;
+    /**
+     * @brief getter for the number of components
+     * @return the number of components, including the outside one
+     */
+    size_t getNumComponents() const;
+  private:
+    /**
+     * @brief a non-empty tile, or a run of empty tiles, within one tile row
+     */
+    struct Segment{
+      /**
+       * @brief first and last tile column covered
+       */
+      int left;
+      int right;
+      /**
+       * @brief labels of the tile, NULL for a run of empty tiles
+       */
+      const TileLabels* tile;
+      /**
+       * @brief union-find node of the first tile component, or of the run
+       */
+      int node;
+    };
+    /**
+     * @brief a tile row holding at least one non-empty tile
+     */
+    struct Row{
+      int y;
+      /**
+       * @brief segments covering the box from left to right
+       */
+      vector<Segment> segments;
+    };
+
+    /**
+     * @brief the label of a cell within its tile, 1 for every cell of an empty tile
+     */
+    static int localLabel( const TileLabels* tile, int x, int y ){
+        return tile ? tile->labels[y*ObstacleTile::SIZE + x] : 1;
+    }
+    /**
+     * @brief splits the tile rows into segments and numbers their union-find nodes
+     * @return the number of nodes
+     */
+    int buildRows();
+    /**
+     * @brief joins two segments side by side in the same row, left.right+1 == right.left
+     */
+    static void joinAcross( const Segment& left, const Segment& right, vector<int>& parent );
+    /**
+     * @brief joins a segment of one tile row with a segment of the row below
+     */
+    static void joinDown( const Segment& upper, const Segment& lower, vector<int>& parent );
+    /**
+     * @brief joins every segment of one tile row with the segments of the row below that it touches
+     */
+    static void joinLines( const vector<Segment>& upper, const vector<Segment>& lower, vector<int>& parent );
+
+    /**
+     * @brief labels of every non-empty tile
+     */
+    boost::unordered_map<Cell, TileLabels::ConstPtr> labels_;
+    /**
+     * @brief tile box of the obstacles, without the empty ring around it
+     */
+    Cell min_tile_;
+    Cell max_tile_;
+    /**
+     * @brief tile rows with obstacles, by increasing y
+     */
+    vector<Row> rows_;
+    /**
+     * @brief node of the empty rows before rows_[i], and after the last one at the end; -1 where there are none
+     */
+    vector<int> band_nodes_;
+    /**
+     * @brief component of every union-find node
+     */
+    vector<int> components_;
+    /**
+     * @brief component of the free space outside the box
+     */
+    int outside_;
+    size_t num_components_;
+};
+
+#endif
@@ -0,0 +1,182 @@
+#ifndef DSTAR_LITE_H
+#define DSTAR_LITE_H
+
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "navi_example/Environment.h"
+#include "navi_example/Path.h"
+
+using namespace std;
+
+/**
+ * @brief Incremental planner that repairs its previous search when the map changes
+ *
+ * Implements D* Lite (Koenig and Likhachev) on the 8-connected grid. The
+ * search runs backwards from the goal and keeps its g and rhs values between
+ * calls to plan(), so after a few cells change or the robot moves only the
+ * affected part of the search is redone. Costs and heuristic match Graph's
+ * FIXED_POINT mode: STRAIGHT_COST per straight step, DIAGONAL_COST per
+ * diagonal step, and the octile distance as the (consistent) heuristic.
+ * With whole numbers, routes of equal cost compare equal; floating point
+ * sums differ in the last bit, and every such difference sends the cells
+ * that depend on it around the open list again.
+ *
+ * Jump Point Search cannot be used here, since jump points depend on the
+ * whole corridor and would all need repairing after a change.
+ */
+class DStarLite{
+  public:
+    typedef boost::shared_ptr<DStarLite> Ptr;
+    typedef boost::shared_ptr<const DStarLite> ConstPtr;
+
+    /**
+     * @brief Constructor for the planner
+     * @param env Environment pointer used for collision checking
+     * @param start the cell the robot is at
+     * @param goal the cell to reach
+     */
+    DStarLite(Environment::Ptr env, const Cell& start, const Cell& goal);
+    /**
+     * @brief computes or repairs the search and extracts the path from the robot to the goal
+     *
+     * Checks the map's ConnectivityIndex first, so a robot walled off from
+     * the goal by the latest updates gets no path without any search.
+     * @param path the jump points of the path, one per change of direction
+     * @return whether a path was found
+     */
+    bool plan(Path& path);
+    /**
+     * @brief tells the planner that the robot moved
+     * @param start the new cell of the robot
+     */
+    void moveStart(const Cell& start);
+    /**
+     * @brief tells the planner that cells became blocked or free
+     *
+     * Must be called after the change has been applied to the environment
+     * @param cells the cells whose occupancy changed
+     */
+    void updateCells(const vector<Cell>& cells);
+    /**
+     * @brief gets the number of states expanded by all calls to plan so far
+     * @return the number of expansions
+     */
+    size_t getNumExpansions() const;
+  private:
+    /**
+     * @brief D* Lite priority, compared lexicographically
+     */
+    typedef pair<double, double> Key;
+    /**
+     * @brief open list entry; outdated entries are skipped when popped
+     */
+    typedef pair<Key, Cell> QueueEntry;
+    /**
+     * @brief the g and rhs values of a cell, both infinite until it is seen
+     */
+    struct Values{
+      Values() : g(numeric_limits<double>::infinity()), rhs(numeric_limits<double>::infinity()) {}
+      double g;
+      double rhs;
+    };
+
+    /**
+     * @brief gets the g and rhs values of a cell with a single lookup
+     */
+    const Values& getValues(const Cell& cell) const;
+    /**
+     * @brief gets the g value of a cell, infinite if never seen
+     */
+    double getG(const Cell& cell) const;
+    /**
+     * @brief gets the rhs value of a cell, infinite if never seen
+     */
+    double getRhs(const Cell& cell) const;
+    /**
+     * @brief octile distance from the robot to a cell
+     */
+    double heuristic(const Cell& from, const Cell& to) const;
+    /**
+     * @brief cost of a step between two neighbouring cells, ignoring obstacles
+     */
+    static double stepCost(const Cell& from, const Cell& to);
+    /**
+     * @brief cost of moving between two neighbouring cells, infinite if either is blocked
+     */
+    double cost(const Cell& from, const Cell& to);
+    /**
+     * @brief computes the priority of a cell
+     */
+    Key calculateKey(const Cell& cell) const;
+    /**
+     * @brief recomputes the rhs value of a cell and puts it on the open list if inconsistent
+     */
+    void updateVertex(const Cell& cell);
+    /**
+     * @brief computes the smallest cost-to-goal through any neighbour of a cell
+     */
+    double lookahead(const Cell& cell);
+    /**
+     * @brief puts a cell on the open list if it is inconsistent, or takes it off otherwise
+     */
+    void updateQueue(const Cell& cell);
+    /**
+     * @brief expands cells until the robot's cell is consistent
+     */
+    void computeShortestPath();
+    /**
+     * @brief finds the open list entry with the smallest key, dropping outdated entries on the way
+     * @param key the key of the entry
+     * @param cell the cell of the entry
+     * @return false if the open list is empty
+     */
+    bool topKey(Key& key, Cell& cell);
+
+    /**
+     * @brief Environment pointer used for collision checking
+     */
+    Environment::Ptr env_;
+    /**
+     * @brief Obstacles used for collision checking, refreshed by plan() and updateCells()
+     */
+    MapSnapshot::ConstPtr snapshot_;
+    /**
+     * @brief the cell the robot is at
+     */
+    Cell start_;
+    /**
+     * @brief the robot's cell when the key modifier was last updated
+     */
+    Cell last_start_;
+    /**
+     * @brief the cell to reach
+     */
+    Cell goal_;
+    /**
+     * @brief key modifier, accumulates the heuristic change as the robot moves
+     */
+    double km_;
+    /**
+     * @brief cost-to-goal estimates and their one-step lookahead values, kept between calls
+     */
+    boost::unordered_map<Cell, Values> values_;
+    /**
+     * @brief heap of open cells, ordered by smallest key first
+     */
+    vector<QueueEntry> open_list_;
+    /**
+     * @brief the current key of every cell on the open list
+     */
+    boost::unordered_map<Cell, Key> open_keys_;
+    /**
+     * @brief number of expansions so far
+     */
+    size_t num_expansions_;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef DESCRIPTION_PARSER_H
+#define DESCRIPTION_PARSER_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "navi_example/Cell.h"
+#include "navi_example/MapSnapshot.h"
+
+using namespace std;
+
+/**
+ * @brief Multithreaded reader for environment descriptions
+ *
+ * Reads the json format of the data sets: an object with "robotStart" and
+ * "robotEnd" coordinate pairs and an "obstacles" array of pairs. The
+ * obstacle array is cut into one chunk per thread, each cut moved forward
+ * to the start of the next pair. Every thread parses its chunk into its
+ * own tiles, then every thread merges one share of the tile coordinates
+ * from all threads, so no lock is taken.
+ *
+ * Anything outside that shape (nested values, strings in the array) is
+ * reported as a failure so the caller can fall back to a general parser.
+ */
+class DescriptionParser{
+  public:
+    typedef boost::shared_ptr<DescriptionParser> Ptr;
+    typedef boost::shared_ptr<const DescriptionParser> ConstPtr;
+
+    /**
+     * @brief Constructor
+     * @param threads number of threads to parse with
+     */
+    DescriptionParser( int threads );
+    /**
+     * @brief parses a description
+     * @param json the whole json text
+     * @return false if the text is not in the expected shape
+     */
+    bool parse( const string& json );
+    Cell getStart() const;
+    Cell getGoal() const;
+    /**
+     * @brief getter for the parsed obstacles
+     * @return the non-empty tiles, with their columns filled in
+     */
+    const MapSnapshot::TileMap& getTiles() const;
+    /**
+     * @brief getter for the number of obstacle pairs read, duplicates included
+     * @return the number of pairs
+     */
+    size_t getNumRecords() const;
+  private:
+    /**
+     * @brief tiles built by one thread
+     */
+    typedef boost::unordered_map<Cell, ObstacleTile::Ptr> Shard;
+
+    /**
+     * @brief parses the pairs in [begin,end) into a shard
+     */
+    void parseChunk( const char* begin, const char* end, Shard* shard, size_t* records, char* ok );
+    /**
+     * @brief merges the tiles of every shard that fall to one thread
+     */
+    void mergeShare( const vector<Shard>* shards, int share, int num_shares, MapSnapshot::TileMap* merged );
+    /**
+     * @brief reads "[x, y]" starting at pos, moving pos past it
+     */
+    static bool parsePair( const char*& pos, const char* end, Cell& cell );
+    /**
+     * @brief reads a number starting at pos, truncated to an integer
+     * @return false when it is not a number or does not fit an int
+     */
+    static bool parseNumber( const char*& pos, const char* end, int& value );
+    /**
+     * @brief skips a json value of any kind starting at pos
+     */
+    static bool skipValue( const char*& pos, const char* end );
+
+    int threads_;
+    Cell start_;
+    Cell goal_;
+    MapSnapshot::TileMap tiles_;
+    size_t num_records_;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef DISTANCE_TRANSFORM_H
+#define DISTANCE_TRANSFORM_H
+
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "navi_example/Cell.h"
+#include "navi_example/MapSnapshot.h"
+
+using namespace std;
+
+/**
+ * @brief Exact squared Euclidean distance to the nearest obstacle over a window of the grid
+ *
+ * Uses the separable algorithm of Felzenszwalb and Huttenlocher. The first
+ * pass sweeps every column for the vertical distance, a whole row of
+ * columns at a time so the inner loop runs over contiguous memory. The
+ * second pass takes the lower envelope of parabolas along every row. Each
+ * pass is split over threads by columns and rows respectively.
+ *
+ * Only obstacles inside the window are seen, so distances are exact for
+ * cells whose nearest obstacle lies inside the window.
+ */
+class DistanceTransform{
+  public:
+    typedef boost::shared_ptr<DistanceTransform> Ptr;
+    typedef boost::shared_ptr<const DistanceTransform> ConstPtr;
+
+    /**
+     * @brief Constructor, computes the transform
+     * @param snapshot obstacles to measure the distance to
+     * @param min_cell lowest corner of the window
+     * @param width number of columns of the window
+     * @param height number of rows of the window
+     * @param threads number of threads to split each pass over
+     */
+    DistanceTransform(const MapSnapshot& snapshot, const Cell& min_cell, int width, int height, int threads);
+    /**
+     * @brief getter for the squared distance of a cell to the nearest obstacle
+     * @param cell a cell inside the window
+     * @return the squared distance, 0 for an obstacle
+     */
+    int getSquaredDistance(const Cell& cell) const;
+    /**
+     * @brief marks the cells of a tile that lie within a radius of an obstacle
+     * @param tile coordinates of a tile inside the window
+     * @param radius the robot radius in cells
+     * @param inflated tile the occupancy bits are written to
+     */
+    void inflateTile(const Cell& tile, int radius, ObstacleTile& inflated) const;
+  private:
+    /**
+     * @brief vertical distances for columns [begin,end)
+     */
+    void sweepColumns(int begin, int end);
+    /**
+     * @brief squared distances for rows [begin,end)
+     */
+    void sweepRows(int begin, int end);
+    /**
+     * @brief runs a pass over [0,count) split evenly over the threads
+     */
+    void runParallel(void (DistanceTransform::*pass)(int, int), int count, int threads);
+
+    /**
+     * @brief lowest corner of the window
+     */
+    Cell min_cell_;
+    int width_;
+    int height_;
+    /**
+     * @brief row major distances, vertical after the first pass and squared after the second
+     */
+    vector<int> distances_;
+};
+
+#endif
@@ -3,21 +3,29 @@
 
 #include <fstream>
 #include <set>
+#include <string>
 #include <vector>
 
+#include <boost/atomic.hpp>
 #include <boost/shared_ptr.hpp>
-#include <boost/unordered_set.hpp>
+#include <boost/thread/mutex.hpp>
 #include <boost/property_tree/ptree.hpp>
 
 #include "navi_example/Cell.h"
+#include "navi_example/MapSnapshot.h"
 
 using namespace std;
 /**
  * @brief Class for the unbounded 2D gridded environment
  *
- * It handles collision checking of Cells, and maintains a set of
- * Cells that are occupied for fast collision checking.
- * It also stores the start and goal cells.
+ * It holds the occupied Cells for collision checking, and the start and
+ * goal cells.
+ *
+ * The obstacles are held in an immutable MapSnapshot. Updates build the next
+ * snapshot and publish it by swapping one pointer, so readers (planners)
+ * never wait for an update to be built and keep seeing the version they
+ * started with. Readers take the snapshot once per query; collision checks
+ * on it take no lock. Writers are serialized among themselves.
  */
 class Environment{
   public:
@@ -36,11 +44,83 @@ class Environment{
      */
     void readDescription( const ifstream& json );
     /**
-     * @brief checks if a given Cell is unoccupied
-     * @param cell Cell to be checked
-     * @return whether it is free
+     * @brief reads in the environment description from json text in memory
+     * @see readDescription()
+     * @param json the whole json text
+     */
+    void readDescription( const string& json );
+    /**
+     * @brief opens a tile file written by writeTiles()
+     *
+     * only the header and tile index are read; tiles are read the first
+     * time a collision check needs them, and at most cache_bytes of them
+     * are kept in memory
+     * @param path the tile file
+     * @param cache_bytes memory cap of the tile cache
+     * @return whether the file could be opened
+     */
+    bool loadTiles( const string& path, size_t cache_bytes );
+    /**
+     * @brief writes start, goal and obstacles as a tile file
+     * @param path the file to write
+     * @return whether the file was written
+     */
+    bool writeTiles( const string& path ) const;
+    /**
+     * @brief gets the current version of the obstacles
+     *
+     * The returned snapshot stays valid and unchanged while it is held,
+     * whatever updates are published in the meantime. Loading it takes
+     * boost's shared_ptr spinlock for a pointer copy, so readers get it
+     * once per query and check cells on the snapshot itself.
+     * @return the latest published snapshot
+     */
+    MapSnapshot::ConstPtr getSnapshot() const;
+    /**
+     * @brief applies a batch of changes and publishes them as one new version
+     * @param add the cells that became occupied
+     * @param remove the cells that became free
+     * @return the new map version
+     */
+    size_t applyDelta( const vector<Cell>& add, const vector<Cell>& remove );
+    /**
+     * @brief computes inflated occupancy for robots of the given radii
+     *
+     * A cell is blocked for a robot of radius r when an obstacle lies within
+     * euclidean distance r of it. The layers are kept up to date by later
+     * updates and descriptions; Graph::setRadius() selects one.
+     * @param radii the robot radii in cells
+     */
+    void setClearanceRadii( const vector<int>& radii );
+    /**
+     * @brief sets how many threads the distance transform may use
+     * @param threads number of threads, defaults to the number of cores
+     */
+    void setNumThreads( int threads );
+    /**
+     * @brief turns the messages printed while loading on or off, on by default
+     * @param verbose whether to print them
      */
-    bool isCollisionFree( const Cell& cell );
+    void setVerbose( bool verbose );
+    /**
+     * @brief marks a batch of cells as occupied
+     *
+     * bumps the map version if any of them was free
+     * @param cells the cells that became occupied
+     */
+    void addObstacles( const vector<Cell>& cells );
+    /**
+     * @brief marks a batch of cells as free
+     *
+     * bumps the map version if any of them was occupied
+     * @param cells the cells that became free
+     */
+    void removeObstacles( const vector<Cell>& cells );
+    /**
+     * @brief gets how long the last update took from being requested to being visible
+     * @return the publish latency in microseconds
+     */
+    double getLastPublishMicroseconds() const;
     /**
      * @brief helper function for reading in coordinates from the property tree
      * @see readDescription()
@@ -58,6 +138,14 @@ class Environment{
      * @return boost shared pointer to start Cell
      */
     Cell::Ptr getStart();
+    /**
+     * @brief getter for the map version
+     *
+     * The version changes every time the obstacles change, so results
+     * computed against one version can be told apart from another
+     * @return the current map version
+     */
+    size_t getVersion() const;
     /**
      * @brief prints obstacles to ostream
      * @param ostream to print to
@@ -84,12 +172,26 @@ class Environment{
      */
     Cell::Ptr goal_;
     /**
-     * @brief Set of Cells that are occupied
+     * @brief The published obstacles
      *
-     * used for fast collision checking
-     * O(1) time for contains (count) operation
+     * only ever accessed through boost::atomic_load and boost::atomic_store
+     */
+    MapSnapshot::ConstPtr snapshot_;
+    /**
+     * @brief Serializes writers; readers never take it
+     */
+    boost::mutex writer_mutex_;
+    /**
+     * @brief Publish latency of the last update in microseconds
+     *
+     * written by the writer holding writer_mutex_, read by anyone
+     */
+    boost::atomic<double> last_publish_us_;
+    /**
+     * @brief Number of threads for computing the inflated layers
      */
-    boost::unordered_set<Cell, boost::hash<Cell> > obstacles_;
+    int num_threads_;
+    bool verbose_;
 };
 
 ostream& operator<<(ostream& os, const Environment& env);
@@ -5,8 +5,10 @@
 #include <vector>
 
 #include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "navi_example/Environment.h"
+#include "navi_example/QueryStats.h"
 
 using namespace std;
 
@@ -61,15 +63,65 @@ class Graph{
   public:
     typedef boost::shared_ptr<Graph> Ptr;
     typedef boost::shared_ptr<const Graph> ConstPtr;
-     
+
+    /**
+     * @brief how edge and heuristic costs are computed
+     */
+    enum CostMode{
+        /**
+         * @brief euclidean costs, sqrt(2) per diagonal step and euclidean heuristic
+         */
+        FLOATING_POINT,
+        /**
+         * @brief octile costs scaled to integers, STRAIGHT_COST and DIAGONAL_COST per step
+         * and octile heuristic. Every g and h value is then a whole number.
+         */
+        FIXED_POINT
+    };
+    /**
+     * @brief cost of a horizontal or vertical step in FIXED_POINT mode
+     */
+    static const int STRAIGHT_COST = 1000;
+    /**
+     * @brief cost of a diagonal step in FIXED_POINT mode
+     */
+    static const int DIAGONAL_COST = 1414;
+
     /**
      * @brief Constructor for Graph that takes in an environment pointer
+     *
+     * The start and goal of the search are taken from the environment
      */
     Graph(Environment::Ptr env);
+    /**
+     * @brief Constructor for Graph that searches between the given cells
+     * instead of the start and goal stored in the environment
+     * @param env Environment pointer
+     * @param start the cell the search starts from
+     * @param goal the cell the search terminates at
+     */
+    Graph(Environment::Ptr env, const Cell& start, const Cell& goal);
+    /**
+     * @brief sets how costs are computed; must be called before planning
+     * @param mode the cost mode
+     */
+    void setCostMode(CostMode mode);
+    /**
+     * @brief getter for the cost mode
+     * @return the cost mode
+     */
+    CostMode getCostMode() const;
+    /**
+     * @brief gets the cost of a single step along a direction
+     * @param dir the direction of the step
+     * @return the step cost in the current cost mode
+     */
+    double getStepCost(const Direction& dir) const;
     /**
      * @brief gets the heuristic cost to the goal from the current state
      *
-     * Uses euclidean distance between the coordinates of current and goal state
+     * Uses euclidean distance between the coordinates of current and goal state,
+     * or octile distance in FIXED_POINT mode
      * @param state current state pointer
      * @return heuristic cost to the goal state
      */
@@ -142,6 +194,13 @@ class Graph{
      * @return whether it has a forced neighbor
      */
     bool hasForced (const GraphState::Ptr& state, const Direction& dir);
+    /**
+     * @brief checks if a cell and direction have a forced neighbor
+     * @param cell current cell
+     * @param dir direction heading in
+     * @return whether it has a forced neighbor
+     */
+    bool hasForced (const Cell& cell, const Direction& dir) const;
     /**
      * @brief checks if the current state and direction have a forced neighbor and records them if able
      * @param state current state
@@ -162,13 +221,187 @@ class Graph{
      * @return pointer to the start state
      */
     GraphState::Ptr getStart();
+    /**
+     * @brief gets the map version this graph searches
+     *
+     * captured when the graph is constructed, so map updates published
+     * during a search do not affect it
+     * @return the snapshot used for collision checking
+     */
+    MapSnapshot::ConstPtr getSnapshot() const;
+    /**
+     * @brief sets the robot radius used for collision checking
+     *
+     * the snapshot must have an inflated layer for the radius,
+     * see Environment::setClearanceRadii()
+     * @param radius the robot radius in cells, 0 for a single cell robot
+     * @return false if no layer exists for the radius
+     */
+    bool setRadius(int radius);
+    /**
+     * @brief checks in constant time whether the goal can be reached at all
+     *
+     * uses the connected components of the snapshot, so a walled off or
+     * occupied goal is rejected without searching
+     * @return false only if no path from start to goal exists
+     */
+    bool isGoalReachable() const;
+    /**
+     * @brief confines the search to a box of cells
+     *
+     * the cells just outside the box are treated as occupied, so no jump
+     * leaves it; start and goal must lie inside the box
+     * @param min_cell lowest corner of the box
+     * @param max_cell highest corner of the box
+     */
+    void setBounds(const Cell& min_cell, const Cell& max_cell);
   private:
+    /**
+     * @brief jumps horizontally or vertically from a cell, see jumpHorizontallyVertically()
+     *
+     * Skips every stretch where the line and its two neighbouring lines are
+     * free at once, a word of 64 cells at a time and a whole run of absent
+     * tiles in one lookup. Only cells next to an obstacle are looked at
+     * one by one. Outside the obstacle bounding box only the goal can stop it.
+     * @param from the cell to jump from
+     * @param dir horizontal or vertical unit direction
+     * @param start_flag whether from is the first step in the jump search
+     * @param jump the jump point found
+     * @param steps number of steps from the cell to the jump point
+     * @return whether a jump point was found
+     */
+    bool jumpStraight(const Cell& from, const Direction& dir, bool start_flag, Cell& jump, int& steps) const;
+    /**
+     * @brief finds the next obstacle on a line or either line next to it
+     * @param line the row (or column if vertical) scanned
+     * @param from the first position along the line to look at
+     * @param step 1 or -1, the direction along the line
+     * @param vertical whether the line is a column
+     * @param found the position of the nearest obstacle
+     * @return false if there are no more obstacles that way
+     */
+    bool nextObstacleNear(int line, int from, int step, bool vertical, int& found) const;
+    /**
+     * @brief finds the nearest tile with obstacles on a line or either line next to it
+     * @param line the row (or column if vertical) scanned
+     * @param tile the first tile along the line to look at
+     * @param step 1 or -1, the direction along the line
+     * @param vertical whether the line is a column
+     * @param present the tile found
+     * @return false if there are no more tiles with obstacles that way
+     */
+    bool nextPresentTile(int line, int tile, int step, bool vertical, int& present) const;
+    /**
+     * @brief occupancy bits of one row, or one column if vertical, within one tile
+     */
+    boost::uint64_t lineBits(int line, int tile, bool vertical) const {
+        const ObstacleTile* obstacles = findTile(
+            vertical ? Cell(line >> ObstacleTile::BITS, tile) : Cell(tile, line >> ObstacleTile::BITS));
+        if(!obstacles)
+            return 0;
+        return vertical ? obstacles->columns[line & (ObstacleTile::SIZE-1)] : obstacles->rows[line & (ObstacleTile::SIZE-1)];
+    }
+    /**
+     * @brief gets the tile for the robot radius, NULL if it has no obstacles
+     */
+    const ObstacleTile* findTile(const Cell& tile) const {
+        if(!fence_.empty()){
+            MapSnapshot::TileMap::const_iterator fence_it = fence_.find(tile);
+            if(fence_it != fence_.end())
+                return fence_it->second.get();
+        }
+        const ObstacleTile::ConstPtr& obstacles = blocked_->find(tile);
+        if(obstacles)
+            return obstacles.get();
+        return store_ ? faultTile(tile) : NULL;
+    }
+    /**
+     * @brief reads a tile of a lazily loaded map and keeps it for the rest of the search
+     */
+    const ObstacleTile* faultTile(const Cell& tile) const;
+    /**
+     * @brief recomputes the bounding box of the obstacles in blocked_, and the fence if bounded
+     */
+    void updateBounds();
+    /**
+     * @brief fills fence_ with the tiles of blocked_ along the edge of the box, walled in
+     */
+    void buildFence();
+    /**
+     * @brief fills row_tiles_ and column_tiles_ from blocked_ and fence_
+     */
+    void indexTiles();
+    /**
+     * @brief checks a cell against the layer for the robot radius
+     */
+    bool isFree(const Cell& cell) const {
+        NAVI_COUNT(COLLISION_CHECKS);
+        const ObstacleTile* tile = findTile(MapSnapshot::tileOf(cell));
+        return !tile || !((tile->rows[cell.y & (ObstacleTile::SIZE-1)] >> (cell.x & (ObstacleTile::SIZE-1))) & 1);
+    }
     /**
      * @brief Pointer to real world environment object
      *
      * used for collision checking generated GraphState
      */
     Environment::Ptr env_;
+    /**
+     * @brief Obstacles as they were when the graph was constructed
+     */
+    MapSnapshot::ConstPtr snapshot_;
+    /**
+     * @brief Occupancy for the robot radius, owned by snapshot_
+     */
+    const TileTable* blocked_;
+    /**
+     * @brief tile file of a lazily loaded map, empty if every tile is in memory
+     */
+    boost::shared_ptr<TileStore> store_;
+    /**
+     * @brief tiles read from store_ so far, pinned until the graph is destroyed
+     *
+     * holds empty pointers for tiles known to have no obstacles
+     */
+    mutable MapSnapshot::TileMap faulted_;
+    /**
+     * @brief bounding box of the tiles in blocked_, empty if min_tile_ > max_tile_
+     */
+    Cell min_tile_;
+    Cell max_tile_;
+    /**
+     * @brief whether the search is confined to the box from min_cell_ to max_cell_
+     */
+    bool bounded_;
+    Cell min_cell_;
+    Cell max_cell_;
+    /**
+     * @brief copies of the tiles the wall around the box runs through, looked up before blocked_
+     */
+    MapSnapshot::TileMap fence_;
+    /**
+     * @brief sorted tile x of the tiles in blocked_ and fence_ by tile y, and tile y by tile x
+     *
+     * lets straight jumps step over absent tiles; not kept for a lazily loaded
+     * map, whose tiles are only known once read
+     */
+    boost::unordered_map<int, vector<int> > row_tiles_;
+    boost::unordered_map<int, vector<int> > column_tiles_;
+    /**
+     * @brief robot radius in cells
+     */
+    int radius_;
+    /**
+     * @brief the cell the search starts from
+     */
+    Cell start_;
+    /**
+     * @brief the cell the search terminates at
+     */
+    Cell goal_;
+    /**
+     * @brief how costs are computed
+     */
+    CostMode cost_mode_;
     bool verbose;
 };
 
@@ -0,0 +1,268 @@
+#ifndef GRID_PLANNER_H
+#define GRID_PLANNER_H
+
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "navi_example/Cell.h"
+#include "navi_example/MapSnapshot.h"
+#include "navi_example/Path.h"
+#include "navi_example/QueryStats.h"
+
+using namespace std;
+
+/**
+ * @brief Jump Point Search on a dense grid covering a bounded map
+ *
+ * The counterpart of Graph and Planner for maps that fit in a fixed size
+ * grid: cells are numbered densely, so occupancy, g values, parents and
+ * the closed set are arrays indexed by cell instead of hash tables of
+ * shared states. Paths never need to leave the bounding box of the
+ * obstacles and the ends by more than one cell, but a diagonal jump only
+ * reports a turn after stepping one cell past it, so the grid covers that
+ * box plus a free ring two cells wide, and everything beyond is walled
+ * off by a border of occupied cells rather than by bounds checks.
+ *
+ * The grid size is a template parameter of FixedGridPlanner; create()
+ * picks the smallest size the map fits in. Maps that fit none are left to
+ * Planner.
+ */
+class GridPlanner{
+  public:
+    typedef boost::shared_ptr<GridPlanner> Ptr;
+    typedef boost::shared_ptr<const GridPlanner> ConstPtr;
+
+    /**
+     * @brief largest grid side a planner is instantiated for
+     */
+    static const int MAX_SIDE = 2048;
+
+    virtual ~GridPlanner() {}
+    /**
+     * @brief makes a planner for the obstacles of a snapshot, if the map is small enough
+     *
+     * A map backed by a tile file is first sized by its tile index, and
+     * its tiles are only read when that box fits MAX_SIDE.
+     * @param snapshot the obstacles
+     * @param radius the robot radius; the snapshot must have a layer for it
+     * @param start a cell queries will start from, kept inside the grid
+     * @param goal a cell queries will end at, kept inside the grid
+     * @return the planner, or an empty pointer if the map exceeds MAX_SIDE or has no layer for the radius
+     */
+    static Ptr create(const MapSnapshot& snapshot, int radius, const Cell& start, const Cell& goal);
+    /**
+     * @brief plans from start to goal
+     *
+     * costs and paths are those of Planner with FLOATING_POINT costs: the
+     * path has the same cost, though it may be another one of equal cost
+     * @param start the cell to start from
+     * @param goal the cell to reach
+     * @param path the jump points of the path from start to goal
+     * @return whether a path was found; false as well if either end lies outside the grid
+     */
+    virtual bool plan(const Cell& start, const Cell& goal, Path& path) = 0;
+    /**
+     * @brief gets how many states the last search expanded
+     */
+    virtual size_t getNumExpansions() const = 0;
+    /**
+     * @brief records the cell of every state expanded by plan()
+     * @param expanded appended to in expansion order, or NULL to stop recording
+     */
+    virtual void setExpansionLog(vector<Cell>* expanded) = 0;
+    /**
+     * @brief gets the side of the grid, the template size picked by create()
+     */
+    virtual int getSide() const = 0;
+    /**
+     * @brief getters for the corners of the map cells the grid covers
+     */
+    virtual Cell getMinCell() const = 0;
+    virtual Cell getMaxCell() const = 0;
+  private:
+    /**
+     * @brief checks from the tile index alone whether a map backed by a tile file can fit the grid
+     *
+     * counts whole tiles, so it may turn down a map whose cells would just fit
+     */
+    static bool fitsTileIndex(const MapSnapshot& snapshot, const Cell& start, const Cell& goal);
+};
+
+/**
+ * @brief GridPlanner for maps of up to WIDTH x HEIGHT cells
+ *
+ * All per cell arrays are members sized at compile time, with a one cell
+ * border on every side: neighbours are a constant offset apart and no
+ * step needs a bounds check. The g values and parents are only valid for
+ * cells whose bit is set in seen_, so nothing but the bitsets is cleared
+ * between queries. Objects are large and must be allocated with new,
+ * which create() does.
+ */
+template<int WIDTH, int HEIGHT>
+class FixedGridPlanner : public GridPlanner{
+  public:
+    /**
+     * @brief Constructor that copies the occupancy of the cells from origin on
+     * @param tiles the tiles holding obstacles, of the map or of an inflated layer
+     * @param origin the map cell at the first corner of the grid
+     * @param size the number of map cells covered along x and y, at most WIDTH x HEIGHT
+     */
+    FixedGridPlanner(const vector<pair<Cell, ObstacleTile::ConstPtr> >& tiles, const Cell& origin, const Cell& size);
+    virtual bool plan(const Cell& start, const Cell& goal, Path& path);
+    virtual size_t getNumExpansions() const;
+    virtual void setExpansionLog(vector<Cell>* expanded);
+    virtual int getSide() const;
+    virtual Cell getMinCell() const;
+    virtual Cell getMaxCell() const;
+  private:
+    /**
+     * @brief cells per row and rows, border included
+     */
+    static const int STRIDE = WIDTH + 2;
+    static const int ROWS = HEIGHT + 2;
+    static const int CELLS = STRIDE * ROWS;
+    /**
+     * @brief spare bits before and after the cells of a bitset
+     *
+     * word scans read up to a row and two words past the cell they start
+     * from, either way, which stays inside the padding
+     */
+    static const int PAD = 128;
+    static const int WORDS = (CELLS + 2*PAD)/64 + 1;
+
+    /**
+     * @brief a successor of the state being expanded and the cost of reaching it
+     */
+    struct Successor{
+      boost::int32_t cell;
+      double cost;
+    };
+
+    /**
+     * @brief number of a map cell, which must lie inside the grid
+     */
+    boost::int32_t indexOf(const Cell& cell) const {
+        return (cell.y - origin_.y + 1)*STRIDE + (cell.x - origin_.x + 1);
+    }
+    Cell cellOf(boost::int32_t index) const {
+        return Cell(origin_.x + index % STRIDE - 1, origin_.y + index / STRIDE - 1);
+    }
+    static bool test(const boost::uint64_t* bits, boost::int32_t index){
+        index += PAD;
+        return (bits[index >> 6] >> (index & 63)) & 1;
+    }
+    static void set(boost::uint64_t* bits, boost::int32_t index){
+        index += PAD;
+        bits[index >> 6] |= boost::uint64_t(1) << (index & 63);
+    }
+    bool isBlocked(boost::int32_t index) const {
+        NAVI_COUNT(COLLISION_CHECKS);
+        return test(blocked_, index);
+    }
+    /**
+     * @brief 64 bits of a bitset starting at a bit index
+     */
+    static boost::uint64_t bitsFrom(const boost::uint64_t* bits, boost::int32_t index){
+        index += PAD;
+        int shift = index & 63;
+        boost::uint64_t low = bits[index >> 6] >> shift;
+        return shift ? low | (bits[(index >> 6) + 1] << (64 - shift)) : low;
+    }
+    /**
+     * @brief ors a word into a bitset at a bit index
+     */
+    static void orBits(boost::uint64_t* bits, boost::int32_t index, boost::uint64_t word){
+        index += PAD;
+        int shift = index & 63;
+        bits[index >> 6] |= word << shift;
+        if(shift)
+            bits[(index >> 6) + 1] |= word >> (64 - shift);
+    }
+    /**
+     * @brief finds the next cell of a line that blocks a straight jump or has a forced neighbour
+     * @param bits blocked_ for rows or columns_ for columns
+     * @param line bits between neighbouring lines
+     * @param position bit of the cell the scan starts after
+     * @param step 1 or -1
+     * @return the bit of the cell found; the border guarantees there is one
+     */
+    static boost::int32_t nextCandidate(const boost::uint64_t* bits, int line, boost::int32_t position, int step);
+    /**
+     * @brief checks for a forced neighbour, with the same rules as Graph::hasForced()
+     */
+    bool hasForced(boost::int32_t index, int dx, int dy) const;
+    /**
+     * @brief adds the forced neighbours of a cell as successors, like Graph::getForced()
+     */
+    void addForced(boost::int32_t index, int dx, int dy);
+    /**
+     * @brief jumps straight from a cell, see Graph::jumpHorizontallyVertically()
+     *
+     * Free cells with no obstacle beside them whose next cell is free can
+     * neither block the jump nor have a forced neighbour, so whole words of
+     * such cells are skipped, rows in blocked_ and columns in columns_.
+     * @return the cell jumped to, or -1 if the jump runs into an obstacle
+     */
+    boost::int32_t jumpStraight(boost::int32_t from, int dx, int dy, bool start_flag, int& steps) const;
+    /**
+     * @brief jumps diagonally from a cell, see Graph::jumpDiagonally()
+     * @return the cell jumped to, or -1 if the jump runs into an obstacle
+     */
+    boost::int32_t jumpDiagonal(boost::int32_t from, int dx, int dy, bool start_flag, int& steps) const;
+    /**
+     * @brief adds the successors of a state arrived at along a direction, or all of them for the start
+     */
+    void addSuccessors(boost::int32_t index, int dx, int dy);
+    void addSuccessor(boost::int32_t cell, double cost);
+    double heuristic(boost::int32_t index) const;
+    /**
+     * @brief follows the parents from the goal back to the start
+     */
+    void unwind(Path& path) const;
+    /**
+     * @brief binary heap of the open cells by g+h
+     */
+    void push(boost::int32_t cell, double f);
+    void decrease(boost::int32_t cell, double f);
+    boost::int32_t pop();
+    void siftUp(size_t position);
+
+    /**
+     * @brief the map cell at the first corner of the grid, and the number covered
+     */
+    Cell origin_;
+    Cell size_;
+    Cell goal_;
+    boost::int32_t goal_index_;
+    size_t num_expansions_;
+    vector<Cell>* expansion_log_;
+    vector<Successor> successors_;
+    /**
+     * @brief open cells and their g+h, as a binary heap
+     */
+    vector<pair<double, boost::int32_t> > heap_;
+    /**
+     * @brief occupancy by cell number, the border set
+     */
+    boost::uint64_t blocked_[WORDS];
+    /**
+     * @brief the same bits by column, bit x*ROWS+y for the cell in column x and row y
+     */
+    boost::uint64_t columns_[WORDS];
+    /**
+     * @brief cells whose g and parent are valid in this search, and cells expanded
+     */
+    boost::uint64_t seen_[WORDS];
+    boost::uint64_t closed_[WORDS];
+    double g_[CELLS];
+    boost::int32_t parents_[CELLS];
+    /**
+     * @brief position of every open cell in heap_
+     */
+    boost::int32_t positions_[CELLS];
+};
+
+#endif
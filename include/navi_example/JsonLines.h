@@ -0,0 +1,48 @@
+#ifndef JSON_LINES_H
+#define JSON_LINES_H
+
+#include <string>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include "navi_example/Cell.h"
+
+using namespace std;
+
+/**
+ * @brief Helpers shared by the servers that answer json line requests
+ *
+ * PlanServer and PartitionWorker read one json object per line and answer
+ * each with one line echoing the id of the request.
+ */
+class JsonLines{
+  public:
+    /**
+     * @brief quotes a string for json
+     * @param text the string
+     * @return the string in double quotes, with quotes and backslashes escaped and control characters blanked
+     */
+    static string quote( const string& text );
+    /**
+     * @brief the id of a request as it should be echoed, a number or a quoted string
+     * @param request the parsed request
+     * @return the id as json, null if the request has none
+     */
+    static string formatId( const boost::property_tree::ptree& request );
+    /**
+     * @brief reads an [x, y] pair
+     * @param node the array
+     * @param cell set to the pair if it is one
+     * @return false if the node is not an array of two numbers within the range of int
+     */
+    static bool readCell( const boost::property_tree::ptree& node, Cell& cell );
+    /**
+     * @brief the reply to a request that failed
+     * @param id the id as returned by formatId()
+     * @param error what went wrong
+     * @return the reply line, without the newline
+     */
+    static string errorReply( const string& id, const string& error );
+};
+
+#endif
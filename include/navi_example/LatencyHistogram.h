@@ -0,0 +1,70 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <ostream>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+using namespace std;
+
+/**
+ * @brief Histogram of latencies with a fixed relative precision, HdrHistogram style
+ *
+ * Values below 256 get a bucket each. Above that every power of two is
+ * split into 128 buckets, so a value is known to within 1/128 of itself
+ * whatever its size, in a fixed 60 KB of counts. Recording is a few
+ * instructions and takes no lock, so each thread keeps its own histogram
+ * and they are merged at the end.
+ *
+ * Values are in whatever unit the caller records, microseconds by convention.
+ */
+class LatencyHistogram{
+  public:
+    typedef boost::shared_ptr<LatencyHistogram> Ptr;
+    typedef boost::shared_ptr<const LatencyHistogram> ConstPtr;
+
+    LatencyHistogram();
+    void record( boost::uint64_t value );
+    /**
+     * @brief adds the counts of another histogram
+     */
+    void merge( const LatencyHistogram& other );
+    boost::uint64_t getCount() const;
+    boost::uint64_t getMin() const;
+    boost::uint64_t getMax() const;
+    double getMean() const;
+    /**
+     * @brief the value below which a percentage of the recorded values fall
+     *
+     * exact up to the precision of the bucket, which is reported by its highest value
+     * @param percentile between 0 and 100
+     */
+    boost::uint64_t getValueAtPercentile( double percentile ) const;
+    /**
+     * @brief writes the percentile distribution in the text format of HdrHistogram
+     *
+     * the columns are value, percentile, total count and 1/(1-percentile),
+     * which the HdrHistogram plotter reads directly
+     * @param os where to write
+     * @param unit_scale the values are divided by this, e.g. 1000 for microseconds written as milliseconds
+     */
+    void writePercentiles( ostream& os, double unit_scale ) const;
+  private:
+    enum{ SUB_BITS = 7, SUB_COUNT = 1 << SUB_BITS, NUM_BUCKETS = 2*SUB_COUNT + (64-SUB_BITS-1)*SUB_COUNT };
+
+    static size_t indexOf( boost::uint64_t value );
+    /**
+     * @brief highest value falling into a bucket
+     */
+    static boost::uint64_t highestOf( size_t index );
+
+    vector<boost::uint64_t> counts_;
+    boost::uint64_t count_;
+    boost::uint64_t min_;
+    boost::uint64_t max_;
+    double sum_;
+};
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef MAP_GENERATOR_H
+#define MAP_GENERATOR_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "navi_example/Cell.h"
+#include "navi_example/MapSnapshot.h"
+
+using namespace std;
+
+/**
+ * @brief Seeded generator of synthetic maps of any size
+ *
+ * Maps cover the cells [0,width) x [0,height) inside a one cell border
+ * wall, in one of these styles:
+ * * RANDOM: every cell occupied with the given density, plus an L shaped
+ *   corridor joining start and goal
+ * * MAZE: a perfect maze of corridors one or more cells wide
+ * * ROOMS: square rooms with a door in every wall of a spanning tree of
+ *   the rooms, and in a share of the other walls
+ * * CITY: blocks of buildings on lots with setbacks, some lots empty,
+ *   between a grid of streets
+ *
+ * Start and goal are always joined by free cells. Every cell is a pure
+ * function of the seed and its coordinates, so a map is the same whatever
+ * the number of threads and any tile can be made on its own; rows are
+ * built a span of cells at a time.
+ */
+class MapGenerator{
+  public:
+    typedef boost::shared_ptr<MapGenerator> Ptr;
+    typedef boost::shared_ptr<const MapGenerator> ConstPtr;
+
+    enum Style{ RANDOM, MAZE, ROOMS, CITY };
+
+    struct Options{
+        Style style;
+        int width;
+        int height;
+        boost::uint64_t seed;
+        /**
+         * @brief share of occupied cells of a RANDOM map, in steps of 1/256
+         */
+        double density;
+        /**
+         * @brief width of the corridors of a MAZE
+         */
+        int corridor;
+        /**
+         * @brief inner side of a room, door width, and share of the walls
+         * off the spanning tree that get a door, for ROOMS
+         */
+        int room;
+        int door;
+        double loops;
+        /**
+         * @brief side of a block and width of the streets of a CITY
+         */
+        int block;
+        int street;
+        Options();
+    };
+
+    MapGenerator( const Options& options );
+    /**
+     * @brief parses "random", "maze", "rooms" or "city"
+     * @return whether the name is known
+     */
+    static bool parseStyle( const string& name, Style& style );
+    /**
+     * @brief checks that the sizes fit together, printing what does not
+     */
+    bool isValid() const;
+    Cell getStart() const;
+    Cell getGoal() const;
+    /**
+     * @brief number of tiles along x and y
+     */
+    Cell getNumTiles() const;
+    /**
+     * @brief fills in one tile, rows and columns
+     * @param tile tile coordinates
+     * @param obstacles the tile to fill
+     * @return whether any cell of it is occupied
+     */
+    bool generateTile( const Cell& tile, ObstacleTile& obstacles ) const;
+    /**
+     * @brief makes every non-empty tile, a band of tile rows per thread
+     * @param threads number of threads
+     * @param tiles map the tiles are added to
+     */
+    void generate( int threads, MapSnapshot::TileMap& tiles ) const;
+    /**
+     * @brief writes the map in the json format of the data sets
+     *
+     * threads format one tile row each, which are written in order, so
+     * the whole map is never held in memory
+     * @param path the file to write
+     * @param threads number of threads
+     * @param obstacles set to the number of obstacles written
+     * @return whether the file was written
+     */
+    bool writeJson( const string& path, int threads, size_t& obstacles ) const;
+  private:
+    /**
+     * @brief occupancy of the cells [x0,x0+64) of row y, bit i for cell x0+i
+     */
+    boost::uint64_t generateRow( int y, int x0 ) const;
+    boost::uint64_t randomRow( int y, int x0 ) const;
+    /**
+     * @brief MAZE and ROOMS: cells of side pitch-1 behind walls with doors
+     */
+    boost::uint64_t gridRow( int y, int x0 ) const;
+    boost::uint64_t cityRow( int y, int x0 ) const;
+    /**
+     * @brief whether the wall between grid cell (i,j) and its west, or south, neighbour has a door
+     * @param opens_east the random choice of that neighbour, ignored at the edges of the grid
+     */
+    bool hasDoor( int i, int j, bool west, bool opens_east ) const;
+    /**
+     * @brief where the door of that wall starts, counted from the corner
+     */
+    int doorOffset( int i, int j, bool west ) const;
+    /**
+     * @brief a random word for some coordinates and a salt
+     */
+    boost::uint64_t hash( boost::int64_t x, boost::int64_t y, boost::uint64_t salt ) const;
+    /**
+     * @brief makes the non-empty tiles of every step-th tile row from first
+     */
+    void generateBand( int first, int step, vector<pair<Cell, ObstacleTile::ConstPtr> >* tiles ) const;
+    /**
+     * @brief formats the obstacles of one tile row as json pairs joined by commas
+     */
+    void formatTileRow( int ty, string* text, size_t* count ) const;
+
+    Options options_;
+    Cell start_;
+    Cell goal_;
+    /**
+     * @brief grid cell side, wall included, and width of a door, for MAZE and ROOMS
+     */
+    int pitch_;
+    int door_;
+    /**
+     * @brief number of grid cells along x and y
+     */
+    int cells_x_;
+    int cells_y_;
+};
+
+#endif
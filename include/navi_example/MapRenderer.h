@@ -0,0 +1,111 @@
+#ifndef MAP_RENDERER_H
+#define MAP_RENDERER_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "navi_example/Cell.h"
+#include "navi_example/MapSnapshot.h"
+#include "navi_example/Path.h"
+
+using namespace std;
+
+/**
+ * @brief Draws a map, a path and the states a search expanded into an image
+ *
+ * The window of cells is scaled down to fit the image, so one pixel may
+ * cover a square of several cells. Each layer is counted per pixel and
+ * only turned into colors when the image is written:
+ * * obstacles in gray, darker the more of the pixel's cells are occupied
+ * * expanded states as a yellow to red heat map, on a log scale
+ * * the path in blue, its jump points in magenta, start in green and goal in red
+ *
+ * +y points up in the image. Files ending in .pgm are written as a gray
+ * image, .png as an uncompressed png, anything else as a color ppm.
+ */
+class MapRenderer{
+  public:
+    typedef boost::shared_ptr<MapRenderer> Ptr;
+    typedef boost::shared_ptr<const MapRenderer> ConstPtr;
+
+    /**
+     * @brief Constructor
+     * @param min_cell lowest corner of the window to draw
+     * @param max_cell highest corner of the window to draw
+     * @param max_pixels the longer side of the image is at most this many pixels
+     */
+    MapRenderer( const Cell& min_cell, const Cell& max_cell, int max_pixels );
+    /**
+     * @brief finds a window holding the obstacles, the path and its ends
+     * @param snapshot the obstacles
+     * @param path the path, may be empty
+     * @param start the start cell
+     * @param goal the goal cell
+     * @return the lowest and the highest corner, with a small margin
+     */
+    static pair<Cell, Cell> findWindow( const MapSnapshot& snapshot, const Path& path, const Cell& start, const Cell& goal );
+    /**
+     * @brief counts the obstacles of every pixel
+     *
+     * the image is split into bands of rows, one per thread
+     * @param snapshot the obstacles
+     * @param threads number of threads
+     */
+    void addObstacles( const MapSnapshot& snapshot, int threads );
+    /**
+     * @brief counts the expanded states of every pixel
+     * @param expanded the cells of the expanded states
+     * @see Planner::setExpansionLog()
+     */
+    void addExpansions( const vector<Cell>& expanded );
+    /**
+     * @brief draws a path with its jump points and its ends
+     * @param path the path
+     */
+    void addPath( const Path& path );
+    /**
+     * @brief marks the start and goal
+     */
+    void addEnds( const Cell& start, const Cell& goal );
+    /**
+     * @brief writes the image
+     * @param filename the file, its extension picks the format
+     * @return whether the file was written
+     */
+    bool write( const string& filename ) const;
+    int getWidth() const;
+    int getHeight() const;
+    /**
+     * @brief side of the square of cells covered by one pixel
+     */
+    int getCellsPerPixel() const;
+  private:
+    enum Mark{ NONE, PATH, JUMP_POINT, START, GOAL };
+
+    bool toPixel( const Cell& cell, int& px, int& py ) const;
+    /**
+     * @brief counts obstacles falling in image rows [begin,end)
+     */
+    void countObstacles( const vector<pair<Cell, ObstacleTile::ConstPtr> >* tiles, int begin, int end );
+    void mark( const Cell& cell, Mark type, int radius );
+    /**
+     * @brief blends the layers into 8 bit rgb pixels, row by row from the top
+     */
+    void compose( vector<unsigned char>& rgb ) const;
+    static bool writePng( const string& filename, int width, int height, const vector<unsigned char>& rgb );
+
+    Cell min_cell_;
+    Cell max_cell_;
+    int scale_;
+    int width_;
+    int height_;
+    vector<boost::uint32_t> obstacles_;
+    vector<boost::uint32_t> expansions_;
+    vector<unsigned char> marks_;
+};
+
+#endif
@@ -0,0 +1,404 @@
+#ifndef MAP_SNAPSHOT_H
+#define MAP_SNAPSHOT_H
+
+#include <vector>
+
+#include <boost/chrono.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "navi_example/Cell.h"
+
+using namespace std;
+
+class ConnectivityIndex;
+class TileStore;
+
+/**
+ * @brief Square block of the grid stored as an occupancy bitmap
+ *
+ * Bit x of rows[y] is set when the cell at (x,y) within the tile is occupied.
+ * Code changing rows must call updateColumns() before the tile is shared.
+ */
+struct ObstacleTile{
+  typedef boost::shared_ptr<ObstacleTile> Ptr;
+  typedef boost::shared_ptr<const ObstacleTile> ConstPtr;
+  /**
+   * @brief log2 of the tile side length
+   */
+  static const int BITS = 6;
+  /**
+   * @brief tile side length in cells
+   */
+  static const int SIZE = 1 << BITS;
+  /**
+   * @brief one word of occupancy bits per row
+   */
+  boost::uint64_t rows[SIZE];
+  /**
+   * @brief the same bits transposed, bit y of columns[x] is cell (x,y)
+   *
+   * lets vertical scans test a whole column word at a time
+   */
+  boost::uint64_t columns[SIZE];
+  /**
+   * @brief Empty constructor, all cells free
+   */
+  ObstacleTile();
+  /**
+   * @brief check if no cell of the tile is occupied
+   * @return verity of whether the tile is empty
+   */
+  bool empty() const;
+  /**
+   * @brief recomputes columns from rows, after rows were changed
+   */
+  void updateColumns();
+  /**
+   * @brief lists the occupied cells of the tile
+   * @param tile coordinates of this tile
+   * @param cells vector the occupied cells are appended to
+   */
+  void appendCells( const Cell& tile, vector<Cell>& cells ) const;
+};
+
+/**
+ * @brief Tiles keyed by tile coordinates, grouped into shared buckets
+ *
+ * Each bucket holds a square block of BUCKET_SIZE tiles a side. Copying the
+ * table only copies the bucket pointers; the first change to a bucket the
+ * copy shares with another table copies that one bucket. So a snapshot
+ * derived from another costs its number of buckets plus the buckets it
+ * touches, not its number of tiles.
+ */
+class TileTable{
+  public:
+    /**
+     * @brief log2 of the bucket side length in tiles
+     */
+    static const int BUCKET_BITS = 3;
+    /**
+     * @brief bucket side length in tiles
+     */
+    static const int BUCKET_SIZE = 1 << BUCKET_BITS;
+    typedef pair<Cell, ObstacleTile::ConstPtr> value_type;
+  private:
+    struct Bucket{
+      typedef boost::shared_ptr<Bucket> Ptr;
+      Bucket() : count(0) {}
+      /**
+       * @brief the tiles indexed by y*BUCKET_SIZE+x within the bucket, empty pointers for no tile
+       */
+      ObstacleTile::ConstPtr tiles[BUCKET_SIZE*BUCKET_SIZE];
+      /**
+       * @brief number of tiles set
+       */
+      int count;
+    };
+    typedef boost::unordered_map<Cell, Bucket::Ptr> BucketMap;
+  public:
+    /**
+     * @brief Walks the tiles of a table, bucket by bucket
+     */
+    class const_iterator{
+      public:
+        const_iterator() : slot_(0) {}
+        const value_type& operator*() const { return current_; }
+        const value_type* operator->() const { return &current_; }
+        const_iterator& operator++(){
+            slot_++;
+            advance();
+            return *this;
+        }
+        bool operator==( const const_iterator& other ) const {
+            return bucket_it_ == other.bucket_it_ && slot_ == other.slot_;
+        }
+        bool operator!=( const const_iterator& other ) const {
+            return !(*this == other);
+        }
+      private:
+        friend class TileTable;
+        const_iterator( BucketMap::const_iterator bucket_it, BucketMap::const_iterator end ) :
+            bucket_it_(bucket_it), end_(end), slot_(0) { advance(); }
+        /**
+         * @brief moves to the first tile at or after slot_, or to the end
+         */
+        void advance();
+        BucketMap::const_iterator bucket_it_;
+        BucketMap::const_iterator end_;
+        int slot_;
+        value_type current_;
+    };
+
+    /**
+     * @brief Empty constructor, no tiles
+     */
+    TileTable() : size_(0) {}
+    /**
+     * @brief Constructor from tiles built elsewhere
+     * @param tiles the tiles keyed by tile coordinates
+     */
+    explicit TileTable( const boost::unordered_map<Cell, ObstacleTile::ConstPtr>& tiles );
+    /**
+     * @brief gets a tile
+     * @param tile tile coordinates
+     * @return the tile, or an empty pointer if there is none
+     */
+    const ObstacleTile::ConstPtr& find( const Cell& tile ) const {
+        BucketMap::const_iterator bucket_it = buckets_.find( bucketOf(tile) );
+        if(bucket_it == buckets_.end())
+            return NONE;
+        return bucket_it->second->tiles[slotOf(tile)];
+    }
+    /**
+     * @brief stores a tile, copying its bucket first if another table shares it
+     * @param tile tile coordinates
+     * @param obstacles the tile; an empty pointer removes it
+     */
+    void set( const Cell& tile, const ObstacleTile::ConstPtr& obstacles );
+    /**
+     * @brief removes a tile, copying its bucket first if another table shares it
+     * @param tile tile coordinates
+     */
+    void erase( const Cell& tile ){
+        set(tile, ObstacleTile::ConstPtr());
+    }
+    /**
+     * @brief getter for the number of tiles
+     * @return the number of tiles set
+     */
+    size_t size() const {
+        return size_;
+    }
+    bool empty() const {
+        return size_ == 0;
+    }
+    const_iterator begin() const {
+        return const_iterator(buckets_.begin(), buckets_.end());
+    }
+    const_iterator end() const {
+        return const_iterator(buckets_.end(), buckets_.end());
+    }
+  private:
+    static Cell bucketOf( const Cell& tile ){
+        return Cell(tile.x >> BUCKET_BITS, tile.y >> BUCKET_BITS);
+    }
+    static int slotOf( const Cell& tile ){
+        return ((tile.y & (BUCKET_SIZE-1)) << BUCKET_BITS) + (tile.x & (BUCKET_SIZE-1));
+    }
+    /**
+     * @brief what find() returns for a missing tile
+     */
+    static const ObstacleTile::ConstPtr NONE;
+    /**
+     * @brief the non-empty buckets keyed by bucket coordinates
+     */
+    BucketMap buckets_;
+    /**
+     * @brief number of tiles set
+     */
+    size_t size_;
+};
+
+/**
+ * @brief Immutable, versioned view of the obstacles
+ *
+ * The grid is split into ObstacleTile blocks and only tiles that contain an
+ * obstacle are stored. A snapshot never changes once published, so any
+ * number of threads may read it without locking. Updates produce a new
+ * snapshot that shares every untouched tile with the previous one and
+ * copies only the tiles the update touches, and the TileTable buckets
+ * holding them.
+ */
+class MapSnapshot{
+  public:
+    typedef boost::shared_ptr<MapSnapshot> Ptr;
+    typedef boost::shared_ptr<const MapSnapshot> ConstPtr;
+    typedef boost::unordered_map<Cell, ObstacleTile::ConstPtr> TileMap;
+    typedef boost::chrono::steady_clock Clock;
+
+    /**
+     * @brief Empty constructor, creates version 0 with no obstacles
+     */
+    MapSnapshot();
+    /**
+     * @brief Constructor for a new map at a given version
+     *
+     * used to replace all obstacles while keeping versions increasing
+     * @param version the version of the new map
+     * @param store tile file the obstacles are read from on demand, or empty for no obstacles
+     */
+    explicit MapSnapshot( size_t version, boost::shared_ptr<TileStore> store = boost::shared_ptr<TileStore>() );
+    /**
+     * @brief Constructor for a new map from tiles built elsewhere
+     * @param version the version of the new map
+     * @param tiles the obstacle tiles, with their columns filled in
+     */
+    MapSnapshot( size_t version, const TileMap& tiles );
+    /**
+     * @brief checks if a given Cell is unoccupied
+     * @param cell Cell to be checked
+     * @return whether it is free
+     */
+    bool isCollisionFree( const Cell& cell ) const {
+        if(!store_)
+            return isFree(tiles_, cell);
+        ObstacleTile::ConstPtr tile = findTile( tileOf(cell) );
+        return !tile || !((tile->rows[cell.y & (ObstacleTile::SIZE-1)] >> (cell.x & (ObstacleTile::SIZE-1))) & 1);
+    }
+    /**
+     * @brief gets the obstacles of one tile, reading it from the tile file if needed
+     * @param tile tile coordinates
+     * @return the tile, or an empty pointer if it has no obstacles
+     */
+    ObstacleTile::ConstPtr findTile( const Cell& tile ) const;
+    /**
+     * @brief lists every tile with obstacles, reading all of a tile file if needed
+     * @param tiles vector the tile coordinates and tiles are appended to
+     */
+    void collectTiles( vector<pair<Cell, ObstacleTile::ConstPtr> >& tiles ) const;
+    /**
+     * @brief getter for the tile file backing this map
+     * @return the store, or an empty pointer if every tile is in memory
+     */
+    boost::shared_ptr<TileStore> getStore() const;
+    /**
+     * @brief checks if a given Cell is unoccupied in a set of tiles
+     * @param tiles the obstacles or one of the inflated layers
+     * @param cell Cell to be checked
+     * @return whether it is free
+     */
+    static bool isFree( const TileTable& tiles, const Cell& cell ){
+        const ObstacleTile::ConstPtr& tile = tiles.find( tileOf(cell) );
+        return !tile || !((tile->rows[cell.y & (ObstacleTile::SIZE-1)] >> (cell.x & (ObstacleTile::SIZE-1))) & 1);
+    }
+    /**
+     * @brief creates the next version of the map
+     *
+     * Tiles and buckets the update does not touch are shared with this
+     * snapshot. The inflated layers are shared unchanged; see updateClearance().
+     * @param add cells that become occupied
+     * @param remove cells that become free
+     * @param submitted when the update was requested, for measuring visibility latency
+     * @return the new snapshot, which may still be modified until it is published
+     */
+    Ptr applyDelta( const vector<Cell>& add, const vector<Cell>& remove, Clock::time_point submitted ) const;
+    /**
+     * @brief gets the occupancy for a robot of a given radius
+     *
+     * A cell is occupied for a robot of radius r if an obstacle lies within
+     * euclidean distance r of it. Radius 0 is the obstacles themselves.
+     * @param radius the robot radius in cells
+     * @return the inflated tiles, or NULL if the radius was not computed
+     */
+    const TileTable* getLayer( int radius ) const;
+    /**
+     * @brief getter for the radii with inflated layers
+     * @return the radii passed to setRadii()
+     */
+    const vector<int>& getRadii() const;
+    /**
+     * @brief computes the inflated layers for a set of robot radii from scratch
+     *
+     * Must only be called before the snapshot is published. Maps backed
+     * by a tile file get no layers, since that would read the whole file.
+     * @param radii the robot radii in cells
+     * @param threads number of threads for the distance transform
+     */
+    void setRadii( const vector<int>& radii, int threads );
+    /**
+     * @brief recomputes the inflated layers around changed cells
+     *
+     * Runs one distance transform per block of tiles near an obstacle, so
+     * the memory it takes does not grow with the empty space between
+     * obstacles. Must only be called before the snapshot is published.
+     * @param min_cell lowest corner of the box containing the changed cells
+     * @param max_cell highest corner of the box containing the changed cells
+     * @param threads number of threads for the distance transform
+     */
+    void updateClearance( const Cell& min_cell, const Cell& max_cell, int threads );
+    /**
+     * @brief gets the connected components of the free space for a robot radius
+     * @param radius the robot radius in cells
+     * @return the index, or NULL if it was not computed for the radius
+     */
+    const ConnectivityIndex* getConnectivity( int radius ) const;
+    /**
+     * @brief brings the connected components of every layer up to date
+     *
+     * reuses the labels of tiles that did not change since the snapshot this
+     * one was derived from. Must only be called before the snapshot is
+     * published. Maps backed by a tile file get no index.
+     * @param threads number of threads for labeling tiles
+     */
+    void updateConnectivity( int threads );
+    /**
+     * @brief gets the coordinates of the tile a cell falls in
+     * @param cell the cell
+     * @return the tile coordinates
+     */
+    static Cell tileOf( const Cell& cell ){
+        return Cell(cell.x >> ObstacleTile::BITS, cell.y >> ObstacleTile::BITS);
+    }
+    /**
+     * @brief getter for the map version
+     * @return the version, incremented by every update
+     */
+    size_t getVersion() const;
+    /**
+     * @brief getter for the number of occupied cells
+     *
+     * for a map backed by a tile file, only counts changes made since it was loaded
+     * @return the number of obstacles
+     */
+    size_t getNumObstacles() const;
+    /**
+     * @brief getter for the stored tiles
+     *
+     * for a map backed by a tile file, only the tiles changed since it was
+     * loaded; those may be empty, to hide the tile in the file
+     * @return the tiles in memory keyed by tile coordinates
+     */
+    const TileTable& getTiles() const;
+    /**
+     * @brief gets when the update that produced this snapshot was requested
+     * @return the submission time of the update
+     */
+    Clock::time_point getSubmitTime() const;
+  private:
+    /**
+     * @brief the non-empty tiles keyed by tile coordinates, or the changed tiles over store_
+     */
+    TileTable tiles_;
+    /**
+     * @brief tile file holding the tiles not in tiles_
+     */
+    boost::shared_ptr<TileStore> store_;
+    /**
+     * @brief robot radii with an inflated layer
+     */
+    vector<int> radii_;
+    /**
+     * @brief the inflated tiles keyed by robot radius
+     */
+    boost::unordered_map<int, TileTable> layers_;
+    /**
+     * @brief connected components keyed by robot radius
+     */
+    boost::unordered_map<int, boost::shared_ptr<const ConnectivityIndex> > connectivity_;
+    /**
+     * @brief map version
+     */
+    size_t version_;
+    /**
+     * @brief number of occupied cells
+     */
+    size_t num_obstacles_;
+    /**
+     * @brief when the update that produced this snapshot was requested
+     */
+    Clock::time_point submitted_;
+};
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef OPEN_LIST_H
+#define OPEN_LIST_H
+
+#include <vector>
+#include <utility>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "navi_example/SearchState.h"
+
+using namespace std;
+
+/**
+ * @brief Interface for the priority queue of states waiting to be expanded
+ *
+ * States are ordered by g+h, smallest first.
+ */
+class OpenList{
+  public:
+    typedef boost::shared_ptr<OpenList> Ptr;
+    typedef boost::shared_ptr<const OpenList> ConstPtr;
+
+    virtual ~OpenList() {}
+    /**
+     * @brief adds a state that is not yet on the open list
+     * @param state the state to add
+     */
+    virtual void push(const SearchState::Ptr& state) = 0;
+    /**
+     * @brief removes and returns the state with the smallest g+h
+     * @return the state to expand next
+     */
+    virtual SearchState::Ptr pop() = 0;
+    /**
+     * @brief tells the open list that the g value of a state on it went down
+     * @param state the state whose g value was lowered
+     */
+    virtual void decreaseKey(const SearchState::Ptr& state) = 0;
+    /**
+     * @brief removes and returns the state with the largest g+h
+     *
+     * used by memory-bounded search to drop the least promising state
+     * @return the removed state
+     */
+    virtual SearchState::Ptr removeWorst() = 0;
+    /**
+     * @brief check if there are states left to expand
+     * @return verity of whether the open list is empty
+     */
+    virtual bool empty() const = 0;
+    /**
+     * @brief gets the number of states on the open list
+     * @return the number of states
+     */
+    virtual size_t size() const = 0;
+};
+
+/**
+ * @brief Binary heap open list on an STL vector
+ *
+ * makes use of std::make_heap, std::push_heap, and std::pop_heap
+ * for standard heap operations. Works with any cost mode.
+ */
+class BinaryHeapOpenList : public OpenList{
+  public:
+    void push(const SearchState::Ptr& state);
+    SearchState::Ptr pop();
+    /**
+     * @brief restores the heap property after a key changed, O(n)
+     */
+    void decreaseKey(const SearchState::Ptr& state);
+    /**
+     * @brief scans the leaves of the heap for the largest key, O(n)
+     */
+    SearchState::Ptr removeWorst();
+    bool empty() const;
+    size_t size() const;
+  private:
+    /**
+     * @brief heap data structure using STL vector
+     */
+    vector<SearchState::Ptr> heap_;
+};
+
+/**
+ * @brief Monotone radix heap open list for integer keys
+ *
+ * Requires every g+h to be a whole number and the popped keys to never
+ * decrease, which holds for Graph::FIXED_POINT costs with its consistent
+ * octile heuristic. Push is O(1) and pop is amortized O(1) per bit of the
+ * key, since an entry only ever moves to lower buckets.
+ *
+ * Decrease-key pushes a second entry with the new key; the outdated entry
+ * is recognised on pop because its key no longer matches the state's g+h.
+ */
+class BucketOpenList : public OpenList{
+  public:
+    /**
+     * @brief Empty constructor
+     */
+    BucketOpenList();
+    void push(const SearchState::Ptr& state);
+    SearchState::Ptr pop();
+    /**
+     * @brief pushes the state again with its lowered key, O(1)
+     */
+    void decreaseKey(const SearchState::Ptr& state);
+    /**
+     * @brief scans the highest non-empty bucket for the largest key
+     */
+    SearchState::Ptr removeWorst();
+    bool empty() const;
+    size_t size() const;
+  private:
+    typedef pair<boost::uint64_t, SearchState::Ptr> Entry;
+    /**
+     * @brief gets the integer key of a state
+     */
+    static boost::uint64_t key(const SearchState::Ptr& state);
+    /**
+     * @brief gets the bucket a key belongs in, relative to the last popped key
+     */
+    size_t bucket(boost::uint64_t key) const;
+    /**
+     * @brief adds an entry to its bucket
+     */
+    void insert(const SearchState::Ptr& state);
+
+    /**
+     * @brief bucket i holds keys whose highest bit differing from last_ is bit i-1
+     */
+    vector<Entry> buckets_[65];
+    /**
+     * @brief the last key popped; no smaller key may be pushed
+     */
+    boost::uint64_t last_;
+    /**
+     * @brief number of states on the list, not counting outdated entries
+     */
+    size_t size_;
+};
+
+#endif
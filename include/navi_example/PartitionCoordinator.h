@@ -0,0 +1,157 @@
+#ifndef PARTITION_COORDINATOR_H
+#define PARTITION_COORDINATOR_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "navi_example/Cell.h"
+#include "navi_example/Path.h"
+
+using namespace std;
+
+/**
+ * @brief What the last PartitionCoordinator query did
+ */
+struct PartitionQueryStats{
+  /**
+   * @brief boundary graph nodes expanded by the search
+   */
+  size_t expansions;
+  /**
+   * @brief in-partition segments asked from the workers to build the path
+   */
+  size_t segments;
+  /**
+   * @brief whether the path stayed in one partition and was planned there directly
+   */
+  bool direct;
+  /**
+   * @brief milliseconds spent linking start and goal to their partitions'
+   * transitions, searching the boundary graph and fetching the segments
+   */
+  double ends_ms;
+  double search_ms;
+  double segments_ms;
+  PartitionQueryStats();
+};
+
+ostream& operator<<(ostream& os, const PartitionQueryStats& stats);
+
+/**
+ * @brief Plans across partitions served by PartitionWorker processes
+ *
+ * Holds the boundary graph only: a node per transition cell, with an edge
+ * for every pair of transitions a worker connected inside its partition,
+ * and a step edge across the border between transitions that pair up,
+ * of cost 1 or sqrt(2) for a diagonal one. A query asks the workers owning start and goal for their costs to
+ * their partition's transitions, searches the boundary graph with A*, then
+ * asks the owners of the partitions the path crosses for their segments,
+ * all workers in parallel, and joins them. Like any hierarchical search,
+ * the path may be a little longer than the optimal one, since it can only
+ * cross borders at transitions.
+ *
+ * Not safe to query from several threads.
+ */
+class PartitionCoordinator{
+  public:
+    typedef boost::shared_ptr<PartitionCoordinator> Ptr;
+    typedef boost::shared_ptr<const PartitionCoordinator> ConstPtr;
+
+    PartitionCoordinator();
+    ~PartitionCoordinator();
+    /**
+     * @brief connects to a worker and adds its partition to the boundary graph
+     *
+     * retries until the worker listens, since it only does so once its
+     * distances are computed
+     * @param host name or address of the worker
+     * @param port its port
+     * @param timeout_seconds how long to keep retrying
+     * @return false if the worker could not be reached or answered badly
+     */
+    bool addWorker( const string& host, int port, double timeout_seconds );
+    /**
+     * @brief plans from start to goal
+     * @param start the cell to start from
+     * @param goal the cell to reach
+     * @param path the jump points of the path
+     * @return whether a path was found; false as well if an end lies in no partition
+     */
+    bool plan( const Cell& start, const Cell& goal, Path& path );
+    /**
+     * @brief getter for the statistics of the last plan()
+     */
+    PartitionQueryStats getStats() const;
+    /**
+     * @brief getters for the size of the boundary graph
+     */
+    size_t getNumWorkers() const;
+    size_t getNumNodes() const;
+    size_t getNumEdges() const;
+  private:
+    struct Worker{
+        int fd;
+        /**
+         * @brief bytes read past the last reply
+         */
+        string pending;
+        Cell min_cell;
+        Cell max_cell;
+        /**
+         * @brief the boundary graph node of every transition of the partition
+         */
+        vector<int> nodes;
+    };
+    struct Edge{
+        int to;
+        double cost;
+    };
+    /**
+     * @brief a request to a worker and its reply
+     */
+    struct Call{
+        size_t worker;
+        string request;
+        boost::property_tree::ptree reply;
+        bool ok;
+    };
+
+    /**
+     * @brief sends a request and reads its reply
+     * @return false if the connection broke or the reply is not ok
+     */
+    bool call( Worker& worker, const string& request, boost::property_tree::ptree& reply );
+    /**
+     * @brief makes calls, those of different workers in parallel
+     */
+    void callAll( vector<Call>& calls );
+    /**
+     * @brief makes the calls to one worker in order
+     */
+    void callWorker( size_t worker, vector<Call>* calls );
+    /**
+     * @brief gets the worker whose partition holds a cell, -1 if none
+     */
+    int ownerOf( const Cell& cell ) const;
+    int addNode( const Cell& cell, int worker );
+    void addEdge( int from, int to, double cost );
+
+    vector<Worker> workers_;
+    /**
+     * @brief cell, owning worker and edges of every node
+     */
+    vector<Cell> cells_;
+    vector<int> owners_;
+    vector<vector<Edge> > edges_;
+    boost::unordered_map<Cell, int> node_ids_;
+    size_t num_edges_;
+    size_t next_id_;
+    PartitionQueryStats stats_;
+};
+
+#endif
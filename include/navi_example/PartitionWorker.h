@@ -0,0 +1,182 @@
+#ifndef PARTITION_WORKER_H
+#define PARTITION_WORKER_H
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "navi_example/Cell.h"
+#include "navi_example/ConnectivityIndex.h"
+#include "navi_example/Environment.h"
+#include "navi_example/Path.h"
+
+using namespace std;
+
+/**
+ * @brief A place where paths cross the border of a partition
+ *
+ * inside is the cell of the partition, outside its neighbour across the
+ * border in the next partition, one straight or diagonal step away.
+ */
+struct Transition{
+  Cell inside;
+  Cell outside;
+};
+
+/**
+ * @brief Plans inside one rectangular partition of a map
+ *
+ * The border of the partition is split into entrances, the runs of cells
+ * that are free on both sides of it. An entrance shorter than
+ * ENTRANCE_SPLIT cells gets one transition in its middle, a longer one a
+ * transition at each end and more between them, ENTRANCE_SPACING cells
+ * apart at most, so that paths need not detour to a corner. Both partitions of a border find the same
+ * entrances, so their transitions pair up without talking to each other.
+ * Where the border can only be crossed diagonally, the two cells of the
+ * diagonal step make a transition of their own.
+ * precompute() plans between every two transitions with Planner kept to
+ * the partition (Graph::setBounds), which makes up this partition's share
+ * of the boundary graph PartitionCoordinator searches. The components of
+ * the partition on its own are labeled first, so that no search is spent
+ * proving two transitions apart.
+ *
+ * Loaded from a tile file, a worker only ever reads the tiles of its
+ * partition and the ring of tiles around it, so its memory follows the
+ * partition size rather than the map size.
+ *
+ * Requests and replies are JSON lines over TCP:
+ *
+ *   {"id": 1, "op": "info"}
+ *     {"id": 1, "ok": true, "min": [0, 0], "max": [511, 511],
+ *      "transitions": [[511, 40, 512, 40], ...], "distances": [[0, 1, 37.2132], ...]}
+ *   {"id": 2, "op": "distances", "cell": [10, 20]}
+ *     {"id": 2, "ok": true, "costs": [412.5513, -1, ...]}
+ *   {"id": 3, "op": "segment", "start": [10, 20], "goal": [511, 40]}
+ *     {"id": 3, "ok": true, "cost": 503.1127, "path": [[10, 20], ...]}
+ *
+ * transitions are inside x, y then outside x, y; distances list the
+ * transition pairs i < j connected inside the partition with their cost,
+ * and costs holds one cost per transition, -1 where it cannot be reached.
+ */
+class PartitionWorker{
+  public:
+    typedef boost::shared_ptr<PartitionWorker> Ptr;
+    typedef boost::shared_ptr<const PartitionWorker> ConstPtr;
+
+    /**
+     * @brief entrances at least this long get a transition at both ends
+     */
+    static const int ENTRANCE_SPLIT = 6;
+    /**
+     * @brief the most cells between two transitions of one entrance
+     */
+    static const int ENTRANCE_SPACING = 64;
+
+    /**
+     * @brief Constructor
+     * @param env the map, ideally loaded from a tile file
+     * @param min_cell lowest corner of the partition
+     * @param max_cell highest corner of the partition
+     */
+    PartitionWorker( Environment::Ptr env, const Cell& min_cell, const Cell& max_cell );
+    /**
+     * @brief finds the transitions and plans between every pair of them
+     * @param threads number of threads, each planning from its share of the transitions
+     */
+    void precompute( int threads );
+    /**
+     * @brief finds the transitions on the border of a partition
+     * @param snapshot the obstacles
+     * @param min_cell lowest corner of the partition
+     * @param max_cell highest corner of the partition
+     * @param transitions the straight transitions side by side, then the diagonal ones
+     */
+    static void findTransitions( const MapSnapshot& snapshot, const Cell& min_cell, const Cell& max_cell, vector<Transition>& transitions );
+    /**
+     * @brief getter for the transitions found by precompute()
+     */
+    const vector<Transition>& getTransitions() const;
+    /**
+     * @brief gets the cost between two transitions inside the partition
+     * @return the cost, negative if one cannot be reached from the other
+     */
+    double getDistance( size_t from, size_t to ) const;
+    /**
+     * @brief plans from start to goal without leaving the partition
+     * @return false if no such path exists or an end lies outside the partition
+     */
+    bool plan( const Cell& start, const Cell& goal, Path& path ) const;
+    /**
+     * @brief plans from a cell to every transition
+     * @param cell the cell, inside the partition
+     * @param costs one cost per transition, negative where it cannot be reached
+     */
+    void planToTransitions( const Cell& cell, vector<double>& costs ) const;
+    /**
+     * @brief answers one request
+     * @param request a request line
+     * @return the reply line, without the newline
+     */
+    string answer( const string& request ) const;
+    /**
+     * @brief answers requests from TCP clients until the socket fails
+     *
+     * each client gets a thread answering its requests in order
+     * @param port the port to listen on, on every interface
+     * @return false if the socket could not be set up
+     */
+    bool serve( int port );
+    /**
+     * @brief getters for the corners of the partition
+     */
+    Cell getMinCell() const;
+    Cell getMaxCell() const;
+
+    /**
+     * @brief writes a line and its newline to a socket
+     * @return false if the connection broke
+     */
+    static bool sendLine( int fd, const string& line );
+    /**
+     * @brief reads the next line from a socket
+     * @param fd the socket
+     * @param pending bytes read past the previous line, kept between calls
+     * @param line the line, without its newline
+     * @return false once the connection is closed
+     */
+    static bool readLine( int fd, string& pending, string& line );
+  private:
+    /**
+     * @brief labels the components of the free cells of the partition, walled off from the rest of the map
+     */
+    void labelComponents( int threads );
+    /**
+     * @brief checks if a path inside the partition can exist between two of its cells
+     */
+    bool isConnected( const Cell& a, const Cell& b ) const;
+    /**
+     * @brief plans from every step-th transition from first to the ones after it
+     */
+    void planSources( int first, int step );
+    /**
+     * @brief answers the requests of one client until it hangs up
+     */
+    void answerClient( int fd ) const;
+    bool contains( const Cell& cell ) const;
+
+    Environment::Ptr env_;
+    Cell min_cell_;
+    Cell max_cell_;
+    vector<Transition> transitions_;
+    /**
+     * @brief components of the partition, see labelComponents()
+     */
+    ConnectivityIndex::ConstPtr components_;
+    /**
+     * @brief cost between every two transitions, row by row, -1 if unreachable
+     */
+    vector<double> distances_;
+};
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef PATH_H
+#define PATH_H
+
+#include <iterator>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "navi_example/Cell.h"
+
+using namespace std;
+
+/**
+ * @brief Compact path made of the jump points found by the search
+ *
+ * Consecutive waypoints are joined by straight horizontal, vertical or
+ * diagonal runs of cells. The individual cells are never stored; they are
+ * produced on demand by CellIterator, so a path across the whole map costs
+ * only as much memory as its number of turns.
+ */
+class Path{
+  public:
+    typedef boost::shared_ptr<Path> Ptr;
+    typedef boost::shared_ptr<const Path> ConstPtr;
+
+    /**
+     * @brief Forward iterator over every cell of the path
+     *
+     * Walks from one waypoint to the next a single step at a time, so
+     * dereferencing never allocates.
+     */
+    class CellIterator{
+      public:
+        typedef forward_iterator_tag iterator_category;
+        typedef Cell value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const Cell* pointer;
+        typedef const Cell& reference;
+
+        /**
+         * @brief position of the end iterator, which compares equal to any
+         * iterator walked past the last cell without counting the cells
+         */
+        static const size_t END = size_t(-1);
+
+        /**
+         * @brief Empty constructor, gives an iterator that is not attached to a path
+         */
+        CellIterator();
+        /**
+         * @brief Constructor used by Path to create begin and end iterators
+         * @param waypoints the waypoints to walk along
+         * @param position 0 for the first cell, or END
+         */
+        CellIterator(const vector<Cell>* waypoints, size_t position);
+
+        reference operator*() const;
+        pointer operator->() const;
+        CellIterator& operator++();
+        CellIterator operator++(int);
+        bool operator==(const CellIterator& other) const;
+        bool operator!=(const CellIterator& other) const;
+      private:
+        /**
+         * @brief skips waypoints that coincide with the current cell
+         */
+        void skipReached();
+        /**
+         * @brief check if the iterator has walked past the last cell
+         */
+        bool exhausted() const;
+
+        /**
+         * @brief the waypoints being walked along
+         */
+        const vector<Cell>* waypoints_;
+        /**
+         * @brief index of the waypoint currently being walked towards,
+         * one past the last waypoint once past the last cell
+         */
+        size_t next_;
+        /**
+         * @brief index of the current cell along the path
+         */
+        size_t position_;
+        /**
+         * @brief the current cell
+         */
+        Cell current_;
+    };
+
+    /**
+     * @brief Empty constructor, creates a path with no cells
+     */
+    Path();
+    /**
+     * @brief Constructor that takes the waypoints in order from start to goal
+     * @param waypoints the waypoints of the path
+     */
+    Path(const vector<Cell>& waypoints);
+    /**
+     * @brief appends a waypoint to the end of the path
+     * @param waypoint the cell to append
+     */
+    void addWaypoint(const Cell& waypoint);
+    /**
+     * @brief getter for the waypoints
+     * @return the waypoints in order from start to goal
+     */
+    const vector<Cell>& getWaypoints() const;
+    /**
+     * @brief reverses the direction of the path
+     */
+    void reverse();
+    /**
+     * @brief removes all waypoints
+     */
+    void clear();
+    /**
+     * @brief check if the path has no cells
+     * @return verity of whether the path is empty
+     */
+    bool empty() const;
+    /**
+     * @brief gets the number of cells along the path, including both ends
+     * @return the number of cells
+     */
+    size_t numCells() const;
+    /**
+     * @brief gets the length of the path
+     *
+     * Straight steps cost 1 and diagonal steps cost sqrt(2), matching Graph
+     * @return the path cost
+     */
+    double cost() const;
+    /**
+     * @brief gets the iterator to the first cell of the path
+     */
+    CellIterator cellsBegin() const;
+    /**
+     * @brief gets the iterator past the last cell of the path, in constant time
+     */
+    CellIterator cellsEnd() const;
+  private:
+    /**
+     * @brief jump points from start to goal
+     */
+    vector<Cell> waypoints_;
+};
+
+#endif
@@ -0,0 +1,223 @@
+#ifndef PATH_CACHE_H
+#define PATH_CACHE_H
+
+#include <list>
+#include <ostream>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "navi_example/Environment.h"
+#include "navi_example/Graph.h"
+#include "navi_example/Path.h"
+
+using namespace std;
+
+/**
+ * @brief Key for a cached path query
+ *
+ * A path is only valid for the map version it was planned on, so the
+ * version is part of the key.
+ */
+struct PathCacheKey{
+  /**
+   * @brief start cell of the query
+   */
+  Cell start;
+  /**
+   * @brief goal cell of the query
+   */
+  Cell goal;
+  /**
+   * @brief map version the query was planned on
+   */
+  size_t version;
+  /**
+   * @brief Constructor that takes in all fields of the key
+   */
+  PathCacheKey(const Cell& s, const Cell& g, size_t v);
+};
+
+/**
+ * @brief Comparison operator overload for PathCacheKey
+ */
+bool operator==(PathCacheKey const& k1, PathCacheKey const& k2);
+/**
+ * @brief boost hash function overload for PathCacheKey
+ */
+size_t hash_value(PathCacheKey const& k);
+
+/**
+ * @brief Counters describing how well the cache is doing
+ */
+struct PathCacheStats{
+  /**
+   * @brief queries answered by an exact (start, goal, version) match
+   */
+  size_t hits;
+  /**
+   * @brief queries answered by slicing a longer cached path
+   */
+  size_t subpath_hits;
+  /**
+   * @brief queries that had to be planned
+   */
+  size_t misses;
+  /**
+   * @brief entries removed to stay under the memory cap
+   */
+  size_t evictions;
+  /**
+   * @brief number of paths currently cached
+   */
+  size_t entries;
+  /**
+   * @brief estimated memory held by the cached paths
+   */
+  size_t bytes;
+  /**
+   * @brief planning time that hits did not have to spend, in seconds
+   *
+   * Estimated from the planning time recorded with the cached path,
+   * prorated by the length of the slice for subpath hits
+   */
+  double seconds_saved;
+  /**
+   * @brief Empty constructor, zeroes all counters
+   */
+  PathCacheStats();
+  /**
+   * @brief fraction of queries answered from the cache
+   */
+  double hitRate() const;
+};
+
+/**
+ * @brief operator<< overload for printing out the cache counters
+ */
+ostream& operator<<(ostream& os, const PathCacheStats& stats);
+
+/**
+ * @brief LRU cache of planned paths that sits in front of Planner
+ *
+ * Paths are keyed by (start, goal, map version) and the least recently
+ * used ones are evicted once the estimated memory use exceeds the cap.
+ * Since every subpath of an optimal path is optimal, a query whose start
+ * and goal both lie on a cached path of the same map version is answered
+ * by slicing that path instead of searching. Only the paths crossing the
+ * tile of the start are tried, found through an index from tiles to the
+ * entries whose cells cover them.
+ */
+class PathCache{
+  public:
+    typedef boost::shared_ptr<PathCache> Ptr;
+    typedef boost::shared_ptr<const PathCache> ConstPtr;
+
+    /**
+     * @brief Constructor that takes in the memory cap
+     * @param max_bytes the estimated memory the cached paths may occupy
+     */
+    PathCache(size_t max_bytes);
+    /**
+     * @brief plans from start to goal, going through the cache first
+     *
+     * On a miss the query is planned with a fresh Graph and Planner and the
+     * result is added to the cache together with the time it took.
+     *
+     * @param env the environment to plan in; its version is part of the key
+     * @param start the cell to start from
+     * @param goal the cell to reach
+     * @param path the jump points of the path from start to goal
+     * @return whether a path was found
+     */
+    bool plan(Environment::Ptr env, const Cell& start, const Cell& goal, Path& path);
+    /**
+     * @brief looks up a path, either exactly or as a slice of a cached path
+     * @param key the query
+     * @param path the path from start to goal, filled on a hit
+     * @param seconds the planning time the hit saved
+     * @return whether the query was answered from the cache
+     */
+    bool lookup(const PathCacheKey& key, Path& path, double& seconds);
+    /**
+     * @brief adds a planned path to the cache, evicting old entries if needed
+     * @param key the query the path answers
+     * @param path the path from start to goal
+     * @param seconds how long planning the path took
+     */
+    void insert(const PathCacheKey& key, const Path& path, double seconds);
+    /**
+     * @brief getter for the cache counters
+     * @return a copy of the current counters
+     */
+    PathCacheStats getStats() const;
+  private:
+    /**
+     * @brief a cached path together with the cell offset of each of its waypoints
+     * and the tiles its cells cover
+     */
+    struct Entry{
+      PathCacheKey key;
+      Path path;
+      vector<size_t> offsets;
+      vector<Cell> tiles;
+      size_t bytes;
+      double seconds;
+      Entry(const PathCacheKey& k) : key(k), bytes(0), seconds(0) {}
+    };
+    typedef list<Entry> LruList;
+    typedef boost::unordered_map<PathCacheKey, LruList::iterator> EntryTable;
+    typedef boost::unordered_map<Cell, vector<LruList::iterator> > TileIndex;
+
+    /**
+     * @brief removes least recently used entries until the memory cap is met
+     */
+    void evict();
+    /**
+     * @brief finds where a cell lies along a cached path
+     * @param entry the cached path
+     * @param cell the cell to look for
+     * @param position the index of the cell along the path
+     * @return whether the cell lies on the path
+     */
+    static bool locate(const Entry& entry, const Cell& cell, size_t& position);
+    /**
+     * @brief gets the cell at a position along a cached path
+     * @param entry the cached path
+     * @param position index of the cell along the path
+     * @return the cell
+     */
+    static Cell cellAt(const Entry& entry, size_t position);
+    /**
+     * @brief gets the cells of a cached path between two positions
+     * @param entry the cached path
+     * @param from index along the path of the first cell
+     * @param to index along the path of the last cell, not less than from
+     * @param slice the resulting path
+     */
+    static void slice(const Entry& entry, size_t from, size_t to, Path& slice);
+
+    /**
+     * @brief entries ordered from most to least recently used
+     */
+    LruList lru_;
+    /**
+     * @brief hash table from the query key to its entry in the LRU list
+     */
+    EntryTable entries_;
+    /**
+     * @brief hash table from a tile to the entries whose paths cross it
+     */
+    TileIndex tiles_;
+    /**
+     * @brief memory cap in bytes
+     */
+    size_t max_bytes_;
+    /**
+     * @brief counters
+     */
+    PathCacheStats stats_;
+};
+
+#endif
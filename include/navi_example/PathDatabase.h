@@ -0,0 +1,187 @@
+#ifndef PATH_DATABASE_H
+#define PATH_DATABASE_H
+
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "navi_example/Cell.h"
+#include "navi_example/Environment.h"
+#include "navi_example/Path.h"
+
+using namespace std;
+
+/**
+ * @brief Fixed size header at the start of a path database file
+ *
+ * The header is followed by the component of every cell (num_cells 32 bit
+ * words), the offset of the first run of every cell and one past the last
+ * (num_cells+1 64 bit words), then the runs (num_runs 32 bit words). All
+ * values are in host byte order.
+ */
+struct PathDatabaseHeader{
+  /**
+   * @brief "NAVC"
+   */
+  char magic[4];
+  boost::uint32_t format;
+  /**
+   * @brief corners of the window of the map the database covers
+   */
+  boost::int32_t min_x;
+  boost::int32_t min_y;
+  boost::int32_t max_x;
+  boost::int32_t max_y;
+  boost::uint64_t num_cells;
+  boost::uint64_t num_runs;
+  /**
+   * @brief hash of the free cells of the window, to reject a database of another map
+   */
+  boost::uint64_t layout_hash;
+};
+
+/**
+ * @brief Compressed path database of first moves
+ *
+ * For every free cell of a window of the map and every target in it, stores
+ * the first move of a shortest 8-connected path, moves between free cells
+ * of the window only. Targets are numbered along a Hilbert curve, so cells
+ * close on the map are close in the numbering and mostly share their first
+ * move; each source keeps its moves as runs over that numbering. Every
+ * optimal first move of a target is allowed, and a run is only cut when no
+ * move is optimal for all of its targets. A query follows the first moves
+ * from start to goal, one binary search in the current cell's runs per
+ * step, without any search.
+ *
+ * Building takes one Dijkstra search per cell, so its cost grows with the
+ * square of the cells: meant for small static maps queried very often.
+ */
+class PathDatabase{
+  public:
+    typedef boost::shared_ptr<PathDatabase> Ptr;
+    typedef boost::shared_ptr<const PathDatabase> ConstPtr;
+
+    /**
+     * @brief Empty constructor, creates a database with no cells
+     */
+    PathDatabase();
+    /**
+     * @brief computes the first move tables of a window of the map
+     * @param env the environment
+     * @param min_cell lowest corner of the window
+     * @param max_cell highest corner of the window
+     * @param threads number of threads, each searching from its share of the cells
+     * @return false if the window holds too many cells to number
+     */
+    bool build(Environment::Ptr env, const Cell& min_cell, const Cell& max_cell, int threads);
+    /**
+     * @brief writes the database, see PathDatabaseHeader
+     * @param path the file to write
+     * @return whether the file was written
+     */
+    bool write(const string& path) const;
+    /**
+     * @brief reads a database written by write()
+     * @param path the file to read
+     * @param env the environment it was built on, whose cells are numbered again
+     * @return false if the file cannot be read or belongs to another map
+     */
+    bool read(const string& path, Environment::Ptr env);
+    /**
+     * @brief gets the first move of a shortest path
+     * @param from the cell to move from
+     * @param to the cell to reach
+     * @param move the unit step to take
+     * @return false if either cell is not a free cell of the window, or to cannot be reached
+     */
+    bool getFirstMove(const Cell& from, const Cell& to, Direction& move) const;
+    /**
+     * @brief follows the first moves from start to goal
+     * @param start the cell to start from
+     * @param goal the cell to reach
+     * @param path the jump points of the path, where the move changes
+     * @return whether a path was found
+     */
+    bool plan(const Cell& start, const Cell& goal, Path& path) const;
+    /**
+     * @brief getter for the number of free cells covered
+     */
+    size_t getNumCells() const;
+    /**
+     * @brief gets a covered cell by its number along the Hilbert curve
+     * @param id a number below getNumCells()
+     * @return the cell
+     */
+    Cell getCell(size_t id) const;
+    /**
+     * @brief getters for the corners of the window covered
+     */
+    Cell getMinCell() const;
+    Cell getMaxCell() const;
+    /**
+     * @brief getter for the number of runs over all cells
+     */
+    size_t getNumRuns() const;
+    /**
+     * @brief gets the size of the tables, as written to a file without the header
+     * @return the size in bytes
+     */
+    size_t getBytes() const;
+  private:
+    /**
+     * @brief numbers the free cells of a window along a Hilbert curve
+     * @return a hash of the free cells
+     */
+    boost::uint64_t numberCells(const MapSnapshot& snapshot, const Cell& min_cell, const Cell& max_cell);
+    /**
+     * @brief gets the number of a cell, -1 if it is blocked or outside the window
+     */
+    boost::int32_t idOf(const Cell& cell) const {
+        if(cell.x < min_cell_.x || cell.x > max_cell_.x || cell.y < min_cell_.y || cell.y > max_cell_.y)
+            return -1;
+        return ids_[size_t(cell.y-min_cell_.y)*(max_cell_.x-min_cell_.x+1) + (cell.x-min_cell_.x)];
+    }
+    /**
+     * @brief gets the move code from a source to a target, both numbered
+     */
+    int lookup(boost::int32_t source, boost::int32_t target) const;
+    /**
+     * @brief runs Dijkstra from every step-th cell from first and compresses its first moves
+     * @param neighbours the number of the neighbour of every cell along each move, -1 if blocked
+     */
+    void buildSources(int first, int step, const vector<boost::int32_t>* neighbours, vector<vector<boost::uint32_t> >* runs) const;
+
+    /**
+     * @brief corners of the window covered
+     */
+    Cell min_cell_;
+    Cell max_cell_;
+    /**
+     * @brief number of every cell of the window, row by row, -1 for blocked cells
+     */
+    vector<boost::int32_t> ids_;
+    /**
+     * @brief the cell of every number
+     */
+    vector<Cell> cells_;
+    /**
+     * @brief 8-connected component of every cell, by number
+     */
+    vector<boost::uint32_t> components_;
+    /**
+     * @brief index of the first run of every cell, and one past the last
+     */
+    vector<boost::uint64_t> offsets_;
+    /**
+     * @brief number of the first target of a run shifted by 3, or'ed with its move code
+     */
+    vector<boost::uint32_t> runs_;
+    /**
+     * @brief hash of the free cells, see PathDatabaseHeader
+     */
+    boost::uint64_t layout_hash_;
+};
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef PATH_INDEX_H
+#define PATH_INDEX_H
+
+#include <ostream>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "navi_example/Environment.h"
+#include "navi_example/Path.h"
+
+using namespace std;
+
+/**
+ * @brief Counters describing the work done by a PathIndex
+ */
+struct PathIndexStats{
+  /**
+   * @brief number of paths currently stored
+   */
+  size_t paths;
+  /**
+   * @brief number of (tile, segment) entries in the index
+   */
+  size_t postings;
+  /**
+   * @brief segments tested against changed cells
+   */
+  size_t segment_checks;
+  /**
+   * @brief paths found to cross a cell that became occupied
+   */
+  size_t invalidated;
+  /**
+   * @brief paths mended by a search around the blocked part only
+   */
+  size_t local_repairs;
+  /**
+   * @brief paths the local searches could not mend, planned again from start to goal
+   */
+  size_t full_replans;
+  /**
+   * @brief paths whose goal could no longer be reached at all
+   */
+  size_t unreachable;
+  /**
+   * @brief Empty constructor, zeroes all counters
+   */
+  PathIndexStats();
+};
+
+/**
+ * @brief operator<< overload for printing out the index counters
+ */
+ostream& operator<<(ostream& os, const PathIndexStats& stats);
+
+/**
+ * @brief Inverted index from map tiles to the stored paths crossing them
+ *
+ * Every segment between two jump points of a stored path is listed under
+ * each tile it passes through. When cells become occupied only the
+ * segments listed under their tiles are looked at, and each is tested
+ * against the cell in constant time, so the paths a change invalidates
+ * are found without walking any path. Cells becoming free never
+ * invalidate a path, though they may make a shorter one possible.
+ *
+ * An invalidated path can be repaired in place: the blocked stretch is
+ * replanned with a search confined to a box around it, and only if that
+ * fails is the path planned again from start to goal.
+ */
+class PathIndex{
+  public:
+    typedef boost::shared_ptr<PathIndex> Ptr;
+    typedef boost::shared_ptr<const PathIndex> ConstPtr;
+    typedef size_t PathId;
+
+    /**
+     * @brief Empty constructor, for a single cell robot
+     */
+    PathIndex();
+    /**
+     * @brief sets the robot radius the stored paths were planned for
+     *
+     * a segment is then invalid once an obstacle lies within the radius
+     * of one of its cells, matching MapSnapshot::getLayer(); must be set
+     * before paths are checked
+     * @param radius the robot radius in cells
+     */
+    void setRadius(int radius);
+    /**
+     * @brief sets how far around the blocked stretch a repair may search
+     * @param cells margin in cells, 32 by default
+     */
+    void setRepairMargin(int cells);
+    /**
+     * @brief stores a path and indexes its segments
+     * @param path the path, at least one cell long
+     * @return the id the path is known by from now on
+     */
+    PathId add(const Path& path);
+    /**
+     * @brief forgets a stored path
+     * @param id the id returned by add()
+     * @return whether the path was stored
+     */
+    bool remove(PathId id);
+    /**
+     * @brief gets a stored path
+     * @param id the id returned by add()
+     * @return the path, or NULL if no path has that id
+     */
+    const Path* find(PathId id) const;
+    /**
+     * @brief finds the stored paths that cross cells which became occupied
+     * @param added the cells that became occupied
+     * @param invalid the ids of the paths crossing them, in increasing order
+     */
+    void findInvalid(const vector<Cell>& added, vector<PathId>& invalid);
+    /**
+     * @brief replans the blocked stretch of a stored path on the current map
+     *
+     * The stretch from the first to the last blocked cell, extended by the
+     * repair margin either way, is planned between its two ends with a
+     * search bounded by a box around it, then once more with four times
+     * the margin. The path outside the stretch is kept, so the result is
+     * valid but not necessarily the shortest. If both searches fail the
+     * path is planned from start to goal on the whole map.
+     * @param id the id of the path, which keeps its id
+     * @param env the environment with the current obstacles
+     * @return false if the path could not be mended, in which case it is left as it was
+     */
+    bool repair(PathId id, Environment::Ptr env);
+    /**
+     * @brief tests whether a straight or diagonal segment passes within a radius of a cell
+     * @param from first cell of the segment
+     * @param to last cell of the segment, in one of the eight directions from from
+     * @param cell the cell to test against
+     * @param radius the robot radius in cells
+     * @return whether some cell of the segment is within euclidean distance radius of cell
+     */
+    static bool segmentTouches(const Cell& from, const Cell& to, const Cell& cell, int radius);
+    /**
+     * @brief getter for the index counters
+     * @return a copy of the current counters
+     */
+    PathIndexStats getStats() const;
+  private:
+    /**
+     * @brief one segment of a stored path listed under a tile
+     */
+    struct Posting{
+      PathId id;
+      /**
+       * @brief index of the first waypoint of the segment
+       */
+      size_t segment;
+      Posting(PathId i, size_t s) : id(i), segment(s) {}
+    };
+    /**
+     * @brief a stored path together with the tiles it is listed under
+     */
+    struct Entry{
+      Path path;
+      vector<Cell> tiles;
+    };
+    typedef boost::unordered_map<Cell, vector<Posting> > PostingTable;
+    typedef boost::unordered_map<PathId, Entry> EntryTable;
+
+    /**
+     * @brief lists every segment of a path under the tiles it passes through
+     */
+    void post(PathId id, Entry& entry);
+    /**
+     * @brief removes every listing of a path
+     */
+    void unpost(PathId id, Entry& entry);
+    /**
+     * @brief plans between two cells of the current map, within a box if margin is positive
+     * @param env the environment
+     * @param from the cell to start from
+     * @param to the cell to reach
+     * @param min_cell lowest corner of the cells the stretch spans
+     * @param max_cell highest corner of the cells the stretch spans
+     * @param margin cells added around the box, 0 for no box
+     * @param path the path found
+     * @return whether a path was found
+     */
+    bool planStretch(Environment::Ptr env, const Cell& from, const Cell& to, const Cell& min_cell, const Cell& max_cell, int margin, Path& path) const;
+
+    /**
+     * @brief stored paths keyed by id
+     */
+    EntryTable entries_;
+    /**
+     * @brief segments keyed by the tiles they pass through
+     */
+    PostingTable postings_;
+    PathId next_id_;
+    int radius_;
+    int repair_margin_;
+    PathIndexStats stats_;
+};
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef PATH_WRITER_H
+#define PATH_WRITER_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "navi_example/Cell.h"
+#include "navi_example/Path.h"
+
+using namespace std;
+
+/**
+ * @brief Buffered writer of solution files
+ *
+ * Waypoints are handed over one at a time and written as they arrive, so
+ * the cells between them are never held in memory. Output goes through
+ * a fixed buffer and is only flushed when the buffer is full or the
+ * writer is closed.
+ *
+ * The binary format is the magic "NAVP", a format byte, the start cell
+ * as two zigzag varints, then the path as runs of steps in one of the
+ * eight directions, each a varint of steps*8 + direction, ended by a 0.
+ * Directions are numbered counter-clockwise from +x:
+ * (1,0) (1,1) (0,1) (-1,1) (-1,0) (-1,-1) (0,-1) (1,-1).
+ */
+class PathWriter{
+  public:
+    typedef boost::shared_ptr<PathWriter> Ptr;
+    typedef boost::shared_ptr<const PathWriter> ConstPtr;
+
+    enum Format{
+      /**
+       * @brief every cell of the path as "x, y" lines
+       */
+      TEXT_CELLS,
+      /**
+       * @brief the waypoints as "x, y" lines
+       */
+      TEXT_WAYPOINTS,
+      /**
+       * @brief delta encoded direction runs
+       */
+      BINARY
+    };
+
+    /**
+     * @brief Constructor, opens the file
+     * @param filename the file to write
+     * @param format how to write the path
+     */
+    PathWriter( const string& filename, Format format );
+    /**
+     * @brief closes the file if close() was not called
+     */
+    ~PathWriter();
+    /**
+     * @brief checks whether the file could be opened
+     */
+    bool isOpen() const;
+    /**
+     * @brief adds the next waypoint of the path
+     * @param waypoint the waypoint, reachable from the last one by diagonal then straight steps
+     */
+    void addWaypoint( const Cell& waypoint );
+    /**
+     * @brief adds every waypoint of a path
+     * @param path the path
+     */
+    void write( const Path& path );
+    /**
+     * @brief finishes the file
+     * @return whether everything was written
+     */
+    bool close();
+    /**
+     * @brief reads a file written in the binary format
+     * @param filename the file
+     * @param path filled with a waypoint at the end of every run
+     * @return false if the file is missing or malformed
+     */
+    static bool readBinary( const string& filename, Path& path );
+  private:
+    /**
+     * @brief adds steps in one direction, merging them into the current run
+     */
+    void addSteps( int direction, boost::uint64_t steps );
+    void endRun();
+    void putVarint( boost::uint64_t value );
+    void putNumber( int value );
+    void putCell( const Cell& cell );
+    void putByte( char byte ){
+        if(used_ == buffer_.size())
+            flush();
+        buffer_[used_++] = byte;
+    }
+    void flush();
+
+    FILE* file_;
+    Format format_;
+    vector<char> buffer_;
+    size_t used_;
+    bool ok_;
+    bool has_last_;
+    Cell last_;
+    /**
+     * @brief the run being built by the binary format, -1 if none
+     */
+    int run_direction_;
+    boost::uint64_t run_steps_;
+};
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef PLAN_SERVER_H
+#define PLAN_SERVER_H
+
+#include <deque>
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "navi_example/Environment.h"
+#include "navi_example/PathCache.h"
+
+using namespace std;
+
+/**
+ * @brief Answers planning queries on maps loaded once
+ *
+ * Queries and answers are JSON lines. A query looks like
+ *
+ *   {"id": 7, "map": "set1", "start": [177, 523], "goal": [1347, 536],
+ *    "options": {"radius": 0, "fixed_point": false, "waypoints": true, "cache": true}}
+ *
+ * where everything but the id may be left out: the map defaults to the only
+ * map loaded, start and goal to the map's own, and the options to the values
+ * shown. The answer carries the same id:
+ *
+ *   {"id": 7, "ok": true, "cost": 1175.3848, "cells": 1171, "ms": 2.1, "cached": false, "path": [[177, 523], ...]}
+ *   {"id": 7, "ok": false, "error": "no plan found"}
+ *
+ * "path" holds the jump points, or every cell when waypoints is false.
+ * Every connection may send any number of queries without waiting. Each
+ * line is handed to a pool of worker threads and its answer is written as
+ * soon as it is ready, so answers may come back out of order.
+ */
+class PlanServer{
+  public:
+    typedef boost::shared_ptr<PlanServer> Ptr;
+    typedef boost::shared_ptr<const PlanServer> ConstPtr;
+
+    /**
+     * @brief Constructor
+     * @param threads number of worker threads planning queries
+     * @param cache_bytes memory cap of the path cache of each map
+     */
+    PlanServer( int threads, size_t cache_bytes );
+    ~PlanServer();
+    /**
+     * @brief makes a map available to queries
+     * @param name the name queries refer to it by
+     * @param env the loaded map
+     */
+    void addMap( const string& name, Environment::Ptr env );
+    /**
+     * @brief answers the queries read from one file descriptor on another
+     *
+     * returns once the input is closed and every query read is answered
+     * @param in_fd where the queries come from, e.g. stdin
+     * @param out_fd where the answers go, e.g. stdout
+     */
+    void serveStream( int in_fd, int out_fd );
+    /**
+     * @brief answers queries from clients of a unix domain socket
+     *
+     * each client gets a thread reading its queries; the planning is done by
+     * the shared worker threads. Runs until the socket fails.
+     * @param path the socket file to create, replaced if it exists
+     * @return false if the socket could not be set up
+     */
+    bool serveSocket( const string& path );
+    /**
+     * @brief answers one query
+     * @param query a query line
+     * @return the answer line, without the newline
+     */
+    string answer( const string& query );
+  private:
+    /**
+     * @brief a client; closed when the reader and the last query are done with it
+     */
+    struct Connection{
+        typedef boost::shared_ptr<Connection> Ptr;
+        int in_fd;
+        int out_fd;
+        bool owned;
+        /**
+         * @brief keeps the answers of concurrent workers from interleaving
+         */
+        boost::mutex write_mutex;
+        Connection( int in, int out, bool own ) : in_fd(in), out_fd(out), owned(own) {}
+        ~Connection();
+    };
+    struct Job{
+        Connection::Ptr connection;
+        string query;
+    };
+    /**
+     * @brief a map with its own path cache
+     */
+    struct ServedMap{
+        Environment::Ptr env;
+        PathCache::Ptr cache;
+        boost::shared_ptr<boost::mutex> cache_mutex;
+    };
+
+    void startWorkers();
+    void stopWorkers();
+    /**
+     * @brief worker thread: answers queued queries until the queue is closed
+     */
+    void work();
+    /**
+     * @brief reads queries from a connection and queues them until it is closed
+     */
+    void readQueries( Connection::Ptr connection );
+    void send( const Connection::Ptr& connection, const string& line );
+    /**
+     * @brief plans a path, through the map's cache when allowed
+     */
+    bool plan( ServedMap& map, const Cell& start, const Cell& goal, int radius, bool fixed_point,
+               bool use_cache, Path& path, bool& cached, string& error );
+
+    int threads_;
+    size_t cache_bytes_;
+    boost::unordered_map<string, ServedMap> maps_;
+    boost::thread_group workers_;
+    /**
+     * @brief queries waiting for a worker, guarded by queue_mutex_
+     */
+    deque<Job> queue_;
+    bool closed_;
+    boost::mutex queue_mutex_;
+    boost::condition_variable queue_cond_;
+};
+
+#endif
@@ -8,84 +8,14 @@
 
 #include "navi_example/Environment.h"
 #include "navi_example/Graph.h"
+#include "navi_example/Path.h"
+#include "navi_example/SearchState.h"
+#include "navi_example/OpenList.h"
 
 #include <boost/unordered_map.hpp>
 
 using namespace std;
 
-/**
- * @brief Wrapper struct for GraphState which bundles it with g and h values
- *
- * This class is used in the actual search algorithm and helps with path
- * unwinding.
- */
-struct SearchState{
-  typedef boost::shared_ptr<SearchState> Ptr;
-  typedef boost::shared_ptr<const SearchState> ConstPtr;
-  /**
-   * @brief cost to come for the state
-   */
-  double g;
-  /**
-   * @brief cost to go for the state
-   */
-  double h;
-  /**
-   * @brief the underlying graph state of the search state
-   */
-  GraphState::Ptr graph_state_;
-  /**
-   * @brief pointer to the parent search state that generated this
-   */
-  SearchState::Ptr parent_;
-  /**
-   * @brief Empty constructor
-   *
-   * Defaults coordinates to (0,0) and g and h to 0
-   */
-  SearchState();
-  /**
-   * @brief getter for the GraphState
-   * @return pointer to GraphState
-   */
-  GraphState::Ptr getGraphState();
-  /**
-   * @brief setter for the GraphState
-   * @param gstate pointer to the graph state to set it to
-   */
-  void setGraphState(const GraphState::Ptr& gstate);
-};
-
-/**
- * @brief operator overload for SearchState* for equality comparison
- *
- * required for using boost unordered_set and map
- *
- * @param s1 first state to compare
- * @param s2 second state to compare
- * @return verity of the comparison
- */
-bool operator==(SearchState::Ptr const& s1, SearchState::Ptr const& s2);
-/**
- * @brief operator overload for SearchState* for less than comparison
- *
- * Used by the sorting functions of the priority queue
- *
- * @param s1 first state to compare
- * @param s2 second state to comparei
- * @return verity of the comparison
- */
-bool operator<(SearchState::Ptr const& lhs, SearchState::Ptr const& rhs);
-/**
- * @brief boost hash function overload for SearchState*, uses the Cell hash functions
- *
- * This is used by the HashTable for tracking whether a state is on the open or closed list
- *
- * @return hash value of the SearchState
- * @param s state to be hashed
- */
-size_t hash_value(SearchState::Ptr const& s);
-
 /**
  * @brief Planner class that uses the Environment and Graph to conduct a search
  * 
@@ -99,8 +29,17 @@ class Planner{
     typedef boost::shared_ptr<Planner> Ptr;
     typedef boost::shared_ptr<Planner const> ConstPtr;
 
+    /**
+     * @brief with a state budget, plan() gives up after this many expansions per state of the budget
+     */
+    static const size_t MAX_EXPANSIONS_PER_STATE = 1000;
+
     /**
      * @brief constructor for the planner
+     *
+     * The open list is a BucketOpenList when the graph uses FIXED_POINT costs
+     * and a BinaryHeapOpenList otherwise
+     *
      * @param env Environment pointer
      * @param graph Graph pointer
      */
@@ -108,27 +47,126 @@ class Planner{
     /**
      * @brief starts the planner to search for a path
      * @return whether a path was found
+     * @param path the jump points of the path from start to goal
+     */
+    bool plan(Path& path);
+    /**
+     * @brief starts the planner to search for a path, producing every cell
+     *
+     * Kept for callers that want one GraphState per cell; prefer plan(Path&)
+     * and Path::CellIterator, which do not allocate per cell.
+     *
+     * @return whether a path was found
      * @param path the path in GraphStates from start to goal
      */
     bool plan(vector<GraphState::Ptr>& path);
     /**
      * @brief helper function for unrolling the discovered path
      *
-     * Uses parent pointers to previous states to build the path
+     * Uses parent pointers to previous states to collect the jump points
      *
      * @param state the state to start unrolling from
-     * @param plan the list of graph states in the plan
+     * @param plan the path to fill with the jump points from start to goal
      */
-    void unwind(const SearchState::Ptr& state, vector<GraphState::Ptr>& plan);
+    void unwind(const SearchState::Ptr& state, Path& plan);
     /**
-     * @brief gets the intermediate states between two states with only using diagonal, horizontal, or vertical steps
+     * @brief gets the cost of the path found by the last call to plan
      *
-     * @param from_state SearchState* to the state we are starting from
-     * @param to_state SearchState* to the state we want to stop before
-     * @param plan the vector of graph states for the final plan
+     * The cost is in the units of the graph's cost mode
+     * @return the g value of the goal, or -1 if no path was found
+     */
+    double getSolutionCost() const;
+    /**
+     * @brief limits the number of states the search may keep in memory
+     *
+     * Until the limit is reached the search is plain A*. From then on, room
+     * for a new state is made SMA*-style: expanded states left without
+     * children are dropped first, then the open state with the largest g+h,
+     * whose f value is backed up into its parent. The parent goes back on
+     * the open list with that f, so the forgotten state is regenerated
+     * before any costlier one is expanded, and a closed state reached again
+     * more cheaply is reopened. A budget too small to hold any path gives up
+     * after MAX_EXPANSIONS_PER_STATE expansions per state of the budget.
+     * A budget of 0 means unbounded, which is the default.
+     *
+     * @param max_states the largest number of states kept in memory
+     */
+    void setStateBudget(size_t max_states);
+    /**
+     * @brief limits the memory the search may use for its states
+     * @see setStateBudget()
+     * @param max_bytes the memory budget in bytes
+     */
+    void setMemoryBudget(size_t max_bytes);
+    /**
+     * @brief gets the estimated memory taken by one state of the search
+     *
+     * covers the SearchState, its GraphState, the hash table node and
+     * the open list entry
+     * @return the estimated bytes per state
+     */
+    static size_t getBytesPerState();
+    /**
+     * @brief gets the largest number of states held at once by the last search
+     * @return the peak number of states
+     */
+    size_t getPeakStates() const;
+    /**
+     * @brief gets how many states the last search expanded
+     * @return the number of expansions
      */
-    void interpolate(const SearchState::Ptr& from_state, const SearchState::Ptr& to_state, vector<GraphState::Ptr>& plan);
+    size_t getNumExpansions() const;
+    /**
+     * @brief checks whether the path found by the last search is known to be optimal
+     *
+     * Always true for unbounded search. With a state budget it is true if
+     * every state forgotten for good, for lack of room or for lying deeper
+     * than the budget, had a g+h of at least the solution cost, so no
+     * cheaper path can have been missed. States pruned and regenerated
+     * later do not count.
+     * @return whether the returned path is guaranteed optimal
+     */
+    bool isSolutionOptimal() const;
+    /**
+     * @brief turns the progress messages on cout on or off, on by default
+     * @param verbose whether to print progress
+     */
+    void setVerbose(bool verbose);
+    /**
+     * @brief records the cell of every state expanded by plan()
+     * @param expanded appended to in expansion order, or NULL to stop recording
+     */
+    void setExpansionLog(vector<Cell>* expanded);
   private:
+    /**
+     * @brief prunes open states until a new state fits within the budget
+     * @return whether there is room for one more state
+     */
+    bool makeRoom();
+    /**
+     * @brief drops the worst open state to stay within the state budget
+     * @return whether a state could be dropped
+     */
+    bool pruneWorst();
+    /**
+     * @brief puts a state whose children were pruned back on the open list,
+     * keyed by their backed-up f value
+     */
+    void reopen(SearchState::Ptr state);
+    /**
+     * @brief deals with an expanded state that no longer has children in memory
+     *
+     * If some of its children were pruned it is reopened; otherwise it is a
+     * dead end, kept for duplicate detection until makeRoom() needs its room.
+     * @param state the expanded state
+     */
+    void noteChildless(SearchState::Ptr state);
+    /**
+     * @brief drops a dead end noted earlier, if it still is one, which may in
+     * turn leave its parent without children
+     */
+    void dropDeadEnd(SearchState::Ptr state);
+
     /**
      * @brief Environment pointer with the start, goal, and obstacle information
      */
@@ -138,12 +176,9 @@ class Planner{
      */
     Graph::Ptr graph_;
     /**
-     * @brief heap data structure using STL vector
-     *
-     * makes use of std::make_heap, std::push_heap, and std::pop_heap 
-     * for standard heap operations
+     * @brief priority queue of the states waiting to be expanded
      */
-    vector<SearchState::Ptr> open_list_;
+    OpenList::Ptr open_list_;
     /**
      * @brief a Hashtable that maps a SearchState* to a pair<SearchState*, bool>
      * 
@@ -160,6 +195,35 @@ class Planner{
      * @brief planner epsilon inflation factor
      */
     double epsilon_;
+    /**
+     * @brief g value of the goal once it is found
+     */
+    double solution_cost_;
+    /**
+     * @brief largest number of states kept in memory, 0 for unbounded
+     */
+    size_t max_states_;
+    /**
+     * @brief largest number of states held at once
+     */
+    size_t peak_states_;
+    size_t num_expansions_;
+    /**
+     * @brief smallest g+h among the states forgotten for good
+     */
+    double min_pruned_f_;
+    /**
+     * @brief the state whose successors are being generated, if any
+     *
+     * it must not be reopened or dropped halfway through its expansion
+     */
+    SearchState::Ptr expanding_;
+    /**
+     * @brief expanded states noted without children, dropped first when the budget is reached
+     */
+    vector<SearchState::Ptr> dead_ends_;
+    bool verbose_;
+    vector<Cell>* expansion_log_;
 };
 
 
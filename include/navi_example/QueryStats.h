@@ -0,0 +1,142 @@
+#ifndef QUERY_STATS_H
+#define QUERY_STATS_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/chrono.hpp>
+
+using namespace std;
+
+/**
+ * @brief Counters and phase timers of one query
+ *
+ * The search code counts into the stats of its thread through the
+ * NAVI_COUNT and NAVI_PHASE macros, which only do something when built
+ * with -DNAVI_INSTRUMENT (make NAVI_INSTRUMENT=1) and compile to nothing
+ * otherwise. A QueryStats::Scope makes a QueryStats the one of its thread
+ * for as long as it lives; with none in place nothing is counted.
+ *
+ * Phases may nest, so the search time includes the unwind time.
+ */
+class QueryStats{
+  public:
+    typedef boost::chrono::steady_clock Clock;
+
+    enum Counter{
+        COLLISION_CHECKS,
+        JUMP_STEPS,
+        FORCED_NEIGHBORS,
+        HEAP_OPERATIONS,
+        HASH_PROBES,
+        ALLOCATIONS,
+        EXPANSIONS,
+        NUM_COUNTERS
+    };
+    enum Phase{ LOAD, SEARCH, UNWIND, NUM_PHASES };
+
+    /**
+     * @brief one timed phase, in microseconds since the start of the process
+     */
+    struct Event{
+        Phase phase;
+        double begin_us;
+        double duration_us;
+        int thread;
+    };
+
+    /**
+     * @brief makes a QueryStats the one its thread counts into, until destroyed
+     */
+    class Scope{
+      public:
+        Scope( QueryStats* stats );
+        ~Scope();
+      private:
+        QueryStats* previous_;
+    };
+
+    /**
+     * @brief times a phase on the stats of its thread, from construction to destruction
+     */
+    class ScopedPhase{
+      public:
+        ScopedPhase( Phase phase );
+        ~ScopedPhase();
+      private:
+        QueryStats* stats_;
+        Phase phase_;
+        Clock::time_point begin_;
+    };
+
+    QueryStats( const string& name = "" );
+    /**
+     * @brief whether the counting macros were compiled in
+     */
+    static bool isEnabled();
+    /**
+     * @brief milliseconds elapsed since a time point, for the timings the tools print
+     */
+    static double millisecondsSince( Clock::time_point begin );
+    /**
+     * @brief the stats the calling thread counts into, NULL if none
+     */
+    static QueryStats* current(){
+        return current_;
+    }
+    void count( Counter counter, size_t amount = 1 ){
+        counters_[counter] += amount;
+    }
+    size_t getCount( Counter counter ) const;
+    /**
+     * @brief total milliseconds spent in a phase
+     */
+    double getPhaseMs( Phase phase ) const;
+    const vector<Event>& getEvents() const;
+    const string& getName() const;
+    /**
+     * @brief records the outcome of the query for the output
+     * @param found whether a path was found
+     * @param cost its cost
+     */
+    void setResult( bool found, double cost );
+    /**
+     * @brief writes the stats as one line of JSON
+     */
+    void writeJson( ostream& os ) const;
+    /**
+     * @brief writes queries as a Chrome trace event file
+     *
+     * every query is a span holding its phases, with the counters as its
+     * arguments; open it in chrome://tracing or Perfetto
+     * @return whether the file was written
+     */
+    static bool writeTrace( const string& filename, const vector<QueryStats>& queries );
+
+    static const char* COUNTER_NAMES[NUM_COUNTERS];
+    static const char* PHASE_NAMES[NUM_PHASES];
+  private:
+    void addEvent( Phase phase, Clock::time_point begin, Clock::time_point end );
+
+    static __thread QueryStats* current_;
+
+    string name_;
+    size_t counters_[NUM_COUNTERS];
+    double phase_ms_[NUM_PHASES];
+    vector<Event> events_;
+    bool has_result_;
+    bool found_;
+    double cost_;
+};
+
+#ifdef NAVI_INSTRUMENT
+#define NAVI_COUNT_N(counter, amount) do{ if(QueryStats* navi_stats = QueryStats::current()) navi_stats->count(QueryStats::counter, (amount)); }while(0)
+#define NAVI_PHASE(phase) QueryStats::ScopedPhase navi_phase_##phase(QueryStats::phase)
+#else
+#define NAVI_COUNT_N(counter, amount) do{}while(0)
+#define NAVI_PHASE(phase) do{}while(0)
+#endif
+#define NAVI_COUNT(counter) NAVI_COUNT_N(counter, 1)
+
+#endif
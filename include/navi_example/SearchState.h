@@ -0,0 +1,100 @@
+#ifndef SEARCH_STATE_H
+#define SEARCH_STATE_H
+
+#include <boost/shared_ptr.hpp>
+
+#include "navi_example/Graph.h"
+
+using namespace std;
+
+/**
+ * @brief Wrapper struct for GraphState which bundles it with g and h values
+ *
+ * This class is used in the actual search algorithm and helps with path
+ * unwinding.
+ */
+struct SearchState{
+  typedef boost::shared_ptr<SearchState> Ptr;
+  typedef boost::shared_ptr<const SearchState> ConstPtr;
+  /**
+   * @brief cost to come for the state
+   */
+  double g;
+  /**
+   * @brief cost to go for the state
+   */
+  double h;
+  /**
+   * @brief the underlying graph state of the search state
+   */
+  GraphState::Ptr graph_state_;
+  /**
+   * @brief pointer to the parent search state that generated this
+   */
+  SearchState::Ptr parent_;
+  /**
+   * @brief number of states between this state and the start
+   */
+  size_t depth_;
+  /**
+   * @brief number of states in memory whose parent is this state
+   *
+   * only maintained for memory-bounded search
+   */
+  size_t num_children_;
+  /**
+   * @brief smallest g+h among children pruned to save memory
+   *
+   * infinite if no child was pruned. This is the backed-up f value the
+   * state is reopened with once all of its children are gone.
+   */
+  double forgotten_f_;
+  /**
+   * @brief Empty constructor
+   *
+   * Defaults coordinates to (0,0) and g and h to 0, with no children
+   */
+  SearchState();
+  /**
+   * @brief getter for the GraphState
+   * @return pointer to GraphState
+   */
+  GraphState::Ptr getGraphState();
+  /**
+   * @brief setter for the GraphState
+   * @param gstate pointer to the graph state to set it to
+   */
+  void setGraphState(const GraphState::Ptr& gstate);
+};
+
+/**
+ * @brief operator overload for SearchState* for equality comparison
+ *
+ * required for using boost unordered_set and map
+ *
+ * @param s1 first state to compare
+ * @param s2 second state to compare
+ * @return verity of the comparison
+ */
+bool operator==(SearchState::Ptr const& s1, SearchState::Ptr const& s2);
+/**
+ * @brief operator overload for SearchState* for less than comparison
+ *
+ * Used by the sorting functions of the priority queue
+ *
+ * @param s1 first state to compare
+ * @param s2 second state to comparei
+ * @return verity of the comparison
+ */
+bool operator<(SearchState::Ptr const& lhs, SearchState::Ptr const& rhs);
+/**
+ * @brief boost hash function overload for SearchState*, uses the Cell hash functions
+ *
+ * This is used by the HashTable for tracking whether a state is on the open or closed list
+ *
+ * @return hash value of the SearchState
+ * @param s state to be hashed
+ */
+size_t hash_value(SearchState::Ptr const& s);
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef TILE_STORE_H
+#define TILE_STORE_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "navi_example/Cell.h"
+#include "navi_example/MapSnapshot.h"
+
+using namespace std;
+
+/**
+ * @brief Fixed size header at the start of a tile file
+ *
+ * A tile file is this header, then num_tiles TileIndexEntry records sorted
+ * by tile coordinates, then the tiles themselves as ObstacleTile::SIZE
+ * row words each. All values are in host byte order.
+ */
+struct TileFileHeader{
+  /**
+   * @brief "NAVT"
+   */
+  char magic[4];
+  boost::uint32_t format;
+  boost::int32_t start_x;
+  boost::int32_t start_y;
+  boost::int32_t goal_x;
+  boost::int32_t goal_y;
+  /**
+   * @brief log2 of the tile side length, must match ObstacleTile::BITS
+   */
+  boost::int32_t tile_bits;
+  boost::uint32_t reserved;
+  boost::uint64_t num_tiles;
+};
+
+/**
+ * @brief Where one tile is stored in a tile file
+ */
+struct TileIndexEntry{
+  boost::int32_t x;
+  boost::int32_t y;
+  /**
+   * @brief byte offset of the tile's rows from the start of the file
+   */
+  boost::uint64_t offset;
+};
+
+/**
+ * @brief Counters of a TileStore
+ */
+struct TileStoreStats{
+  /**
+   * @brief tiles read from disk
+   */
+  size_t faults;
+  /**
+   * @brief tile requests answered from memory
+   */
+  size_t hits;
+  size_t evictions;
+  /**
+   * @brief tiles currently held in memory
+   */
+  size_t resident;
+  /**
+   * @brief non-empty tiles in the file
+   */
+  size_t file_tiles;
+  size_t bytes_read;
+  /**
+   * @brief tiles that could not be read and were reported fully occupied
+   */
+  size_t read_errors;
+  TileStoreStats();
+};
+
+ostream& operator<<(ostream& os, const TileStoreStats& stats);
+
+/**
+ * @brief Obstacle tiles read on demand from a tile file
+ *
+ * Only the header and the tile index are read when the file is opened.
+ * Tiles are read with pread the first time they are asked for and kept in
+ * a bounded cache, so memory follows the area that is actually searched
+ * rather than the size of the map. Safe to use from several threads: a
+ * tile in memory is handed out without taking the store's lock, which
+ * only guards faults and evictions, so cell checks on a tile file map
+ * never wait on each other. Evictions pick tiles not used since the last
+ * pass of a clock hand, an approximation of LRU that needs no list update
+ * on every hit.
+ */
+class TileStore{
+  public:
+    typedef boost::shared_ptr<TileStore> Ptr;
+    typedef boost::shared_ptr<const TileStore> ConstPtr;
+
+    /**
+     * @brief opens a tile file
+     * @param path the tile file
+     * @param max_tiles number of tiles the cache may hold
+     * @return the store, or an empty pointer if the file could not be read
+     */
+    static Ptr open( const string& path, size_t max_tiles );
+    /**
+     * @brief checks if a file starts like a tile file
+     * @param path the file
+     * @return whether it has the tile file magic
+     */
+    static bool isTileFile( const string& path );
+    /**
+     * @brief writes the obstacles of a map as a tile file
+     * @param path the file to write
+     * @param start the start cell
+     * @param goal the goal cell
+     * @param snapshot the obstacles
+     * @return whether the file was written
+     */
+    static bool write( const string& path, const Cell& start, const Cell& goal, const MapSnapshot& snapshot );
+
+    ~TileStore();
+    /**
+     * @brief gets a tile, reading it from disk if it is not in memory
+     * @param tile tile coordinates
+     * @return the tile, an empty pointer if it has no obstacles, or a fully
+     * occupied tile if it could not be read
+     */
+    ObstacleTile::ConstPtr getTile( const Cell& tile );
+    /**
+     * @brief checks the index for a tile without reading it
+     * @param tile tile coordinates
+     * @return whether the file holds the tile
+     */
+    bool hasTile( const Cell& tile ) const;
+    /**
+     * @brief getter for the coordinates of every tile in the file
+     * @return the tile coordinates
+     */
+    vector<Cell> getTileCoordinates() const;
+    Cell getStart() const;
+    Cell getGoal() const;
+    /**
+     * @brief bounding box of the tiles in the file, empty if min > max
+     */
+    Cell getMinTile() const;
+    Cell getMaxTile() const;
+    TileStoreStats getStats() const;
+  private:
+    /**
+     * @brief use open()
+     */
+    TileStore( int fd, size_t max_tiles );
+
+    /**
+     * @brief a tile of the file and its place in the cache
+     */
+    struct TileSlot{
+      /**
+       * @brief byte offset of the tile's rows from the start of the file
+       */
+      boost::uint64_t offset;
+      /**
+       * @brief the tile while it is in memory, only accessed through boost::atomic_load and boost::atomic_store
+       */
+      ObstacleTile::ConstPtr tile;
+      /**
+       * @brief set by every hit, cleared as the clock hand passes
+       */
+      boost::atomic<bool> referenced;
+      TileSlot();
+    };
+
+    int fd_;
+    size_t max_tiles_;
+    Cell start_;
+    Cell goal_;
+    Cell min_tile_;
+    Cell max_tile_;
+    /**
+     * @brief slot of every tile in the file; neither changes after open()
+     */
+    boost::unordered_map<Cell, size_t> index_;
+    vector<TileSlot> slots_;
+    /**
+     * @brief slots holding a tile, in the order the clock hand visits them
+     */
+    vector<size_t> resident_;
+    size_t hand_;
+    /**
+     * @brief guards resident_, hand_, stats_ and storing into the slots
+     */
+    mutable boost::mutex mutex_;
+    TileStoreStats stats_;
+    /**
+     * @brief counted outside the lock, unlike the rest of stats_
+     */
+    boost::atomic<size_t> hits_;
+};
+
+#endif
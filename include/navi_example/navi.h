@@ -0,0 +1,167 @@
+#ifndef NAVI_H
+#define NAVI_H
+
+/**
+ * @file navi.h
+ * @brief C interface of libnavi, for planning inside another process
+ *
+ * A map is loaded once and then planned on any number of times. Planning
+ * writes the path straight into a buffer owned by the caller. A map may be
+ * planned on from several threads at once, also while another thread
+ * updates its obstacles; each plan sees the obstacles as they were when it
+ * started.
+ *
+ * Functions that can fail return a navi_status; navi_status_string()
+ * describes one. Malformed input and internal failures, such as running
+ * out of memory, are reported through the return values, never thrown.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief version of this interface; grows only when functions are added
+ */
+#define NAVI_API_VERSION 1
+
+typedef enum{
+  NAVI_OK = 0,
+  /**
+   * @brief a null pointer or a negative radius was passed
+   */
+  NAVI_INVALID_ARGUMENT = -1,
+  /**
+   * @brief start and goal are in different free space components
+   */
+  NAVI_UNREACHABLE = -2,
+  /**
+   * @brief the search ended without a path
+   */
+  NAVI_NO_PATH = -3,
+  /**
+   * @brief the path did not fit in the buffer; the count holds the size needed
+   */
+  NAVI_BUFFER_TOO_SMALL = -4,
+  /**
+   * @brief the radius was not set up with navi_map_set_radii()
+   */
+  NAVI_RADIUS_NOT_LOADED = -5,
+  /**
+   * @brief obstacles of a tile file cannot be inflated
+   */
+  NAVI_NOT_SUPPORTED = -6,
+  /**
+   * @brief the library failed inside, e.g. it ran out of memory; the map is left as it was
+   */
+  NAVI_INTERNAL_ERROR = -7
+} navi_status;
+
+typedef struct{
+  int32_t x;
+  int32_t y;
+} navi_cell;
+
+/**
+ * @brief what navi_plan() writes into the buffer
+ */
+typedef enum{
+  /**
+   * @brief the jump points: the ends of the straight segments of the path
+   */
+  NAVI_PATH_WAYPOINTS = 0,
+  /**
+   * @brief every cell the path passes through
+   */
+  NAVI_PATH_CELLS = 1
+} navi_path_mode;
+
+/**
+ * @brief a loaded map, opaque to the caller
+ */
+typedef struct navi_map navi_map;
+
+/**
+ * @brief gets the interface version the library was built with
+ * @return NAVI_API_VERSION of the library
+ */
+int navi_api_version(void);
+/**
+ * @brief describes a status
+ * @return a static string
+ */
+const char* navi_status_string(int status);
+
+/**
+ * @brief loads a map from a json description or a tile file
+ * @param path the file
+ * @param threads threads used for loading and updates, 0 for one per core
+ * @return the map, or NULL if it could not be read
+ */
+navi_map* navi_map_load_file(const char* path, int threads);
+/**
+ * @brief loads a map from a json description in memory
+ * @param json the text, need not be terminated
+ * @param size length of the text in bytes
+ * @param threads threads used for loading and updates, 0 for one per core
+ * @return the map, or NULL if it could not be parsed
+ */
+navi_map* navi_map_load_buffer(const char* json, size_t size, int threads);
+/**
+ * @brief releases a map; plans still running on it must have returned
+ */
+void navi_map_free(navi_map* map);
+
+/**
+ * @brief gets the start and goal stored with the map
+ */
+navi_status navi_map_get_start(const navi_map* map, navi_cell* start);
+navi_status navi_map_get_goal(const navi_map* map, navi_cell* goal);
+/**
+ * @brief gets the version of the obstacles, which changes with every update
+ * @return the version, 0 for a null map
+ */
+uint64_t navi_map_get_version(const navi_map* map);
+/**
+ * @brief sets up the robot radii that navi_plan() may be asked for
+ *
+ * radius 0 is always available. Not supported for maps loaded from a tile file.
+ * @param radii robot radii in cells
+ * @param count number of radii
+ */
+navi_status navi_map_set_radii(navi_map* map, const int* radii, size_t count);
+/**
+ * @brief marks cells as occupied, publishing one new version
+ */
+navi_status navi_map_add_obstacles(navi_map* map, const navi_cell* cells, size_t count);
+/**
+ * @brief marks cells as free, publishing one new version
+ */
+navi_status navi_map_remove_obstacles(navi_map* map, const navi_cell* cells, size_t count);
+
+/**
+ * @brief plans a path and copies it into the caller's buffer
+ *
+ * When the path does not fit, nothing is written but the count, which is
+ * set to the size needed, and NAVI_BUFFER_TOO_SMALL is returned.
+ * @param map the map
+ * @param start the start cell
+ * @param goal the goal cell
+ * @param radius robot radius in cells, 0 or one set with navi_map_set_radii()
+ * @param mode whether to write the jump points or every cell
+ * @param path buffer for the path, start first; may be NULL if capacity is 0
+ * @param capacity number of cells the buffer holds
+ * @param count set to the number of cells of the path
+ * @param cost set to the cost of the path, may be NULL
+ */
+navi_status navi_plan(navi_map* map, navi_cell start, navi_cell goal, int radius, navi_path_mode mode,
+                      navi_cell* path, size_t capacity, size_t* count, double* cost);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,292 @@
+#include "navi_example/ConnectivityIndex.h"
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/thread.hpp>
+
+using namespace std;
+
+namespace {
+/**
+ * @brief union-find root with path halving
+ */
+template <typename T>
+T findRoot(vector<T>& parent, T node){
+    while(parent[node] != node){
+        parent[node] = parent[parent[node]];
+        node = parent[node];
+    }
+    return node;
+}
+
+template <typename T>
+void unite(vector<T>& parent, T a, T b){
+    if(parent[a] == parent[b])
+        return;
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if(a != b)
+        parent[max(a,b)] = min(a,b);
+}
+
+/**
+ * @brief labels tiles [begin,end) of a list
+ */
+void labelTiles(const vector<pair<Cell, ObstacleTile::ConstPtr> >* tiles, vector<TileLabels::ConstPtr>* labels, size_t begin, size_t end){
+    for(size_t i=begin; i<end; i++)
+        (*labels)[i] = boost::make_shared<TileLabels>((*tiles)[i].second);
+}
+
+/**
+ * @brief orders tiles by row, then by column
+ */
+bool rowMajor(const pair<Cell, const TileLabels*>& lhs, const pair<Cell, const TileLabels*>& rhs){
+    return lhs.first.y != rhs.first.y ? lhs.first.y < rhs.first.y : lhs.first.x < rhs.first.x;
+}
+}
+
+TileLabels::TileLabels( const ObstacleTile::ConstPtr& tile ) : source(tile), count(0) {
+    const int SIZE = ObstacleTile::SIZE;
+    vector<boost::uint16_t> parent(SIZE*SIZE);
+    for(int y=0; y<SIZE; y++){
+        for(int x=0; x<SIZE; x++){
+            boost::uint16_t node = y*SIZE + x;
+            parent[node] = node;
+            if((tile->rows[y] >> x) & 1)
+                continue;
+            //join with the free neighbours already visited: left, and the three above
+            if(x > 0 && !((tile->rows[y] >> (x-1)) & 1))
+                unite<boost::uint16_t>(parent, node, node-1);
+            if(y > 0){
+                for(int dx=-1; dx<2; dx++){
+                    if(x+dx >= 0 && x+dx < SIZE && !((tile->rows[y-1] >> (x+dx)) & 1))
+                        unite<boost::uint16_t>(parent, node, node-SIZE+dx);
+                }
+            }
+        }
+    }
+    //number the roots in scan order; a root always comes before the rest of its set
+    for(int node=0; node<SIZE*SIZE; node++){
+        if((tile->rows[node/SIZE] >> (node%SIZE)) & 1)
+            labels[node] = 0;
+        else if(findRoot<boost::uint16_t>(parent, node) == node)
+            labels[node] = ++count;
+        else
+            labels[node] = labels[findRoot<boost::uint16_t>(parent, node)];
+    }
+}
+
+ConnectivityIndex::ConnectivityIndex( const TileTable& blocked, int threads, ConstPtr previous ) :
+    min_tile_(0,0), max_tile_(-1,-1), outside_(0), num_components_(1)
+{
+    //reuse the labels of tiles that did not change, and collect the rest
+    vector<pair<Cell, ObstacleTile::ConstPtr> > changed;
+    for(TileTable::const_iterator tile_it = blocked.begin(); tile_it != blocked.end(); ++tile_it){
+        if(previous){
+            boost::unordered_map<Cell, TileLabels::ConstPtr>::const_iterator label_it = previous->labels_.find(tile_it->first);
+            if(label_it != previous->labels_.end() && label_it->second->source == tile_it->second){
+                labels_[tile_it->first] = label_it->second;
+                continue;
+            }
+        }
+        changed.push_back(*tile_it);
+    }
+
+    //label the changed tiles, split over the threads when there are enough of them
+    vector<TileLabels::ConstPtr> changed_labels(changed.size());
+    threads = max(1, min(threads, int(changed.size()/16)));
+    if(threads == 1){
+        labelTiles(&changed, &changed_labels, 0, changed.size());
+    }
+    else{
+        boost::thread_group workers;
+        for(int i=0; i<threads; i++)
+            workers.create_thread(boost::bind(&labelTiles, &changed, &changed_labels,
+                                              changed.size()*i/threads, changed.size()*(i+1)/threads));
+        workers.join_all();
+    }
+    for(size_t i=0; i<changed.size(); i++)
+        labels_[changed[i].first] = changed_labels[i];
+
+    if(labels_.empty())
+        return;
+    int num_nodes = buildRows();
+    vector<int> parent(num_nodes);
+    for(int node=0; node<num_nodes; node++)
+        parent[node] = node;
+
+    //a band is one run across the box and its empty ring, like the ends of every row
+    Segment band = {min_tile_.x-1, max_tile_.x+1, NULL, 0};
+    vector<Segment> band_line(1, band);
+    for(size_t i=0; i<=rows_.size(); i++){
+        if(i < rows_.size()){
+            const vector<Segment>& segments = rows_[i].segments;
+            for(size_t j=0; j+1<segments.size(); j++)
+                joinAcross(segments[j], segments[j+1], parent);
+        }
+        //the line above row i is the band before it, or the previous row if they are adjacent
+        if(band_nodes_[i] >= 0){
+            band_line[0].node = band_nodes_[i];
+            if(i > 0)
+                joinLines(rows_[i-1].segments, band_line, parent);
+            if(i < rows_.size())
+                joinLines(band_line, rows_[i].segments, parent);
+        }
+        else{
+            joinLines(rows_[i-1].segments, rows_[i].segments, parent);
+        }
+    }
+
+    //flatten to component numbers
+    components_.resize(num_nodes);
+    num_components_ = 0;
+    for(int node=0; node<num_nodes; node++){
+        int root = findRoot<int>(parent, node);
+        components_[node] = (root == node) ? int(num_components_++) : components_[root];
+    }
+    outside_ = components_[band_nodes_[0]];
+}
+
+int ConnectivityIndex::buildRows(){
+    vector<pair<Cell, const TileLabels*> > tiles;
+    tiles.reserve(labels_.size());
+    for(boost::unordered_map<Cell, TileLabels::ConstPtr>::const_iterator label_it = labels_.begin(); label_it != labels_.end(); ++label_it)
+        tiles.push_back(make_pair(label_it->first, label_it->second.get()));
+    sort(tiles.begin(), tiles.end(), rowMajor);
+    min_tile_ = max_tile_ = tiles[0].first;
+    for(size_t i=0; i<tiles.size(); i++){
+        min_tile_ = Cell(min(min_tile_.x, tiles[i].first.x), min(min_tile_.y, tiles[i].first.y));
+        max_tile_ = Cell(max(max_tile_.x, tiles[i].first.x), max(max_tile_.y, tiles[i].first.y));
+    }
+
+    //rows of tiles and the empty runs between them; the ring column on
+    //either side of the box keeps a run at both ends of every row
+    int num_nodes = 0;
+    size_t i = 0;
+    while(i < tiles.size()){
+        Row row;
+        row.y = tiles[i].first.y;
+        int next_free = min_tile_.x-1;
+        for(; i < tiles.size() && tiles[i].first.y == row.y; i++){
+            int x = tiles[i].first.x;
+            if(x > next_free){
+                Segment run = {next_free, x-1, NULL, num_nodes++};
+                row.segments.push_back(run);
+            }
+            Segment tile = {x, x, tiles[i].second, num_nodes};
+            row.segments.push_back(tile);
+            num_nodes += tiles[i].second->count;
+            next_free = x+1;
+        }
+        Segment run = {next_free, max_tile_.x+1, NULL, num_nodes++};
+        row.segments.push_back(run);
+        rows_.push_back(row);
+    }
+
+    //a band before the first row and after the last one, for the empty ring, and in every gap between rows
+    band_nodes_.assign(rows_.size()+1, -1);
+    for(size_t r=0; r<=rows_.size(); r++){
+        if(r == 0 || r == rows_.size() || rows_[r].y > rows_[r-1].y+1)
+            band_nodes_[r] = num_nodes++;
+    }
+    return num_nodes;
+}
+
+void ConnectivityIndex::joinAcross( const Segment& left, const Segment& right, vector<int>& parent ){
+    const int SIZE = ObstacleTile::SIZE;
+    //last column of the left segment against the first column of the right one
+    for(int y=0; y<SIZE; y++){
+        int label = localLabel(left.tile, SIZE-1, y);
+        if(!label)
+            continue;
+        for(int dy=-1; dy<2; dy++){
+            if(y+dy < 0 || y+dy >= SIZE)
+                continue;
+            int right_label = localLabel(right.tile, 0, y+dy);
+            if(right_label)
+                unite<int>(parent, left.node+label-1, right.node+right_label-1);
+        }
+    }
+}
+
+void ConnectivityIndex::joinDown( const Segment& upper, const Segment& lower, vector<int>& parent ){
+    const int SIZE = ObstacleTile::SIZE;
+    //two runs are free all the way, so any touch joins them
+    if(!upper.tile && !lower.tile){
+        unite<int>(parent, upper.node, lower.node);
+        return;
+    }
+    //otherwise walk the cells of the one-tile segment: last row of the upper one against the first row of the lower one
+    const Segment& narrow = upper.tile ? upper : lower;
+    const Segment& other = upper.tile ? lower : upper;
+    int sign = upper.tile ? 1 : -1;
+    for(int x=0; x<SIZE; x++){
+        int narrow_x = narrow.left*SIZE + x;
+        for(int dx=-1; dx<2; dx++){
+            int other_x = narrow_x + dx;
+            int other_tile = other_x >> ObstacleTile::BITS;
+            if(other_tile < other.left || other_tile > other.right)
+                continue;
+            int upper_x = sign > 0 ? narrow_x : other_x;
+            int lower_x = sign > 0 ? other_x : narrow_x;
+            int upper_label = localLabel(upper.tile, upper_x & (SIZE-1), SIZE-1);
+            int lower_label = localLabel(lower.tile, lower_x & (SIZE-1), 0);
+            if(upper_label && lower_label)
+                unite<int>(parent, upper.node+upper_label-1, lower.node+lower_label-1);
+        }
+    }
+}
+
+void ConnectivityIndex::joinLines( const vector<Segment>& upper, const vector<Segment>& lower, vector<int>& parent ){
+    //both lines are sorted and cover the same columns, so the segments below one
+    //above start where the last one ended, give or take a diagonal step
+    size_t first = 0;
+    for(size_t i=0; i<upper.size(); i++){
+        while(first < lower.size() && lower[first].right < upper[i].left-1)
+            first++;
+        for(size_t j=first; j<lower.size() && lower[j].left <= upper[i].right+1; j++)
+            joinDown(upper[i], lower[j], parent);
+    }
+}
+
+int ConnectivityIndex::getComponent( const Cell& cell ) const {
+    Cell tile = MapSnapshot::tileOf(cell);
+    if(rows_.empty() || tile.x < min_tile_.x || tile.x > max_tile_.x || tile.y < min_tile_.y || tile.y > max_tile_.y)
+        return outside_;
+    //binary search for the row, then for the segment holding the column
+    size_t low = 0, high = rows_.size();
+    while(low < high){
+        size_t middle = (low+high)/2;
+        if(rows_[middle].y < tile.y)
+            low = middle+1;
+        else
+            high = middle;
+    }
+    if(low == rows_.size() || rows_[low].y != tile.y)
+        return components_[band_nodes_[low]];
+    const vector<Segment>& segments = rows_[low].segments;
+    size_t first = 0, last = segments.size();
+    while(first < last){
+        size_t middle = (first+last)/2;
+        if(segments[middle].right < tile.x)
+            first = middle+1;
+        else
+            last = middle;
+    }
+    const Segment& segment = segments[first];
+    int label = localLabel(segment.tile, cell.x & (ObstacleTile::SIZE-1), cell.y & (ObstacleTile::SIZE-1));
+    if(!label)
+        return -1;
+    return components_[segment.node + label - 1];
+}
+
+bool ConnectivityIndex::isConnected( const Cell& a, const Cell& b ) const {
+    int component = getComponent(a);
+    return component >= 0 && component == getComponent(b);
+}
+
+size_t ConnectivityIndex::getNumComponents() const {
+    return num_components_;
+}
@@ -0,0 +1,249 @@
+#include "navi_example/DStarLite.h"
+#include "navi_example/ConnectivityIndex.h"
+#include "navi_example/Graph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+using namespace std;
+
+namespace {
+const double INF = numeric_limits<double>::infinity();
+
+/**
+ * @brief orders the open list heap so the smallest key is on top
+ */
+struct GreaterKey{
+    bool operator()(const pair<pair<double,double>, Cell>& lhs, const pair<pair<double,double>, Cell>& rhs) const {
+        return lhs.first > rhs.first;
+    }
+};
+}
+
+DStarLite::DStarLite(Environment::Ptr env, const Cell& start, const Cell& goal) :
+    env_(env), snapshot_(env->getSnapshot()), start_(start), last_start_(start), goal_(goal), km_(0), num_expansions_(0)
+{
+    //the search runs backwards, so it starts out from the goal
+    values_[goal_].rhs = 0;
+    Key key = calculateKey(goal_);
+    open_keys_[goal_] = key;
+    open_list_.push_back(make_pair(key, goal_));
+}
+
+const DStarLite::Values& DStarLite::getValues(const Cell& cell) const {
+    static const Values UNSEEN;
+    boost::unordered_map<Cell, Values>::const_iterator it = values_.find(cell);
+    return it == values_.end() ? UNSEEN : it->second;
+}
+
+double DStarLite::getG(const Cell& cell) const {
+    return getValues(cell).g;
+}
+
+double DStarLite::getRhs(const Cell& cell) const {
+    return getValues(cell).rhs;
+}
+
+double DStarLite::heuristic(const Cell& from, const Cell& to) const {
+    int dx = abs(from.x - to.x);
+    int dy = abs(from.y - to.y);
+    return double(Graph::DIAGONAL_COST)*min(dx,dy) + double(Graph::STRAIGHT_COST)*(max(dx,dy)-min(dx,dy));
+}
+
+double DStarLite::stepCost(const Cell& from, const Cell& to){
+    return (from.x != to.x && from.y != to.y) ? Graph::DIAGONAL_COST : Graph::STRAIGHT_COST;
+}
+
+double DStarLite::cost(const Cell& from, const Cell& to){
+    if(!snapshot_->isCollisionFree(from) || !snapshot_->isCollisionFree(to))
+        return INF;
+    return stepCost(from, to);
+}
+
+DStarLite::Key DStarLite::calculateKey(const Cell& cell) const {
+    const Values& values = getValues(cell);
+    double best = min(values.g, values.rhs);
+    return Key(best + heuristic(start_, cell) + km_, best);
+}
+
+void DStarLite::updateVertex(const Cell& cell){
+    if(!(cell == goal_))
+        values_[cell].rhs = lookahead(cell);
+    updateQueue(cell);
+}
+
+double DStarLite::lookahead(const Cell& cell){
+    double best = INF;
+    for(int dx=-1; dx<2; dx++){
+        for(int dy=-1; dy<2; dy++){
+            if(dx==0 && dy==0)
+                continue;
+            Cell neighbor(cell.x+dx, cell.y+dy);
+            best = min(best, cost(cell, neighbor) + getG(neighbor));
+        }
+    }
+    return best;
+}
+
+void DStarLite::updateQueue(const Cell& cell){
+    //drop the old entry lazily and queue it again if inconsistent
+    open_keys_.erase(cell);
+    const Values& values = getValues(cell);
+    if(values.g != values.rhs){
+        Key key = calculateKey(cell);
+        open_keys_[cell] = key;
+        open_list_.push_back(make_pair(key, cell));
+        push_heap(open_list_.begin(), open_list_.end(), GreaterKey());
+    }
+}
+
+bool DStarLite::topKey(Key& key, Cell& cell){
+    while(!open_list_.empty()){
+        const QueueEntry& top = open_list_.front();
+        boost::unordered_map<Cell, Key>::const_iterator it = open_keys_.find(top.second);
+        if(it != open_keys_.end() && it->second == top.first){
+            key = top.first;
+            cell = top.second;
+            return true;
+        }
+        pop_heap(open_list_.begin(), open_list_.end(), GreaterKey());
+        open_list_.pop_back();
+    }
+    return false;
+}
+
+void DStarLite::computeShortestPath(){
+    Key k_old;
+    Cell u;
+    while(topKey(k_old, u) && (k_old < calculateKey(start_) || getRhs(start_) != getG(start_))){
+        num_expansions_++;
+        Key k_new = calculateKey(u);
+        pop_heap(open_list_.begin(), open_list_.end(), GreaterKey());
+        open_list_.pop_back();
+        open_keys_.erase(u);
+
+        if(k_old < k_new){
+            //the robot moved since u was queued
+            open_keys_[u] = k_new;
+            open_list_.push_back(make_pair(k_new, u));
+            push_heap(open_list_.begin(), open_list_.end(), GreaterKey());
+        }
+        else if(getG(u) > getRhs(u)){
+            //overconsistent: settle u and relax its neighbours
+            double g_u = getRhs(u);
+            values_[u].g = g_u;
+            for(int dx=-1; dx<2; dx++){
+                for(int dy=-1; dy<2; dy++){
+                    if(dx==0 && dy==0)
+                        continue;
+                    Cell s(u.x+dx, u.y+dy);
+                    double through_u = cost(s, u) + g_u;
+                    if(!(s == goal_) && through_u < getRhs(s)){
+                        values_[s].rhs = through_u;
+                        updateQueue(s);
+                    }
+                }
+            }
+        }
+        else{
+            //underconsistent: u got more expensive, so neighbours that relied on it are recomputed
+            double g_old = getG(u);
+            values_[u].g = INF;
+            updateQueue(u);
+            for(int dx=-1; dx<2; dx++){
+                for(int dy=-1; dy<2; dy++){
+                    if(dx==0 && dy==0)
+                        continue;
+                    Cell s(u.x+dx, u.y+dy);
+                    if(!(s == goal_) && getRhs(s) == cost(s, u) + g_old){
+                        values_[s].rhs = lookahead(s);
+                        updateQueue(s);
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool DStarLite::plan(Path& path){
+    snapshot_ = env_->getSnapshot();
+    path.clear();
+    //the backward search would never run out of free space to expand if the robot is walled off
+    const ConnectivityIndex* connectivity = snapshot_->getConnectivity(0);
+    if(connectivity && !connectivity->isConnected(start_, goal_))
+        return false;
+    computeShortestPath();
+    if(getG(start_) == INF)
+        return false;
+
+    //follow the cheapest neighbour, keeping a waypoint wherever the direction changes
+    Cell current = start_;
+    Values current_values = getValues(start_);
+    path.addWaypoint(current);
+    Direction last_dir(0,0);
+    while(!(current == goal_)){
+        //costs are whole numbers, so on a consistent cell a step that accounts for all of
+        //its g exactly is a cheapest one, and the other neighbours need not be looked at
+        Cell ahead = current + last_dir;
+        const Values& ahead_values = getValues(ahead);
+        if(!(ahead == current) && current_values.g == current_values.rhs &&
+           stepCost(current, ahead) + ahead_values.g == current_values.g && snapshot_->isCollisionFree(ahead)){
+            current = ahead;
+            current_values = ahead_values;
+            continue;
+        }
+        //the cells on the way are free, and a neighbour is only checked if it would be the best
+        Cell best_next = current;
+        Values best_values;
+        double best = INF;
+        for(int dx=-1; dx<2; dx++){
+            for(int dy=-1; dy<2; dy++){
+                if(dx==0 && dy==0)
+                    continue;
+                Cell next(current.x+dx, current.y+dy);
+                const Values& next_values = getValues(next);
+                double through = stepCost(current, next) + next_values.g;
+                if(through < best && snapshot_->isCollisionFree(next)){
+                    best = through;
+                    best_next = next;
+                    best_values = next_values;
+                }
+            }
+        }
+        if(best == INF)
+            return false;
+        Direction dir = best_next - current;
+        if(!(current == path.getWaypoints().back()) && (dir.getX() != last_dir.getX() || dir.getY() != last_dir.getY()))
+            path.addWaypoint(current);
+        last_dir = dir;
+        current = best_next;
+        current_values = best_values;
+    }
+    if(!(path.getWaypoints().back() == goal_))
+        path.addWaypoint(goal_);
+    return true;
+}
+
+void DStarLite::moveStart(const Cell& start){
+    start_ = start;
+    km_ += heuristic(last_start_, start_);
+    last_start_ = start_;
+}
+
+void DStarLite::updateCells(const vector<Cell>& cells){
+    snapshot_ = env_->getSnapshot();
+    //every edge touching a changed cell changed cost
+    for(size_t i=0; i<cells.size(); i++){
+        for(int dx=-1; dx<2; dx++){
+            for(int dy=-1; dy<2; dy++){
+                updateVertex(Cell(cells[i].x+dx, cells[i].y+dy));
+            }
+        }
+    }
+}
+
+size_t DStarLite::getNumExpansions() const {
+    return num_expansions_;
+}
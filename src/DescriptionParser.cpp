@@ -0,0 +1,280 @@
+#include "navi_example/DescriptionParser.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/thread.hpp>
+
+using namespace std;
+
+namespace {
+const char* skipSpace(const char* pos, const char* end){
+    while(pos < end && (*pos == ' ' || *pos == '\n' || *pos == '\r' || *pos == '\t'))
+        pos++;
+    return pos;
+}
+}
+
+DescriptionParser::DescriptionParser( int threads ) : threads_(max(1, threads)), num_records_(0) {}
+
+bool DescriptionParser::parseNumber( const char*& pos, const char* end, int& value ){
+    const char* begin = pos;
+    bool negative = false;
+    if(pos < end && *pos == '-'){
+        negative = true;
+        pos++;
+    }
+    if(pos == end || *pos < '0' || *pos > '9')
+        return false;
+    long magnitude = 0;
+    while(pos < end && *pos >= '0' && *pos <= '9' && magnitude < 100000000000L)
+        magnitude = magnitude*10 + (*pos++ - '0');
+    if(pos < end && (*pos == '.' || *pos == 'e' || *pos == 'E' || (*pos >= '0' && *pos <= '9'))){
+        //not a plain integer; read it as a double and truncate, like the general parser
+        char* number_end;
+        double real = strtod(begin, &number_end);
+        if(number_end == begin || number_end > end || !(real >= INT_MIN && real <= INT_MAX))
+            return false;
+        pos = number_end;
+        value = int(real);
+        return true;
+    }
+    if(magnitude > (negative ? -long(INT_MIN) : long(INT_MAX)))
+        return false;
+    value = int(negative ? -magnitude : magnitude);
+    return true;
+}
+
+bool DescriptionParser::parsePair( const char*& pos, const char* end, Cell& cell ){
+    pos = skipSpace(pos, end);
+    if(pos == end || *pos != '[')
+        return false;
+    pos = skipSpace(pos+1, end);
+    if(!parseNumber(pos, end, cell.x))
+        return false;
+    pos = skipSpace(pos, end);
+    if(pos == end || *pos != ',')
+        return false;
+    pos = skipSpace(pos+1, end);
+    if(!parseNumber(pos, end, cell.y))
+        return false;
+    pos = skipSpace(pos, end);
+    if(pos == end || *pos != ']')
+        return false;
+    pos++;
+    return true;
+}
+
+bool DescriptionParser::skipValue( const char*& pos, const char* end ){
+    //good enough for values without brackets inside strings
+    int depth = 0;
+    bool in_string = false;
+    for(; pos < end; pos++){
+        char c = *pos;
+        if(in_string){
+            if(c == '\\')
+                pos++;
+            else if(c == '"')
+                in_string = false;
+            continue;
+        }
+        if(c == '"')
+            in_string = true;
+        else if(c == '[' || c == '{')
+            depth++;
+        else if(c == ']' || c == '}'){
+            if(depth == 0)
+                return true;
+            depth--;
+        }
+        else if(c == ',' && depth == 0)
+            return true;
+    }
+    return depth == 0;
+}
+
+bool DescriptionParser::parse( const string& json ){
+    const char* pos = json.c_str();
+    const char* end = pos + json.size();
+    const char* array_begin = NULL;
+    const char* array_end = NULL;
+    bool has_start = false, has_goal = false;
+
+    //walk the keys of the top level object
+    pos = skipSpace(pos, end);
+    if(pos == end || *pos != '{')
+        return false;
+    pos++;
+    while(true){
+        pos = skipSpace(pos, end);
+        if(pos < end && *pos == '}')
+            break;
+        if(pos == end || *pos != '"')
+            return false;
+        const char* key_end = static_cast<const char*>(memchr(pos+1, '"', end-pos-1));
+        if(!key_end)
+            return false;
+        string key(pos+1, key_end);
+        pos = skipSpace(key_end+1, end);
+        if(pos == end || *pos != ':')
+            return false;
+        pos = skipSpace(pos+1, end);
+
+        if(key == "robotStart"){
+            if(!parsePair(pos, end, start_))
+                return false;
+            has_start = true;
+        }
+        else if(key == "robotEnd"){
+            if(!parsePair(pos, end, goal_))
+                return false;
+            has_goal = true;
+        }
+        else if(key == "obstacles"){
+            if(pos == end || *pos != '[')
+                return false;
+            //find the closing bracket; the pairs hold nothing but numbers
+            array_begin = ++pos;
+            int depth = 1;
+            for(; pos < end && depth > 0; pos++){
+                if(*pos == '[')
+                    depth++;
+                else if(*pos == ']')
+                    depth--;
+                else if(*pos == '"' || *pos == '{')
+                    return false;
+                if(depth > 2)
+                    return false;
+            }
+            if(depth != 0)
+                return false;
+            array_end = pos-1;
+        }
+        else if(!skipValue(pos, end)){
+            return false;
+        }
+
+        pos = skipSpace(pos, end);
+        if(pos < end && *pos == ','){
+            pos++;
+            continue;
+        }
+        if(pos < end && *pos == '}')
+            break;
+        return false;
+    }
+    if(!has_start || !has_goal || !array_begin)
+        return false;
+
+    //cut the array into chunks; a chunk owns the pairs whose '[' lies in it
+    vector<const char*> cuts(threads_+1);
+    cuts[0] = array_begin;
+    cuts[threads_] = array_end;
+    for(int i=1; i<threads_; i++){
+        const char* cut = max(cuts[i-1], array_begin + (array_end-array_begin)*i/threads_);
+        const char* close = static_cast<const char*>(memchr(cut, ']', array_end-cut));
+        const char* open = close ? static_cast<const char*>(memchr(close, '[', array_end-close)) : NULL;
+        cuts[i] = open ? open : array_end;
+    }
+
+    vector<Shard> shards(threads_);
+    vector<size_t> records(threads_, 0);
+    vector<char> ok(threads_, false);
+    if(threads_ == 1){
+        parseChunk(cuts[0], cuts[1], &shards[0], &records[0], &ok[0]);
+    }
+    else{
+        boost::thread_group workers;
+        for(int i=0; i<threads_; i++)
+            workers.create_thread(boost::bind(&DescriptionParser::parseChunk, this, cuts[i], cuts[i+1], &shards[i], &records[i], &ok[i]));
+        workers.join_all();
+    }
+    bool all_ok = true;
+    num_records_ = 0;
+    for(int i=0; i<threads_; i++){
+        all_ok = all_ok && ok[i];
+        num_records_ += records[i];
+    }
+    if(!all_ok)
+        return false;
+
+    //each thread merges the tiles of its share of coordinates from every shard
+    vector<MapSnapshot::TileMap> merged(threads_);
+    if(threads_ == 1){
+        mergeShare(&shards, 0, 1, &merged[0]);
+    }
+    else{
+        boost::thread_group workers;
+        for(int i=0; i<threads_; i++)
+            workers.create_thread(boost::bind(&DescriptionParser::mergeShare, this, &shards, i, threads_, &merged[i]));
+        workers.join_all();
+    }
+    tiles_.clear();
+    for(int i=0; i<threads_; i++)
+        tiles_.insert(merged[i].begin(), merged[i].end());
+    return true;
+}
+
+void DescriptionParser::parseChunk( const char* begin, const char* end, Shard* shard, size_t* records, char* ok ){
+    *ok = true;
+    const char* pos = begin;
+    Cell cell;
+    while(true){
+        const char* open = static_cast<const char*>(memchr(pos, '[', end-pos));
+        if(!open)
+            break;
+        pos = open;
+        //chunks end at the '[' of the next pair, so a pair never runs past the end
+        if(!parsePair(pos, end, cell)){
+            *ok = false;
+            return;
+        }
+        (*records)++;
+        ObstacleTile::Ptr& tile = (*shard)[MapSnapshot::tileOf(cell)];
+        if(!tile)
+            tile = boost::make_shared<ObstacleTile>();
+        tile->rows[cell.y & (ObstacleTile::SIZE-1)] |= boost::uint64_t(1) << (cell.x & (ObstacleTile::SIZE-1));
+    }
+}
+
+void DescriptionParser::mergeShare( const vector<Shard>* shards, int share, int num_shares, MapSnapshot::TileMap* merged ){
+    Shard tiles;
+    boost::hash<Cell> hasher;
+    for(size_t i=0; i<shards->size(); i++){
+        for(Shard::const_iterator tile_it = (*shards)[i].begin(); tile_it != (*shards)[i].end(); ++tile_it){
+            if(int(hasher(tile_it->first) % num_shares) != share)
+                continue;
+            ObstacleTile::Ptr& tile = tiles[tile_it->first];
+            if(!tile){
+                tile = tile_it->second;
+                continue;
+            }
+            for(int y=0; y<ObstacleTile::SIZE; y++)
+                tile->rows[y] |= tile_it->second->rows[y];
+        }
+    }
+    for(Shard::iterator tile_it = tiles.begin(); tile_it != tiles.end(); ++tile_it){
+        tile_it->second->updateColumns();
+        (*merged)[tile_it->first] = tile_it->second;
+    }
+}
+
+Cell DescriptionParser::getStart() const {
+    return start_;
+}
+
+Cell DescriptionParser::getGoal() const {
+    return goal_;
+}
+
+const MapSnapshot::TileMap& DescriptionParser::getTiles() const {
+    return tiles_;
+}
+
+size_t DescriptionParser::getNumRecords() const {
+    return num_records_;
+}
@@ -0,0 +1,133 @@
+#include "navi_example/DistanceTransform.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+using namespace std;
+
+DistanceTransform::DistanceTransform(const MapSnapshot& snapshot, const Cell& min_cell, int width, int height, int threads) :
+    min_cell_(min_cell), width_(width), height_(height), distances_(size_t(width)*height, min(width+height, 16383))
+{
+    //seed the obstacles inside the window with distance 0
+    Cell min_tile = MapSnapshot::tileOf(min_cell_);
+    Cell max_tile = MapSnapshot::tileOf(Cell(min_cell_.x+width_-1, min_cell_.y+height_-1));
+    //look the window up tile by tile when that is cheaper than walking the whole map
+    const TileTable& obstacles = snapshot.getTiles();
+    vector<pair<Cell, ObstacleTile::ConstPtr> > tiles;
+    if(size_t(max_tile.x-min_tile.x+1)*(max_tile.y-min_tile.y+1) < obstacles.size()){
+        for(int ty=min_tile.y; ty<=max_tile.y; ty++){
+            for(int tx=min_tile.x; tx<=max_tile.x; tx++){
+                const ObstacleTile::ConstPtr& tile = obstacles.find(Cell(tx,ty));
+                if(tile)
+                    tiles.push_back(make_pair(Cell(tx,ty), tile));
+            }
+        }
+    }
+    else{
+        for(TileTable::const_iterator tile_it = obstacles.begin(); tile_it != obstacles.end(); ++tile_it){
+            const Cell& tile = tile_it->first;
+            if(tile.x >= min_tile.x && tile.x <= max_tile.x && tile.y >= min_tile.y && tile.y <= max_tile.y)
+                tiles.push_back(*tile_it);
+        }
+    }
+    vector<Cell> cells;
+    for(size_t t=0; t<tiles.size(); t++){
+        cells.clear();
+        tiles[t].second->appendCells(tiles[t].first, cells);
+        for(size_t i=0; i<cells.size(); i++){
+            int x = cells[i].x - min_cell_.x;
+            int y = cells[i].y - min_cell_.y;
+            if(x >= 0 && x < width_ && y >= 0 && y < height_)
+                distances_[size_t(y)*width_+x] = 0;
+        }
+    }
+    runParallel(&DistanceTransform::sweepColumns, width_, threads);
+    runParallel(&DistanceTransform::sweepRows, height_, threads);
+}
+
+void DistanceTransform::runParallel(void (DistanceTransform::*pass)(int, int), int count, int threads){
+    threads = max(1, min(threads, count));
+    if(threads == 1){
+        (this->*pass)(0, count);
+        return;
+    }
+    boost::thread_group workers;
+    for(int i=0; i<threads; i++)
+        workers.create_thread(boost::bind(pass, this, int(size_t(count)*i/threads), int(size_t(count)*(i+1)/threads)));
+    workers.join_all();
+}
+
+void DistanceTransform::sweepColumns(int begin, int end){
+    //downwards then upwards; the inner loop is over neighbouring columns
+    for(int y=1; y<height_; y++){
+        int* row = &distances_[size_t(y)*width_];
+        const int* above = row - width_;
+        for(int x=begin; x<end; x++)
+            row[x] = min(row[x], above[x]+1);
+    }
+    for(int y=height_-2; y>=0; y--){
+        int* row = &distances_[size_t(y)*width_];
+        const int* below = row + width_;
+        for(int x=begin; x<end; x++)
+            row[x] = min(row[x], below[x]+1);
+    }
+}
+
+void DistanceTransform::sweepRows(int begin, int end){
+    //scratch space for the lower envelope, per thread
+    vector<double> f(width_);
+    vector<int> v(width_);
+    vector<double> z(width_+1);
+    for(int y=begin; y<end; y++){
+        int* row = &distances_[size_t(y)*width_];
+        for(int x=0; x<width_; x++)
+            f[x] = double(row[x])*row[x];
+
+        //lower envelope of the parabolas rooted at every column
+        int k = 0;
+        v[0] = 0;
+        z[0] = -numeric_limits<double>::infinity();
+        z[1] = numeric_limits<double>::infinity();
+        for(int q=1; q<width_; q++){
+            double s = ((f[q]+double(q)*q) - (f[v[k]]+double(v[k])*v[k])) / (2.0*(q-v[k]));
+            while(s <= z[k]){
+                k--;
+                s = ((f[q]+double(q)*q) - (f[v[k]]+double(v[k])*v[k])) / (2.0*(q-v[k]));
+            }
+            k++;
+            v[k] = q;
+            z[k] = s;
+            z[k+1] = numeric_limits<double>::infinity();
+        }
+
+        //read the envelope back out
+        k = 0;
+        for(int q=0; q<width_; q++){
+            while(z[k+1] < q)
+                k++;
+            //in double, since the square of a column offset overflows int past 46340
+            row[q] = int(double(q-v[k])*(q-v[k]) + f[v[k]]);
+        }
+    }
+}
+
+int DistanceTransform::getSquaredDistance(const Cell& cell) const {
+    return distances_[size_t(cell.y-min_cell_.y)*width_ + (cell.x-min_cell_.x)];
+}
+
+void DistanceTransform::inflateTile(const Cell& tile, int radius, ObstacleTile& inflated) const {
+    int squared_radius = radius*radius;
+    int x0 = (tile.x << ObstacleTile::BITS) - min_cell_.x;
+    int y0 = (tile.y << ObstacleTile::BITS) - min_cell_.y;
+    for(int y=0; y<ObstacleTile::SIZE; y++){
+        const int* row = &distances_[size_t(y0+y)*width_ + x0];
+        boost::uint64_t bits = 0;
+        for(int x=0; x<ObstacleTile::SIZE; x++)
+            bits |= boost::uint64_t(row[x] <= squared_radius) << x;
+        inflated.rows[y] = bits;
+    }
+    inflated.updateColumns();
+}
@@ -1,51 +1,188 @@
 #include "navi_example/Environment.h"
 
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <iostream>
 #include <sstream>
 #include <ostream>
 #include <boost/foreach.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/property_tree/json_parser.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "navi_example/DescriptionParser.h"
+#include "navi_example/QueryStats.h"
+#include "navi_example/TileStore.h"
 
 using namespace std;
 
-Environment::Environment(){
+namespace {
+/**
+ * @brief a coordinate truncated to an int; throws like a malformed file when it is not a number in int range
+ */
+int readCoordinate( const boost::property_tree::ptree& node ){
+  double value = node.get_value<double>();
+  if(!(value >= INT_MIN && value <= INT_MAX))
+    throw boost::property_tree::ptree_bad_data("coordinate out of range: " + node.data(), node.data());
+  return int(value);
+}
+}
+
+Environment::Environment() : snapshot_(boost::make_shared<MapSnapshot>()), last_publish_us_(0),
+  num_threads_(max(1u, boost::thread::hardware_concurrency())), verbose_(true) {
 }
 
 void Environment::readDescription( const ifstream& json ){
   //read the file in
   stringstream buffer;
   buffer << json.rdbuf();
-  //populate parse tree
-  boost::property_tree::ptree pt;
-  boost::property_tree::read_json(buffer, pt);
-  
-  //fill in the environment
-  start_ = boost::make_shared<Cell>( readCoordinates( pt.get_child("robotStart") ) );
-  goal_ = boost::make_shared<Cell>( readCoordinates( pt.get_child("robotEnd") ) );
-
-  cout << "Start:" << *start_ << endl;
-  cout << "Goal:" << *goal_ << endl;
-  
-  //put the obstacles
-  BOOST_FOREACH( const boost::property_tree::ptree::value_type& obstacle, pt.get_child("obstacles")){
-    vector<int> coords;
-    BOOST_FOREACH( const boost::property_tree::ptree::value_type& coordinates, obstacle.second ){
-      coords.push_back(coordinates.second.get_value<double>());
+  readDescription( buffer.str() );
+}
+
+void Environment::readDescription( const string& text ){
+  NAVI_PHASE(LOAD);
+  //the data set layout is parsed on every thread, anything else goes through the parse tree
+  MapSnapshot::Clock::time_point began = MapSnapshot::Clock::now();
+  DescriptionParser parser(num_threads_);
+  bool fast = parser.parse(text);
+  vector<Cell> obstacles;
+  if(fast){
+    start_ = boost::make_shared<Cell>( parser.getStart() );
+    goal_ = boost::make_shared<Cell>( parser.getGoal() );
+  }
+  else{
+    stringstream buffer(text);
+    boost::property_tree::ptree pt;
+    boost::property_tree::read_json(buffer, pt);
+    start_ = boost::make_shared<Cell>( readCoordinates( pt.get_child("robotStart") ) );
+    goal_ = boost::make_shared<Cell>( readCoordinates( pt.get_child("robotEnd") ) );
+    BOOST_FOREACH( const boost::property_tree::ptree::value_type& obstacle, pt.get_child("obstacles")){
+      vector<int> coords;
+      BOOST_FOREACH( const boost::property_tree::ptree::value_type& coordinates, obstacle.second ){
+        coords.push_back(readCoordinate(coordinates.second));
+      }
+      obstacles.push_back(Cell(coords));
+    }
+  }
+  double seconds = boost::chrono::duration<double>(MapSnapshot::Clock::now() - began).count();
+
+  if(verbose_){
+    cout << "Start:" << *start_ << endl;
+    cout << "Goal:" << *goal_ << endl;
+    printf("Parsed %zu obstacles (%.1f MB) in %.1f ms, %.1f MB/s with %d %s\n",
+         fast ? parser.getNumRecords() : obstacles.size(), text.size()/1e6, seconds*1e3,
+         text.size()/1e6/max(seconds, 1e-9), fast ? num_threads_ : 1, (fast && num_threads_ > 1) ? "threads" : "thread");
+  }
+
+  //a new description replaces the obstacles, but keeps counting versions
+  boost::mutex::scoped_lock lock(writer_mutex_);
+  MapSnapshot::ConstPtr current = boost::atomic_load(&snapshot_);
+  MapSnapshot::Ptr next;
+  if(fast){
+    next = boost::make_shared<MapSnapshot>( current->getVersion()+1, parser.getTiles() );
+  }
+  else{
+    MapSnapshot base( current->getVersion() );
+    next = base.applyDelta(obstacles, vector<Cell>(), MapSnapshot::Clock::now());
+  }
+  next->setRadii(current->getRadii(), num_threads_);
+  next->updateConnectivity(num_threads_);
+  boost::atomic_store(&snapshot_, MapSnapshot::ConstPtr(next));
+}
+
+bool Environment::loadTiles( const string& path, size_t cache_bytes ){
+  NAVI_PHASE(LOAD);
+  TileStore::Ptr store = TileStore::open(path, cache_bytes/sizeof(ObstacleTile));
+  if(!store)
+    return false;
+  start_ = boost::make_shared<Cell>( store->getStart() );
+  goal_ = boost::make_shared<Cell>( store->getGoal() );
+
+  if(verbose_){
+    cout << "Start:" << *start_ << endl;
+    cout << "Goal:" << *goal_ << endl;
+  }
+
+  //only the index is read here, tiles are read as they are first checked
+  boost::mutex::scoped_lock lock(writer_mutex_);
+  MapSnapshot::Ptr next = boost::make_shared<MapSnapshot>( boost::atomic_load(&snapshot_)->getVersion()+1, store );
+  boost::atomic_store(&snapshot_, MapSnapshot::ConstPtr(next));
+  return true;
+}
+
+bool Environment::writeTiles( const string& path ) const {
+  return TileStore::write(path, *start_, *goal_, *getSnapshot());
+}
+
+void Environment::setClearanceRadii( const vector<int>& radii ){
+  boost::mutex::scoped_lock lock(writer_mutex_);
+  MapSnapshot::Ptr next = boost::atomic_load(&snapshot_)->applyDelta(vector<Cell>(), vector<Cell>(), MapSnapshot::Clock::now());
+  next->setRadii(radii, num_threads_);
+  next->updateConnectivity(num_threads_);
+  boost::atomic_store(&snapshot_, MapSnapshot::ConstPtr(next));
+}
+
+void Environment::setNumThreads( int threads ){
+  num_threads_ = max(1, threads);
+}
+
+void Environment::setVerbose( bool verbose ){
+  verbose_ = verbose;
+}
+
+MapSnapshot::ConstPtr Environment::getSnapshot() const {
+  return boost::atomic_load(&snapshot_);
+}
+
+size_t Environment::applyDelta( const vector<Cell>& add, const vector<Cell>& remove ){
+  MapSnapshot::Clock::time_point submitted = MapSnapshot::Clock::now();
+  boost::mutex::scoped_lock lock(writer_mutex_);
+  MapSnapshot::ConstPtr current = boost::atomic_load(&snapshot_);
+  //only publish if something actually changes, so cached results stay valid otherwise
+  bool changed = false;
+  for(size_t i=0; i<add.size() && !changed; i++)
+    changed = current->isCollisionFree(add[i]);
+  for(size_t i=0; i<remove.size() && !changed; i++)
+    changed = !current->isCollisionFree(remove[i]);
+  if(!changed)
+    return current->getVersion();
+  MapSnapshot::Ptr next = current->applyDelta(add, remove, submitted);
+  if(!next->getRadii().empty()){
+    //only the inflation near the changed cells needs redoing
+    const vector<Cell>& first = add.empty() ? remove : add;
+    Cell min_cell = first[0], max_cell = first[0];
+    for(int pass=0; pass<2; pass++){
+      const vector<Cell>& cells = (pass==0) ? add : remove;
+      for(size_t i=0; i<cells.size(); i++){
+        min_cell = Cell(min(min_cell.x, cells[i].x), min(min_cell.y, cells[i].y));
+        max_cell = Cell(max(max_cell.x, cells[i].x), max(max_cell.y, cells[i].y));
+      }
     }
-    Cell::Ptr obs_cell = boost::make_shared<Cell>(coords);
-    obstacles_.insert(*obs_cell);
+    next->updateClearance(min_cell, max_cell, num_threads_);
   }
+  next->updateConnectivity(num_threads_);
+  boost::atomic_store(&snapshot_, MapSnapshot::ConstPtr(next));
+  last_publish_us_ = boost::chrono::duration<double, boost::micro>(MapSnapshot::Clock::now() - submitted).count();
+  return next->getVersion();
 }
 
-bool Environment::isCollisionFree( const Cell& cell ){
-   return (obstacles_.count(cell)==0); 
+void Environment::addObstacles( const vector<Cell>& cells ){
+  applyDelta(cells, vector<Cell>());
 }
 
+void Environment::removeObstacles( const vector<Cell>& cells ){
+  applyDelta(vector<Cell>(), cells);
+}
+
+double Environment::getLastPublishMicroseconds() const {
+  return last_publish_us_;
+}
 
 vector<int> Environment::readCoordinates( boost::property_tree::ptree& node ){
   vector<int> coord;
   BOOST_FOREACH( const boost::property_tree::ptree::value_type& child, node)
-    coord.push_back(child.second.get_value<double>());
+    coord.push_back(readCoordinate(child.second));
   return coord;
 }
 
@@ -57,6 +194,10 @@ Cell::Ptr Environment::getStart(){
     return start_;
 }
 
+size_t Environment::getVersion() const {
+    return getSnapshot()->getVersion();
+}
+
 ostream& operator<<(ostream& os, const Environment& env){
     env.printStart(os);
     env.printGoal(os);
@@ -65,14 +206,19 @@ ostream& operator<<(ostream& os, const Environment& env){
 }
 
 void Environment::printObstacles(ostream& os) const {
-    for(boost::unordered_set<Cell, boost::hash<Cell> >::iterator obs_it = obstacles_.begin();
-            obs_it != obstacles_.end(); ++obs_it){
-        os << *obs_it << endl;
+    vector<pair<Cell, ObstacleTile::ConstPtr> > tiles;
+    getSnapshot()->collectTiles(tiles);
+    vector<Cell> cells;
+    for(size_t i=0; i<tiles.size(); i++){
+        cells.clear();
+        tiles[i].second->appendCells(tiles[i].first, cells);
+        for(size_t j=0; j<cells.size(); j++)
+            os << cells[j] << '\n';
     }
 }
 void Environment::printStart(ostream& os) const {
-    os << *(start_) << endl;
+    os << *(start_) << '\n';
 }
 void Environment::printGoal(ostream& os) const {
-    os << *goal_ << endl;
+    os << *goal_ << '\n';
 }
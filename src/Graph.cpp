@@ -1,6 +1,10 @@
 #include <navi_example/Graph.h>
+#include <navi_example/ConnectivityIndex.h>
+#include <navi_example/TileStore.h>
 
 #include <math.h>
+#include <algorithm>
+#include <cstdlib>
 #include <boost/make_shared.hpp>
 
 GraphState::GraphState( Cell coordinates ) : coords(coordinates)
@@ -17,12 +21,154 @@ ostream& operator<<(ostream& os, const GraphState& s){
   return os;
 }
 
-Graph::Graph(Environment::Ptr env) : env_(env), verbose(false) {
+Graph::Graph(Environment::Ptr env) : env_(env), snapshot_(env->getSnapshot()), blocked_(snapshot_->getLayer(0)), bounded_(false), radius_(0), start_(*(env->getStart())), goal_(*(env->getGoal())), cost_mode_(FLOATING_POINT), verbose(false) {
+    store_ = snapshot_->getStore();
+    updateBounds();
+}
+
+Graph::Graph(Environment::Ptr env, const Cell& start, const Cell& goal) : env_(env), snapshot_(env->getSnapshot()), blocked_(snapshot_->getLayer(0)), bounded_(false), radius_(0), start_(start), goal_(goal), cost_mode_(FLOATING_POINT), verbose(false) {
+    store_ = snapshot_->getStore();
+    updateBounds();
+}
+
+void Graph::updateBounds(){
+    min_tile_ = Cell(0,0);
+    max_tile_ = Cell(-1,-1);
+    for(TileTable::const_iterator tile_it = blocked_->begin(); tile_it != blocked_->end(); ++tile_it){
+        if(tile_it == blocked_->begin()){
+            min_tile_ = max_tile_ = tile_it->first;
+            continue;
+        }
+        min_tile_ = Cell(min(min_tile_.x, tile_it->first.x), min(min_tile_.y, tile_it->first.y));
+        max_tile_ = Cell(max(max_tile_.x, tile_it->first.x), max(max_tile_.y, tile_it->first.y));
+    }
+    //tiles still on disk count too, known from the tile index
+    if(store_ && store_->getMinTile().x <= store_->getMaxTile().x){
+        if(min_tile_.x > max_tile_.x){
+            min_tile_ = store_->getMinTile();
+            max_tile_ = store_->getMaxTile();
+        }
+        else{
+            min_tile_ = Cell(min(min_tile_.x, store_->getMinTile().x), min(min_tile_.y, store_->getMinTile().y));
+            max_tile_ = Cell(max(max_tile_.x, store_->getMaxTile().x), max(max_tile_.y, store_->getMaxTile().y));
+        }
+    }
+    //nothing beyond the wall can be reached, so it bounds what jumps need to look at
+    if(bounded_){
+        buildFence();
+        min_tile_ = MapSnapshot::tileOf(Cell(min_cell_.x-1, min_cell_.y-1));
+        max_tile_ = MapSnapshot::tileOf(Cell(max_cell_.x+1, max_cell_.y+1));
+    }
+    indexTiles();
+}
 
+void Graph::indexTiles(){
+    row_tiles_.clear();
+    column_tiles_.clear();
+    if(store_)
+        return;
+    for(TileTable::const_iterator tile_it = blocked_->begin(); tile_it != blocked_->end(); ++tile_it){
+        row_tiles_[tile_it->first.y].push_back(tile_it->first.x);
+        column_tiles_[tile_it->first.x].push_back(tile_it->first.y);
+    }
+    for(MapSnapshot::TileMap::const_iterator tile_it = fence_.begin(); tile_it != fence_.end(); ++tile_it){
+        row_tiles_[tile_it->first.y].push_back(tile_it->first.x);
+        column_tiles_[tile_it->first.x].push_back(tile_it->first.y);
+    }
+    boost::unordered_map<int, vector<int> >* indexes[2] = { &row_tiles_, &column_tiles_ };
+    for(int i=0; i<2; i++){
+        for(boost::unordered_map<int, vector<int> >::iterator line_it = indexes[i]->begin(); line_it != indexes[i]->end(); ++line_it){
+            vector<int>& tiles = line_it->second;
+            sort(tiles.begin(), tiles.end());
+            tiles.erase(unique(tiles.begin(), tiles.end()), tiles.end());
+        }
+    }
+}
+
+void Graph::buildFence(){
+    fence_.clear();
+    boost::unordered_map<Cell, ObstacleTile::Ptr> walled;
+    //one ring of occupied cells just outside the box
+    int width = max_cell_.x - min_cell_.x + 3, height = max_cell_.y - min_cell_.y + 3;
+    for(int i=0; i<2*(width+height)-4; i++){
+        Cell cell;
+        if(i < width)
+            cell = Cell(min_cell_.x-1+i, min_cell_.y-1);
+        else if(i < 2*width)
+            cell = Cell(min_cell_.x-1+i-width, max_cell_.y+1);
+        else if(i < 2*width+height-2)
+            cell = Cell(min_cell_.x-1, min_cell_.y+i-2*width);
+        else
+            cell = Cell(max_cell_.x+1, min_cell_.y+i-2*width-height+2);
+        Cell tile = MapSnapshot::tileOf(cell);
+        ObstacleTile::Ptr& copy = walled[tile];
+        if(!copy){
+            const ObstacleTile* obstacles = findTile(tile);
+            copy = obstacles ? boost::make_shared<ObstacleTile>(*obstacles) : boost::make_shared<ObstacleTile>();
+        }
+        copy->rows[cell.y & (ObstacleTile::SIZE-1)] |= boost::uint64_t(1) << (cell.x & (ObstacleTile::SIZE-1));
+    }
+    for(boost::unordered_map<Cell, ObstacleTile::Ptr>::iterator tile_it = walled.begin(); tile_it != walled.end(); ++tile_it){
+        tile_it->second->updateColumns();
+        fence_[tile_it->first] = tile_it->second;
+    }
+}
+
+void Graph::setBounds(const Cell& min_cell, const Cell& max_cell){
+    bounded_ = true;
+    min_cell_ = min_cell;
+    max_cell_ = max_cell;
+    updateBounds();
+}
+
+const ObstacleTile* Graph::faultTile(const Cell& tile) const {
+    MapSnapshot::TileMap::const_iterator tile_it = faulted_.find(tile);
+    if(tile_it == faulted_.end())
+        tile_it = faulted_.insert(make_pair(tile, store_->getTile(tile))).first;
+    return tile_it->second.get();
+}
+
+MapSnapshot::ConstPtr Graph::getSnapshot() const {
+    return snapshot_;
+}
+
+bool Graph::setRadius(int radius){
+    const TileTable* layer = snapshot_->getLayer(radius);
+    if(!layer)
+        return false;
+    blocked_ = layer;
+    radius_ = radius;
+    updateBounds();
+    return true;
+}
+
+bool Graph::isGoalReachable() const {
+    const ConnectivityIndex* connectivity = snapshot_->getConnectivity(radius_);
+    return !connectivity || connectivity->isConnected(start_, goal_);
+}
+
+void Graph::setCostMode(CostMode mode){
+    cost_mode_ = mode;
+}
+
+Graph::CostMode Graph::getCostMode() const {
+    return cost_mode_;
+}
+
+double Graph::getStepCost(const Direction& dir) const {
+    if(cost_mode_ == FIXED_POINT)
+        return dir.isDiagonal() ? DIAGONAL_COST : STRAIGHT_COST;
+    return dir.norm();
 }
 
 double Graph::getHeuristicCost( const GraphState::Ptr& state ){
-   double eu_dist = pow(env_->getGoal()->x - state->coords.x,2) + pow(env_->getGoal()->y - state->coords.y,2);
+   if(cost_mode_ == FIXED_POINT){
+       //octile distance: diagonal steps until aligned, then straight
+       int dx = abs(goal_.x - state->coords.x);
+       int dy = abs(goal_.y - state->coords.y);
+       return DIAGONAL_COST*min(dx,dy) + STRAIGHT_COST*(max(dx,dy)-min(dx,dy));
+   }
+   double eu_dist = pow(goal_.x - state->coords.x,2) + pow(goal_.y - state->coords.y,2);
    return sqrt(eu_dist);
 }
 
@@ -33,20 +179,21 @@ void Graph::getValidSuccessors( const GraphState::Ptr& state, vector<GraphState:
                 continue;
             }
             //8 connected grid
+            NAVI_COUNT(ALLOCATIONS);
             GraphState::Ptr neighbor = boost::make_shared<GraphState>( Cell(state->coords.x+dx, state->coords.y+dy) );
-            if(env_->isCollisionFree( neighbor->coords )){
+            if(isFree( neighbor->coords )){
                 successors.push_back(neighbor);
-                costs.push_back( sqrt(pow(dx,2)+pow(dy,2)) );
+                costs.push_back( getStepCost(Direction(dx,dy)) );
             }
         }
     }
 }
 bool Graph::isGoalState( const GraphState::Ptr& state ){
-    return (state->coords)==*(env_->getGoal());
+    return (state->coords)==goal_;
 }
 
 GraphState::Ptr Graph::getStart(){
-    return boost::make_shared<GraphState>( *(env_->getStart()) );
+    return boost::make_shared<GraphState>( start_ );
 }
 
 
@@ -80,7 +227,7 @@ void Graph::getJumpPointSuccessorsHelper( const GraphState::Ptr& state, const Di
         //this function adds forced neighbors if available
     }
     GraphState::Ptr jump;
-    double cost;
+    double cost = 0;
     //get the next jump point depending on the current states direction
     if(dir.isDiagonal()){
         //if we are jumping diagonally, start off with a horizontal and vertical
@@ -89,11 +236,13 @@ void Graph::getJumpPointSuccessorsHelper( const GraphState::Ptr& state, const Di
             successors.push_back(jump);
             costs.push_back(cost);
         }        
+        cost = 0;
         if(jumpHorizontallyVertically(state, dir.dot(Direction(0,1)), jump, cost, true)){
             successors.push_back(jump);
             costs.push_back(cost);
         }        
         //then jump diagonally from the starting state
+        cost = 0;
         if(jumpDiagonally(state, dir, jump, cost, true)){
             successors.push_back(jump);
             costs.push_back(cost);
@@ -109,74 +258,181 @@ void Graph::getJumpPointSuccessorsHelper( const GraphState::Ptr& state, const Di
 }
 
 bool Graph::jumpHorizontallyVertically( const GraphState::Ptr& state, const Direction& dir, GraphState::Ptr& jump, double& cost, bool start_flag){
-    GraphState::Ptr current = boost::make_shared<GraphState>( state->coords );
-    //if the state we are at is collision free
-    if( env_->isCollisionFree( current->coords ) ){
-        if( isGoalState( current ) ){
-            jump = current;
+    Cell jump_cell;
+    int steps;
+    if(!jumpStraight(state->coords, dir, start_flag, jump_cell, steps))
+        return false;
+    cost += steps*getStepCost(dir);
+    NAVI_COUNT(ALLOCATIONS);
+    jump = boost::make_shared<GraphState>(jump_cell);
+    return true;
+}
+
+bool Graph::nextObstacleNear(int line, int from, int step, bool vertical, int& found) const {
+    int min_tile = vertical ? min_tile_.y : min_tile_.x;
+    int max_tile = vertical ? max_tile_.y : max_tile_.x;
+    int tile = from >> ObstacleTile::BITS;
+    int offset = from & (ObstacleTile::SIZE-1);
+    //nothing lies beyond the bounding box
+    if(step > 0)
+        tile = max(tile, min_tile);
+    else
+        tile = min(tile, max_tile);
+    if(tile != (from >> ObstacleTile::BITS))
+        offset = (step > 0) ? 0 : ObstacleTile::SIZE-1;
+
+    while(min_tile <= tile && tile <= max_tile){
+        boost::uint64_t bits = lineBits(line-1, tile, vertical) | lineBits(line, tile, vertical) | lineBits(line+1, tile, vertical);
+        //keep only the bits at or ahead of the offset
+        if(step > 0)
+            bits &= ~boost::uint64_t(0) << offset;
+        else if(offset < ObstacleTile::SIZE-1)
+            bits &= (boost::uint64_t(1) << (offset+1)) - 1;
+        if(bits){
+            found = (tile << ObstacleTile::BITS) + ((step > 0) ? __builtin_ctzll(bits) : 63 - __builtin_clzll(bits));
             return true;
         }
+        offset = (step > 0) ? 0 : ObstacleTile::SIZE-1;
+        tile += step;
+        //absent tiles hold nothing, go straight to the next one that is there
+        if(!store_ && !nextPresentTile(line, tile, step, vertical, tile))
+            return false;
+    }
+    return false;
+}
+
+bool Graph::nextPresentTile(int line, int tile, int step, bool vertical, int& present) const {
+    const boost::unordered_map<int, vector<int> >& index = vertical ? column_tiles_ : row_tiles_;
+    bool found = false;
+    //the three lines span one or two tile lines
+    for(int tile_line = (line-1) >> ObstacleTile::BITS; tile_line <= ((line+1) >> ObstacleTile::BITS); tile_line++){
+        boost::unordered_map<int, vector<int> >::const_iterator line_it = index.find(tile_line);
+        if(line_it == index.end())
+            continue;
+        const vector<int>& tiles = line_it->second;
+        int nearest;
+        if(step > 0){
+            vector<int>::const_iterator tile_it = lower_bound(tiles.begin(), tiles.end(), tile);
+            if(tile_it == tiles.end())
+                continue;
+            nearest = *tile_it;
+        }
         else{
-            //if the state has a forced neighbor, stop jumping and add state as jump point
-            if( hasForced( current, dir) && !start_flag){
-                jump = current;
-                return true;
-            }
-            else{
-                cost += dir.norm();
-                //generate next step
-                GraphState::Ptr next = boost::make_shared<GraphState>(current->coords + dir);
-                //continue jumping
-                return jumpHorizontallyVertically( next, dir, jump, cost);
-            }
+            vector<int>::const_iterator tile_it = upper_bound(tiles.begin(), tiles.end(), tile);
+            if(tile_it == tiles.begin())
+                continue;
+            nearest = *(tile_it-1);
         }
+        if(!found || (step > 0 ? nearest < present : nearest > present))
+            present = nearest;
+        found = true;
     }
-    else{
-        return false;//current is blocked
+    return found;
+}
+
+bool Graph::jumpStraight(const Cell& from, const Direction& dir, bool start_flag, Cell& jump, int& steps) const {
+    bool vertical = (dir.getX() == 0);
+    int step = vertical ? int(dir.getY()) : int(dir.getX());
+    int line = vertical ? from.x : from.y;
+    int goal_line = vertical ? goal_.x : goal_.y;
+    int goal_position = vertical ? goal_.y : goal_.x;
+    int position = vertical ? from.y : from.x;
+    steps = 0;
+    while(true){
+        Cell current = vertical ? Cell(line, position) : Cell(position, line);
+        if(!isFree(current))
+            return false;
+        if(current == goal_ || (!start_flag && hasForced(current, dir))){
+            jump = current;
+            return true;
+        }
+        start_flag = false;
+
+        //cells with no obstacle on or beside the line can neither block the
+        //jump nor have a forced neighbour, so go straight to the next one that does
+        int next;
+        bool found = nextObstacleNear(line, position+step, step, vertical, next);
+        if(goal_line == line && (goal_position-position)*step > 0 && (!found || (next-goal_position)*step > 0)){
+            next = goal_position;
+            found = true;
+        }
+        if(!found)
+            return false;
+        steps += (next-position)*step;
+        NAVI_COUNT_N(JUMP_STEPS, (next-position)*step);
+        position = next;
     }
 }
 
 bool Graph::jumpDiagonally( const GraphState::Ptr& state, const Direction& dir, GraphState::Ptr& jump, double& cost, bool start_flag){
-    //get diagonal step
-    GraphState::Ptr current = boost::make_shared<GraphState>( state->coords+dir );
-    //if the digaonal step is collision free
-    if(env_->isCollisionFree( current->coords )){
+    Direction horizontal = dir.dot(Direction(1,0));
+    Direction vertical = dir.dot(Direction(0,1));
+    int dx = int(dir.getX());
+    int dy = int(dir.getY());
+    Cell previous = state->coords;
+    while(true){
+        //get diagonal step
+        Cell current = previous + dir;
+        //unable to continue jumping diagonally this way
+        if(!isFree(current))
+            return false;
         //if we jumped to the goal, then we can stop
         //and add the goal as a jump point
-        if( isGoalState( current ) ){
-            jump = current;
+        if(current == goal_){
+            cost += getStepCost(dir);
+            NAVI_COUNT(ALLOCATIONS);
+            jump = boost::make_shared<GraphState>(current);
             return true;
         }
         //if the place we came from has forced neighbor
         //and if it is not the first diagonal step taken
-        if(hasForced(state, dir) && !start_flag){
-            jump = state;
+        if(!start_flag && hasForced(previous, dir)){
+            NAVI_COUNT(ALLOCATIONS);
+            jump = boost::make_shared<GraphState>(previous);
             return true;
         }
+        start_flag = false;
+        cost += getStepCost(dir);
+        NAVI_COUNT(JUMP_STEPS);
         //test if you can jump horizontally and vertically after the diagonal step
         //if you can then add the current diagonal step as a jump point
-        double dummy_cost;
-        bool res_jump_h = jumpHorizontallyVertically( current, dir.dot(Direction(1,0)), jump, dummy_cost, true);
-        if(res_jump_h){
-            jump = current;
+        Cell ignored;
+        int ignored_steps;
+        if(jumpStraight(current, horizontal, true, ignored, ignored_steps) || jumpStraight(current, vertical, true, ignored, ignored_steps)){
+            NAVI_COUNT(ALLOCATIONS);
+            jump = boost::make_shared<GraphState>(current);
             return true;
         }
-        bool res_jump_v = jumpHorizontallyVertically( current, dir.dot(Direction(0,1)), jump, dummy_cost, true);
-        if(res_jump_v){
-            jump = current;
+
+        //once heading away from the obstacles in either axis, no obstacle can
+        //stop the jump anymore; only lining up with the goal gives a jump point
+        int min_x = min_tile_.x << ObstacleTile::BITS, max_x = ((max_tile_.x+1) << ObstacleTile::BITS) - 1;
+        int min_y = min_tile_.y << ObstacleTile::BITS, max_y = ((max_tile_.y+1) << ObstacleTile::BITS) - 1;
+        bool away = (min_tile_.x > max_tile_.x) ||
+                    (dx > 0 && current.x > max_x+1) || (dx < 0 && current.x < min_x-1) ||
+                    (dy > 0 && current.y > max_y+1) || (dy < 0 && current.y < min_y-1);
+        if(away){
+            int steps_x = (goal_.x - current.x)*dx;
+            int steps_y = (goal_.y - current.y)*dy;
+            if(steps_x < 0 || steps_y < 0)
+                return false;
+            int steps = min(steps_x, steps_y);
+            cost += steps*getStepCost(dir);
+            NAVI_COUNT_N(JUMP_STEPS, steps);
+            NAVI_COUNT(ALLOCATIONS);
+            jump = boost::make_shared<GraphState>(Cell(current.x + steps*dx, current.y + steps*dy));
             return true;
         }
-        //otherwise continue jumping digaonally
-        cost += dir.norm();
-        return jumpDiagonally(current, dir, jump, cost);
+        previous = current;
     }
-    //unable to continue jumping diagonally this way
-    else
-        return false;
 }
 
 
 bool Graph::hasForced (const GraphState::Ptr& state, const Direction& dir){
+    return hasForced(state->coords, dir);
+}
+
+bool Graph::hasForced (const Cell& cell, const Direction& dir) const {
     //get the positions to check
     Direction dir_free1 = dir;
     Direction dir_free2 = dir;
@@ -196,8 +452,10 @@ bool Graph::hasForced (const GraphState::Ptr& state, const Direction& dir){
         dir_block1.rotate(M_PI/2);
         dir_block2.rotate(-M_PI/2);
     }
-    res1 = env_->isCollisionFree( state->coords + dir_free1 ) && !env_->isCollisionFree( state->coords + dir_block1 );
-    res2 = env_->isCollisionFree( state->coords + dir_free2 ) && !env_->isCollisionFree( state->coords + dir_block2 );
+    res1 = isFree( cell + dir_free1 ) && !isFree( cell + dir_block1 );
+    res2 = isFree( cell + dir_free2 ) && !isFree( cell + dir_block2 );
+    if(res1 || res2)
+        NAVI_COUNT(FORCED_NEIGHBORS);
 
     return res1||res2;
 }
@@ -222,21 +480,26 @@ bool Graph::getForced (const GraphState::Ptr& state, const Direction& dir, vecto
         dir_block1.rotate(M_PI/2);
         dir_block2.rotate(-M_PI/2);
     }
-    res1 = env_->isCollisionFree( state->coords + dir_free1 ) && !env_->isCollisionFree( state->coords + dir_block1 );
-    res2 = env_->isCollisionFree( state->coords + dir_free2 ) && !env_->isCollisionFree( state->coords + dir_block2 );
+    res1 = isFree( state->coords + dir_free1 ) && !isFree( state->coords + dir_block1 );
+    res2 = isFree( state->coords + dir_free2 ) && !isFree( state->coords + dir_block2 );
+
+    if(res1 || res2)
+        NAVI_COUNT(FORCED_NEIGHBORS);
 
     //add the free state if there is a forced neighbor
     GraphState::Ptr succ;
     if(res1){
+        NAVI_COUNT(ALLOCATIONS);
         succ = boost::make_shared<GraphState>( state->coords + dir_free1 );
         succs.push_back(succ);
-        costs.push_back(dir_free1.norm());
+        costs.push_back(getStepCost(dir_free1));
     }
 
     if(res2){
+        NAVI_COUNT(ALLOCATIONS);
         succ = boost::make_shared<GraphState>( state->coords + dir_free2 );
         succs.push_back(succ);
-        costs.push_back(dir_free2.norm());
+        costs.push_back(getStepCost(dir_free2));
     }
 
     return res1||res2;
@@ -0,0 +1,481 @@
+#include "navi_example/GridPlanner.h"
+#include "navi_example/TileStore.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+/**
+ * @brief the eight unit moves counterclockwise from east, so that turning
+ * by a multiple of 45 degrees adds to the index
+ */
+static const int MOVE_X[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+static const int MOVE_Y[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+
+/**
+ * @brief index of a unit move in MOVE_X and MOVE_Y
+ */
+static int moveIndex(int dx, int dy){
+    static const int indices[3][3] = {{5, 4, 3}, {6, -1, 2}, {7, 0, 1}};
+    return indices[dx+1][dy+1];
+}
+
+static double moveCost(int move){
+    return (move & 1) ? M_SQRT2 : 1.0;
+}
+
+/**
+ * @brief bits lo to hi-1 of a word
+ */
+static boost::uint64_t rangeMask(int lo, int hi){
+    if(hi - lo >= 64)
+        return ~boost::uint64_t(0);
+    return ((boost::uint64_t(1) << (hi - lo)) - 1) << lo;
+}
+
+/**
+ * @brief clears count bits of a bitset from a raw bit index on
+ */
+static void clearBits(boost::uint64_t* bits, boost::int32_t index, int count){
+    while(count > 0){
+        int shift = index & 63;
+        int n = min(count, 64 - shift);
+        bits[index >> 6] &= ~rangeMask(shift, shift + n);
+        index += n;
+        count -= n;
+    }
+}
+
+template<int WIDTH, int HEIGHT>
+FixedGridPlanner<WIDTH, HEIGHT>::FixedGridPlanner(const vector<pair<Cell, ObstacleTile::ConstPtr> >& tiles, const Cell& origin, const Cell& size) :
+    origin_(origin), size_(min(size.x, WIDTH), min(size.y, HEIGHT)), goal_(origin), goal_index_(-1), num_expansions_(0), expansion_log_(NULL) {
+    //everything is blocked but the cells covered, which start out free
+    memset(blocked_, 0xff, sizeof(blocked_));
+    memset(columns_, 0xff, sizeof(columns_));
+    for(int y=1; y<=size_.y; y++)
+        clearBits(blocked_, PAD + y*STRIDE + 1, size_.x);
+    for(int x=1; x<=size_.x; x++)
+        clearBits(columns_, PAD + x*ROWS + 1, size_.y);
+
+    //then the obstacles are copied a tile row or column at a time
+    for(size_t i=0; i<tiles.size(); i++){
+        const ObstacleTile& tile = *tiles[i].second;
+        int x0 = (tiles[i].first.x << ObstacleTile::BITS) - origin_.x;
+        int y0 = (tiles[i].first.y << ObstacleTile::BITS) - origin_.y;
+        if(x0 >= size_.x || y0 >= size_.y || x0 + ObstacleTile::SIZE <= 0 || y0 + ObstacleTile::SIZE <= 0)
+            continue;
+        boost::uint64_t row_mask = rangeMask(max(0, -x0), min(int(ObstacleTile::SIZE), size_.x - x0));
+        boost::uint64_t column_mask = rangeMask(max(0, -y0), min(int(ObstacleTile::SIZE), size_.y - y0));
+        for(int k=0; k<ObstacleTile::SIZE; k++){
+            boost::uint64_t row = tile.rows[k] & row_mask;
+            if(row && y0 + k >= 0 && y0 + k < size_.y)
+                orBits(blocked_, (y0 + k + 1)*STRIDE + max(x0, 0) + 1, x0 >= 0 ? row : row >> -x0);
+            boost::uint64_t column = tile.columns[k] & column_mask;
+            if(column && x0 + k >= 0 && x0 + k < size_.x)
+                orBits(columns_, (x0 + k + 1)*ROWS + max(y0, 0) + 1, y0 >= 0 ? column : column >> -y0);
+        }
+    }
+}
+
+template<int WIDTH, int HEIGHT>
+size_t FixedGridPlanner<WIDTH, HEIGHT>::getNumExpansions() const {
+    return num_expansions_;
+}
+
+template<int WIDTH, int HEIGHT>
+void FixedGridPlanner<WIDTH, HEIGHT>::setExpansionLog(vector<Cell>* expanded){
+    expansion_log_ = expanded;
+}
+
+template<int WIDTH, int HEIGHT>
+int FixedGridPlanner<WIDTH, HEIGHT>::getSide() const {
+    return max(WIDTH, HEIGHT);
+}
+
+template<int WIDTH, int HEIGHT>
+Cell FixedGridPlanner<WIDTH, HEIGHT>::getMinCell() const {
+    return origin_;
+}
+
+template<int WIDTH, int HEIGHT>
+Cell FixedGridPlanner<WIDTH, HEIGHT>::getMaxCell() const {
+    return Cell(origin_.x + size_.x - 1, origin_.y + size_.y - 1);
+}
+
+template<int WIDTH, int HEIGHT>
+bool FixedGridPlanner<WIDTH, HEIGHT>::plan(const Cell& start, const Cell& goal, Path& path){
+    NAVI_PHASE(SEARCH);
+    num_expansions_ = 0;
+    Cell max_cell = getMaxCell();
+    if(start.x < origin_.x || start.y < origin_.y || start.x > max_cell.x || start.y > max_cell.y ||
+       goal.x < origin_.x || goal.y < origin_.y || goal.x > max_cell.x || goal.y > max_cell.y)
+        return false;
+    boost::int32_t start_index = indexOf(start);
+    goal_ = goal;
+    goal_index_ = indexOf(goal);
+    //a start inside inflated obstacles may still leave them through a forced
+    //neighbour, as with Planner, but a blocked goal is never reached
+    if(isBlocked(goal_index_))
+        return false;
+
+    //only the bitsets say which g values and parents belong to this search
+    memset(seen_, 0, sizeof(seen_));
+    memset(closed_, 0, sizeof(closed_));
+    heap_.clear();
+    set(seen_, start_index);
+    g_[start_index] = 0;
+    parents_[start_index] = -1;
+    push(start_index, heuristic(start_index));
+
+    while(!heap_.empty()){
+        boost::int32_t current = pop();
+        NAVI_COUNT(HEAP_OPERATIONS);
+        set(closed_, current);
+        num_expansions_++;
+        NAVI_COUNT(EXPANSIONS);
+        if(expansion_log_)
+            expansion_log_->push_back(cellOf(current));
+        if(current == goal_index_){
+            unwind(path);
+            return true;
+        }
+
+        //the direction of arrival picks the successors, none for the start
+        int dx = 0, dy = 0;
+        boost::int32_t parent = parents_[current];
+        if(parent >= 0){
+            int ex = current % STRIDE - parent % STRIDE;
+            int ey = current / STRIDE - parent / STRIDE;
+            dx = (ex > 0) - (ex < 0);
+            dy = (ey > 0) - (ey < 0);
+        }
+        successors_.clear();
+        addSuccessors(current, dx, dy);
+        for(size_t i=0; i<successors_.size(); i++){
+            boost::int32_t cell = successors_[i].cell;
+            if(test(closed_, cell))
+                continue;
+            double g = g_[current] + successors_[i].cost;
+            if(!test(seen_, cell)){
+                set(seen_, cell);
+                g_[cell] = g;
+                parents_[cell] = current;
+                push(cell, g + heuristic(cell));
+                NAVI_COUNT(HEAP_OPERATIONS);
+            }
+            else if(g < g_[cell]){
+                g_[cell] = g;
+                parents_[cell] = current;
+                decrease(cell, g + heuristic(cell));
+                NAVI_COUNT(HEAP_OPERATIONS);
+            }
+        }
+    }
+    return false;
+}
+
+template<int WIDTH, int HEIGHT>
+void FixedGridPlanner<WIDTH, HEIGHT>::unwind(Path& path) const {
+    NAVI_PHASE(UNWIND);
+    path.clear();
+    for(boost::int32_t cell = goal_index_; cell >= 0; cell = parents_[cell])
+        path.addWaypoint(cellOf(cell));
+    path.reverse();
+}
+
+template<int WIDTH, int HEIGHT>
+double FixedGridPlanner<WIDTH, HEIGHT>::heuristic(boost::int32_t index) const {
+    double dx = index % STRIDE - goal_index_ % STRIDE;
+    double dy = index / STRIDE - goal_index_ / STRIDE;
+    return sqrt(dx*dx + dy*dy);
+}
+
+template<int WIDTH, int HEIGHT>
+void FixedGridPlanner<WIDTH, HEIGHT>::addSuccessor(boost::int32_t cell, double cost){
+    Successor successor;
+    successor.cell = cell;
+    successor.cost = cost;
+    successors_.push_back(successor);
+}
+
+template<int WIDTH, int HEIGHT>
+void FixedGridPlanner<WIDTH, HEIGHT>::addSuccessors(boost::int32_t index, int dx, int dy){
+    if(dx == 0 && dy == 0){
+        //the start jumps in every direction, in the order Graph tries them
+        static const int xs[] = {1, 0, -1};
+        static const int ys[] = {0, 1, -1};
+        for(int i=0; i<3; i++){
+            for(int j=0; j<3; j++){
+                if(!(i == 1 && j == 0))
+                    addSuccessors(index, xs[i], ys[j]);
+            }
+        }
+        return;
+    }
+    addForced(index, dx, dy);
+    boost::int32_t jump;
+    int steps;
+    if(dx != 0 && dy != 0){
+        if((jump = jumpStraight(index, dx, 0, true, steps)) >= 0)
+            addSuccessor(jump, steps);
+        if((jump = jumpStraight(index, 0, dy, true, steps)) >= 0)
+            addSuccessor(jump, steps);
+        if((jump = jumpDiagonal(index, dx, dy, true, steps)) >= 0)
+            addSuccessor(jump, steps*M_SQRT2);
+    }
+    else if((jump = jumpStraight(index, dx, dy, true, steps)) >= 0){
+        addSuccessor(jump, steps);
+    }
+}
+
+template<int WIDTH, int HEIGHT>
+bool FixedGridPlanner<WIDTH, HEIGHT>::hasForced(boost::int32_t index, int dx, int dy) const {
+    int move = moveIndex(dx, dy);
+    int free_turn = (dx != 0 && dy != 0) ? 2 : 1;
+    for(int side=-1; side<=1; side+=2){
+        int free_move = (move + side*free_turn) & 7;
+        int block_move = (move + side*(free_turn+1)) & 7;
+        if(!isBlocked(index + MOVE_Y[free_move]*STRIDE + MOVE_X[free_move]) &&
+           isBlocked(index + MOVE_Y[block_move]*STRIDE + MOVE_X[block_move])){
+            NAVI_COUNT(FORCED_NEIGHBORS);
+            return true;
+        }
+    }
+    return false;
+}
+
+template<int WIDTH, int HEIGHT>
+void FixedGridPlanner<WIDTH, HEIGHT>::addForced(boost::int32_t index, int dx, int dy){
+    int move = moveIndex(dx, dy);
+    int free_turn = (dx != 0 && dy != 0) ? 2 : 1;
+    //the side turned counterclockwise first, as Graph::getForced() does
+    for(int side=1; side>=-1; side-=2){
+        int free_move = (move + side*free_turn) & 7;
+        int block_move = (move + side*(free_turn+1)) & 7;
+        boost::int32_t free_cell = index + MOVE_Y[free_move]*STRIDE + MOVE_X[free_move];
+        if(!isBlocked(free_cell) && isBlocked(index + MOVE_Y[block_move]*STRIDE + MOVE_X[block_move])){
+            NAVI_COUNT(FORCED_NEIGHBORS);
+            addSuccessor(free_cell, moveCost(free_move));
+        }
+    }
+}
+
+template<int WIDTH, int HEIGHT>
+boost::int32_t FixedGridPlanner<WIDTH, HEIGHT>::nextCandidate(const boost::uint64_t* bits, int line, boost::int32_t position, int step){
+    //a cell is a candidate if it is blocked, or if a neighbouring line is
+    //blocked beside it and free one step further, which is exactly when
+    //hasForced() holds for a straight move
+    if(step > 0){
+        for(boost::int32_t first = position+1; ; first += 64){
+            boost::uint64_t candidates = bitsFrom(bits, first) |
+                                         (bitsFrom(bits, first-line) & ~bitsFrom(bits, first-line+1)) |
+                                         (bitsFrom(bits, first+line) & ~bitsFrom(bits, first+line+1));
+            if(candidates)
+                return first + __builtin_ctzll(candidates);
+        }
+    }
+    for(boost::int32_t first = position-64; ; first -= 64){
+        boost::uint64_t candidates = bitsFrom(bits, first) |
+                                     (bitsFrom(bits, first-line) & ~bitsFrom(bits, first-line-1)) |
+                                     (bitsFrom(bits, first+line) & ~bitsFrom(bits, first+line-1));
+        if(candidates)
+            return first + 63 - __builtin_clzll(candidates);
+    }
+}
+
+template<int WIDTH, int HEIGHT>
+boost::int32_t FixedGridPlanner<WIDTH, HEIGHT>::jumpStraight(boost::int32_t from, int dx, int dy, bool start_flag, int& steps) const {
+    steps = 0;
+    if(isBlocked(from))
+        return -1;
+    if(from == goal_index_ || (!start_flag && hasForced(from, dx, dy)))
+        return from;
+
+    //rows are scanned in blocked_ and columns in columns_
+    bool vertical = (dx == 0);
+    int step = vertical ? dy : dx;
+    int x = from % STRIDE, y = from / STRIDE;
+    int goal_x = goal_index_ % STRIDE, goal_y = goal_index_ / STRIDE;
+    const boost::uint64_t* bits = vertical ? columns_ : blocked_;
+    int line = vertical ? ROWS : STRIDE;
+    boost::int32_t position = vertical ? x*ROWS + y : from;
+    boost::int32_t next = nextCandidate(bits, line, position, step);
+    NAVI_COUNT_N(JUMP_STEPS, (next-position)*step);
+
+    if(vertical ? goal_x == x : goal_y == y){
+        boost::int32_t goal_position = vertical ? goal_x*ROWS + goal_y : goal_index_;
+        if((goal_position-position)*step > 0 && (next-goal_position)*step >= 0){
+            steps = (goal_position-position)*step;
+            return goal_index_;
+        }
+    }
+    //the cell the scan stopped at, like the isFree() of Graph::jumpStraight
+    NAVI_COUNT(COLLISION_CHECKS);
+    if(test(bits, next))
+        return -1;
+    steps = (next-position)*step;
+    return vertical ? (next % ROWS)*STRIDE + next / ROWS : next;
+}
+
+template<int WIDTH, int HEIGHT>
+boost::int32_t FixedGridPlanner<WIDTH, HEIGHT>::jumpDiagonal(boost::int32_t from, int dx, int dy, bool start_flag, int& steps) const {
+    boost::int32_t offset = dy*STRIDE + dx;
+    boost::int32_t previous = from;
+    steps = 0;
+    //the same order of tests as Graph::jumpDiagonally(), so the same jump points
+    while(true){
+        boost::int32_t current = previous + offset;
+        if(isBlocked(current))
+            return -1;
+        if(current == goal_index_){
+            steps++;
+            return current;
+        }
+        if(!start_flag && hasForced(previous, dx, dy))
+            return previous;
+        start_flag = false;
+        steps++;
+        NAVI_COUNT(JUMP_STEPS);
+        int ignored;
+        if(jumpStraight(current, dx, 0, true, ignored) >= 0 || jumpStraight(current, 0, dy, true, ignored) >= 0)
+            return current;
+        previous = current;
+    }
+}
+
+template<int WIDTH, int HEIGHT>
+void FixedGridPlanner<WIDTH, HEIGHT>::push(boost::int32_t cell, double f){
+    heap_.push_back(make_pair(f, cell));
+    positions_[cell] = boost::int32_t(heap_.size()-1);
+    siftUp(heap_.size()-1);
+}
+
+template<int WIDTH, int HEIGHT>
+void FixedGridPlanner<WIDTH, HEIGHT>::decrease(boost::int32_t cell, double f){
+    size_t position = positions_[cell];
+    heap_[position].first = f;
+    siftUp(position);
+}
+
+template<int WIDTH, int HEIGHT>
+void FixedGridPlanner<WIDTH, HEIGHT>::siftUp(size_t position){
+    pair<double, boost::int32_t> entry = heap_[position];
+    while(position > 0){
+        size_t parent = (position-1)/2;
+        if(!(entry.first < heap_[parent].first))
+            break;
+        heap_[position] = heap_[parent];
+        positions_[heap_[position].second] = boost::int32_t(position);
+        position = parent;
+    }
+    heap_[position] = entry;
+    positions_[entry.second] = boost::int32_t(position);
+}
+
+template<int WIDTH, int HEIGHT>
+boost::int32_t FixedGridPlanner<WIDTH, HEIGHT>::pop(){
+    boost::int32_t top = heap_[0].second;
+    pair<double, boost::int32_t> last = heap_.back();
+    heap_.pop_back();
+    size_t size = heap_.size();
+    if(size == 0)
+        return top;
+    size_t position = 0;
+    while(true){
+        size_t child = 2*position + 1;
+        if(child >= size)
+            break;
+        if(child+1 < size && heap_[child+1].first < heap_[child].first)
+            child++;
+        if(!(heap_[child].first < last.first))
+            break;
+        heap_[position] = heap_[child];
+        positions_[heap_[position].second] = boost::int32_t(position);
+        position = child;
+    }
+    heap_[position] = last;
+    positions_[last.second] = boost::int32_t(position);
+    return top;
+}
+
+template class FixedGridPlanner<256, 256>;
+template class FixedGridPlanner<512, 512>;
+template class FixedGridPlanner<1024, 1024>;
+template class FixedGridPlanner<2048, 2048>;
+
+bool GridPlanner::fitsTileIndex(const MapSnapshot& snapshot, const Cell& start, const Cell& goal){
+    //whole tiles of the file, the tiles changed since it was loaded and both ends
+    boost::shared_ptr<TileStore> store = snapshot.getStore();
+    Cell low = MapSnapshot::tileOf(Cell(min(start.x, goal.x), min(start.y, goal.y)));
+    Cell high = MapSnapshot::tileOf(Cell(max(start.x, goal.x), max(start.y, goal.y)));
+    if(store->getMinTile().x <= store->getMaxTile().x){
+        low = Cell(min(low.x, store->getMinTile().x), min(low.y, store->getMinTile().y));
+        high = Cell(max(high.x, store->getMaxTile().x), max(high.y, store->getMaxTile().y));
+    }
+    const TileTable& changed = snapshot.getTiles();
+    for(TileTable::const_iterator tile_it = changed.begin(); tile_it != changed.end(); ++tile_it){
+        low = Cell(min(low.x, tile_it->first.x), min(low.y, tile_it->first.y));
+        high = Cell(max(high.x, tile_it->first.x), max(high.y, tile_it->first.y));
+    }
+    //the box in cells with the free ring around it, never smaller than the one create() computes
+    long side = (long(max(high.x - low.x, high.y - low.y)) + 1) * ObstacleTile::SIZE + 4;
+    return side <= MAX_SIDE;
+}
+
+GridPlanner::Ptr GridPlanner::create(const MapSnapshot& snapshot, int radius, const Cell& start, const Cell& goal){
+    vector<pair<Cell, ObstacleTile::ConstPtr> > tiles;
+    if(radius == 0 && snapshot.getStore() && !fitsTileIndex(snapshot, start, goal))
+        return Ptr();
+    if(radius == 0){
+        snapshot.collectTiles(tiles);
+    }
+    else{
+        const TileTable* layer = snapshot.getLayer(radius);
+        if(!layer)
+            return Ptr();
+        for(TileTable::const_iterator tile_it = layer->begin(); tile_it != layer->end(); ++tile_it){
+            if(!tile_it->second->empty())
+                tiles.push_back(*tile_it);
+        }
+    }
+
+    //the bounding box of the occupied cells and both ends, plus the free ring around it
+    Cell low(min(start.x, goal.x), min(start.y, goal.y));
+    Cell high(max(start.x, goal.x), max(start.y, goal.y));
+    for(size_t i=0; i<tiles.size(); i++){
+        const ObstacleTile& tile = *tiles[i].second;
+        int x0 = tiles[i].first.x << ObstacleTile::BITS;
+        int y0 = tiles[i].first.y << ObstacleTile::BITS;
+        for(int k=0; k<ObstacleTile::SIZE; k++){
+            if(tile.rows[k]){
+                low.y = min(low.y, y0 + k);
+                high.y = max(high.y, y0 + k);
+            }
+            if(tile.columns[k]){
+                low.x = min(low.x, x0 + k);
+                high.x = max(high.x, x0 + k);
+            }
+        }
+    }
+    //two cells wide: jumpDiagonal() only stops at a turn in the ring once
+    //it has stepped past it, so the ring needs a free cell beyond every turn;
+    //spans near the int range would overflow the size, so check them wide
+    if(long(high.x) - low.x + 5 > MAX_SIDE || long(high.y) - low.y + 5 > MAX_SIDE
+       || long(low.x) - 2 < INT_MIN || long(low.y) - 2 < INT_MIN || long(high.x) + 2 > INT_MAX || long(high.y) + 2 > INT_MAX)
+        return Ptr();
+    Cell origin(low.x - 2, low.y - 2);
+    Cell size(high.x - low.x + 5, high.y - low.y + 5);
+    int side = max(size.x, size.y);
+    if(side <= 256)
+        return Ptr(new FixedGridPlanner<256, 256>(tiles, origin, size));
+    if(side <= 512)
+        return Ptr(new FixedGridPlanner<512, 512>(tiles, origin, size));
+    if(side <= 1024)
+        return Ptr(new FixedGridPlanner<1024, 1024>(tiles, origin, size));
+    if(side <= MAX_SIDE)
+        return Ptr(new FixedGridPlanner<2048, 2048>(tiles, origin, size));
+    return Ptr();
+}
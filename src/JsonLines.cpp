@@ -0,0 +1,86 @@
+#include "navi_example/JsonLines.h"
+
+#include <cctype>
+#include <climits>
+#include <vector>
+
+#include <boost/foreach.hpp>
+
+using namespace std;
+
+namespace {
+/**
+ * @brief skips the digits starting at a position
+ * @return the position after the last digit
+ */
+size_t skipDigits(const string& text, size_t i){
+    while(i < text.size() && isdigit((unsigned char)text[i]))
+        i++;
+    return i;
+}
+
+/**
+ * @brief checks for json number syntax, -?digits[.digits][(e|E)[+-]digits]
+ */
+bool isJsonNumber(const string& text){
+    size_t i = (!text.empty() && text[0] == '-') ? 1 : 0;
+    size_t end = skipDigits(text, i);
+    if(end == i || (text[i] == '0' && end > i+1))
+        return false;
+    i = end;
+    if(i < text.size() && text[i] == '.'){
+        end = skipDigits(text, i+1);
+        if(end == i+1)
+            return false;
+        i = end;
+    }
+    if(i < text.size() && (text[i] == 'e' || text[i] == 'E')){
+        i++;
+        if(i < text.size() && (text[i] == '+' || text[i] == '-'))
+            i++;
+        end = skipDigits(text, i);
+        if(end == i)
+            return false;
+        i = end;
+    }
+    return i == text.size();
+}
+}
+
+string JsonLines::quote( const string& text ){
+    string quoted = "\"";
+    for(size_t i=0; i<text.size(); i++){
+        if(text[i] == '"' || text[i] == '\\')
+            quoted += '\\';
+        if((unsigned char)text[i] < 0x20)
+            quoted += ' ';
+        else
+            quoted += text[i];
+    }
+    return quoted + "\"";
+}
+
+string JsonLines::formatId( const boost::property_tree::ptree& request ){
+    boost::optional<string> id = request.get_optional<string>("id");
+    if(!id)
+        return "null";
+    return isJsonNumber(*id) ? *id : quote(*id);
+}
+
+bool JsonLines::readCell( const boost::property_tree::ptree& node, Cell& cell ){
+    vector<int> coords;
+    BOOST_FOREACH( const boost::property_tree::ptree::value_type& coordinate, node ){
+        boost::optional<double> value = coordinate.second.get_value_optional<double>();
+        if(!value || !(*value >= INT_MIN && *value <= INT_MAX))
+            return false;
+        coords.push_back(int(*value));
+    }
+    if(coords.size() != 2)
+        return false;
+    cell = Cell(coords[0], coords[1]);
+    return true;
+}
+
+string JsonLines::errorReply( const string& id, const string& error ){
+    return "{\"id\": " + id + ", \"ok\": false, \"error\": " + quote(error) + "}";
+}
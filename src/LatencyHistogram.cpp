@@ -0,0 +1,110 @@
+#include "navi_example/LatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+using namespace std;
+
+LatencyHistogram::LatencyHistogram() : counts_(NUM_BUCKETS, 0), count_(0),
+    min_(numeric_limits<boost::uint64_t>::max()), max_(0), sum_(0) {}
+
+size_t LatencyHistogram::indexOf( boost::uint64_t value ){
+    if(value < 2*SUB_COUNT)
+        return value;
+    //keep the top SUB_BITS+1 bits of the value
+    int shift = 63 - __builtin_clzll(value) - SUB_BITS;
+    return 2*SUB_COUNT + size_t(shift-1)*SUB_COUNT + ((value >> shift) - SUB_COUNT);
+}
+
+boost::uint64_t LatencyHistogram::highestOf( size_t index ){
+    if(index < 2*SUB_COUNT)
+        return index;
+    int shift = (index - 2*SUB_COUNT)/SUB_COUNT + 1;
+    boost::uint64_t top = (index - 2*SUB_COUNT)%SUB_COUNT + SUB_COUNT;
+    return (top << shift) + ((boost::uint64_t(1) << shift) - 1);
+}
+
+void LatencyHistogram::record( boost::uint64_t value ){
+    counts_[indexOf(value)]++;
+    count_++;
+    min_ = min(min_, value);
+    max_ = max(max_, value);
+    sum_ += value;
+}
+
+void LatencyHistogram::merge( const LatencyHistogram& other ){
+    for(size_t i=0; i<counts_.size(); i++)
+        counts_[i] += other.counts_[i];
+    count_ += other.count_;
+    min_ = min(min_, other.min_);
+    max_ = max(max_, other.max_);
+    sum_ += other.sum_;
+}
+
+boost::uint64_t LatencyHistogram::getCount() const {
+    return count_;
+}
+
+boost::uint64_t LatencyHistogram::getMin() const {
+    return count_ ? min_ : 0;
+}
+
+boost::uint64_t LatencyHistogram::getMax() const {
+    return max_;
+}
+
+double LatencyHistogram::getMean() const {
+    return count_ ? sum_/count_ : 0;
+}
+
+boost::uint64_t LatencyHistogram::getValueAtPercentile( double percentile ) const {
+    if(!count_)
+        return 0;
+    boost::uint64_t target = max(boost::uint64_t(1), boost::uint64_t(ceil(min(percentile, 100.0)/100*count_)));
+    boost::uint64_t seen = 0;
+    for(size_t i=0; i<counts_.size(); i++){
+        seen += counts_[i];
+        if(seen >= target)
+            return min(highestOf(i), max_);
+    }
+    return max_;
+}
+
+void LatencyHistogram::writePercentiles( ostream& os, double unit_scale ) const {
+    char line[128];
+    os << "       Value     Percentile TotalCount 1/(1-Percentile)\n\n";
+    //five lines per halving of the distance to 100%, like HdrHistogram's default
+    size_t index = 0;
+    boost::uint64_t seen = 0;
+    for(int tick=0; count_ && seen < count_; tick++){
+        double percentile = 100*(1 - pow(0.5, tick/5.0));
+        boost::uint64_t target = max(boost::uint64_t(1), boost::uint64_t(ceil(percentile/100*count_)));
+        //ticks falling into a bucket already written add nothing
+        if(seen >= target)
+            continue;
+        while(seen < target)
+            seen += counts_[index++];
+        double fraction = double(seen)/count_;
+        boost::uint64_t value = min(highestOf(index-1), max_);
+        if(seen < count_)
+            snprintf(line, sizeof(line), "%12.3f %14.12f %10llu %14.2f\n", value/unit_scale, fraction, (unsigned long long)seen, 1/(1-fraction));
+        else
+            snprintf(line, sizeof(line), "%12.3f %14.12f %10llu\n", value/unit_scale, fraction, (unsigned long long)seen);
+        os << line;
+    }
+    double variance = 0;
+    for(size_t i=0; i<counts_.size(); i++){
+        if(counts_[i]){
+            double difference = min(highestOf(i), max_) - getMean();
+            variance += counts_[i]*difference*difference;
+        }
+    }
+    snprintf(line, sizeof(line), "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n", getMean()/unit_scale, count_ ? sqrt(variance/count_)/unit_scale : 0.0);
+    os << line;
+    snprintf(line, sizeof(line), "#[Max     = %12.3f, Total count    = %12llu]\n", max_/unit_scale, (unsigned long long)count_);
+    os << line;
+    snprintf(line, sizeof(line), "#[Buckets = %12d, SubBuckets     = %12d]\n", int(NUM_BUCKETS), int(SUB_COUNT));
+    os << line;
+}
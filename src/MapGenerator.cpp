@@ -0,0 +1,349 @@
+#include "navi_example/MapGenerator.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/thread.hpp>
+
+using namespace std;
+
+namespace {
+enum Salt{ DENSITY, TREE, LOOP, DOOR, LOT };
+
+/**
+ * @brief bits of the cells [from,to) among the 64 cells starting at x0
+ */
+boost::uint64_t span(boost::int64_t from, boost::int64_t to, boost::int64_t x0){
+    boost::int64_t a = max(from, x0) - x0, b = min(to, x0 + 64) - x0;
+    if(a >= b)
+        return 0;
+    boost::uint64_t ones = (b - a == 64) ? ~boost::uint64_t(0) : ((boost::uint64_t(1) << (b - a)) - 1);
+    return ones << a;
+}
+
+void appendNumber(string& text, int value){
+    char digits[12];
+    int count = 0;
+    unsigned int magnitude = value < 0 ? -(unsigned int)value : value;
+    do{
+        digits[count++] = '0' + magnitude%10;
+        magnitude /= 10;
+    } while(magnitude);
+    if(value < 0)
+        text += '-';
+    while(count)
+        text += digits[--count];
+}
+}
+
+MapGenerator::Options::Options() : style(RANDOM), width(1024), height(1024), seed(1), density(0.3),
+    corridor(1), room(30), door(3), loops(0.3), block(40), street(8) {}
+
+MapGenerator::MapGenerator( const Options& options ) : options_(options), pitch_(0), door_(0), cells_x_(0), cells_y_(0) {
+    int width = options_.width, height = options_.height;
+    if(options_.style == MAZE || options_.style == ROOMS){
+        pitch_ = (options_.style == MAZE ? options_.corridor : options_.room) + 1;
+        door_ = options_.style == MAZE ? options_.corridor : options_.door;
+        //the east and north walls of the last grid cells must fall inside the border
+        cells_x_ = (width-1) / pitch_;
+        cells_y_ = (height-1) / pitch_;
+        //the spanning tree leans north east, so a goal there would be one straight run away;
+        //south east the way leads up to the north east corner and back down
+        start_ = Cell(pitch_/2, pitch_/2);
+        goal_ = Cell((cells_x_-1)*pitch_ + pitch_/2, pitch_/2);
+    }
+    else if(options_.style == CITY){
+        //on street crossings, the first and the last
+        int pitch = options_.block + options_.street, middle = options_.street/2;
+        start_ = Cell(middle, middle);
+        goal_ = Cell((width-2-middle)/pitch*pitch + middle, (height-2-middle)/pitch*pitch + middle);
+    }
+    else{
+        start_ = Cell(1 + width/8, 1 + height/8);
+        goal_ = Cell(width-2 - width/8, height-2 - height/8);
+    }
+}
+
+bool MapGenerator::parseStyle( const string& name, Style& style ){
+    const char* names[] = {"random", "maze", "rooms", "city"};
+    for(int i=0; i<4; i++){
+        if(name == names[i]){
+            style = Style(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MapGenerator::isValid() const {
+    if(options_.width < 3 || options_.height < 3){
+        printf("A map must be at least 3x3 cells\n");
+        return false;
+    }
+    if(options_.style == RANDOM && (options_.density < 0 || options_.density > 1)){
+        printf("The density must be between 0 and 1\n");
+        return false;
+    }
+    if((options_.style == MAZE && options_.corridor < 1) ||
+       (options_.style == ROOMS && (options_.room < 1 || options_.door < 1 || options_.door > options_.room))){
+        printf("Corridors and rooms must be at least a cell wide, and doors no wider than rooms\n");
+        return false;
+    }
+    if((options_.style == MAZE || options_.style == ROOMS) && (cells_x_ < 1 || cells_y_ < 1)){
+        printf("The map is too small for a single %s\n", options_.style == MAZE ? "corridor" : "room");
+        return false;
+    }
+    if(options_.style == CITY && (options_.street < 2 || options_.block < 1 ||
+       options_.width < options_.street+1 || options_.height < options_.street+1)){
+        printf("Streets must be at least 2 cells wide, blocks at least 1, and the map wider than a street\n");
+        return false;
+    }
+    return true;
+}
+
+Cell MapGenerator::getStart() const {
+    return start_;
+}
+
+Cell MapGenerator::getGoal() const {
+    return goal_;
+}
+
+Cell MapGenerator::getNumTiles() const {
+    return Cell((options_.width + ObstacleTile::SIZE-1) / ObstacleTile::SIZE, (options_.height + ObstacleTile::SIZE-1) / ObstacleTile::SIZE);
+}
+
+boost::uint64_t MapGenerator::hash( boost::int64_t x, boost::int64_t y, boost::uint64_t salt ) const {
+    //splitmix64 finaliser over the mixed inputs
+    boost::uint64_t z = options_.seed ^ (boost::uint64_t(x) * 0x9e3779b97f4a7c15ull) ^ (boost::uint64_t(y) * 0xc2b2ae3d27d4eb4full) ^ (salt * 0x165667b19e3779f9ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+boost::uint64_t MapGenerator::generateRow( int y, int x0 ) const {
+    int width = options_.width, height = options_.height;
+    if(y < 0 || y >= height)
+        return 0;
+    boost::uint64_t bits;
+    if(y == 0 || y == height-1){
+        bits = ~boost::uint64_t(0);
+    }
+    else{
+        switch(options_.style){
+            case MAZE:
+            case ROOMS: bits = gridRow(y, x0); break;
+            case CITY: bits = cityRow(y, x0); break;
+            default: bits = randomRow(y, x0); break;
+        }
+        bits |= span(0, 1, x0) | span(width-1, width, x0);
+    }
+    bits &= span(0, width, x0);
+    if(y == start_.y)
+        bits &= ~span(start_.x, start_.x+1, x0);
+    if(y == goal_.y)
+        bits &= ~span(goal_.x, goal_.x+1, x0);
+    return bits;
+}
+
+boost::uint64_t MapGenerator::randomRow( int y, int x0 ) const {
+    //each binary digit of the density, lowest first, halves the share or adds half the rest
+    int digits = int(options_.density*256 + 0.5);
+    boost::uint64_t bits = 0;
+    if(digits >= 256){
+        bits = ~boost::uint64_t(0);
+    }
+    else{
+        for(int digit=0; digit<8; digit++){
+            boost::uint64_t word = hash(x0 >> ObstacleTile::BITS, y, DENSITY + 8*digit);
+            bits = ((digits >> digit) & 1) ? (bits | word) : (bits & word);
+        }
+    }
+    //an L from start to goal: along the start row, then along the goal column
+    if(y == start_.y)
+        bits &= ~span(min(start_.x, goal_.x), max(start_.x, goal_.x)+1, x0);
+    if(min(start_.y, goal_.y) <= y && y <= max(start_.y, goal_.y))
+        bits &= ~span(goal_.x, goal_.x+1, x0);
+    return bits;
+}
+
+bool MapGenerator::hasDoor( int i, int j, bool west, bool opens_east ) const {
+    if(west ? i == 0 : j == 0)
+        return false;
+    //the spanning tree: every cell but the north east one opens to its east or its north neighbour
+    int from_i = west ? i-1 : i, from_j = west ? j : j-1;
+    if(from_i == cells_x_-1)
+        opens_east = false;
+    else if(from_j == cells_y_-1)
+        opens_east = true;
+    if(opens_east == west)
+        return true;
+    if(options_.style != ROOMS || options_.loops <= 0)
+        return false;
+    return (hash(i, j, LOOP + 8*west) >> 11) * (1.0/9007199254740992.0) < options_.loops;
+}
+
+int MapGenerator::doorOffset( int i, int j, bool west ) const {
+    //a maze corridor opens the whole wall
+    if(pitch_ - door_ == 1)
+        return 1;
+    return 1 + hash(i, j, DOOR + 8*west) % (pitch_ - door_);
+}
+
+boost::uint64_t MapGenerator::gridRow( int y, int x0 ) const {
+    int j = y / pitch_, offset_y = y % pitch_;
+    //the tree choices of the cells whose doors this row shows, the south neighbours on a
+    //wall row and the west ones otherwise, one random word for 64 grid cells in a row
+    int first = x0 / pitch_ - 1, tree_j = (offset_y == 0) ? j-1 : j;
+    boost::uint64_t tree[3];
+    for(int word=0; word<3; word++)
+        tree[word] = hash((first >> 6) + word, tree_j, TREE);
+    boost::uint64_t bits = 0;
+    for(int i = x0 / pitch_; i <= (x0 + 63) / pitch_; i++){
+        boost::int64_t corner = boost::int64_t(i)*pitch_;
+        int from_i = (offset_y == 0) ? i : i-1;
+        bool opens_east = (tree[(from_i >> 6) - (first >> 6)] >> (from_i & 63)) & 1;
+        if(i >= cells_x_ || j >= cells_y_){
+            //beyond the last grid cells, all wall
+            bits |= span(corner, corner+pitch_, x0);
+        }
+        else if(offset_y == 0){
+            //the south wall of cell (i,j)
+            boost::uint64_t wall = span(corner, corner+pitch_, x0);
+            if(hasDoor(i, j, false, opens_east)){
+                int door = doorOffset(i, j, false);
+                wall &= ~span(corner+door, corner+door+door_, x0);
+            }
+            bits |= wall;
+        }
+        else{
+            //the west wall of cell (i,j)
+            bool open = false;
+            if(hasDoor(i, j, true, opens_east)){
+                int door = doorOffset(i, j, true);
+                open = door <= offset_y && offset_y < door+door_;
+            }
+            if(!open)
+                bits |= span(corner, corner+1, x0);
+        }
+    }
+    return bits;
+}
+
+boost::uint64_t MapGenerator::cityRow( int y, int x0 ) const {
+    int street = options_.street, block = options_.block, pitch = street + block;
+    int j = y / pitch, offset_y = y % pitch;
+    if(offset_y < street)
+        return 0;
+    //a block is split into lots of about 16 to 32 cells a side
+    int lots = max(1, block/16), lot = block/lots;
+    int lot_j = min((offset_y - street) / lot, lots-1);
+    int lot_y0 = street + lot_j*lot, lot_y1 = (lot_j == lots-1) ? pitch : lot_y0 + lot;
+    boost::uint64_t bits = 0;
+    for(int i = x0 / pitch; i <= (x0 + 63) / pitch; i++){
+        boost::int64_t corner = boost::int64_t(i)*pitch;
+        for(int lot_i=0; lot_i<lots; lot_i++){
+            boost::uint64_t h = hash(boost::int64_t(i)*lots + lot_i, boost::int64_t(j)*lots + lot_j, LOT);
+            //about one lot in seven is left empty
+            if((h & 0xff) < 38)
+                continue;
+            //building set back one to three cells from every side of its lot
+            int lot_x0 = street + lot_i*lot, lot_x1 = (lot_i == lots-1) ? pitch : lot_x0 + lot;
+            int x_from = lot_x0 + 1 + (h >> 8)%3, x_to = lot_x1 - 1 - (h >> 10)%3;
+            int y_from = lot_y0 + 1 + (h >> 12)%3, y_to = lot_y1 - 1 - (h >> 14)%3;
+            if(y_from <= offset_y && offset_y < y_to)
+                bits |= span(corner + x_from, corner + x_to, x0);
+        }
+    }
+    return bits;
+}
+
+bool MapGenerator::generateTile( const Cell& tile, ObstacleTile& obstacles ) const {
+    for(int row=0; row<ObstacleTile::SIZE; row++)
+        obstacles.rows[row] = generateRow(tile.y*ObstacleTile::SIZE + row, tile.x*ObstacleTile::SIZE);
+    obstacles.updateColumns();
+    return !obstacles.empty();
+}
+
+void MapGenerator::generateBand( int first, int step, vector<pair<Cell, ObstacleTile::ConstPtr> >* tiles ) const {
+    Cell num_tiles = getNumTiles();
+    for(int ty=first; ty<num_tiles.y; ty+=step){
+        for(int tx=0; tx<num_tiles.x; tx++){
+            ObstacleTile::Ptr obstacles = boost::make_shared<ObstacleTile>();
+            if(generateTile(Cell(tx, ty), *obstacles))
+                tiles->push_back(make_pair(Cell(tx, ty), ObstacleTile::ConstPtr(obstacles)));
+        }
+    }
+}
+
+void MapGenerator::generate( int threads, MapSnapshot::TileMap& tiles ) const {
+    //tile rows are dealt out in turn, so every thread gets a share of each part of the map
+    threads = max(1, threads);
+    vector<vector<pair<Cell, ObstacleTile::ConstPtr> > > bands(threads);
+    boost::thread_group workers;
+    for(int i=0; i<threads; i++)
+        workers.create_thread(boost::bind(&MapGenerator::generateBand, this, i, threads, &bands[i]));
+    workers.join_all();
+    for(int i=0; i<threads; i++){
+        tiles.insert(bands[i].begin(), bands[i].end());
+        vector<pair<Cell, ObstacleTile::ConstPtr> >().swap(bands[i]);
+    }
+}
+
+void MapGenerator::formatTileRow( int ty, string* text, size_t* count ) const {
+    ObstacleTile obstacles;
+    for(int tx=0; tx<getNumTiles().x; tx++){
+        if(!generateTile(Cell(tx, ty), obstacles))
+            continue;
+        for(int row=0; row<ObstacleTile::SIZE; row++){
+            for(boost::uint64_t bits = obstacles.rows[row]; bits; bits &= bits-1){
+                if(!text->empty())
+                    *text += ", ";
+                *text += '[';
+                appendNumber(*text, tx*ObstacleTile::SIZE + __builtin_ctzll(bits));
+                *text += ", ";
+                appendNumber(*text, ty*ObstacleTile::SIZE + row);
+                *text += ']';
+                (*count)++;
+            }
+        }
+    }
+}
+
+bool MapGenerator::writeJson( const string& path, int threads, size_t& obstacles ) const {
+    FILE* file = fopen(path.c_str(), "w");
+    if(!file){
+        printf("File \"%s\" could not be opened for writing!\n", path.c_str());
+        return false;
+    }
+    threads = max(1, threads);
+    obstacles = 0;
+    bool ok = fputs("{\"obstacles\": [", file) >= 0;
+    bool first = true;
+    int num_rows = getNumTiles().y;
+    for(int batch=0; ok && batch<num_rows; batch+=threads){
+        int rows = min(threads, num_rows - batch);
+        vector<string> texts(rows);
+        vector<size_t> counts(rows, 0);
+        boost::thread_group workers;
+        for(int i=0; i<rows; i++)
+            workers.create_thread(boost::bind(&MapGenerator::formatTileRow, this, batch+i, &texts[i], &counts[i]));
+        workers.join_all();
+        for(int i=0; ok && i<rows; i++){
+            if(texts[i].empty())
+                continue;
+            if(!first)
+                ok = fputs(", ", file) >= 0;
+            ok = ok && fwrite(texts[i].data(), 1, texts[i].size(), file) == texts[i].size();
+            obstacles += counts[i];
+            first = false;
+        }
+    }
+    ok = ok && fprintf(file, "], \"robotStart\": [%d, %d], \"robotEnd\": [%d, %d]}", start_.x, start_.y, goal_.x, goal_.y) > 0;
+    ok = (fclose(file) == 0) && ok;
+    if(!ok)
+        printf("Failed writing \"%s\"\n", path.c_str());
+    return ok;
+}
@@ -0,0 +1,280 @@
+#include "navi_example/MapRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+using namespace std;
+
+namespace {
+const int MARGIN = 2;
+
+/**
+ * @brief appends a big endian 32 bit value
+ */
+void putUint32(vector<unsigned char>& out, boost::uint32_t value){
+    for(int shift=24; shift>=0; shift-=8)
+        out.push_back((value >> shift) & 0xff);
+}
+
+boost::uint32_t crc32(const unsigned char* data, size_t size){
+    static boost::uint32_t table[256];
+    static bool filled = false;
+    if(!filled){
+        for(boost::uint32_t n=0; n<256; n++){
+            boost::uint32_t c = n;
+            for(int k=0; k<8; k++)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        filled = true;
+    }
+    boost::uint32_t crc = 0xffffffffu;
+    for(size_t i=0; i<size; i++)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffffu;
+}
+
+/**
+ * @brief appends a png chunk: length, type, data and crc of type and data
+ */
+void putChunk(vector<unsigned char>& out, const char* type, const vector<unsigned char>& data){
+    putUint32(out, data.size());
+    size_t begin = out.size();
+    out.insert(out.end(), type, type+4);
+    out.insert(out.end(), data.begin(), data.end());
+    putUint32(out, crc32(&out[begin], out.size()-begin));
+}
+}
+
+MapRenderer::MapRenderer( const Cell& min_cell, const Cell& max_cell, int max_pixels ) : min_cell_(min_cell), max_cell_(max_cell) {
+    int extent = max(max_cell.x - min_cell.x, max_cell.y - min_cell.y) + 1;
+    max_pixels = max(1, max_pixels);
+    scale_ = (extent + max_pixels - 1) / max_pixels;
+    width_ = (max_cell.x - min_cell.x) / scale_ + 1;
+    height_ = (max_cell.y - min_cell.y) / scale_ + 1;
+    obstacles_.assign(size_t(width_)*height_, 0);
+    expansions_.assign(size_t(width_)*height_, 0);
+    marks_.assign(size_t(width_)*height_, NONE);
+}
+
+pair<Cell, Cell> MapRenderer::findWindow( const MapSnapshot& snapshot, const Path& path, const Cell& start, const Cell& goal ){
+    Cell low(min(start.x, goal.x), min(start.y, goal.y));
+    Cell high(max(start.x, goal.x), max(start.y, goal.y));
+    vector<pair<Cell, ObstacleTile::ConstPtr> > tiles;
+    snapshot.collectTiles(tiles);
+    for(size_t i=0; i<tiles.size(); i++){
+        low = Cell(min(low.x, tiles[i].first.x << ObstacleTile::BITS), min(low.y, tiles[i].first.y << ObstacleTile::BITS));
+        high = Cell(max(high.x, ((tiles[i].first.x+1) << ObstacleTile::BITS) - 1), max(high.y, ((tiles[i].first.y+1) << ObstacleTile::BITS) - 1));
+    }
+    const vector<Cell>& waypoints = path.getWaypoints();
+    for(size_t i=0; i<waypoints.size(); i++){
+        low = Cell(min(low.x, waypoints[i].x), min(low.y, waypoints[i].y));
+        high = Cell(max(high.x, waypoints[i].x), max(high.y, waypoints[i].y));
+    }
+    return make_pair(Cell(low.x-MARGIN, low.y-MARGIN), Cell(high.x+MARGIN, high.y+MARGIN));
+}
+
+void MapRenderer::addObstacles( const MapSnapshot& snapshot, int threads ){
+    vector<pair<Cell, ObstacleTile::ConstPtr> > tiles;
+    snapshot.collectTiles(tiles);
+    //each thread owns a band of image rows, so no pixel is counted by two threads
+    threads = max(1, min(threads, height_));
+    if(threads == 1){
+        countObstacles(&tiles, 0, height_);
+        return;
+    }
+    boost::thread_group workers;
+    for(int i=0; i<threads; i++)
+        workers.create_thread(boost::bind(&MapRenderer::countObstacles, this, &tiles, height_*i/threads, height_*(i+1)/threads));
+    workers.join_all();
+}
+
+void MapRenderer::countObstacles( const vector<pair<Cell, ObstacleTile::ConstPtr> >* tiles, int begin, int end ){
+    //cell rows drawn in image rows [begin,end)
+    int top = max_cell_.y - begin*scale_;
+    int bottom = max(min_cell_.y, max_cell_.y - end*scale_ + 1);
+    for(size_t i=0; i<tiles->size(); i++){
+        const Cell& tile = (*tiles)[i].first;
+        int tile_y = tile.y << ObstacleTile::BITS;
+        int tile_x = tile.x << ObstacleTile::BITS;
+        int from = max(bottom, tile_y), to = min(top, tile_y + ObstacleTile::SIZE - 1);
+        for(int y=from; y<=to; y++){
+            for(boost::uint64_t row = (*tiles)[i].second->rows[y - tile_y]; row; row &= row-1){
+                int px, py;
+                if(toPixel(Cell(tile_x + __builtin_ctzll(row), y), px, py))
+                    obstacles_[size_t(py)*width_ + px]++;
+            }
+        }
+    }
+}
+
+void MapRenderer::addExpansions( const vector<Cell>& expanded ){
+    for(size_t i=0; i<expanded.size(); i++){
+        int px, py;
+        if(toPixel(expanded[i], px, py))
+            expansions_[size_t(py)*width_ + px]++;
+    }
+}
+
+void MapRenderer::addPath( const Path& path ){
+    for(Path::CellIterator cell_it = path.cellsBegin(); cell_it != path.cellsEnd(); ++cell_it)
+        mark(*cell_it, PATH, 0);
+    const vector<Cell>& waypoints = path.getWaypoints();
+    for(size_t i=0; i<waypoints.size(); i++)
+        mark(waypoints[i], JUMP_POINT, 1);
+}
+
+void MapRenderer::addEnds( const Cell& start, const Cell& goal ){
+    mark(start, START, 2);
+    mark(goal, GOAL, 2);
+}
+
+bool MapRenderer::toPixel( const Cell& cell, int& px, int& py ) const {
+    if(cell.x < min_cell_.x || cell.x > max_cell_.x || cell.y < min_cell_.y || cell.y > max_cell_.y)
+        return false;
+    px = (cell.x - min_cell_.x) / scale_;
+    py = (max_cell_.y - cell.y) / scale_;
+    return true;
+}
+
+void MapRenderer::mark( const Cell& cell, Mark type, int radius ){
+    int px, py;
+    if(!toPixel(cell, px, py))
+        return;
+    //later marks of a higher kind win, so the ends stay visible over the path
+    for(int y=max(0, py-radius); y<=min(height_-1, py+radius); y++){
+        for(int x=max(0, px-radius); x<=min(width_-1, px+radius); x++){
+            unsigned char& pixel = marks_[size_t(y)*width_ + x];
+            pixel = max(pixel, (unsigned char)type);
+        }
+    }
+}
+
+void MapRenderer::compose( vector<unsigned char>& rgb ) const {
+    rgb.resize(size_t(width_)*height_*3);
+    boost::uint32_t max_expansions = *max_element(expansions_.begin(), expansions_.end());
+    double cells_per_pixel = double(scale_)*scale_;
+    for(size_t i=0; i<obstacles_.size(); i++){
+        double r = 255, g = 255, b = 255;
+        if(obstacles_[i]){
+            double shade = 200*(1 - min(1.0, obstacles_[i]/cells_per_pixel));
+            r = g = b = shade;
+        }
+        if(expansions_[i]){
+            //yellow for a few expansions, red for the most
+            double heat = log1p(expansions_[i]) / log1p(max_expansions);
+            r = 0.25*r + 0.75*255;
+            g = 0.25*g + 0.75*(230*(1-heat));
+            b = 0.25*b;
+        }
+        switch(marks_[i]){
+            case PATH: r = 0; g = 90; b = 255; break;
+            case JUMP_POINT: r = 255; g = 0; b = 255; break;
+            case START: r = 0; g = 200; b = 0; break;
+            case GOAL: r = 230; g = 0; b = 0; break;
+            default: break;
+        }
+        rgb[3*i] = (unsigned char)r;
+        rgb[3*i+1] = (unsigned char)g;
+        rgb[3*i+2] = (unsigned char)b;
+    }
+}
+
+bool MapRenderer::write( const string& filename ) const {
+    vector<unsigned char> rgb;
+    compose(rgb);
+    string extension = filename.size() >= 4 ? filename.substr(filename.size()-4) : "";
+    if(extension == ".png")
+        return writePng(filename, width_, height_, rgb);
+
+    FILE* file = fopen(filename.c_str(), "wb");
+    if(!file){
+        printf("File \"%s\" could not be opened for writing!\n", filename.c_str());
+        return false;
+    }
+    bool ok;
+    if(extension == ".pgm"){
+        vector<unsigned char> gray(size_t(width_)*height_);
+        for(size_t i=0; i<gray.size(); i++)
+            gray[i] = (299*rgb[3*i] + 587*rgb[3*i+1] + 114*rgb[3*i+2]) / 1000;
+        fprintf(file, "P5\n%d %d\n255\n", width_, height_);
+        ok = fwrite(&gray[0], 1, gray.size(), file) == gray.size();
+    }
+    else{
+        fprintf(file, "P6\n%d %d\n255\n", width_, height_);
+        ok = fwrite(&rgb[0], 1, rgb.size(), file) == rgb.size();
+    }
+    return (fclose(file) == 0) && ok;
+}
+
+bool MapRenderer::writePng( const string& filename, int width, int height, const vector<unsigned char>& rgb ){
+    vector<unsigned char> png;
+    const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    png.insert(png.end(), signature, signature+8);
+
+    vector<unsigned char> header;
+    putUint32(header, width);
+    putUint32(header, height);
+    header.push_back(8);    //bits per channel
+    header.push_back(2);    //rgb
+    header.push_back(0);    //deflate
+    header.push_back(0);    //adaptive filters
+    header.push_back(0);    //no interlace
+    putChunk(png, "IHDR", header);
+
+    //every row starts with filter type 0
+    vector<unsigned char> raw;
+    raw.reserve(size_t(height)*(3*width+1));
+    for(int y=0; y<height; y++){
+        raw.push_back(0);
+        raw.insert(raw.end(), rgb.begin() + size_t(y)*3*width, rgb.begin() + size_t(y+1)*3*width);
+    }
+
+    //zlib stream of stored deflate blocks, at most 65535 bytes each
+    vector<unsigned char> data;
+    data.push_back(0x78);
+    data.push_back(0x01);
+    size_t offset = 0;
+    do{
+        size_t length = min(raw.size()-offset, size_t(65535));
+        data.push_back(offset+length == raw.size() ? 1 : 0);
+        data.push_back(length & 0xff);
+        data.push_back(length >> 8);
+        data.push_back(~length & 0xff);
+        data.push_back((~length >> 8) & 0xff);
+        data.insert(data.end(), raw.begin()+offset, raw.begin()+offset+length);
+        offset += length;
+    } while(offset < raw.size());
+    boost::uint32_t a = 1, b = 0;
+    for(size_t i=0; i<raw.size(); i++){
+        a = (a + raw[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    putUint32(data, (b << 16) | a);
+    putChunk(png, "IDAT", data);
+    putChunk(png, "IEND", vector<unsigned char>());
+
+    FILE* file = fopen(filename.c_str(), "wb");
+    if(!file){
+        printf("File \"%s\" could not be opened for writing!\n", filename.c_str());
+        return false;
+    }
+    bool ok = fwrite(&png[0], 1, png.size(), file) == png.size();
+    return (fclose(file) == 0) && ok;
+}
+
+int MapRenderer::getWidth() const {
+    return width_;
+}
+
+int MapRenderer::getHeight() const {
+    return height_;
+}
+
+int MapRenderer::getCellsPerPixel() const {
+    return scale_;
+}
@@ -0,0 +1,311 @@
+#include "navi_example/MapSnapshot.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <boost/make_shared.hpp>
+#include <boost/unordered_set.hpp>
+
+#include "navi_example/ConnectivityIndex.h"
+#include "navi_example/DistanceTransform.h"
+#include "navi_example/TileStore.h"
+
+using namespace std;
+
+ObstacleTile::ObstacleTile(){
+    memset(rows, 0, sizeof(rows));
+    memset(columns, 0, sizeof(columns));
+}
+
+bool ObstacleTile::empty() const {
+    for(int y=0; y<SIZE; y++){
+        if(rows[y])
+            return false;
+    }
+    return true;
+}
+
+void ObstacleTile::updateColumns(){
+    memset(columns, 0, sizeof(columns));
+    for(int y=0; y<SIZE; y++){
+        for(boost::uint64_t row = rows[y]; row; row &= row-1)
+            columns[__builtin_ctzll(row)] |= boost::uint64_t(1) << y;
+    }
+}
+
+void ObstacleTile::appendCells( const Cell& tile, vector<Cell>& cells ) const {
+    for(int y=0; y<SIZE; y++){
+        //walk the set bits of the row, lowest first
+        for(boost::uint64_t row = rows[y]; row; row &= row-1){
+            int x = __builtin_ctzll(row);
+            cells.push_back(Cell((tile.x << BITS) + x, (tile.y << BITS) + y));
+        }
+    }
+}
+
+const ObstacleTile::ConstPtr TileTable::NONE;
+
+void TileTable::const_iterator::advance(){
+    for(; bucket_it_ != end_; ++bucket_it_, slot_ = 0){
+        for(; slot_ < BUCKET_SIZE*BUCKET_SIZE; slot_++){
+            const ObstacleTile::ConstPtr& tile = bucket_it_->second->tiles[slot_];
+            if(tile){
+                current_.first = Cell((bucket_it_->first.x << BUCKET_BITS) + (slot_ & (BUCKET_SIZE-1)),
+                                      (bucket_it_->first.y << BUCKET_BITS) + (slot_ >> BUCKET_BITS));
+                current_.second = tile;
+                return;
+            }
+        }
+    }
+    slot_ = 0;
+}
+
+TileTable::TileTable( const boost::unordered_map<Cell, ObstacleTile::ConstPtr>& tiles ) : size_(0) {
+    for(boost::unordered_map<Cell, ObstacleTile::ConstPtr>::const_iterator tile_it = tiles.begin(); tile_it != tiles.end(); ++tile_it)
+        set(tile_it->first, tile_it->second);
+}
+
+void TileTable::set( const Cell& tile, const ObstacleTile::ConstPtr& obstacles ){
+    BucketMap::iterator bucket_it = buckets_.find( bucketOf(tile) );
+    if(bucket_it == buckets_.end()){
+        if(!obstacles)
+            return;
+        bucket_it = buckets_.insert(make_pair(bucketOf(tile), boost::make_shared<Bucket>())).first;
+    }
+    else if(!bucket_it->second.unique()){
+        //another table still reads this bucket, so change a private copy
+        bucket_it->second = boost::make_shared<Bucket>(*bucket_it->second);
+    }
+    Bucket& bucket = *bucket_it->second;
+    ObstacleTile::ConstPtr& slot = bucket.tiles[slotOf(tile)];
+    if(slot && !obstacles){
+        bucket.count--;
+        size_--;
+    }
+    else if(!slot && obstacles){
+        bucket.count++;
+        size_++;
+    }
+    slot = obstacles;
+    if(bucket.count == 0)
+        buckets_.erase(bucket_it);
+}
+
+MapSnapshot::MapSnapshot() : version_(0), num_obstacles_(0), submitted_(Clock::now()) {}
+
+MapSnapshot::MapSnapshot( size_t version, boost::shared_ptr<TileStore> store ) :
+    store_(store), version_(version), num_obstacles_(0), submitted_(Clock::now()) {}
+
+MapSnapshot::MapSnapshot( size_t version, const TileMap& tiles ) :
+    tiles_(tiles), version_(version), num_obstacles_(0), submitted_(Clock::now())
+{
+    for(TileMap::const_iterator tile_it = tiles.begin(); tile_it != tiles.end(); ++tile_it){
+        for(int y=0; y<ObstacleTile::SIZE; y++)
+            num_obstacles_ += __builtin_popcountll(tile_it->second->rows[y]);
+    }
+}
+
+MapSnapshot::Ptr MapSnapshot::applyDelta( const vector<Cell>& add, const vector<Cell>& remove, Clock::time_point submitted ) const {
+    //shares the buckets of the tiles and layers; the ones changed below are copied on first write
+    MapSnapshot::Ptr next = boost::make_shared<MapSnapshot>(*this);
+    next->version_ = version_ + 1;
+    next->submitted_ = submitted;
+
+    //tiles copied for this update; they are private to next until it is published
+    boost::unordered_map<Cell, ObstacleTile::Ptr> copied;
+    for(int pass=0; pass<2; pass++){
+        const vector<Cell>& cells = (pass==0) ? add : remove;
+        bool occupied = (pass==0);
+        for(size_t i=0; i<cells.size(); i++){
+            Cell key = tileOf(cells[i]);
+            ObstacleTile::Ptr& tile = copied[key];
+            if(!tile){
+                ObstacleTile::ConstPtr existing = findTile(key);
+                if(existing)
+                    tile = boost::make_shared<ObstacleTile>(*existing);
+                else
+                    tile = boost::make_shared<ObstacleTile>();
+            }
+            boost::uint64_t& row = tile->rows[cells[i].y & (ObstacleTile::SIZE-1)];
+            boost::uint64_t bit = boost::uint64_t(1) << (cells[i].x & (ObstacleTile::SIZE-1));
+            if(occupied && !(row & bit)){
+                row |= bit;
+                next->num_obstacles_++;
+            }
+            else if(!occupied && (row & bit)){
+                row &= ~bit;
+                next->num_obstacles_--;
+            }
+        }
+    }
+
+    for(boost::unordered_map<Cell, ObstacleTile::Ptr>::iterator copy_it = copied.begin(); copy_it != copied.end(); ++copy_it){
+        if(copy_it->second->empty() && !(store_ && store_->hasTile(copy_it->first))){
+            next->tiles_.erase(copy_it->first);
+        }
+        else{
+            copy_it->second->updateColumns();
+            next->tiles_.set(copy_it->first, copy_it->second);
+        }
+    }
+    return next;
+}
+
+size_t MapSnapshot::getVersion() const {
+    return version_;
+}
+
+size_t MapSnapshot::getNumObstacles() const {
+    return num_obstacles_;
+}
+
+ObstacleTile::ConstPtr MapSnapshot::findTile( const Cell& tile ) const {
+    const ObstacleTile::ConstPtr& changed = tiles_.find(tile);
+    if(changed)
+        return changed;
+    return store_ ? store_->getTile(tile) : ObstacleTile::ConstPtr();
+}
+
+void MapSnapshot::collectTiles( vector<pair<Cell, ObstacleTile::ConstPtr> >& tiles ) const {
+    for(TileTable::const_iterator tile_it = tiles_.begin(); tile_it != tiles_.end(); ++tile_it){
+        if(!tile_it->second->empty())
+            tiles.push_back(*tile_it);
+    }
+    if(!store_)
+        return;
+    vector<Cell> stored = store_->getTileCoordinates();
+    for(size_t i=0; i<stored.size(); i++){
+        if(!tiles_.find(stored[i]))
+            tiles.push_back(make_pair(stored[i], store_->getTile(stored[i])));
+    }
+}
+
+boost::shared_ptr<TileStore> MapSnapshot::getStore() const {
+    return store_;
+}
+
+const TileTable& MapSnapshot::getTiles() const {
+    return tiles_;
+}
+
+MapSnapshot::Clock::time_point MapSnapshot::getSubmitTime() const {
+    return submitted_;
+}
+
+const TileTable* MapSnapshot::getLayer( int radius ) const {
+    if(radius == 0)
+        return &tiles_;
+    boost::unordered_map<int, TileTable>::const_iterator layer_it = layers_.find(radius);
+    return layer_it == layers_.end() ? NULL : &(layer_it->second);
+}
+
+const vector<int>& MapSnapshot::getRadii() const {
+    return radii_;
+}
+
+void MapSnapshot::setRadii( const vector<int>& radii, int threads ){
+    radii_ = radii;
+    layers_.clear();
+    if(store_)
+        radii_.clear();
+    if(tiles_.empty() || store_)
+        return;
+    //bounding box of the obstacles, in whole tiles
+    Cell min_tile = tiles_.begin()->first;
+    Cell max_tile = min_tile;
+    for(TileTable::const_iterator tile_it = tiles_.begin(); tile_it != tiles_.end(); ++tile_it){
+        min_tile = Cell(min(min_tile.x, tile_it->first.x), min(min_tile.y, tile_it->first.y));
+        max_tile = Cell(max(max_tile.x, tile_it->first.x), max(max_tile.y, tile_it->first.y));
+    }
+    updateClearance(Cell(min_tile.x << ObstacleTile::BITS, min_tile.y << ObstacleTile::BITS),
+                    Cell(((max_tile.x+1) << ObstacleTile::BITS) - 1, ((max_tile.y+1) << ObstacleTile::BITS) - 1),
+                    threads);
+}
+
+void MapSnapshot::updateClearance( const Cell& min_cell, const Cell& max_cell, int threads ){
+    int max_radius = 0;
+    for(size_t i=0; i<radii_.size(); i++)
+        max_radius = max(max_radius, radii_[i]);
+    if(max_radius == 0)
+        return;
+
+    //tiles whose inflation may have changed, and the margin of tiles around
+    //them wide enough to contain every obstacle within max_radius of them
+    Cell min_tile = tileOf(Cell(min_cell.x-max_radius, min_cell.y-max_radius));
+    Cell max_tile = tileOf(Cell(max_cell.x+max_radius, max_cell.y+max_radius));
+    int margin = (max_radius + ObstacleTile::SIZE - 1) >> ObstacleTile::BITS;
+    //log2 of the block side in tiles; larger blocks spend less on margins
+    const int BLOCK_BITS = 4;
+
+    //only blocks of tiles near an obstacle or holding an inflated tile can
+    //change, so sparse maps never get a window over their empty space
+    boost::unordered_set<Cell> blocks;
+    if(size_t(max_tile.x-min_tile.x+1)*(max_tile.y-min_tile.y+1) <= tiles_.size()){
+        for(int bx=min_tile.x >> BLOCK_BITS; bx<=max_tile.x >> BLOCK_BITS; bx++){
+            for(int by=min_tile.y >> BLOCK_BITS; by<=max_tile.y >> BLOCK_BITS; by++)
+                blocks.insert(Cell(bx,by));
+        }
+    }
+    else{
+        for(TileTable::const_iterator tile_it = tiles_.begin(); tile_it != tiles_.end(); ++tile_it){
+            const Cell& tile = tile_it->first;
+            for(int tx=max(tile.x-margin, min_tile.x); tx<=min(tile.x+margin, max_tile.x); tx++){
+                for(int ty=max(tile.y-margin, min_tile.y); ty<=min(tile.y+margin, max_tile.y); ty++)
+                    blocks.insert(Cell(tx >> BLOCK_BITS, ty >> BLOCK_BITS));
+            }
+        }
+        for(boost::unordered_map<int, TileTable>::const_iterator layer_it = layers_.begin(); layer_it != layers_.end(); ++layer_it){
+            for(TileTable::const_iterator tile_it = layer_it->second.begin(); tile_it != layer_it->second.end(); ++tile_it){
+                const Cell& tile = tile_it->first;
+                if(tile.x >= min_tile.x && tile.x <= max_tile.x && tile.y >= min_tile.y && tile.y <= max_tile.y)
+                    blocks.insert(Cell(tile.x >> BLOCK_BITS, tile.y >> BLOCK_BITS));
+            }
+        }
+    }
+
+    //one transform per block, over the block and its margin
+    for(boost::unordered_set<Cell>::const_iterator block_it = blocks.begin(); block_it != blocks.end(); ++block_it){
+        Cell low(max(block_it->x << BLOCK_BITS, min_tile.x), max(block_it->y << BLOCK_BITS, min_tile.y));
+        Cell high(min(((block_it->x+1) << BLOCK_BITS) - 1, max_tile.x), min(((block_it->y+1) << BLOCK_BITS) - 1, max_tile.y));
+        Cell window_min((low.x-margin) << ObstacleTile::BITS, (low.y-margin) << ObstacleTile::BITS);
+        int width = (high.x-low.x+1+2*margin) << ObstacleTile::BITS;
+        int height = (high.y-low.y+1+2*margin) << ObstacleTile::BITS;
+        DistanceTransform transform(*this, window_min, width, height, threads);
+
+        for(size_t i=0; i<radii_.size(); i++){
+            if(radii_[i] == 0)
+                continue;
+            TileTable& layer = layers_[radii_[i]];
+            for(int tx=low.x; tx<=high.x; tx++){
+                for(int ty=low.y; ty<=high.y; ty++){
+                    ObstacleTile::Ptr inflated = boost::make_shared<ObstacleTile>();
+                    transform.inflateTile(Cell(tx,ty), radii_[i], *inflated);
+                    if(inflated->empty())
+                        layer.erase(Cell(tx,ty));
+                    else
+                        layer.set(Cell(tx,ty), inflated);
+                }
+            }
+        }
+    }
+}
+
+const ConnectivityIndex* MapSnapshot::getConnectivity( int radius ) const {
+    boost::unordered_map<int, boost::shared_ptr<const ConnectivityIndex> >::const_iterator index_it = connectivity_.find(radius);
+    return index_it == connectivity_.end() ? NULL : index_it->second.get();
+}
+
+void MapSnapshot::updateConnectivity( int threads ){
+    boost::unordered_map<int, boost::shared_ptr<const ConnectivityIndex> > previous;
+    previous.swap(connectivity_);
+    if(store_)
+        return;
+    vector<int> radii(1, 0);
+    radii.insert(radii.end(), radii_.begin(), radii_.end());
+    for(size_t i=0; i<radii.size(); i++){
+        const TileTable* layer = getLayer(radii[i]);
+        if(!layer || connectivity_.count(radii[i]))
+            continue;
+        connectivity_[radii[i]] = boost::make_shared<ConnectivityIndex>(*layer, threads, previous[radii[i]]);
+    }
+}
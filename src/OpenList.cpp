@@ -0,0 +1,136 @@
+#include "navi_example/OpenList.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+void BinaryHeapOpenList::push(const SearchState::Ptr& state){
+    heap_.push_back(state);
+    push_heap(heap_.begin(), heap_.end());
+}
+
+SearchState::Ptr BinaryHeapOpenList::pop(){
+    SearchState::Ptr top = heap_.front();
+    pop_heap(heap_.begin(), heap_.end());
+    heap_.pop_back();
+    return top;
+}
+
+void BinaryHeapOpenList::decreaseKey(const SearchState::Ptr& state){
+    make_heap(heap_.begin(), heap_.end());
+}
+
+SearchState::Ptr BinaryHeapOpenList::removeWorst(){
+    //the largest key is always a leaf, and the leaves are the second half
+    size_t worst = heap_.size()/2;
+    for(size_t i=worst+1; i<heap_.size(); i++){
+        //operator< orders by descending g+h, so this is the larger key
+        if(heap_[i] < heap_[worst])
+            worst = i;
+    }
+    SearchState::Ptr state = heap_[worst];
+    heap_[worst] = heap_.back();
+    heap_.pop_back();
+    make_heap(heap_.begin(), heap_.end());
+    return state;
+}
+
+bool BinaryHeapOpenList::empty() const {
+    return heap_.empty();
+}
+
+size_t BinaryHeapOpenList::size() const {
+    return heap_.size();
+}
+
+BucketOpenList::BucketOpenList() : last_(0), size_(0) {}
+
+boost::uint64_t BucketOpenList::key(const SearchState::Ptr& state){
+    return llround(state->g + state->h);
+}
+
+size_t BucketOpenList::bucket(boost::uint64_t key) const {
+    if(key == last_)
+        return 0;
+    return 64 - __builtin_clzll(key ^ last_);
+}
+
+void BucketOpenList::insert(const SearchState::Ptr& state){
+    boost::uint64_t k = key(state);
+    buckets_[bucket(k)].push_back(make_pair(k, state));
+}
+
+void BucketOpenList::push(const SearchState::Ptr& state){
+    insert(state);
+    size_++;
+}
+
+void BucketOpenList::decreaseKey(const SearchState::Ptr& state){
+    insert(state);
+}
+
+SearchState::Ptr BucketOpenList::pop(){
+    while(true){
+        if(buckets_[0].empty()){
+            //find the first non-empty bucket and make its minimum the new last key
+            size_t i = 1;
+            while(buckets_[i].empty())
+                i++;
+            boost::uint64_t min_key = buckets_[i][0].first;
+            for(size_t j=1; j<buckets_[i].size(); j++)
+                min_key = min(min_key, buckets_[i][j].first);
+            last_ = min_key;
+
+            //every entry of bucket i now falls in a lower bucket
+            vector<Entry> entries;
+            entries.swap(buckets_[i]);
+            for(size_t j=0; j<entries.size(); j++)
+                buckets_[bucket(entries[j].first)].push_back(entries[j]);
+        }
+        Entry entry = buckets_[0].back();
+        buckets_[0].pop_back();
+        //skip entries left behind by decreaseKey
+        if(entry.first == key(entry.second)){
+            size_--;
+            return entry.second;
+        }
+    }
+}
+
+SearchState::Ptr BucketOpenList::removeWorst(){
+    for(size_t i=64; i<65; i--){
+        vector<Entry>& entries = buckets_[i];
+        //drop outdated entries while looking for the largest key
+        size_t worst = 0;
+        bool found = false;
+        for(size_t j=0; j<entries.size(); ){
+            if(entries[j].first != key(entries[j].second)){
+                entries[j] = entries.back();
+                entries.pop_back();
+                continue;
+            }
+            if(!found || entries[j].first > entries[worst].first){
+                worst = j;
+                found = true;
+            }
+            j++;
+        }
+        if(found){
+            SearchState::Ptr state = entries[worst].second;
+            entries[worst] = entries.back();
+            entries.pop_back();
+            size_--;
+            return state;
+        }
+    }
+    return SearchState::Ptr();
+}
+
+bool BucketOpenList::empty() const {
+    return size_ == 0;
+}
+
+size_t BucketOpenList::size() const {
+    return size_;
+}
@@ -0,0 +1,412 @@
+#include "navi_example/PartitionCoordinator.h"
+#include "navi_example/PartitionWorker.h"
+#include "navi_example/QueryStats.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <sstream>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <boost/bind.hpp>
+#include <boost/chrono.hpp>
+#include <boost/foreach.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/thread/thread.hpp>
+
+using namespace std;
+
+typedef boost::chrono::steady_clock Clock;
+
+namespace {
+/**
+ * @brief reads a json array of numbers
+ */
+bool readNumbers(const boost::property_tree::ptree& node, vector<double>& numbers){
+    numbers.clear();
+    BOOST_FOREACH( const boost::property_tree::ptree::value_type& item, node ){
+        boost::optional<double> value = item.second.get_value_optional<double>();
+        if(!value)
+            return false;
+        numbers.push_back(*value);
+    }
+    return true;
+}
+
+/**
+ * @brief reads a json array of arrays of numbers
+ */
+bool readRows(const boost::property_tree::ptree& node, vector<vector<double> >& rows){
+    rows.clear();
+    BOOST_FOREACH( const boost::property_tree::ptree::value_type& item, node ){
+        rows.push_back(vector<double>());
+        if(!readNumbers(item.second, rows.back()))
+            return false;
+    }
+    return true;
+}
+
+double distance(const Cell& from, const Cell& to){
+    double dx = to.x - from.x, dy = to.y - from.y;
+    return sqrt(dx*dx + dy*dy);
+}
+}
+
+PartitionQueryStats::PartitionQueryStats() : expansions(0), segments(0), direct(false), ends_ms(0), search_ms(0), segments_ms(0) {}
+
+ostream& operator<<(ostream& os, const PartitionQueryStats& stats){
+    os << "expansions=" << stats.expansions
+       << " segments=" << stats.segments
+       << " direct=" << (stats.direct ? "true" : "false")
+       << " ends_ms=" << stats.ends_ms
+       << " search_ms=" << stats.search_ms
+       << " segments_ms=" << stats.segments_ms;
+    return os;
+}
+
+PartitionCoordinator::PartitionCoordinator() : num_edges_(0), next_id_(0) {}
+
+PartitionCoordinator::~PartitionCoordinator(){
+    for(size_t i=0; i<workers_.size(); i++)
+        close(workers_[i].fd);
+}
+
+bool PartitionCoordinator::addWorker( const string& host, int port, double timeout_seconds ){
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* address = NULL;
+    ostringstream service;
+    service << port;
+    if(getaddrinfo(host.c_str(), service.str().c_str(), &hints, &address) != 0 || !address){
+        printf("Could not resolve worker \"%s\"\n", host.c_str());
+        return false;
+    }
+
+    //the worker only listens once its distances are computed
+    Clock::time_point begin = Clock::now();
+    int fd = -1;
+    while(true){
+        fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if(fd >= 0 && connect(fd, address->ai_addr, address->ai_addrlen) == 0)
+            break;
+        int error = errno;
+        if(fd >= 0)
+            close(fd);
+        fd = -1;
+        if(QueryStats::millisecondsSince(begin) > timeout_seconds*1000){
+            printf("Could not connect to worker %s:%d: %s\n", host.c_str(), port, strerror(error));
+            break;
+        }
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(50));
+    }
+    freeaddrinfo(address);
+    if(fd < 0)
+        return false;
+    int no_delay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+    Worker worker;
+    worker.fd = fd;
+    boost::property_tree::ptree reply;
+    ostringstream request;
+    request << "{\"id\": " << next_id_++ << ", \"op\": \"info\"}";
+    vector<double> min_cell, max_cell;
+    vector<vector<double> > transitions, distances;
+    if(!call(worker, request.str(), reply) ||
+       !readNumbers(reply.get_child("min", boost::property_tree::ptree()), min_cell) || min_cell.size() != 2 ||
+       !readNumbers(reply.get_child("max", boost::property_tree::ptree()), max_cell) || max_cell.size() != 2 ||
+       !readRows(reply.get_child("transitions", boost::property_tree::ptree()), transitions) ||
+       !readRows(reply.get_child("distances", boost::property_tree::ptree()), distances)){
+        printf("Worker %s:%d did not describe its partition\n", host.c_str(), port);
+        close(fd);
+        return false;
+    }
+    worker.min_cell = Cell(int(min_cell[0]), int(min_cell[1]));
+    worker.max_cell = Cell(int(max_cell[0]), int(max_cell[1]));
+    int index = int(workers_.size());
+
+    //transitions sharing a corner cell share its node
+    for(size_t i=0; i<transitions.size(); i++){
+        if(transitions[i].size() != 4){
+            close(fd);
+            return false;
+        }
+        worker.nodes.push_back(addNode(Cell(int(transitions[i][0]), int(transitions[i][1])), index));
+    }
+    for(size_t i=0; i<distances.size(); i++){
+        if(distances[i].size() != 3 || distances[i][0] >= worker.nodes.size() || distances[i][1] >= worker.nodes.size())
+            continue;
+        int from = worker.nodes[size_t(distances[i][0])], to = worker.nodes[size_t(distances[i][1])];
+        addEdge(from, to, distances[i][2]);
+        addEdge(to, from, distances[i][2]);
+    }
+    //a transition pairs up with the neighbouring partition's one across the border, if it is loaded yet
+    for(size_t i=0; i<transitions.size(); i++){
+        boost::unordered_map<Cell, int>::const_iterator outside_it = node_ids_.find(Cell(int(transitions[i][2]), int(transitions[i][3])));
+        if(outside_it == node_ids_.end() || owners_[outside_it->second] == index)
+            continue;
+        double cost = distance(Cell(int(transitions[i][0]), int(transitions[i][1])), cells_[outside_it->second]);
+        addEdge(worker.nodes[i], outside_it->second, cost);
+        addEdge(outside_it->second, worker.nodes[i], cost);
+    }
+    workers_.push_back(worker);
+    return true;
+}
+
+int PartitionCoordinator::addNode( const Cell& cell, int worker ){
+    boost::unordered_map<Cell, int>::const_iterator node_it = node_ids_.find(cell);
+    if(node_it != node_ids_.end())
+        return node_it->second;
+    int node = int(cells_.size());
+    node_ids_[cell] = node;
+    cells_.push_back(cell);
+    owners_.push_back(worker);
+    edges_.push_back(vector<Edge>());
+    return node;
+}
+
+void PartitionCoordinator::addEdge( int from, int to, double cost ){
+    if(from == to)
+        return;
+    Edge edge;
+    edge.to = to;
+    edge.cost = cost;
+    edges_[from].push_back(edge);
+    num_edges_++;
+}
+
+int PartitionCoordinator::ownerOf( const Cell& cell ) const {
+    for(size_t i=0; i<workers_.size(); i++){
+        const Worker& worker = workers_[i];
+        if(cell.x >= worker.min_cell.x && cell.y >= worker.min_cell.y && cell.x <= worker.max_cell.x && cell.y <= worker.max_cell.y)
+            return int(i);
+    }
+    return -1;
+}
+
+bool PartitionCoordinator::call( Worker& worker, const string& request, boost::property_tree::ptree& reply ){
+    string line;
+    if(!PartitionWorker::sendLine(worker.fd, request) || !PartitionWorker::readLine(worker.fd, worker.pending, line))
+        return false;
+    try{
+        stringstream input(line);
+        boost::property_tree::read_json(input, reply);
+    }
+    catch(const boost::property_tree::ptree_error& error){
+        return false;
+    }
+    return reply.get("ok", false);
+}
+
+void PartitionCoordinator::callWorker( size_t worker, vector<Call>* calls ){
+    for(size_t i=0; i<calls->size(); i++){
+        Call& current = (*calls)[i];
+        if(current.worker == worker)
+            current.ok = call(workers_[worker], current.request, current.reply);
+    }
+}
+
+void PartitionCoordinator::callAll( vector<Call>& calls ){
+    vector<bool> busy(workers_.size(), false);
+    vector<size_t> called;
+    for(size_t i=0; i<calls.size(); i++){
+        if(!busy[calls[i].worker])
+            called.push_back(calls[i].worker);
+        busy[calls[i].worker] = true;
+    }
+    //each worker answers its calls in order over its one connection
+    boost::thread_group group;
+    for(size_t i=1; i<called.size(); i++)
+        group.create_thread(boost::bind(&PartitionCoordinator::callWorker, this, called[i], &calls));
+    if(!called.empty())
+        callWorker(called[0], &calls);
+    group.join_all();
+}
+
+bool PartitionCoordinator::plan( const Cell& start, const Cell& goal, Path& path ){
+    stats_ = PartitionQueryStats();
+    path.clear();
+    int start_owner = ownerOf(start), goal_owner = ownerOf(goal);
+    if(start_owner < 0 || goal_owner < 0)
+        return false;
+
+    //link both ends to the transitions of their partitions, and plan
+    //directly if they share one
+    Clock::time_point begin = Clock::now();
+    vector<Call> calls(start_owner == goal_owner ? 3 : 2);
+    ostringstream request;
+    request << "{\"id\": " << next_id_++ << ", \"op\": \"distances\", \"cell\": [" << start.x << ", " << start.y << "]}";
+    calls[0].worker = start_owner;
+    calls[0].request = request.str();
+    request.str("");
+    request << "{\"id\": " << next_id_++ << ", \"op\": \"distances\", \"cell\": [" << goal.x << ", " << goal.y << "]}";
+    calls[1].worker = goal_owner;
+    calls[1].request = request.str();
+    if(calls.size() == 3){
+        request.str("");
+        request << "{\"id\": " << next_id_++ << ", \"op\": \"segment\", \"start\": [" << start.x << ", " << start.y
+                << "], \"goal\": [" << goal.x << ", " << goal.y << "]}";
+        calls[2].worker = start_owner;
+        calls[2].request = request.str();
+    }
+    callAll(calls);
+    vector<double> from_start, to_goal;
+    if(!calls[0].ok || !calls[1].ok ||
+       !readNumbers(calls[0].reply.get_child("costs", boost::property_tree::ptree()), from_start) ||
+       !readNumbers(calls[1].reply.get_child("costs", boost::property_tree::ptree()), to_goal) ||
+       from_start.size() != workers_[start_owner].nodes.size() || to_goal.size() != workers_[goal_owner].nodes.size())
+        return false;
+    double direct_cost = numeric_limits<double>::infinity();
+    vector<vector<double> > direct;
+    if(calls.size() == 3 && calls[2].ok && readRows(calls[2].reply.get_child("path", boost::property_tree::ptree()), direct))
+        direct_cost = calls[2].reply.get("cost", numeric_limits<double>::infinity());
+    stats_.ends_ms = QueryStats::millisecondsSince(begin);
+
+    //A* over the boundary graph, with start and goal as two extra nodes
+    begin = Clock::now();
+    int num_nodes = int(cells_.size());
+    int start_node = num_nodes, goal_node = num_nodes+1;
+    vector<double> goal_costs(num_nodes, -1);
+    for(size_t i=0; i<to_goal.size(); i++){
+        int node = workers_[goal_owner].nodes[i];
+        if(to_goal[i] >= 0 && (goal_costs[node] < 0 || to_goal[i] < goal_costs[node]))
+            goal_costs[node] = to_goal[i];
+    }
+    vector<double> g(num_nodes+2, numeric_limits<double>::infinity());
+    vector<int> parents(num_nodes+2, -1);
+    vector<bool> closed(num_nodes+2, false);
+    typedef pair<double, int> Entry;
+    priority_queue<Entry, vector<Entry>, greater<Entry> > open;
+    g[start_node] = 0;
+    open.push(Entry(distance(start, goal), start_node));
+    while(!open.empty()){
+        int node = open.top().second;
+        open.pop();
+        if(closed[node])
+            continue;
+        closed[node] = true;
+        stats_.expansions++;
+        if(node == goal_node)
+            break;
+
+        vector<Edge> successors;
+        if(node == start_node){
+            for(size_t i=0; i<from_start.size(); i++){
+                if(from_start[i] < 0)
+                    continue;
+                Edge edge;
+                edge.to = workers_[start_owner].nodes[i];
+                edge.cost = from_start[i];
+                successors.push_back(edge);
+            }
+        }
+        else{
+            successors = edges_[node];
+            if(goal_costs[node] >= 0){
+                Edge edge;
+                edge.to = goal_node;
+                edge.cost = goal_costs[node];
+                successors.push_back(edge);
+            }
+        }
+        for(size_t i=0; i<successors.size(); i++){
+            int next = successors[i].to;
+            double cost = g[node] + successors[i].cost;
+            if(closed[next] || cost >= g[next])
+                continue;
+            g[next] = cost;
+            parents[next] = node;
+            open.push(Entry(cost + (next == goal_node ? 0 : distance(cells_[next], goal)), next));
+        }
+    }
+    stats_.search_ms = QueryStats::millisecondsSince(begin);
+
+    if(!direct.empty() && direct_cost <= g[goal_node]){
+        stats_.direct = true;
+        for(size_t i=0; i<direct.size(); i++){
+            if(direct[i].size() == 2)
+                path.addWaypoint(Cell(int(direct[i][0]), int(direct[i][1])));
+        }
+        return true;
+    }
+    if(!closed[goal_node])
+        return false;
+
+    //the path through the boundary graph, then its segments from the workers
+    begin = Clock::now();
+    vector<int> nodes;
+    for(int node = goal_node; node >= 0; node = parents[node])
+        nodes.push_back(node);
+    reverse(nodes.begin(), nodes.end());
+    vector<Cell> points;
+    vector<int> owners;
+    for(size_t i=0; i<nodes.size(); i++){
+        points.push_back(nodes[i] == start_node ? start : nodes[i] == goal_node ? goal : cells_[nodes[i]]);
+        owners.push_back(nodes[i] == start_node ? start_owner : nodes[i] == goal_node ? goal_owner : owners_[nodes[i]]);
+    }
+    //a step between partitions is a border crossing, any other step a segment inside one
+    calls.clear();
+    vector<int> pieces(points.size(), -1);
+    for(size_t i=0; i+1<points.size(); i++){
+        if(owners[i] != owners[i+1] || points[i] == points[i+1])
+            continue;
+        Call segment;
+        segment.worker = owners[i];
+        request.str("");
+        request << "{\"id\": " << next_id_++ << ", \"op\": \"segment\", \"start\": [" << points[i].x << ", " << points[i].y
+                << "], \"goal\": [" << points[i+1].x << ", " << points[i+1].y << "]}";
+        segment.request = request.str();
+        pieces[i] = int(calls.size());
+        calls.push_back(segment);
+    }
+    callAll(calls);
+    stats_.segments = calls.size();
+
+    path.addWaypoint(start);
+    for(size_t i=0; i+1<points.size(); i++){
+        if(pieces[i] < 0){
+            if(!(points[i] == points[i+1]))
+                path.addWaypoint(points[i+1]);
+            continue;
+        }
+        vector<vector<double> > waypoints;
+        if(!calls[pieces[i]].ok || !readRows(calls[pieces[i]].reply.get_child("path", boost::property_tree::ptree()), waypoints)){
+            path.clear();
+            return false;
+        }
+        //the first waypoint is where the previous piece ended
+        for(size_t j=1; j<waypoints.size(); j++){
+            if(waypoints[j].size() == 2)
+                path.addWaypoint(Cell(int(waypoints[j][0]), int(waypoints[j][1])));
+        }
+    }
+    stats_.segments_ms = QueryStats::millisecondsSince(begin);
+    return true;
+}
+
+PartitionQueryStats PartitionCoordinator::getStats() const {
+    return stats_;
+}
+
+size_t PartitionCoordinator::getNumWorkers() const {
+    return workers_.size();
+}
+
+size_t PartitionCoordinator::getNumNodes() const {
+    return cells_.size();
+}
+
+size_t PartitionCoordinator::getNumEdges() const {
+    return num_edges_;
+}
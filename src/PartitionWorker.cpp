@@ -0,0 +1,339 @@
+#include "navi_example/PartitionWorker.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "navi_example/Graph.h"
+#include "navi_example/JsonLines.h"
+#include "navi_example/Planner.h"
+
+using namespace std;
+
+PartitionWorker::PartitionWorker( Environment::Ptr env, const Cell& min_cell, const Cell& max_cell ) : env_(env), min_cell_(min_cell), max_cell_(max_cell) {}
+
+void PartitionWorker::findTransitions( const MapSnapshot& snapshot, const Cell& min_cell, const Cell& max_cell, vector<Transition>& transitions ){
+    //bottom, top, left and right: the first inside cell, the step along the side and the step out of the partition
+    Cell firsts[4] = {min_cell, Cell(min_cell.x, max_cell.y), min_cell, Cell(max_cell.x, min_cell.y)};
+    Cell alongs[4] = {Cell(1,0), Cell(1,0), Cell(0,1), Cell(0,1)};
+    Cell outs[4] = {Cell(0,-1), Cell(0,1), Cell(-1,0), Cell(1,0)};
+    int lengths[4] = {max_cell.x-min_cell.x+1, max_cell.x-min_cell.x+1, max_cell.y-min_cell.y+1, max_cell.y-min_cell.y+1};
+    for(int side=0; side<4; side++){
+        int run_start = -1;
+        for(int i=0; i<=lengths[side]; i++){
+            Cell inside(firsts[side].x + i*alongs[side].x, firsts[side].y + i*alongs[side].y);
+            Cell outside(inside.x + outs[side].x, inside.y + outs[side].y);
+            bool open = i < lengths[side] && snapshot.isCollisionFree(inside) && snapshot.isCollisionFree(outside);
+            if(open && run_start < 0)
+                run_start = i;
+            if(open || run_start < 0)
+                continue;
+            //an entrance just ended at i-1
+            vector<int> picks;
+            if(i - run_start < ENTRANCE_SPLIT){
+                picks.push_back((run_start + i-1)/2);
+            }
+            else{
+                //both ends, and evenly spread ones between them no more than ENTRANCE_SPACING apart
+                int gaps = (i-1 - run_start + ENTRANCE_SPACING-1)/ENTRANCE_SPACING;
+                for(int k=0; k<=gaps; k++)
+                    picks.push_back(run_start + (i-1 - run_start)*k/gaps);
+            }
+            for(size_t k=0; k<picks.size(); k++){
+                Transition transition;
+                transition.inside = Cell(firsts[side].x + picks[k]*alongs[side].x, firsts[side].y + picks[k]*alongs[side].y);
+                transition.outside = Cell(transition.inside.x + outs[side].x, transition.inside.y + outs[side].y);
+                transitions.push_back(transition);
+            }
+            run_start = -1;
+        }
+    }
+
+    //a crossing only diagonal, from an inside cell to the outside cell one
+    //step along, with both straight crossings between them blocked; both
+    //partitions find it from their side. Only the left and right sides take
+    //the ones at a corner, into the partition diagonally next to this one
+    for(int side=0; side<4; side++){
+        for(int i=0; i<lengths[side]; i++){
+            Cell inside(firsts[side].x + i*alongs[side].x, firsts[side].y + i*alongs[side].y);
+            if(!snapshot.isCollisionFree(inside) || snapshot.isCollisionFree(Cell(inside.x + outs[side].x, inside.y + outs[side].y)))
+                continue;
+            for(int step=-1; step<=1; step+=2){
+                if(side < 2 && (i+step < 0 || i+step >= lengths[side]))
+                    continue;
+                Cell beside(inside.x + step*alongs[side].x, inside.y + step*alongs[side].y);
+                Cell outside(beside.x + outs[side].x, beside.y + outs[side].y);
+                if(snapshot.isCollisionFree(beside) || !snapshot.isCollisionFree(outside))
+                    continue;
+                Transition transition;
+                transition.inside = inside;
+                transition.outside = outside;
+                transitions.push_back(transition);
+            }
+        }
+    }
+}
+
+void PartitionWorker::labelComponents( int threads ){
+    //copies of the tiles of the partition and the ring around it, every cell outside the partition occupied
+    MapSnapshot::ConstPtr snapshot = env_->getSnapshot();
+    TileTable walled;
+    Cell min_tile = MapSnapshot::tileOf(Cell(min_cell_.x-1, min_cell_.y-1));
+    Cell max_tile = MapSnapshot::tileOf(Cell(max_cell_.x+1, max_cell_.y+1));
+    for(int ty=min_tile.y; ty<=max_tile.y; ty++){
+        for(int tx=min_tile.x; tx<=max_tile.x; tx++){
+            ObstacleTile::ConstPtr obstacles = snapshot->findTile(Cell(tx, ty));
+            ObstacleTile::Ptr tile = obstacles ? boost::make_shared<ObstacleTile>(*obstacles) : boost::make_shared<ObstacleTile>();
+            int x0 = tx << ObstacleTile::BITS, y0 = ty << ObstacleTile::BITS;
+            boost::uint64_t outside = 0;
+            for(int k=0; k<ObstacleTile::SIZE; k++){
+                if(x0 + k < min_cell_.x || x0 + k > max_cell_.x)
+                    outside |= boost::uint64_t(1) << k;
+            }
+            for(int k=0; k<ObstacleTile::SIZE; k++)
+                tile->rows[k] |= (y0 + k < min_cell_.y || y0 + k > max_cell_.y) ? ~boost::uint64_t(0) : outside;
+            tile->updateColumns();
+            walled.set(Cell(tx, ty), tile);
+        }
+    }
+    components_ = boost::make_shared<ConnectivityIndex>(walled, threads);
+}
+
+bool PartitionWorker::isConnected( const Cell& a, const Cell& b ) const {
+    return !components_ || components_->isConnected(a, b);
+}
+
+void PartitionWorker::precompute( int threads ){
+    transitions_.clear();
+    findTransitions(*env_->getSnapshot(), min_cell_, max_cell_, transitions_);
+    labelComponents(threads);
+    distances_.assign(transitions_.size()*transitions_.size(), -1);
+    threads = max(1, threads);
+    boost::thread_group group;
+    for(int i=0; i<threads; i++)
+        group.create_thread(boost::bind(&PartitionWorker::planSources, this, i, threads));
+    group.join_all();
+}
+
+void PartitionWorker::planSources( int first, int step ){
+    size_t count = transitions_.size();
+    for(size_t i=first; i<count; i+=step){
+        distances_[i*count + i] = 0;
+        for(size_t j=i+1; j<count; j++){
+            Path path;
+            if(isConnected(transitions_[i].inside, transitions_[j].inside) && plan(transitions_[i].inside, transitions_[j].inside, path))
+                distances_[i*count + j] = distances_[j*count + i] = path.cost();
+        }
+    }
+}
+
+const vector<Transition>& PartitionWorker::getTransitions() const {
+    return transitions_;
+}
+
+double PartitionWorker::getDistance( size_t from, size_t to ) const {
+    return distances_[from*transitions_.size() + to];
+}
+
+bool PartitionWorker::contains( const Cell& cell ) const {
+    return cell.x >= min_cell_.x && cell.y >= min_cell_.y && cell.x <= max_cell_.x && cell.y <= max_cell_.y;
+}
+
+bool PartitionWorker::plan( const Cell& start, const Cell& goal, Path& path ) const {
+    path.clear();
+    if(!contains(start) || !contains(goal))
+        return false;
+    if(start == goal){
+        path.addWaypoint(start);
+        return env_->getSnapshot()->isCollisionFree(start);
+    }
+    Graph::Ptr graph = boost::make_shared<Graph>(env_, start, goal);
+    graph->setBounds(min_cell_, max_cell_);
+    Planner planner(env_, graph);
+    planner.setVerbose(false);
+    return planner.plan(path);
+}
+
+void PartitionWorker::planToTransitions( const Cell& cell, vector<double>& costs ) const {
+    costs.assign(transitions_.size(), -1);
+    for(size_t i=0; i<transitions_.size(); i++){
+        Path path;
+        if(isConnected(cell, transitions_[i].inside) && plan(cell, transitions_[i].inside, path))
+            costs[i] = path.cost();
+    }
+}
+
+Cell PartitionWorker::getMinCell() const {
+    return min_cell_;
+}
+
+Cell PartitionWorker::getMaxCell() const {
+    return max_cell_;
+}
+
+string PartitionWorker::answer( const string& request ) const {
+    boost::property_tree::ptree tree;
+    try{
+        stringstream input(request);
+        boost::property_tree::read_json(input, tree);
+    }
+    catch(const boost::property_tree::ptree_error& error){
+        return JsonLines::errorReply("null", "malformed request");
+    }
+    string id = JsonLines::formatId(tree);
+    string op = tree.get<string>("op", "");
+
+    ostringstream reply;
+    reply << fixed << setprecision(4) << "{\"id\": " << id << ", \"ok\": true";
+    if(op == "info"){
+        reply << ", \"min\": [" << min_cell_.x << ", " << min_cell_.y << "], \"max\": [" << max_cell_.x << ", " << max_cell_.y << "], \"transitions\": [";
+        for(size_t i=0; i<transitions_.size(); i++){
+            const Transition& transition = transitions_[i];
+            reply << (i ? ", " : "") << "[" << transition.inside.x << ", " << transition.inside.y << ", "
+                  << transition.outside.x << ", " << transition.outside.y << "]";
+        }
+        reply << "], \"distances\": [";
+        bool first = true;
+        for(size_t i=0; i<transitions_.size(); i++){
+            for(size_t j=i+1; j<transitions_.size(); j++){
+                double distance = getDistance(i, j);
+                if(distance < 0)
+                    continue;
+                reply << (first ? "" : ", ") << "[" << i << ", " << j << ", " << distance << "]";
+                first = false;
+            }
+        }
+        reply << "]}";
+    }
+    else if(op == "distances"){
+        Cell cell;
+        boost::optional<boost::property_tree::ptree&> cell_node = tree.get_child_optional("cell");
+        if(!cell_node || !JsonLines::readCell(*cell_node, cell))
+            return JsonLines::errorReply(id, "cell must be [x, y]");
+        if(!contains(cell))
+            return JsonLines::errorReply(id, "cell outside the partition");
+        vector<double> costs;
+        planToTransitions(cell, costs);
+        reply << ", \"costs\": [";
+        for(size_t i=0; i<costs.size(); i++)
+            reply << (i ? ", " : "") << costs[i];
+        reply << "]}";
+    }
+    else if(op == "segment"){
+        Cell start, goal;
+        boost::optional<boost::property_tree::ptree&> start_node = tree.get_child_optional("start");
+        boost::optional<boost::property_tree::ptree&> goal_node = tree.get_child_optional("goal");
+        if(!start_node || !goal_node || !JsonLines::readCell(*start_node, start) || !JsonLines::readCell(*goal_node, goal))
+            return JsonLines::errorReply(id, "start and goal must be [x, y]");
+        Path path;
+        if(!plan(start, goal, path))
+            return JsonLines::errorReply(id, "no plan found");
+        reply << ", \"cost\": " << path.cost() << ", \"path\": [";
+        const vector<Cell>& points = path.getWaypoints();
+        for(size_t i=0; i<points.size(); i++)
+            reply << (i ? ", " : "") << "[" << points[i].x << ", " << points[i].y << "]";
+        reply << "]}";
+    }
+    else{
+        return JsonLines::errorReply(id, "unknown op");
+    }
+    return reply.str();
+}
+
+bool PartitionWorker::serve( int port ){
+    //a coordinator hanging up early must not take the worker down
+    signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    if(listener >= 0)
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if(listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 64) != 0){
+        printf("Could not listen on port %d: %s\n", port, strerror(errno));
+        if(listener >= 0)
+            close(listener);
+        return false;
+    }
+    while(true){
+        int client = accept(listener, NULL, NULL);
+        if(client < 0){
+            if(errno == EINTR || errno == ECONNABORTED)
+                continue;
+            printf("Accepting on port %d failed: %s\n", port, strerror(errno));
+            break;
+        }
+        //replies are single small writes a client waits for
+        int no_delay = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+        boost::thread reader(boost::bind(&PartitionWorker::answerClient, this, client));
+        reader.detach();
+    }
+    close(listener);
+    return true;
+}
+
+void PartitionWorker::answerClient( int fd ) const {
+    string pending, line;
+    while(readLine(fd, pending, line)){
+        if(line.find_first_not_of(" \t\r") == string::npos)
+            continue;
+        if(!sendLine(fd, answer(line)))
+            break;
+    }
+    close(fd);
+}
+
+bool PartitionWorker::sendLine( int fd, const string& line ){
+    string data = line + '\n';
+    const char* out = data.c_str();
+    size_t left = data.size();
+    while(left > 0){
+        ssize_t written = write(fd, out, left);
+        if(written < 0 && errno == EINTR)
+            continue;
+        if(written <= 0)
+            return false;
+        out += written;
+        left -= written;
+    }
+    return true;
+}
+
+bool PartitionWorker::readLine( int fd, string& pending, string& line ){
+    char buffer[1 << 16];
+    size_t newline;
+    while((newline = pending.find('\n')) == string::npos){
+        ssize_t got = read(fd, buffer, sizeof(buffer));
+        if(got < 0 && errno == EINTR)
+            continue;
+        if(got <= 0){
+            //a last line without a newline still counts
+            if(pending.empty())
+                return false;
+            pending += '\n';
+            break;
+        }
+        pending.append(buffer, got);
+    }
+    newline = pending.find('\n');
+    line = pending.substr(0, newline);
+    pending.erase(0, newline+1);
+    return true;
+}
@@ -0,0 +1,116 @@
+#include "navi_example/Path.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+using namespace std;
+
+Path::CellIterator::CellIterator() : waypoints_(NULL), next_(0), position_(0) {}
+
+Path::CellIterator::CellIterator(const vector<Cell>* waypoints, size_t position) : waypoints_(waypoints), next_(1), position_(position) {
+    if(position_ == END)
+        next_ = waypoints_->size()+1;
+    else if(!waypoints_->empty()){
+        current_ = waypoints_->front();
+        skipReached();
+    }
+}
+
+void Path::CellIterator::skipReached(){
+    while(next_ < waypoints_->size() && current_ == (*waypoints_)[next_])
+        next_++;
+}
+
+Path::CellIterator::reference Path::CellIterator::operator*() const {
+    return current_;
+}
+
+Path::CellIterator::pointer Path::CellIterator::operator->() const {
+    return &current_;
+}
+
+Path::CellIterator& Path::CellIterator::operator++(){
+    position_++;
+    if(next_ < waypoints_->size()){
+        //one step towards the next waypoint
+        current_ = current_ + ((*waypoints_)[next_] - current_);
+        skipReached();
+    }
+    else if(next_ == waypoints_->size())
+        next_++;
+    return *this;
+}
+
+Path::CellIterator Path::CellIterator::operator++(int){
+    CellIterator copy = *this;
+    ++(*this);
+    return copy;
+}
+
+bool Path::CellIterator::exhausted() const {
+    return !waypoints_ || next_ > waypoints_->size();
+}
+
+bool Path::CellIterator::operator==(const CellIterator& other) const {
+    if(position_ == END || other.position_ == END)
+        return exhausted() == other.exhausted();
+    return position_ == other.position_;
+}
+
+bool Path::CellIterator::operator!=(const CellIterator& other) const {
+    return !(*this == other);
+}
+
+Path::Path() {}
+
+Path::Path(const vector<Cell>& waypoints) : waypoints_(waypoints) {}
+
+void Path::addWaypoint(const Cell& waypoint){
+    waypoints_.push_back(waypoint);
+}
+
+const vector<Cell>& Path::getWaypoints() const {
+    return waypoints_;
+}
+
+void Path::reverse(){
+    std::reverse(waypoints_.begin(), waypoints_.end());
+}
+
+void Path::clear(){
+    waypoints_.clear();
+}
+
+bool Path::empty() const {
+    return waypoints_.empty();
+}
+
+size_t Path::numCells() const {
+    if(waypoints_.empty())
+        return 0;
+    size_t cells = 1;
+    for(size_t i=1; i<waypoints_.size(); i++){
+        //each step moves at most one cell along both axes
+        cells += max(abs(waypoints_[i].x-waypoints_[i-1].x), abs(waypoints_[i].y-waypoints_[i-1].y));
+    }
+    return cells;
+}
+
+double Path::cost() const {
+    double total = 0;
+    for(size_t i=1; i<waypoints_.size(); i++){
+        int dx = abs(waypoints_[i].x-waypoints_[i-1].x);
+        int dy = abs(waypoints_[i].y-waypoints_[i-1].y);
+        total += min(dx,dy)*M_SQRT2 + abs(dx-dy);
+    }
+    return total;
+}
+
+Path::CellIterator Path::cellsBegin() const {
+    return CellIterator(&waypoints_, 0);
+}
+
+Path::CellIterator Path::cellsEnd() const {
+    return CellIterator(&waypoints_, CellIterator::END);
+}
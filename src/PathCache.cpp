@@ -0,0 +1,235 @@
+#include "navi_example/PathCache.h"
+#include "navi_example/Planner.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <boost/chrono.hpp>
+#include <boost/make_shared.hpp>
+
+using namespace std;
+
+namespace {
+/**
+ * @brief lists the tiles of count cells in a line, stepping from tile to tile rather than from cell to cell
+ */
+void addLineTiles(Cell cell, int sx, int sy, size_t count, vector<Cell>& tiles){
+    while(count){
+        tiles.push_back(MapSnapshot::tileOf(cell));
+        size_t steps = count;
+        if(sx > 0)
+            steps = min(steps, size_t(ObstacleTile::SIZE - (cell.x & (ObstacleTile::SIZE-1))));
+        else if(sx < 0)
+            steps = min(steps, size_t((cell.x & (ObstacleTile::SIZE-1)) + 1));
+        if(sy > 0)
+            steps = min(steps, size_t(ObstacleTile::SIZE - (cell.y & (ObstacleTile::SIZE-1))));
+        else if(sy < 0)
+            steps = min(steps, size_t((cell.y & (ObstacleTile::SIZE-1)) + 1));
+        cell = Cell(cell.x + int(steps)*sx, cell.y + int(steps)*sy);
+        count -= steps;
+    }
+}
+}
+
+PathCacheKey::PathCacheKey(const Cell& s, const Cell& g, size_t v) : start(s), goal(g), version(v) {}
+
+bool operator==(PathCacheKey const& k1, PathCacheKey const& k2){
+    return k1.start==k2.start && k1.goal==k2.goal && k1.version==k2.version;
+}
+
+size_t hash_value(PathCacheKey const& k){
+    size_t seed = hash_value(k.start);
+    boost::hash_combine(seed, hash_value(k.goal));
+    boost::hash_combine(seed, k.version);
+    return seed;
+}
+
+PathCacheStats::PathCacheStats() : hits(0), subpath_hits(0), misses(0), evictions(0), entries(0), bytes(0), seconds_saved(0) {}
+
+double PathCacheStats::hitRate() const {
+    size_t total = hits + subpath_hits + misses;
+    if(total == 0)
+        return 0;
+    return double(hits + subpath_hits)/total;
+}
+
+ostream& operator<<(ostream& os, const PathCacheStats& stats){
+    os << "hits=" << stats.hits
+       << " subpath_hits=" << stats.subpath_hits
+       << " misses=" << stats.misses
+       << " hit_rate=" << stats.hitRate()
+       << " evictions=" << stats.evictions
+       << " entries=" << stats.entries
+       << " bytes=" << stats.bytes
+       << " seconds_saved=" << stats.seconds_saved;
+    return os;
+}
+
+PathCache::PathCache(size_t max_bytes) : max_bytes_(max_bytes) {}
+
+bool PathCache::plan(Environment::Ptr env, const Cell& start, const Cell& goal, Path& path){
+    PathCacheKey key(start, goal, env->getVersion());
+    double seconds;
+    if(lookup(key, path, seconds))
+        return true;
+
+    boost::chrono::steady_clock::time_point begin = boost::chrono::steady_clock::now();
+    Graph::Ptr graph = boost::make_shared<Graph>(env, start, goal);
+    Planner planner(env, graph);
+    bool found = planner.plan(path);
+    boost::chrono::duration<double> elapsed = boost::chrono::steady_clock::now() - begin;
+
+    //the map may have been updated since the lookup; file under the version actually searched
+    key.version = graph->getSnapshot()->getVersion();
+    if(found)
+        insert(key, path, elapsed.count());
+    return found;
+}
+
+bool PathCache::lookup(const PathCacheKey& key, Path& path, double& seconds){
+    //exact match
+    EntryTable::iterator entry_it = entries_.find(key);
+    if(entry_it != entries_.end()){
+        //move to the front of the LRU list
+        lru_.splice(lru_.begin(), lru_, entry_it->second);
+        path = entry_it->second->path;
+        seconds = entry_it->second->seconds;
+        stats_.hits++;
+        stats_.seconds_saved += seconds;
+        return true;
+    }
+
+    //both ends on a cached path of the same version, which then crosses the start's tile
+    TileIndex::iterator tile_it = tiles_.find(MapSnapshot::tileOf(key.start));
+    for(size_t i=0; tile_it != tiles_.end() && i<tile_it->second.size(); i++){
+        LruList::iterator lru_it = tile_it->second[i];
+        if(lru_it->key.version != key.version)
+            continue;
+        size_t from, to;
+        if(!locate(*lru_it, key.start, from) || !locate(*lru_it, key.goal, to))
+            continue;
+
+        //the grid is undirected so a slice can be walked backwards
+        if(from <= to)
+            slice(*lru_it, from, to, path);
+        else{
+            slice(*lru_it, to, from, path);
+            path.reverse();
+        }
+
+        seconds = lru_it->seconds * path.numCells() / lru_it->offsets.back();
+        lru_.splice(lru_.begin(), lru_, lru_it);
+        stats_.subpath_hits++;
+        stats_.seconds_saved += seconds;
+        return true;
+    }
+
+    stats_.misses++;
+    return false;
+}
+
+bool PathCache::locate(const Entry& entry, const Cell& cell, size_t& position){
+    const vector<Cell>& waypoints = entry.path.getWaypoints();
+    if(waypoints.size() == 1 && waypoints[0] == cell){
+        position = 0;
+        return true;
+    }
+    for(size_t i=1; i<waypoints.size(); i++){
+        Direction dir = waypoints[i] - waypoints[i-1];
+        int steps = entry.offsets[i] - entry.offsets[i-1];
+        int rx = cell.x - waypoints[i-1].x;
+        int ry = cell.y - waypoints[i-1].y;
+        int k = max(abs(rx), abs(ry));
+        //on the segment if it is k straight steps along its direction
+        if(k <= steps && rx == k*dir.getX() && ry == k*dir.getY()){
+            position = entry.offsets[i-1] + k;
+            return true;
+        }
+    }
+    return false;
+}
+
+Cell PathCache::cellAt(const Entry& entry, size_t position){
+    const vector<Cell>& waypoints = entry.path.getWaypoints();
+    size_t i = upper_bound(entry.offsets.begin(), entry.offsets.end(), position) - entry.offsets.begin() - 1;
+    if(i+1 >= waypoints.size())
+        return waypoints.back();
+    Direction dir = waypoints[i+1] - waypoints[i];
+    int k = position - entry.offsets[i];
+    return Cell(waypoints[i].x + k*dir.getX(), waypoints[i].y + k*dir.getY());
+}
+
+void PathCache::slice(const Entry& entry, size_t from, size_t to, Path& slice){
+    const vector<Cell>& waypoints = entry.path.getWaypoints();
+    slice.clear();
+    slice.addWaypoint(cellAt(entry, from));
+    for(size_t i=0; i<waypoints.size(); i++){
+        if(entry.offsets[i] > from && entry.offsets[i] < to)
+            slice.addWaypoint(waypoints[i]);
+    }
+    if(to > from)
+        slice.addWaypoint(cellAt(entry, to));
+}
+
+void PathCache::insert(const PathCacheKey& key, const Path& path, double seconds){
+    if(entries_.count(key))
+        return;
+
+    lru_.push_front(Entry(key));
+    Entry& entry = lru_.front();
+    entry.path = path;
+    entry.seconds = seconds;
+    //cell offset of each waypoint, ending with the number of cells
+    const vector<Cell>& waypoints = path.getWaypoints();
+    for(size_t i=0; i<waypoints.size(); i++){
+        if(i == 0)
+            entry.offsets.push_back(0);
+        else
+            entry.offsets.push_back(entry.offsets.back() + max(abs(waypoints[i].x-waypoints[i-1].x), abs(waypoints[i].y-waypoints[i-1].y)));
+    }
+    entry.offsets.push_back(entry.offsets.back()+1);
+    //tiles covered by the cells of the path
+    vector<Cell> tiles;
+    for(size_t i=0; i<waypoints.size(); i++){
+        //the last waypoint is a single step, the offsets ending one past it
+        Direction dir = i+1 < waypoints.size() ? waypoints[i+1] - waypoints[i] : Direction();
+        addLineTiles(waypoints[i], int(dir.getX()), int(dir.getY()), entry.offsets[i+1] - entry.offsets[i], tiles);
+    }
+    //a path may cross a tile more than once; the index lists the entry once per tile
+    for(size_t i=0; i<tiles.size(); i++){
+        vector<LruList::iterator>& crossing = tiles_[tiles[i]];
+        if(crossing.empty() || crossing.back() != lru_.begin()){
+            crossing.push_back(lru_.begin());
+            entry.tiles.push_back(tiles[i]);
+        }
+    }
+    entry.bytes = sizeof(Entry) + waypoints.capacity()*sizeof(Cell) + entry.offsets.capacity()*sizeof(size_t) +
+                  entry.tiles.size()*(sizeof(Cell) + sizeof(LruList::iterator));
+
+    entries_[key] = lru_.begin();
+    stats_.bytes += entry.bytes;
+    stats_.entries++;
+    evict();
+}
+
+void PathCache::evict(){
+    //always keep the newest entry, even if it alone is over the cap
+    while(stats_.bytes > max_bytes_ && lru_.size() > 1){
+        Entry& oldest = lru_.back();
+        stats_.bytes -= oldest.bytes;
+        stats_.entries--;
+        stats_.evictions++;
+        entries_.erase(oldest.key);
+        for(size_t i=0; i<oldest.tiles.size(); i++){
+            vector<LruList::iterator>& crossing = tiles_[oldest.tiles[i]];
+            crossing.erase(find(crossing.begin(), crossing.end(), --lru_.end()));
+            if(crossing.empty())
+                tiles_.erase(oldest.tiles[i]);
+        }
+        lru_.pop_back();
+    }
+}
+
+PathCacheStats PathCache::getStats() const {
+    return stats_;
+}
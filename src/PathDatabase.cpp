@@ -0,0 +1,358 @@
+#include "navi_example/PathDatabase.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+using namespace std;
+
+namespace {
+const char DATABASE_MAGIC[4] = {'N','A','V','C'};
+const boost::uint32_t DATABASE_FORMAT = 1;
+/**
+ * @brief unit steps by move code, counter clockwise from east
+ */
+const int MOVE_X[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+const int MOVE_Y[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+/**
+ * @brief step costs scaled to integers, fine enough that two paths only tie when their lengths are equal
+ */
+const boost::int64_t STRAIGHT_COST = 100000000;
+const boost::int64_t DIAGONAL_COST = 141421356;
+const boost::int64_t UNREACHED = -1;
+/**
+ * @brief any move, for targets whose move is never asked for
+ */
+const unsigned char ANY_MOVE = 0xff;
+
+/**
+ * @brief position of a cell along the Hilbert curve filling a square of side n, a power of two
+ */
+boost::uint64_t hilbertIndex(boost::uint32_t n, boost::uint32_t x, boost::uint32_t y){
+    boost::uint64_t d = 0;
+    for(boost::uint32_t s = n/2; s > 0; s /= 2){
+        boost::uint32_t rx = (x & s) > 0;
+        boost::uint32_t ry = (y & s) > 0;
+        d += boost::uint64_t(s)*s*((3*rx) ^ ry);
+        //turn the quadrant so the curve inside it starts and ends at the right corners
+        if(ry == 0){
+            if(rx == 1){
+                x = n-1 - x;
+                y = n-1 - y;
+            }
+            swap(x, y);
+        }
+    }
+    return d;
+}
+
+/**
+ * @brief orders cells by their position along the curve, which is unique
+ */
+bool curveLess(const pair<boost::uint64_t, Cell>& lhs, const pair<boost::uint64_t, Cell>& rhs){
+    return lhs.first < rhs.first;
+}
+}
+
+PathDatabase::PathDatabase() : min_cell_(0,0), max_cell_(-1,-1), offsets_(1, 0), layout_hash_(0) {}
+
+boost::uint64_t PathDatabase::numberCells(const MapSnapshot& snapshot, const Cell& min_cell, const Cell& max_cell){
+    min_cell_ = min_cell;
+    max_cell_ = max_cell;
+    int width = max_cell.x - min_cell.x + 1, height = max_cell.y - min_cell.y + 1;
+    boost::uint32_t side = 1;
+    while(side < boost::uint32_t(max(width, height)))
+        side *= 2;
+    vector<pair<boost::uint64_t, Cell> > order;
+    for(int y=0; y<height; y++){
+        for(int x=0; x<width; x++){
+            Cell cell(min_cell.x+x, min_cell.y+y);
+            if(snapshot.isCollisionFree(cell))
+                order.push_back(make_pair(hilbertIndex(side, x, y), cell));
+        }
+    }
+    sort(order.begin(), order.end(), curveLess);
+
+    ids_.assign(size_t(width)*height, -1);
+    cells_.resize(order.size());
+    boost::uint64_t hash = 14695981039346656037ULL;
+    for(size_t i=0; i<order.size(); i++){
+        cells_[i] = order[i].second;
+        ids_[size_t(cells_[i].y-min_cell.y)*width + (cells_[i].x-min_cell.x)] = boost::int32_t(i);
+        hash = (hash ^ order[i].first) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool PathDatabase::build(Environment::Ptr env, const Cell& min_cell, const Cell& max_cell, int threads){
+    layout_hash_ = numberCells(*env->getSnapshot(), min_cell, max_cell);
+    size_t num_cells = cells_.size();
+    if(num_cells >= (size_t(1) << 29)){
+        printf("Too many cells (%zu) for a path database\n", num_cells);
+        return false;
+    }
+
+    //label the components, so queries between them are answered without following moves
+    components_.assign(num_cells, boost::uint32_t(-1));
+    boost::uint32_t num_components = 0;
+    vector<boost::int32_t> stack;
+    for(size_t seed=0; seed<num_cells; seed++){
+        if(components_[seed] != boost::uint32_t(-1))
+            continue;
+        components_[seed] = num_components;
+        stack.push_back(boost::int32_t(seed));
+        while(!stack.empty()){
+            Cell cell = cells_[stack.back()];
+            stack.pop_back();
+            for(int move=0; move<8; move++){
+                boost::int32_t neighbour = idOf(Cell(cell.x+MOVE_X[move], cell.y+MOVE_Y[move]));
+                if(neighbour >= 0 && components_[neighbour] == boost::uint32_t(-1)){
+                    components_[neighbour] = num_components;
+                    stack.push_back(neighbour);
+                }
+            }
+        }
+        num_components++;
+    }
+
+    vector<boost::int32_t> neighbours(8*num_cells);
+    for(size_t i=0; i<num_cells; i++){
+        for(int move=0; move<8; move++)
+            neighbours[8*i + move] = idOf(Cell(cells_[i].x+MOVE_X[move], cells_[i].y+MOVE_Y[move]));
+    }
+
+    //cells are dealt out in turn, so every thread gets a share of each part of the map
+    threads = max(1, threads);
+    vector<vector<boost::uint32_t> > runs(num_cells);
+    boost::thread_group workers;
+    for(int i=0; i<threads; i++)
+        workers.create_thread(boost::bind(&PathDatabase::buildSources, this, i, threads, &neighbours, &runs));
+    workers.join_all();
+
+    offsets_.assign(num_cells+1, 0);
+    for(size_t i=0; i<num_cells; i++)
+        offsets_[i+1] = offsets_[i] + runs[i].size();
+    runs_.clear();
+    runs_.reserve(offsets_.back());
+    for(size_t i=0; i<num_cells; i++){
+        runs_.insert(runs_.end(), runs[i].begin(), runs[i].end());
+        vector<boost::uint32_t>().swap(runs[i]);
+    }
+    return true;
+}
+
+void PathDatabase::buildSources(int first, int step, const vector<boost::int32_t>* neighbours, vector<vector<boost::uint32_t> >* runs) const {
+    size_t num_cells = cells_.size();
+    vector<boost::int64_t> distance_storage(num_cells);
+    vector<unsigned char> move_storage(num_cells);
+    //binary heap of cell numbers by distance, with the heap position of every cell for decreasing keys
+    vector<boost::int32_t> heap_storage(num_cells), position_storage(num_cells);
+    boost::int64_t* distances = &distance_storage[0];
+    unsigned char* moves = &move_storage[0];
+    boost::int32_t* heap = &heap_storage[0];
+    boost::int32_t* positions = &position_storage[0];
+    const boost::int32_t* adjacent = &(*neighbours)[0];
+    for(size_t source=first; source<num_cells; source+=step){
+        fill(distance_storage.begin(), distance_storage.end(), UNREACHED);
+        fill(move_storage.begin(), move_storage.end(), 0);
+        size_t size = 0;
+        distances[source] = 0;
+        heap[size++] = boost::int32_t(source);
+        positions[source] = 0;
+        while(size > 0){
+            boost::int32_t cell = heap[0];
+            boost::int32_t last = heap[--size];
+            //sift the last entry down from the root
+            size_t hole = 0;
+            while(true){
+                size_t child = 2*hole+1;
+                if(child >= size)
+                    break;
+                if(child+1 < size && distances[heap[child+1]] < distances[heap[child]])
+                    child++;
+                if(distances[heap[child]] >= distances[last])
+                    break;
+                heap[hole] = heap[child];
+                positions[heap[hole]] = boost::int32_t(hole);
+                hole = child;
+            }
+            heap[hole] = last;
+            positions[last] = boost::int32_t(hole);
+            positions[cell] = -1;
+
+            boost::int64_t base = distances[cell];
+            //a target inherits every first move of its predecessors on shortest paths
+            unsigned char inherited = moves[cell];
+            for(int move=0; move<8; move++){
+                boost::int32_t neighbour = adjacent[8*size_t(cell) + move];
+                if(neighbour < 0)
+                    continue;
+                boost::int64_t distance = base + ((move & 1) ? DIAGONAL_COST : STRAIGHT_COST);
+                unsigned char first_moves = (size_t(cell) == source) ? (1 << move) : inherited;
+                boost::int64_t known = distances[neighbour];
+                if(known == distance){
+                    moves[neighbour] |= first_moves;
+                    continue;
+                }
+                if(known != UNREACHED && known < distance)
+                    continue;
+                distances[neighbour] = distance;
+                moves[neighbour] = first_moves;
+                //sift up from its place, or from a new leaf
+                size_t up = (known == UNREACHED) ? size++ : size_t(positions[neighbour]);
+                while(up > 0 && distances[heap[(up-1)/2]] > distance){
+                    heap[up] = heap[(up-1)/2];
+                    positions[heap[up]] = boost::int32_t(up);
+                    up = (up-1)/2;
+                }
+                heap[up] = neighbour;
+                positions[neighbour] = boost::int32_t(up);
+            }
+        }
+
+        //extend each run while some move stays optimal for all of its targets
+        vector<boost::uint32_t>& source_runs = (*runs)[source];
+        unsigned char common = ANY_MOVE;
+        boost::uint32_t run_start = 0;
+        for(size_t target=0; target<num_cells; target++){
+            unsigned char allowed = (target == source || distances[target] == UNREACHED) ? ANY_MOVE : moves[target];
+            if(common & allowed){
+                common &= allowed;
+                continue;
+            }
+            source_runs.push_back((run_start << 3) | __builtin_ctz(common));
+            run_start = boost::uint32_t(target);
+            common = allowed;
+        }
+        source_runs.push_back((run_start << 3) | __builtin_ctz(common));
+        vector<boost::uint32_t>(source_runs).swap(source_runs);
+    }
+}
+
+bool PathDatabase::write(const string& path) const {
+    PathDatabaseHeader header;
+    memcpy(header.magic, DATABASE_MAGIC, 4);
+    header.format = DATABASE_FORMAT;
+    header.min_x = min_cell_.x;
+    header.min_y = min_cell_.y;
+    header.max_x = max_cell_.x;
+    header.max_y = max_cell_.y;
+    header.num_cells = cells_.size();
+    header.num_runs = runs_.size();
+    header.layout_hash = layout_hash_;
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if(!file){
+        printf("File \"%s\" could not be opened for writing!\n", path.c_str());
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    if(ok && !components_.empty())
+        ok = fwrite(&components_[0], sizeof(components_[0]), components_.size(), file) == components_.size();
+    if(ok)
+        ok = fwrite(&offsets_[0], sizeof(offsets_[0]), offsets_.size(), file) == offsets_.size();
+    if(ok && !runs_.empty())
+        ok = fwrite(&runs_[0], sizeof(runs_[0]), runs_.size(), file) == runs_.size();
+    ok = (fclose(file) == 0) && ok;
+    if(!ok)
+        printf("Failed writing path database \"%s\"\n", path.c_str());
+    return ok;
+}
+
+bool PathDatabase::read(const string& path, Environment::Ptr env){
+    FILE* file = fopen(path.c_str(), "rb");
+    if(!file){
+        printf("File \"%s\" does not exist to be read!\n", path.c_str());
+        return false;
+    }
+    PathDatabaseHeader header;
+    if(fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, DATABASE_MAGIC, 4) != 0 ||
+            header.format != DATABASE_FORMAT){
+        printf("File \"%s\" is not a path database of this version\n", path.c_str());
+        fclose(file);
+        return false;
+    }
+    //the numbering is a pure function of the free cells, so it is made again rather than stored
+    layout_hash_ = numberCells(*env->getSnapshot(), Cell(header.min_x, header.min_y), Cell(header.max_x, header.max_y));
+    if(cells_.size() != header.num_cells || layout_hash_ != header.layout_hash){
+        printf("Path database \"%s\" was built on another map\n", path.c_str());
+        fclose(file);
+        return false;
+    }
+    components_.resize(header.num_cells);
+    offsets_.resize(header.num_cells+1);
+    runs_.resize(header.num_runs);
+    bool ok = (components_.empty() || fread(&components_[0], sizeof(components_[0]), components_.size(), file) == components_.size()) &&
+              fread(&offsets_[0], sizeof(offsets_[0]), offsets_.size(), file) == offsets_.size() &&
+              (runs_.empty() || fread(&runs_[0], sizeof(runs_[0]), runs_.size(), file) == runs_.size());
+    fclose(file);
+    if(!ok)
+        printf("Path database \"%s\" is truncated\n", path.c_str());
+    return ok;
+}
+
+int PathDatabase::lookup(boost::int32_t source, boost::int32_t target) const {
+    const boost::uint32_t* begin = &runs_[0] + offsets_[source];
+    const boost::uint32_t* end = &runs_[0] + offsets_[source+1];
+    //the last run starting at or before the target
+    const boost::uint32_t* run = upper_bound(begin, end, (boost::uint32_t(target) << 3) | 7) - 1;
+    return *run & 7;
+}
+
+bool PathDatabase::getFirstMove(const Cell& from, const Cell& to, Direction& move) const {
+    boost::int32_t source = idOf(from), target = idOf(to);
+    if(source < 0 || target < 0 || components_[source] != components_[target])
+        return false;
+    int code = lookup(source, target);
+    move = Direction(MOVE_X[code], MOVE_Y[code]);
+    return true;
+}
+
+bool PathDatabase::plan(const Cell& start, const Cell& goal, Path& path) const {
+    path.clear();
+    boost::int32_t current = idOf(start), target = idOf(goal);
+    if(current < 0 || target < 0 || components_[current] != components_[target])
+        return false;
+    path.addWaypoint(start);
+    int last_move = -1;
+    Cell cell = start;
+    while(current != target){
+        int move = lookup(current, target);
+        //a jump point wherever the move changes
+        if(move != last_move && last_move >= 0)
+            path.addWaypoint(cell);
+        last_move = move;
+        cell = Cell(cell.x+MOVE_X[move], cell.y+MOVE_Y[move]);
+        current = idOf(cell);
+    }
+    if(!(cell == start))
+        path.addWaypoint(goal);
+    return true;
+}
+
+size_t PathDatabase::getNumCells() const {
+    return cells_.size();
+}
+
+Cell PathDatabase::getCell(size_t id) const {
+    return cells_[id];
+}
+
+Cell PathDatabase::getMinCell() const {
+    return min_cell_;
+}
+
+Cell PathDatabase::getMaxCell() const {
+    return max_cell_;
+}
+
+size_t PathDatabase::getNumRuns() const {
+    return runs_.size();
+}
+
+size_t PathDatabase::getBytes() const {
+    return components_.size()*sizeof(components_[0]) + offsets_.size()*sizeof(offsets_[0]) + runs_.size()*sizeof(runs_[0]);
+}
@@ -0,0 +1,273 @@
+#include "navi_example/PathIndex.h"
+#include "navi_example/Graph.h"
+#include "navi_example/Planner.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include <boost/make_shared.hpp>
+#include <boost/unordered_set.hpp>
+
+using namespace std;
+
+PathIndexStats::PathIndexStats() : paths(0), postings(0), segment_checks(0), invalidated(0), local_repairs(0), full_replans(0), unreachable(0) {}
+
+ostream& operator<<(ostream& os, const PathIndexStats& stats){
+    os << "paths=" << stats.paths
+       << " postings=" << stats.postings
+       << " segment_checks=" << stats.segment_checks
+       << " invalidated=" << stats.invalidated
+       << " local_repairs=" << stats.local_repairs
+       << " full_replans=" << stats.full_replans
+       << " unreachable=" << stats.unreachable;
+    return os;
+}
+
+/**
+ * @brief gets the cell at a position along a path
+ * @param waypoints the waypoints of the path
+ * @param offsets the position of each waypoint along the path
+ * @param position index of the cell along the path
+ */
+static Cell cellAt(const vector<Cell>& waypoints, const vector<size_t>& offsets, size_t position){
+    size_t i = upper_bound(offsets.begin(), offsets.end(), position) - offsets.begin() - 1;
+    if(i+1 == waypoints.size())
+        return waypoints[i];
+    const Cell& from = waypoints[i];
+    const Cell& to = waypoints[i+1];
+    int steps = int(position - offsets[i]);
+    return Cell(from.x + steps*((to.x > from.x) - (to.x < from.x)), from.y + steps*((to.y > from.y) - (to.y < from.y)));
+}
+
+PathIndex::PathIndex() : next_id_(0), radius_(0), repair_margin_(32) {}
+
+void PathIndex::setRadius(int radius){
+    radius_ = radius;
+}
+
+void PathIndex::setRepairMargin(int cells){
+    repair_margin_ = max(1, cells);
+}
+
+PathIndex::PathId PathIndex::add(const Path& path){
+    PathId id = next_id_++;
+    Entry& entry = entries_[id];
+    entry.path = path;
+    post(id, entry);
+    stats_.paths++;
+    return id;
+}
+
+bool PathIndex::remove(PathId id){
+    EntryTable::iterator entry_it = entries_.find(id);
+    if(entry_it == entries_.end())
+        return false;
+    unpost(id, entry_it->second);
+    entries_.erase(entry_it);
+    stats_.paths--;
+    return true;
+}
+
+const Path* PathIndex::find(PathId id) const {
+    EntryTable::const_iterator entry_it = entries_.find(id);
+    return entry_it == entries_.end() ? NULL : &entry_it->second.path;
+}
+
+void PathIndex::post(PathId id, Entry& entry){
+    const vector<Cell>& waypoints = entry.path.getWaypoints();
+    entry.tiles.clear();
+    //a single cell path still has the one segment from its cell to itself
+    for(size_t segment=0; segment == 0 || segment+1 < waypoints.size(); segment++){
+        if(waypoints.empty())
+            break;
+        const Cell& from = waypoints[segment];
+        const Cell& to = waypoints[min(segment+1, waypoints.size()-1)];
+        int sx = (to.x > from.x) - (to.x < from.x);
+        int sy = (to.y > from.y) - (to.y < from.y);
+        int left = max(abs(to.x-from.x), abs(to.y-from.y));
+        Cell cell = from;
+        //step from tile to tile rather than from cell to cell
+        while(true){
+            Cell tile = MapSnapshot::tileOf(cell);
+            postings_[tile].push_back(Posting(id, segment));
+            stats_.postings++;
+            if(entry.tiles.empty() || !(entry.tiles.back() == tile))
+                entry.tiles.push_back(tile);
+            int steps = left+1;
+            if(sx > 0)
+                steps = min(steps, ObstacleTile::SIZE - (cell.x & (ObstacleTile::SIZE-1)));
+            else if(sx < 0)
+                steps = min(steps, (cell.x & (ObstacleTile::SIZE-1)) + 1);
+            if(sy > 0)
+                steps = min(steps, ObstacleTile::SIZE - (cell.y & (ObstacleTile::SIZE-1)));
+            else if(sy < 0)
+                steps = min(steps, (cell.y & (ObstacleTile::SIZE-1)) + 1);
+            if(steps > left)
+                break;
+            cell = Cell(cell.x + steps*sx, cell.y + steps*sy);
+            left -= steps;
+        }
+    }
+}
+
+void PathIndex::unpost(PathId id, Entry& entry){
+    for(size_t i=0; i<entry.tiles.size(); i++){
+        PostingTable::iterator tile_it = postings_.find(entry.tiles[i]);
+        if(tile_it == postings_.end())
+            continue;
+        vector<Posting>& postings = tile_it->second;
+        size_t kept = 0;
+        for(size_t j=0; j<postings.size(); j++){
+            if(postings[j].id != id)
+                postings[kept++] = postings[j];
+        }
+        stats_.postings -= postings.size() - kept;
+        postings.erase(postings.begin()+kept, postings.end());
+        if(postings.empty())
+            postings_.erase(tile_it);
+    }
+    entry.tiles.clear();
+}
+
+bool PathIndex::segmentTouches(const Cell& from, const Cell& to, const Cell& cell, int radius){
+    if(cell.x + radius < min(from.x, to.x) || cell.x - radius > max(from.x, to.x) ||
+       cell.y + radius < min(from.y, to.y) || cell.y - radius > max(from.y, to.y))
+        return false;
+    int sx = (to.x > from.x) - (to.x < from.x);
+    int sy = (to.y > from.y) - (to.y < from.y);
+    boost::int64_t steps = max(abs(to.x-from.x), abs(to.y-from.y));
+    boost::int64_t ex = cell.x - from.x, ey = cell.y - from.y;
+    //the squared distance is a parabola in the step count, so the nearest
+    //cell of the segment is one of the two around its minimum
+    boost::int64_t along = ex*sx + ey*sy, norm = sx*sx + sy*sy;
+    boost::int64_t nearest = (along <= 0 || norm == 0) ? 0 : along/norm;
+    for(boost::int64_t k=nearest; k<=nearest+1; k++){
+        boost::int64_t clamped = min(k, steps);
+        boost::int64_t dx = ex - clamped*sx, dy = ey - clamped*sy;
+        if(dx*dx + dy*dy <= boost::int64_t(radius)*radius)
+            return true;
+    }
+    return false;
+}
+
+void PathIndex::findInvalid(const vector<Cell>& added, vector<PathId>& invalid){
+    boost::unordered_set<PathId> found;
+    for(size_t i=0; i<added.size(); i++){
+        const Cell& cell = added[i];
+        //only tiles within the radius of the cell can hold a segment it blocks
+        Cell low = MapSnapshot::tileOf(Cell(cell.x-radius_, cell.y-radius_));
+        Cell high = MapSnapshot::tileOf(Cell(cell.x+radius_, cell.y+radius_));
+        for(int ty=low.y; ty<=high.y; ty++){
+            for(int tx=low.x; tx<=high.x; tx++){
+                PostingTable::const_iterator tile_it = postings_.find(Cell(tx, ty));
+                if(tile_it == postings_.end())
+                    continue;
+                const vector<Posting>& postings = tile_it->second;
+                for(size_t j=0; j<postings.size(); j++){
+                    if(found.count(postings[j].id))
+                        continue;
+                    const vector<Cell>& waypoints = entries_.find(postings[j].id)->second.path.getWaypoints();
+                    size_t segment = postings[j].segment;
+                    stats_.segment_checks++;
+                    if(segmentTouches(waypoints[segment], waypoints[min(segment+1, waypoints.size()-1)], cell, radius_))
+                        found.insert(postings[j].id);
+                }
+            }
+        }
+    }
+    invalid.assign(found.begin(), found.end());
+    sort(invalid.begin(), invalid.end());
+    stats_.invalidated += invalid.size();
+}
+
+bool PathIndex::planStretch(Environment::Ptr env, const Cell& from, const Cell& to, const Cell& min_cell, const Cell& max_cell, int margin, Path& path) const {
+    Graph::Ptr graph = boost::make_shared<Graph>(env, from, to);
+    if(!graph->setRadius(radius_))
+        return false;
+    if(margin > 0)
+        graph->setBounds(Cell(min_cell.x-margin, min_cell.y-margin), Cell(max_cell.x+margin, max_cell.y+margin));
+    Planner planner(env, graph);
+    planner.setVerbose(false);
+    path.clear();
+    return planner.plan(path);
+}
+
+bool PathIndex::repair(PathId id, Environment::Ptr env){
+    EntryTable::iterator entry_it = entries_.find(id);
+    if(entry_it == entries_.end())
+        return false;
+    Entry& entry = entry_it->second;
+    const vector<Cell>& waypoints = entry.path.getWaypoints();
+    if(waypoints.empty())
+        return false;
+    MapSnapshot::ConstPtr snapshot = env->getSnapshot();
+    const TileTable* layer = snapshot->getLayer(radius_);
+    if(!layer){
+        printf("No inflated obstacles for radius %d to repair paths with\n", radius_);
+        return false;
+    }
+
+    //find the stretch of the path that runs through obstacles now
+    vector<size_t> offsets(waypoints.size(), 0);
+    for(size_t i=1; i<waypoints.size(); i++)
+        offsets[i] = offsets[i-1] + max(abs(waypoints[i].x-waypoints[i-1].x), abs(waypoints[i].y-waypoints[i-1].y));
+    size_t num_cells = offsets.back() + 1;
+    size_t first = num_cells, last = 0, position = 0;
+    Path::CellIterator cells_end = entry.path.cellsEnd();
+    for(Path::CellIterator cell_it = entry.path.cellsBegin(); cell_it != cells_end; ++cell_it, position++){
+        bool free = radius_ ? MapSnapshot::isFree(*layer, *cell_it) : snapshot->isCollisionFree(*cell_it);
+        if(!free){
+            first = min(first, position);
+            last = position;
+        }
+    }
+    if(first == num_cells)
+        return true;
+    if(first == 0 || last == num_cells-1){
+        stats_.unreachable++;
+        return false;
+    }
+
+    size_t from = first > size_t(repair_margin_) ? first - repair_margin_ : 0;
+    size_t to = min(num_cells-1, last + repair_margin_);
+    Cell from_cell = cellAt(waypoints, offsets, from), to_cell = cellAt(waypoints, offsets, to);
+    Cell min_cell(min(from_cell.x, to_cell.x), min(from_cell.y, to_cell.y));
+    Cell max_cell(max(from_cell.x, to_cell.x), max(from_cell.y, to_cell.y));
+    for(size_t i=0; i<waypoints.size(); i++){
+        if(offsets[i] > from && offsets[i] < to){
+            min_cell = Cell(min(min_cell.x, waypoints[i].x), min(min_cell.y, waypoints[i].y));
+            max_cell = Cell(max(max_cell.x, waypoints[i].x), max(max_cell.y, waypoints[i].y));
+        }
+    }
+
+    Path stretch, repaired;
+    bool found = planStretch(env, from_cell, to_cell, min_cell, max_cell, repair_margin_, stretch) ||
+                 planStretch(env, from_cell, to_cell, min_cell, max_cell, 4*repair_margin_, stretch);
+    if(found){
+        for(size_t i=0; i<waypoints.size() && offsets[i] < from; i++)
+            repaired.addWaypoint(waypoints[i]);
+        for(size_t i=0; i<stretch.getWaypoints().size(); i++)
+            repaired.addWaypoint(stretch.getWaypoints()[i]);
+        for(size_t i=0; i<waypoints.size(); i++){
+            if(offsets[i] > to)
+                repaired.addWaypoint(waypoints[i]);
+        }
+        stats_.local_repairs++;
+    }
+    else if(planStretch(env, waypoints.front(), waypoints.back(), min_cell, max_cell, 0, repaired)){
+        stats_.full_replans++;
+    }
+    else{
+        stats_.unreachable++;
+        return false;
+    }
+    unpost(id, entry);
+    entry.path = repaired;
+    post(id, entry);
+    return true;
+}
+
+PathIndexStats PathIndex::getStats() const {
+    return stats_;
+}
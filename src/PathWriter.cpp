@@ -0,0 +1,200 @@
+#include "navi_example/PathWriter.h"
+
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+const char PATH_MAGIC[4] = {'N','A','V','P'};
+const char PATH_FORMAT = 1;
+const int DIRECTION_X[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+const int DIRECTION_Y[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+
+int sign(int value){
+    return (value > 0) - (value < 0);
+}
+
+int directionOf(int dx, int dy){
+    for(int direction=0; direction<8; direction++){
+        if(DIRECTION_X[direction] == dx && DIRECTION_Y[direction] == dy)
+            return direction;
+    }
+    return -1;
+}
+
+boost::uint64_t zigzag(boost::int64_t value){
+    return (boost::uint64_t(value) << 1) ^ boost::uint64_t(value >> 63);
+}
+
+boost::int64_t unzigzag(boost::uint64_t value){
+    return boost::int64_t(value >> 1) ^ -boost::int64_t(value & 1);
+}
+
+bool readVarint(FILE* file, boost::uint64_t& value){
+    value = 0;
+    for(int shift=0; shift<64; shift+=7){
+        int byte = getc(file);
+        if(byte == EOF)
+            return false;
+        value |= boost::uint64_t(byte & 0x7f) << shift;
+        if(!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+}
+
+PathWriter::PathWriter( const string& filename, Format format ) :
+    file_(fopen(filename.c_str(), format == BINARY ? "wb" : "w")), format_(format),
+    buffer_(1 << 16), used_(0), ok_(file_ != NULL), has_last_(false), run_direction_(-1), run_steps_(0) {}
+
+PathWriter::~PathWriter(){
+    close();
+}
+
+bool PathWriter::isOpen() const {
+    return file_ != NULL;
+}
+
+void PathWriter::addWaypoint( const Cell& waypoint ){
+    if(!file_)
+        return;
+    if(!has_last_){
+        has_last_ = true;
+        last_ = waypoint;
+        if(format_ == BINARY){
+            for(int i=0; i<4; i++)
+                putByte(PATH_MAGIC[i]);
+            putByte(PATH_FORMAT);
+            putVarint(zigzag(waypoint.x));
+            putVarint(zigzag(waypoint.y));
+        }
+        else{
+            putCell(waypoint);
+        }
+        return;
+    }
+
+    if(format_ == TEXT_WAYPOINTS){
+        putCell(waypoint);
+    }
+    else{
+        //diagonal steps until the waypoint is in line, then straight ones, as Path::CellIterator walks
+        int dx = waypoint.x - last_.x, dy = waypoint.y - last_.y;
+        int diagonal = min(abs(dx), abs(dy));
+        int straight = max(abs(dx), abs(dy)) - diagonal;
+        if(format_ == BINARY){
+            if(diagonal)
+                addSteps(directionOf(sign(dx), sign(dy)), diagonal);
+            if(straight)
+                addSteps(abs(dx) > abs(dy) ? directionOf(sign(dx), 0) : directionOf(0, sign(dy)), straight);
+        }
+        else{
+            Cell cell = last_;
+            for(int i=0; i<diagonal; i++){
+                cell = Cell(cell.x + sign(dx), cell.y + sign(dy));
+                putCell(cell);
+            }
+            for(int i=0; i<straight; i++){
+                cell = abs(dx) > abs(dy) ? Cell(cell.x + sign(dx), cell.y) : Cell(cell.x, cell.y + sign(dy));
+                putCell(cell);
+            }
+        }
+    }
+    last_ = waypoint;
+}
+
+void PathWriter::write( const Path& path ){
+    const vector<Cell>& waypoints = path.getWaypoints();
+    for(size_t i=0; i<waypoints.size(); i++)
+        addWaypoint(waypoints[i]);
+}
+
+bool PathWriter::close(){
+    if(!file_)
+        return false;
+    if(format_ == BINARY && has_last_){
+        endRun();
+        putVarint(0);
+    }
+    flush();
+    ok_ = (fclose(file_) == 0) && ok_;
+    file_ = NULL;
+    return ok_;
+}
+
+bool PathWriter::readBinary( const string& filename, Path& path ){
+    FILE* file = fopen(filename.c_str(), "rb");
+    if(!file)
+        return false;
+    char magic[5];
+    bool ok = fread(magic, 1, 5, file) == 5 && memcmp(magic, PATH_MAGIC, 4) == 0 && magic[4] == PATH_FORMAT;
+    boost::uint64_t x, y, run;
+    ok = ok && readVarint(file, x) && readVarint(file, y);
+    path.clear();
+    if(ok){
+        Cell cell(unzigzag(x), unzigzag(y));
+        path.addWaypoint(cell);
+        while((ok = readVarint(file, run)) && run){
+            int direction = run & 7;
+            boost::int64_t steps = run >> 3;
+            cell = Cell(cell.x + DIRECTION_X[direction]*steps, cell.y + DIRECTION_Y[direction]*steps);
+            path.addWaypoint(cell);
+        }
+    }
+    fclose(file);
+    return ok;
+}
+
+void PathWriter::addSteps( int direction, boost::uint64_t steps ){
+    if(direction != run_direction_){
+        endRun();
+        run_direction_ = direction;
+    }
+    run_steps_ += steps;
+}
+
+void PathWriter::endRun(){
+    if(run_direction_ >= 0 && run_steps_)
+        putVarint(run_steps_*8 + run_direction_);
+    run_direction_ = -1;
+    run_steps_ = 0;
+}
+
+void PathWriter::putVarint( boost::uint64_t value ){
+    while(value >= 0x80){
+        putByte(char(value | 0x80));
+        value >>= 7;
+    }
+    putByte(char(value));
+}
+
+void PathWriter::putNumber( int value ){
+    char digits[12];
+    int count = 0;
+    unsigned int magnitude = value < 0 ? -(unsigned int)value : value;
+    do{
+        digits[count++] = '0' + magnitude%10;
+        magnitude /= 10;
+    } while(magnitude);
+    if(value < 0)
+        putByte('-');
+    while(count)
+        putByte(digits[--count]);
+}
+
+void PathWriter::putCell( const Cell& cell ){
+    //same as operator<<(ostream&, const Cell&) followed by a newline
+    putNumber(cell.x);
+    putByte(',');
+    putByte(' ');
+    putNumber(cell.y);
+    putByte('\n');
+}
+
+void PathWriter::flush(){
+    if(used_ && fwrite(&buffer_[0], 1, used_, file_) != used_)
+        ok_ = false;
+    used_ = 0;
+}
@@ -0,0 +1,287 @@
+#include "navi_example/PlanServer.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <boost/bind.hpp>
+#include <boost/chrono.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include "navi_example/Graph.h"
+#include "navi_example/JsonLines.h"
+#include "navi_example/Planner.h"
+
+using namespace std;
+
+PlanServer::Connection::~Connection(){
+    if(owned)
+        close(in_fd);
+}
+
+PlanServer::PlanServer( int threads, size_t cache_bytes ) : threads_(max(1, threads)), cache_bytes_(cache_bytes), closed_(true) {}
+
+PlanServer::~PlanServer(){
+    stopWorkers();
+}
+
+void PlanServer::addMap( const string& name, Environment::Ptr env ){
+    ServedMap map;
+    map.env = env;
+    map.cache = boost::make_shared<PathCache>(cache_bytes_);
+    map.cache_mutex = boost::make_shared<boost::mutex>();
+    maps_[name] = map;
+}
+
+void PlanServer::serveStream( int in_fd, int out_fd ){
+    startWorkers();
+    readQueries(boost::make_shared<Connection>(in_fd, out_fd, false));
+    stopWorkers();
+}
+
+bool PlanServer::serveSocket( const string& path ){
+    //a client hanging up early must not take the server down
+    signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(address.sun_path)){
+        printf("Socket path \"%s\" is too long\n", path.c_str());
+        return false;
+    }
+    strcpy(address.sun_path, path.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if(listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 64) != 0){
+        printf("Could not listen on \"%s\": %s\n", path.c_str(), strerror(errno));
+        if(listener >= 0)
+            close(listener);
+        return false;
+    }
+    printf("Serving %zu map%s on %s with %d threads\n", maps_.size(), maps_.size() == 1 ? "" : "s", path.c_str(), threads_);
+    fflush(stdout);
+
+    startWorkers();
+    while(true){
+        int client = accept(listener, NULL, NULL);
+        if(client < 0){
+            if(errno == EINTR || errno == ECONNABORTED)
+                continue;
+            printf("Accepting on \"%s\" failed: %s\n", path.c_str(), strerror(errno));
+            break;
+        }
+        boost::thread reader(boost::bind(&PlanServer::readQueries, this, boost::make_shared<Connection>(client, client, true)));
+        reader.detach();
+    }
+    stopWorkers();
+    close(listener);
+    unlink(path.c_str());
+    return true;
+}
+
+void PlanServer::startWorkers(){
+    boost::mutex::scoped_lock lock(queue_mutex_);
+    if(!closed_)
+        return;
+    closed_ = false;
+    for(int i=0; i<threads_; i++)
+        workers_.create_thread(boost::bind(&PlanServer::work, this));
+}
+
+void PlanServer::stopWorkers(){
+    {
+        boost::mutex::scoped_lock lock(queue_mutex_);
+        closed_ = true;
+    }
+    queue_cond_.notify_all();
+    workers_.join_all();
+}
+
+void PlanServer::work(){
+    while(true){
+        Job job;
+        {
+            boost::mutex::scoped_lock lock(queue_mutex_);
+            while(queue_.empty() && !closed_)
+                queue_cond_.wait(lock);
+            //the queue is drained before the workers stop
+            if(queue_.empty())
+                return;
+            job = queue_.front();
+            queue_.pop_front();
+        }
+        send(job.connection, answer(job.query));
+    }
+}
+
+void PlanServer::readQueries( Connection::Ptr connection ){
+    string pending;
+    char buffer[1 << 16];
+    bool done = false;
+    while(!done){
+        ssize_t got = read(connection->in_fd, buffer, sizeof(buffer));
+        if(got < 0 && errno == EINTR)
+            continue;
+        if(got <= 0){
+            //a last query without a newline still counts
+            done = true;
+            pending += '\n';
+        }
+        else{
+            pending.append(buffer, got);
+        }
+
+        //queue every complete line without waiting for the answers
+        size_t line_start = 0, newline;
+        while((newline = pending.find('\n', line_start)) != string::npos){
+            Job job;
+            job.connection = connection;
+            job.query = pending.substr(line_start, newline-line_start);
+            line_start = newline+1;
+            if(job.query.find_first_not_of(" \t\r") == string::npos)
+                continue;
+            {
+                boost::mutex::scoped_lock lock(queue_mutex_);
+                queue_.push_back(job);
+            }
+            queue_cond_.notify_one();
+        }
+        pending.erase(0, line_start);
+    }
+}
+
+void PlanServer::send( const Connection::Ptr& connection, const string& line ){
+    string data = line + '\n';
+    boost::mutex::scoped_lock lock(connection->write_mutex);
+    const char* out = data.c_str();
+    size_t left = data.size();
+    while(left > 0){
+        ssize_t written = write(connection->out_fd, out, left);
+        if(written < 0 && errno == EINTR)
+            continue;
+        if(written <= 0)
+            return;
+        out += written;
+        left -= written;
+    }
+}
+
+string PlanServer::answer( const string& query ){
+    boost::chrono::steady_clock::time_point begin = boost::chrono::steady_clock::now();
+    boost::property_tree::ptree request;
+    try{
+        stringstream input(query);
+        boost::property_tree::read_json(input, request);
+    }
+    catch(const boost::property_tree::ptree_error& error){
+        return JsonLines::errorReply("null", "malformed query");
+    }
+    string id = JsonLines::formatId(request);
+
+    //find the map, the only one may be left out
+    boost::unordered_map<string, ServedMap>::iterator map_it;
+    boost::optional<string> map_name = request.get_optional<string>("map");
+    if(map_name)
+        map_it = maps_.find(*map_name);
+    else if(maps_.size() == 1)
+        map_it = maps_.begin();
+    else
+        return JsonLines::errorReply(id, "no map given");
+    if(map_it == maps_.end())
+        return JsonLines::errorReply(id, "unknown map " + *map_name);
+    ServedMap& map = map_it->second;
+
+    Cell start = *map.env->getStart();
+    Cell goal = *map.env->getGoal();
+    boost::optional<boost::property_tree::ptree&> start_node = request.get_child_optional("start");
+    boost::optional<boost::property_tree::ptree&> goal_node = request.get_child_optional("goal");
+    if((start_node && !JsonLines::readCell(*start_node, start)) || (goal_node && !JsonLines::readCell(*goal_node, goal)))
+        return JsonLines::errorReply(id, "start and goal must be [x, y]");
+
+    int radius;
+    bool fixed_point, waypoints, use_cache;
+    try{
+        radius = request.get("options.radius", 0);
+        fixed_point = request.get("options.fixed_point", false);
+        waypoints = request.get("options.waypoints", true);
+        use_cache = request.get("options.cache", true);
+    }
+    catch(const boost::property_tree::ptree_error& error){
+        return JsonLines::errorReply(id, "malformed options");
+    }
+
+    Path path;
+    bool cached = false;
+    string error;
+    if(!plan(map, start, goal, radius, fixed_point, use_cache, path, cached, error))
+        return JsonLines::errorReply(id, error);
+    boost::chrono::duration<double, boost::milli> elapsed = boost::chrono::steady_clock::now() - begin;
+
+    ostringstream reply;
+    reply << "{\"id\": " << id << ", \"ok\": true, \"cost\": " << fixed << setprecision(4) << path.cost()
+          << ", \"cells\": " << path.numCells() << ", \"ms\": " << setprecision(3) << elapsed.count()
+          << ", \"cached\": " << (cached ? "true" : "false") << ", \"path\": [";
+    bool first = true;
+    if(waypoints){
+        const vector<Cell>& points = path.getWaypoints();
+        for(size_t i=0; i<points.size(); i++, first=false)
+            reply << (first ? "" : ", ") << "[" << points[i].x << ", " << points[i].y << "]";
+    }
+    else{
+        for(Path::CellIterator cell_it = path.cellsBegin(); cell_it != path.cellsEnd(); ++cell_it, first=false)
+            reply << (first ? "" : ", ") << "[" << cell_it->x << ", " << cell_it->y << "]";
+    }
+    reply << "]}";
+    return reply.str();
+}
+
+bool PlanServer::plan( ServedMap& map, const Cell& start, const Cell& goal, int radius, bool fixed_point,
+                       bool use_cache, Path& path, bool& cached, string& error ){
+    //the cache holds paths of the default graph only
+    use_cache = use_cache && radius == 0 && !fixed_point;
+    PathCacheKey key(start, goal, map.env->getVersion());
+    if(use_cache){
+        boost::mutex::scoped_lock lock(*map.cache_mutex);
+        double seconds;
+        if(map.cache->lookup(key, path, seconds)){
+            cached = true;
+            return true;
+        }
+    }
+
+    //plan without holding the cache, so queries on the same map run side by side
+    boost::chrono::steady_clock::time_point begin = boost::chrono::steady_clock::now();
+    Graph::Ptr graph = boost::make_shared<Graph>(map.env, start, goal);
+    if(fixed_point)
+        graph->setCostMode(Graph::FIXED_POINT);
+    if(!graph->setRadius(radius)){
+        ostringstream message;
+        message << "radius " << radius << " is not loaded";
+        error = message.str();
+        return false;
+    }
+    Planner planner(map.env, graph);
+    planner.setVerbose(false);
+    if(!planner.plan(path)){
+        error = graph->isGoalReachable() ? "no plan found" : "goal is not reachable from start";
+        return false;
+    }
+    boost::chrono::duration<double> elapsed = boost::chrono::steady_clock::now() - begin;
+
+    if(use_cache){
+        //file under the version actually searched
+        key.version = graph->getSnapshot()->getVersion();
+        boost::mutex::scoped_lock lock(*map.cache_mutex);
+        map.cache->insert(key, path, elapsed.count());
+    }
+    return true;
+}
@@ -1,32 +1,21 @@
 #include <navi_example/Planner.h>
+#include <navi_example/QueryStats.h>
 
 #include <boost/make_shared.hpp>
 #include <algorithm>
+#include <iostream>
+#include <limits>
 
 using namespace std;
 
-SearchState::SearchState() : g(0), h(0)
+Planner::Planner(Environment::Ptr env, Graph::Ptr graph): env_(env), graph_(graph), epsilon_(1.0), solution_cost_(-1),
+    max_states_(0), peak_states_(0), num_expansions_(0), min_pruned_f_(numeric_limits<double>::infinity()), verbose_(true), expansion_log_(NULL)
 {
-}
-
-bool operator==(SearchState::Ptr const& s1, SearchState::Ptr const& s2){
-    return s1->graph_state_->coords == s2->graph_state_->coords;
-}
-size_t hash_value(SearchState::Ptr const& s){
-    return hash_value(s->getGraphState()->coords);
-}
-bool operator<(SearchState::Ptr const& lhs, SearchState::Ptr const& rhs){
-    return (lhs->g + lhs->h)>(rhs->g + rhs->h);
-}
-GraphState::Ptr SearchState::getGraphState(){
-    return graph_state_;
-}
-void SearchState::setGraphState( const GraphState::Ptr& gstate ){
-    graph_state_ = gstate;
-}
+    if(graph_->getCostMode() == Graph::FIXED_POINT)
+        open_list_ = boost::make_shared<BucketOpenList>();
+    else
+        open_list_ = boost::make_shared<BinaryHeapOpenList>();
 
-Planner::Planner(Environment::Ptr env, Graph::Ptr graph): env_(env), graph_(graph), epsilon_(1.0)
-{
     //initialize the priority queue
     SearchState::Ptr start_state = boost::make_shared<SearchState>();
     start_state->setGraphState( graph_->getStart() );
@@ -35,46 +24,73 @@ Planner::Planner(Environment::Ptr env, Graph::Ptr graph): env_(env), graph_(grap
     search_state_space_[start_state] = make_pair(start_state, true); //in the open list
 
     //initialize the heap
-    open_list_.push_back(start_state);
-    make_heap(open_list_.begin(), open_list_.end());
+    open_list_->push(start_state);
 }
 
 bool Planner::plan(vector<GraphState::Ptr>& path){
+    Path compact;
+    if(!plan(compact))
+        return false;
+    for(Path::CellIterator cell_it = compact.cellsBegin(); cell_it != compact.cellsEnd(); ++cell_it)
+        path.push_back(boost::make_shared<GraphState>(*cell_it));
+    return true;
+}
+
+bool Planner::plan(Path& path){
+    NAVI_PHASE(SEARCH);
     
     bool isGoalFound = false;
-    typedef pair<SearchState::Ptr,bool> StatePair;
 
-    size_t num_expansions = 0;
+    //no search can succeed if start and goal are in different components
+    if(!graph_->isGoalReachable()){
+        if(verbose_)
+            cout << "Goal is not reachable from start" << endl;
+        return false;
+    }
 
-    while(!open_list_.empty() && !isGoalFound){
+    num_expansions_ = 0;
+
+    while(!open_list_->empty() && !isGoalFound){
+        //a budget too small for any path can keep regenerating the same states
+        if(max_states_ && num_expansions_ >= max_states_*MAX_EXPANSIONS_PER_STATE){
+            if(verbose_)
+                cout << "Gave up after " << num_expansions_ << " expansions, the state budget is too small" << endl;
+            break;
+        }
         //pop off open_list
-        SearchState::Ptr current = open_list_.front();
-        pop_heap(open_list_.begin(), open_list_.end());
-        open_list_.pop_back();
+        SearchState::Ptr current = open_list_->pop();
+        NAVI_COUNT(HEAP_OPERATIONS);
+
+        //skip states that were expanded already or replaced after being pruned
+        HashTable::iterator current_it = search_state_space_.find(current);
+        NAVI_COUNT(HASH_PROBES);
+        if(current_it == search_state_space_.end() || current_it->second.first != current || !current_it->second.second)
+            continue;
         
         //if( current->parent_ )
         //    cout << *(current->parent_->getGraphState()) << ", " << *(current->getGraphState()) << endl;
 
-        num_expansions++;
-        if((num_expansions%1000) == 0){
-            cout << "Expansions=" << num_expansions << endl;
-        }
+        num_expansions_++;
+        NAVI_COUNT(EXPANSIONS);
+        if(expansion_log_)
+            expansion_log_->push_back(current->getGraphState()->coords);
         
         //check if goal
         if(graph_->isGoalState(current->getGraphState()) ){
             //unwind path
             //terminate search
             isGoalFound = true;
+            solution_cost_ = current->g;
             unwind(current, path);
-            cout << "Done!" << endl;
+            if(verbose_)
+                cout << "Done!" << endl;
         }
         else{
             //add current to closed
-            HashTable::iterator state_pair_it = search_state_space_.find(current);
-            if(state_pair_it == search_state_space_.end())
-                cout << "Impossible scenario" << endl;
-            else
-                state_pair_it->second.second = false;
+            current_it->second.second = false;
+            expanding_ = current;
+            //children are regenerated, so nothing below it is forgotten anymore
+            current->forgotten_f_ = numeric_limits<double>::infinity();
             
             //generate succs
             vector<double> costs;
@@ -87,19 +103,31 @@ bool Planner::plan(vector<GraphState::Ptr>& path){
             
             //check succs in open and closed list
             for(size_t i=0; i<successors.size(); i++){
+                NAVI_COUNT(ALLOCATIONS);
                 SearchState::Ptr succ = boost::make_shared<SearchState>();
                 succ->g = current->g + costs[i];
                 succ->graph_state_ = successors[i];
 
                 //check if on open or closed list
                 HashTable::iterator state_pair_it = search_state_space_.find(succ);
+                NAVI_COUNT(HASH_PROBES);
                 if(state_pair_it == search_state_space_.end()){
                     //not in open and closed
                     succ->h = epsilon_ * graph_->getHeuristicCost( succ->getGraphState() );
+                    succ->depth_ = current->depth_ + 1;
+                    //a path through a state this deep could never fit in memory,
+                    //and neither can one when all memory is taken by the states leading here
+                    if(max_states_ && ((succ->depth_+1 >= max_states_ && !graph_->isGoalState(successors[i])) || !makeRoom())){
+                        //forget it for good
+                        min_pruned_f_ = min(min_pruned_f_, succ->g + succ->h);
+                        continue;
+                    }
                     succ->parent_ = current;
-                    open_list_.push_back(succ);
-                    push_heap(open_list_.begin(), open_list_.end());
+                    current->num_children_++;
+                    open_list_->push(succ);
                     search_state_space_[succ] = make_pair(succ,true);
+                    NAVI_COUNT(HEAP_OPERATIONS);
+                    NAVI_COUNT(HASH_PROBES);
                 }
                 else{
                     if(state_pair_it->second.second)//true = open list
@@ -108,11 +136,32 @@ bool Planner::plan(vector<GraphState::Ptr>& path){
                             //update g value
                             state_pair_it->second.first->g = succ->g;
                             //update parent
+                            SearchState::Ptr old_parent = state_pair_it->second.first->parent_;
                             state_pair_it->second.first->parent_ = current;
+                            state_pair_it->second.first->depth_ = current->depth_ + 1;
+                            current->num_children_++;
+                            //decrease key operation
+                            open_list_->decreaseKey(state_pair_it->second.first);
+                            NAVI_COUNT(HEAP_OPERATIONS);
+                            if(old_parent && --old_parent->num_children_ == 0 && max_states_)
+                                noteChildless(old_parent);
                         }
-                        //resort heap
-                        //decrease key operation
-                        make_heap(open_list_.begin(), open_list_.end());
+                    }
+                    else if(max_states_ && succ->g < state_pair_it->second.first->g)
+                    {
+                        //closed by a costlier route while the cheaper one was forgotten; reopen it
+                        SearchState::Ptr closed = state_pair_it->second.first;
+                        SearchState::Ptr old_parent = closed->parent_;
+                        closed->g = succ->g;
+                        closed->h = epsilon_ * graph_->getHeuristicCost( closed->getGraphState() );
+                        closed->parent_ = current;
+                        closed->depth_ = current->depth_ + 1;
+                        current->num_children_++;
+                        state_pair_it->second.second = true;
+                        open_list_->push(closed);
+                        NAVI_COUNT(HEAP_OPERATIONS);
+                        if(old_parent && --old_parent->num_children_ == 0)
+                            noteChildless(old_parent);
                     }
                     else//false = closed list
                     {
@@ -121,33 +170,159 @@ bool Planner::plan(vector<GraphState::Ptr>& path){
                 }
                 
             }
+
+            expanding_.reset();
+            //successors pruned while it was being expanded are regenerated later
+            if(max_states_ && current->forgotten_f_ < numeric_limits<double>::infinity())
+                reopen(current);
+            else if(max_states_ && current->num_children_ == 0)
+                noteChildless(current);
+            peak_states_ = max(peak_states_, search_state_space_.size());
         }
     }
+    dead_ends_.clear();
     return isGoalFound;
 }
 
-void Planner::unwind(const SearchState::Ptr& state, vector<GraphState::Ptr>& plan){
-    SearchState::Ptr current=state;
-    while(current->parent_){
-        interpolate(current, current->parent_, plan);
-        current = current->parent_;
+bool Planner::makeRoom(){
+    //only once the budget is reached: first dead ends, then the worst open states
+    while(search_state_space_.size() >= max_states_){
+        if(!dead_ends_.empty()){
+            SearchState::Ptr dead_end = dead_ends_.back();
+            dead_ends_.pop_back();
+            dropDeadEnd(dead_end);
+        }
+        else if(!pruneWorst())
+            return false;
     }
-    plan.push_back(current->getGraphState());
-    reverse(plan.begin(), plan.end());
+    return true;
 }
 
-void Planner::interpolate(const SearchState::Ptr& from_state, const SearchState::Ptr& to_state, vector<GraphState::Ptr>& plan){
-    GraphState::Ptr from_gstate = from_state->getGraphState();
-    GraphState::Ptr to_gstate = to_state->getGraphState();
-    
-    Direction dir = to_gstate->coords - from_gstate->coords;
-    //copy start
-    GraphState::Ptr current = boost::make_shared<GraphState>(from_gstate->coords);
-
-    //add intermediate steps by add the direction until you reach the to_state
-    while( !(current->coords==to_gstate->coords) ){
-        plan.push_back(current);
-        current = boost::make_shared<GraphState>( current->coords + dir );
+bool Planner::pruneWorst(){
+    //the worst leaf; states reopened for their forgotten children still hold
+    //children in memory, so they are set aside and put back
+    vector<SearchState::Ptr> interior;
+    SearchState::Ptr worst;
+    while(!worst && !open_list_->empty()){
+        SearchState::Ptr candidate = open_list_->removeWorst();
+        NAVI_COUNT(HEAP_OPERATIONS);
+        if(!candidate)
+            break;
+        HashTable::iterator candidate_it = search_state_space_.find(candidate);
+        NAVI_COUNT(HASH_PROBES);
+        //an entry left behind by an expansion or an earlier prune
+        if(candidate_it == search_state_space_.end() || candidate_it->second.first != candidate || !candidate_it->second.second)
+            continue;
+        //never drop the start state
+        if(candidate->num_children_ > 0 || !candidate->parent_)
+            interior.push_back(candidate);
+        else
+            worst = candidate;
+    }
+    for(size_t i=0; i<interior.size(); i++){
+        open_list_->push(interior[i]);
+        NAVI_COUNT(HEAP_OPERATIONS);
     }
+    if(!worst)
+        return false;
+    search_state_space_.erase(worst);
+    NAVI_COUNT(HASH_PROBES);
+
+    //back the f value up into the parent, which goes back on the open list to regenerate it
+    SearchState::Ptr parent = worst->parent_;
+    parent->num_children_--;
+    parent->forgotten_f_ = min(parent->forgotten_f_, worst->g + worst->h);
+    if(parent.get() != expanding_.get())
+        reopen(parent);
+    return true;
 }
 
+void Planner::reopen(SearchState::Ptr state){
+    HashTable::iterator state_it = search_state_space_.find(state);
+    NAVI_COUNT(HASH_PROBES);
+    if(state_it == search_state_space_.end() || state_it->second.first != state)
+        return;
+    //keyed by the smallest f forgotten below it
+    state->h = state->forgotten_f_ - state->g;
+    if(state_it->second.second)
+        open_list_->decreaseKey(state);
+    else{
+        state_it->second.second = true;
+        open_list_->push(state);
+    }
+    NAVI_COUNT(HEAP_OPERATIONS);
+}
+
+void Planner::noteChildless(SearchState::Ptr state){
+    //by address, == compares the cells
+    if(state.get() == expanding_.get())
+        return;
+    if(state->forgotten_f_ < numeric_limits<double>::infinity())
+        reopen(state);
+    else
+        dead_ends_.push_back(state);
+}
+
+void Planner::dropDeadEnd(SearchState::Ptr state){
+    HashTable::iterator state_it = search_state_space_.find(state);
+    NAVI_COUNT(HASH_PROBES);
+    //it may have been dropped, reopened or given children since it was noted
+    if(state_it == search_state_space_.end() || state_it->second.first != state || state_it->second.second ||
+       state->num_children_ > 0 || state.get() == expanding_.get() || !state->parent_)
+        return;
+    search_state_space_.erase(state_it);
+    SearchState::Ptr parent = state->parent_;
+    if(--parent->num_children_ == 0)
+        noteChildless(parent);
+}
+
+void Planner::setStateBudget(size_t max_states){
+    max_states_ = max_states;
+}
+
+void Planner::setMemoryBudget(size_t max_bytes){
+    //always leave room for the start state and one expansion
+    max_states_ = max(max_bytes/getBytesPerState(), size_t(2));
+}
+
+size_t Planner::getBytesPerState(){
+    //make_shared puts each object next to its reference counts
+    size_t shared_overhead = 2*sizeof(long) + sizeof(void*);
+    size_t hash_node = sizeof(HashTable::value_type) + 2*sizeof(void*) + sizeof(size_t);
+    return sizeof(SearchState) + sizeof(GraphState) + 2*shared_overhead + hash_node + sizeof(SearchState::Ptr);
+}
+
+size_t Planner::getNumExpansions() const {
+    return num_expansions_;
+}
+
+size_t Planner::getPeakStates() const {
+    return peak_states_;
+}
+
+void Planner::setVerbose(bool verbose){
+    verbose_ = verbose;
+}
+
+void Planner::setExpansionLog(vector<Cell>* expanded){
+    expansion_log_ = expanded;
+}
+
+bool Planner::isSolutionOptimal() const {
+    return solution_cost_ >= 0 && solution_cost_ <= min_pruned_f_;
+}
+
+double Planner::getSolutionCost() const {
+    return solution_cost_;
+}
+
+void Planner::unwind(const SearchState::Ptr& state, Path& plan){
+    NAVI_PHASE(UNWIND);
+    plan.clear();
+    SearchState::Ptr current=state;
+    while(current){
+        plan.addWaypoint(current->getGraphState()->coords);
+        current = current->parent_;
+    }
+    plan.reverse();
+}
@@ -0,0 +1,150 @@
+#include "navi_example/QueryStats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+const QueryStats::Clock::time_point EPOCH = QueryStats::Clock::now();
+
+double microsecondsSinceEpoch(QueryStats::Clock::time_point time){
+    return boost::chrono::duration<double, boost::micro>(time - EPOCH).count();
+}
+}
+
+__thread QueryStats* QueryStats::current_ = NULL;
+
+const char* QueryStats::COUNTER_NAMES[NUM_COUNTERS] = {
+    "collision_checks", "jump_steps", "forced_neighbors", "heap_operations", "hash_probes", "allocations", "expansions"
+};
+
+const char* QueryStats::PHASE_NAMES[NUM_PHASES] = { "load", "search", "unwind" };
+
+QueryStats::Scope::Scope( QueryStats* stats ) : previous_(current_) {
+    current_ = stats;
+}
+
+QueryStats::Scope::~Scope(){
+    current_ = previous_;
+}
+
+QueryStats::ScopedPhase::ScopedPhase( Phase phase ) : stats_(current_), phase_(phase) {
+    if(stats_)
+        begin_ = Clock::now();
+}
+
+QueryStats::ScopedPhase::~ScopedPhase(){
+    if(stats_)
+        stats_->addEvent(phase_, begin_, Clock::now());
+}
+
+QueryStats::QueryStats( const string& name ) : name_(name), has_result_(false), found_(false), cost_(-1) {
+    fill(counters_, counters_+NUM_COUNTERS, 0);
+    fill(phase_ms_, phase_ms_+NUM_PHASES, 0.0);
+}
+
+bool QueryStats::isEnabled(){
+#ifdef NAVI_INSTRUMENT
+    return true;
+#else
+    return false;
+#endif
+}
+
+double QueryStats::millisecondsSince( Clock::time_point begin ){
+    return boost::chrono::duration<double, boost::milli>(Clock::now() - begin).count();
+}
+
+size_t QueryStats::getCount( Counter counter ) const {
+    return counters_[counter];
+}
+
+double QueryStats::getPhaseMs( Phase phase ) const {
+    return phase_ms_[phase];
+}
+
+const vector<QueryStats::Event>& QueryStats::getEvents() const {
+    return events_;
+}
+
+const string& QueryStats::getName() const {
+    return name_;
+}
+
+void QueryStats::setResult( bool found, double cost ){
+    has_result_ = true;
+    found_ = found;
+    cost_ = cost;
+}
+
+void QueryStats::addEvent( Phase phase, Clock::time_point begin, Clock::time_point end ){
+    Event event;
+    event.phase = phase;
+    event.begin_us = microsecondsSinceEpoch(begin);
+    event.duration_us = boost::chrono::duration<double, boost::micro>(end - begin).count();
+    event.thread = syscall(SYS_gettid);
+    events_.push_back(event);
+    phase_ms_[phase] += event.duration_us / 1000;
+}
+
+void QueryStats::writeJson( ostream& os ) const {
+    os << "{\"query\": \"" << name_ << "\"";
+    if(has_result_){
+        char result[64];
+        snprintf(result, sizeof(result), ", \"found\": %s, \"cost\": %.4f", found_ ? "true" : "false", cost_);
+        os << result;
+    }
+    os << ", \"counters\": {";
+    for(int i=0; i<NUM_COUNTERS; i++)
+        os << (i ? ", \"" : "\"") << COUNTER_NAMES[i] << "\": " << counters_[i];
+    os << "}, \"phases_ms\": {";
+    for(int i=0; i<NUM_PHASES; i++){
+        char phase[64];
+        snprintf(phase, sizeof(phase), "%s\"%s\": %.3f", i ? ", " : "", PHASE_NAMES[i], phase_ms_[i]);
+        os << phase;
+    }
+    os << "}}";
+}
+
+bool QueryStats::writeTrace( const string& filename, const vector<QueryStats>& queries ){
+    ofstream trace(filename.c_str());
+    if(!trace){
+        printf("File \"%s\" could not be opened for writing!\n", filename.c_str());
+        return false;
+    }
+    int pid = getpid();
+    bool first = true;
+    trace << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    for(size_t i=0; i<queries.size(); i++){
+        const vector<Event>& events = queries[i].events_;
+        if(events.empty())
+            continue;
+        //the query spans all of its phases
+        double begin = events[0].begin_us, end = begin;
+        for(size_t j=0; j<events.size(); j++){
+            begin = min(begin, events[j].begin_us);
+            end = max(end, events[j].begin_us + events[j].duration_us);
+        }
+        char line[256];
+        snprintf(line, sizeof(line), "%s\n{\"name\": \"%s\", \"cat\": \"query\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, \"tid\": %d, \"args\": {",
+                 first ? "" : ",", queries[i].name_.c_str(), begin, end-begin, pid, events[0].thread);
+        trace << line;
+        first = false;
+        for(int c=0; c<NUM_COUNTERS; c++)
+            trace << (c ? ", \"" : "\"") << COUNTER_NAMES[c] << "\": " << queries[i].counters_[c];
+        trace << "}}";
+        for(size_t j=0; j<events.size(); j++){
+            snprintf(line, sizeof(line), ",\n{\"name\": \"%s\", \"cat\": \"phase\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, \"tid\": %d}",
+                     PHASE_NAMES[events[j].phase], events[j].begin_us, events[j].duration_us, pid, events[j].thread);
+            trace << line;
+        }
+    }
+    trace << "\n]}\n";
+    trace.close();
+    return !trace.fail();
+}
@@ -0,0 +1,23 @@
+#include "navi_example/SearchState.h"
+
+#include <limits>
+
+SearchState::SearchState() : g(0), h(0), depth_(0), num_children_(0), forgotten_f_(numeric_limits<double>::infinity())
+{
+}
+
+bool operator==(SearchState::Ptr const& s1, SearchState::Ptr const& s2){
+    return s1->graph_state_->coords == s2->graph_state_->coords;
+}
+size_t hash_value(SearchState::Ptr const& s){
+    return hash_value(s->getGraphState()->coords);
+}
+bool operator<(SearchState::Ptr const& lhs, SearchState::Ptr const& rhs){
+    return (lhs->g + lhs->h)>(rhs->g + rhs->h);
+}
+GraphState::Ptr SearchState::getGraphState(){
+    return graph_state_;
+}
+void SearchState::setGraphState( const GraphState::Ptr& gstate ){
+    graph_state_ = gstate;
+}
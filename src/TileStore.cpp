@@ -0,0 +1,262 @@
+#include "navi_example/TileStore.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/make_shared.hpp>
+
+using namespace std;
+
+namespace {
+const char TILE_MAGIC[4] = {'N','A','V','T'};
+const boost::uint32_t TILE_FORMAT = 1;
+
+/**
+ * @brief orders index entries by row of tiles, then column
+ */
+bool entryLess(const TileIndexEntry& lhs, const TileIndexEntry& rhs){
+    return lhs.y < rhs.y || (lhs.y == rhs.y && lhs.x < rhs.x);
+}
+
+/**
+ * @brief reads exactly size bytes at an offset
+ */
+bool readFully(int fd, void* buffer, size_t size, off_t offset){
+    char* out = static_cast<char*>(buffer);
+    while(size > 0){
+        ssize_t got = pread(fd, out, size, offset);
+        if(got <= 0)
+            return false;
+        out += got;
+        size -= got;
+        offset += got;
+    }
+    return true;
+}
+
+/**
+ * @brief a tile with every cell blocked
+ */
+ObstacleTile::ConstPtr makeOccupiedTile(){
+    ObstacleTile::Ptr tile = boost::make_shared<ObstacleTile>();
+    for(int y=0; y<ObstacleTile::SIZE; y++)
+        tile->rows[y] = ~boost::uint64_t(0);
+    tile->updateColumns();
+    return tile;
+}
+
+/**
+ * @brief the tile handed out for tiles that could not be read, shared by every store
+ */
+ObstacleTile::ConstPtr occupiedTile(){
+    static const ObstacleTile::ConstPtr occupied = makeOccupiedTile();
+    return occupied;
+}
+}
+
+TileStoreStats::TileStoreStats() : faults(0), hits(0), evictions(0), resident(0), file_tiles(0), bytes_read(0), read_errors(0) {}
+
+ostream& operator<<(ostream& os, const TileStoreStats& stats){
+    os << "faults=" << stats.faults
+       << " hits=" << stats.hits
+       << " evictions=" << stats.evictions
+       << " resident=" << stats.resident
+       << " file_tiles=" << stats.file_tiles
+       << " bytes_read=" << stats.bytes_read
+       << " read_errors=" << stats.read_errors;
+    return os;
+}
+
+TileStore::Ptr TileStore::open( const string& path, size_t max_tiles ){
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        printf("File \"%s\" does not exist to be read!\n", path.c_str());
+        return Ptr();
+    }
+    Ptr store(new TileStore(fd, max(max_tiles, size_t(1))));
+
+    TileFileHeader header;
+    if(!readFully(fd, &header, sizeof(header), 0) || memcmp(header.magic, TILE_MAGIC, 4) != 0 ||
+            header.format != TILE_FORMAT || header.tile_bits != ObstacleTile::BITS){
+        printf("File \"%s\" is not a tile file of this version\n", path.c_str());
+        return Ptr();
+    }
+    store->start_ = Cell(header.start_x, header.start_y);
+    store->goal_ = Cell(header.goal_x, header.goal_y);
+
+    vector<TileIndexEntry> entries(header.num_tiles);
+    if(header.num_tiles && !readFully(fd, &entries[0], entries.size()*sizeof(TileIndexEntry), sizeof(header))){
+        printf("Tile index of \"%s\" is truncated\n", path.c_str());
+        return Ptr();
+    }
+    vector<TileSlot>(entries.size()).swap(store->slots_);
+    for(size_t i=0; i<entries.size(); i++){
+        Cell tile(entries[i].x, entries[i].y);
+        store->index_[tile] = i;
+        store->slots_[i].offset = entries[i].offset;
+        if(i == 0){
+            store->min_tile_ = store->max_tile_ = tile;
+            continue;
+        }
+        store->min_tile_ = Cell(min(store->min_tile_.x, tile.x), min(store->min_tile_.y, tile.y));
+        store->max_tile_ = Cell(max(store->max_tile_.x, tile.x), max(store->max_tile_.y, tile.y));
+    }
+    store->stats_.file_tiles = entries.size();
+    store->stats_.bytes_read = sizeof(header) + entries.size()*sizeof(TileIndexEntry);
+    return store;
+}
+
+bool TileStore::isTileFile( const string& path ){
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    char magic[4];
+    bool result = readFully(fd, magic, sizeof(magic), 0) && memcmp(magic, TILE_MAGIC, 4) == 0;
+    close(fd);
+    return result;
+}
+
+bool TileStore::write( const string& path, const Cell& start, const Cell& goal, const MapSnapshot& snapshot ){
+    vector<pair<Cell, ObstacleTile::ConstPtr> > tiles;
+    snapshot.collectTiles(tiles);
+
+    vector<TileIndexEntry> entries(tiles.size());
+    for(size_t i=0; i<tiles.size(); i++){
+        entries[i].x = tiles[i].first.x;
+        entries[i].y = tiles[i].first.y;
+    }
+    sort(entries.begin(), entries.end(), entryLess);
+    boost::unordered_map<Cell, ObstacleTile::ConstPtr> by_coords(tiles.begin(), tiles.end());
+
+    TileFileHeader header;
+    memcpy(header.magic, TILE_MAGIC, 4);
+    header.format = TILE_FORMAT;
+    header.start_x = start.x;
+    header.start_y = start.y;
+    header.goal_x = goal.x;
+    header.goal_y = goal.y;
+    header.tile_bits = ObstacleTile::BITS;
+    header.reserved = 0;
+    header.num_tiles = entries.size();
+
+    //tiles follow the index in index order, so neighbouring tiles of a row are close on disk
+    boost::uint64_t offset = sizeof(header) + entries.size()*sizeof(TileIndexEntry);
+    for(size_t i=0; i<entries.size(); i++){
+        entries[i].offset = offset;
+        offset += sizeof(ObstacleTile().rows);
+    }
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if(!file){
+        printf("File \"%s\" could not be opened for writing!\n", path.c_str());
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    if(ok && !entries.empty())
+        ok = fwrite(&entries[0], sizeof(TileIndexEntry), entries.size(), file) == entries.size();
+    for(size_t i=0; ok && i<entries.size(); i++){
+        const ObstacleTile& tile = *by_coords[Cell(entries[i].x, entries[i].y)];
+        ok = fwrite(tile.rows, sizeof(tile.rows), 1, file) == 1;
+    }
+    ok = (fclose(file) == 0) && ok;
+    if(!ok)
+        printf("Failed writing tile file \"%s\"\n", path.c_str());
+    return ok;
+}
+
+TileStore::TileSlot::TileSlot() : offset(0), referenced(false) {}
+
+TileStore::TileStore( int fd, size_t max_tiles ) : fd_(fd), max_tiles_(max_tiles), min_tile_(0,0), max_tile_(-1,-1), hand_(0), hits_(0) {}
+
+TileStore::~TileStore(){
+    close(fd_);
+}
+
+ObstacleTile::ConstPtr TileStore::getTile( const Cell& tile ){
+    boost::unordered_map<Cell, size_t>::const_iterator index_it = index_.find(tile);
+    if(index_it == index_.end())
+        return ObstacleTile::ConstPtr();
+    TileSlot& slot = slots_[index_it->second];
+    ObstacleTile::ConstPtr cached = boost::atomic_load(&slot.tile);
+    if(cached){
+        //skip the store when the bit is already set, so hits on a tile do not write its cache line
+        if(!slot.referenced.load(boost::memory_order_relaxed))
+            slot.referenced.store(true, boost::memory_order_relaxed);
+        hits_.fetch_add(1, boost::memory_order_relaxed);
+        return cached;
+    }
+
+    //read without holding the lock; a tile faulted twice at once is just read twice
+    ObstacleTile::Ptr loaded = boost::make_shared<ObstacleTile>();
+    if(!readFully(fd_, loaded->rows, sizeof(loaded->rows), slot.offset)){
+        //fail closed: an empty pointer would read as free space; left out of
+        //the cache so the next request tries the disk again
+        printf("Failed reading tile %d, %d\n", tile.x, tile.y);
+        boost::mutex::scoped_lock lock(mutex_);
+        stats_.read_errors++;
+        return occupiedTile();
+    }
+    loaded->updateColumns();
+
+    boost::mutex::scoped_lock lock(mutex_);
+    cached = boost::atomic_load(&slot.tile);
+    if(cached)
+        return cached;
+    stats_.faults++;
+    stats_.bytes_read += sizeof(loaded->rows);
+    if(resident_.size() < max_tiles_){
+        resident_.push_back(index_it->second);
+    }
+    else{
+        //the clock hand clears the bits of tiles used since it last passed
+        //them and evicts the first tile that was not; two rounds at most, in
+        //case readers keep setting bits behind it
+        for(size_t passed=0; passed < 2*resident_.size() && slots_[resident_[hand_]].referenced.exchange(false); passed++)
+            hand_ = (hand_+1) % resident_.size();
+        boost::atomic_store(&slots_[resident_[hand_]].tile, ObstacleTile::ConstPtr());
+        stats_.evictions++;
+        resident_[hand_] = index_it->second;
+        hand_ = (hand_+1) % resident_.size();
+    }
+    slot.referenced.store(true, boost::memory_order_relaxed);
+    boost::atomic_store(&slot.tile, ObstacleTile::ConstPtr(loaded));
+    return loaded;
+}
+
+bool TileStore::hasTile( const Cell& tile ) const {
+    return index_.count(tile) > 0;
+}
+
+vector<Cell> TileStore::getTileCoordinates() const {
+    vector<Cell> tiles;
+    for(boost::unordered_map<Cell, size_t>::const_iterator index_it = index_.begin(); index_it != index_.end(); ++index_it)
+        tiles.push_back(index_it->first);
+    return tiles;
+}
+
+Cell TileStore::getStart() const {
+    return start_;
+}
+
+Cell TileStore::getGoal() const {
+    return goal_;
+}
+
+Cell TileStore::getMinTile() const {
+    return min_tile_;
+}
+
+Cell TileStore::getMaxTile() const {
+    return max_tile_;
+}
+
+TileStoreStats TileStore::getStats() const {
+    boost::mutex::scoped_lock lock(mutex_);
+    TileStoreStats stats = stats_;
+    stats.hits = hits_.load(boost::memory_order_relaxed);
+    stats.resident = resident_.size();
+    return stats;
+}
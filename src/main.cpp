@@ -1,16 +1,126 @@
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <cmath>
 
+#include <boost/chrono.hpp>
 #include <boost/foreach.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
+#include <unistd.h>
 
+#include "navi_example/ConnectivityIndex.h"
 #include "navi_example/Environment.h"
 #include "navi_example/Graph.h"
+#include "navi_example/GridPlanner.h"
+#include "navi_example/MapRenderer.h"
 #include "navi_example/Planner.h"
+#include "navi_example/PathCache.h"
+#include "navi_example/PathWriter.h"
+#include "navi_example/PlanServer.h"
+#include "navi_example/QueryStats.h"
+#include "navi_example/TileStore.h"
 
 using namespace std;
+namespace po = boost::program_options;
+
+/**
+ * @brief loads a json or tile file and inflates its obstacles as the options ask
+ * @param file the map
+ * @param vm the program options
+ * @param inflate whether to inflate by the --radius option
+ * @return the environment, or an empty pointer if it could not be loaded
+ */
+Environment::Ptr loadEnvironment( const boost::filesystem::path& file, const po::variables_map& vm, bool inflate ){
+  ifstream input_json_file;
+  if(boost::filesystem::exists(file)){
+     input_json_file.open( file.string().c_str() );
+  }
+  if(!input_json_file){
+      printf("File \"%s\" does not exist to be read!\n", file.string().c_str());
+      return Environment::Ptr();
+  }
+
+  Environment::Ptr env = boost::make_shared<Environment>();
+  if(vm.count("threads"))
+      env->setNumThreads( vm["threads"].as<int>() );
+  bool lazy = TileStore::isTileFile( file.string() );
+  if(lazy){
+      if(!env->loadTiles( file.string(), vm["tile-cache-mb"].as<double>()*1024*1024 ))
+          return Environment::Ptr();
+  }
+  else{
+      env->readDescription( input_json_file );
+  }
+  input_json_file.close();
+
+  int radius = vm["radius"].as<int>();
+  if(radius > 0 && inflate){
+      if(lazy){
+          printf("Obstacles of a tile file cannot be inflated, load the json file instead\n");
+          return Environment::Ptr();
+      }
+      boost::chrono::steady_clock::time_point begin = boost::chrono::steady_clock::now();
+      env->setClearanceRadii( vector<int>(1, radius) );
+      boost::chrono::duration<double, boost::milli> elapsed = boost::chrono::steady_clock::now() - begin;
+      cout << "Inflated obstacles by radius " << radius << " in " << elapsed.count() << " ms" << endl;
+  }
+  return env;
+}
+
+/**
+ * @brief writes the stats of the queries as JSON lines and as a trace, as the options ask
+ * @return whether everything asked for was written
+ */
+bool writeQueryStats( const vector<QueryStats>& queries, const po::variables_map& vm ){
+  if(!vm.count("stats") && !vm.count("trace"))
+      return true;
+  if(!QueryStats::isEnabled())
+      printf("Built without NAVI_INSTRUMENT, so the stats are empty; rebuild with make NAVI_INSTRUMENT=1\n");
+  if(vm.count("stats")){
+      ofstream stats( vm["stats"].as<string>().c_str() );
+      for(size_t i=0; i<queries.size(); i++){
+          queries[i].writeJson(stats);
+          stats << "\n";
+      }
+      if(!stats){
+          printf("File \"%s\" could not be written!\n", vm["stats"].as<string>().c_str());
+          return false;
+      }
+  }
+  return !vm.count("trace") || QueryStats::writeTrace( vm["trace"].as<string>(), queries );
+}
+
+/**
+ * @brief reads a binary solution back and compares it cell by cell with the path it was written from
+ * @param filename the _sol.bin file
+ * @param path the planned path
+ * @return whether the file decodes to exactly the cells of the path
+ */
+bool checkBinarySolution( const string& filename, const Path& path ){
+  Path decoded;
+  if(!PathWriter::readBinary(filename, decoded)){
+      printf("Binary check failed: %s could not be read\n", filename.c_str());
+      return false;
+  }
+  size_t position = 0;
+  Path::CellIterator cell_it = path.cellsBegin(), decoded_it = decoded.cellsBegin();
+  for(; cell_it != path.cellsEnd() && decoded_it != decoded.cellsEnd(); ++cell_it, ++decoded_it, position++){
+      if(!(*cell_it == *decoded_it)){
+          cout << "Binary check failed: cell " << position << " is " << *decoded_it << " instead of " << *cell_it << endl;
+          return false;
+      }
+  }
+  if(cell_it != path.cellsEnd() || decoded_it != decoded.cellsEnd()){
+      printf("Binary check failed: %zu cells decoded for a path of %zu\n", decoded.numCells(), path.numCells());
+      return false;
+  }
+  printf("Binary check passed: %zu cells\n", position);
+  return true;
+}
+
 /**
  * @brief main function
  * 
@@ -20,32 +130,86 @@ using namespace std;
 int main(int argc, char** argv){
 
   //some program options boilerplate
-  namespace po = boost::program_options; 
   po::options_description desc("Vanilla Navigation Planner Usage"); 
   desc.add_options() 
     ("vis,v","mode to rewrite the json files into readable format for matlab")
-    ("env,e",po::value<string>()->required(),"input environment json file"); 
+    ("waypoints,w","write only the jump points of the solution instead of every cell")
+    ("binary,b","write the solution as delta encoded direction runs to _sol.bin")
+    ("check-binary","write _sol.bin, read it back and check it cell by cell against the planned path")
+    ("fixed-point,f","plan with integer octile costs and a bucket open list")
+    ("check-costs","plan with both cost modes and check that the path costs agree")
+    ("max-states",po::value<size_t>(),"bound the search to this many states in memory")
+    ("memory-mb",po::value<double>(),"bound the search states to this many megabytes")
+    ("unbounded","plan on the hashed graph even when the map fits a dense grid")
+    ("queries,q",po::value<string>(),"file of \"sx sy gx gy\" queries to answer through the path cache")
+    ("cache-mb",po::value<double>()->default_value(64),"memory cap of the path cache in megabytes")
+    ("radius,r",po::value<int>()->default_value(0),"robot radius in cells; obstacles are inflated by it")
+    ("threads,t",po::value<int>(),"threads for parsing the map, inflating obstacles and serving queries, defaults to the number of cores")
+    ("write-tiles",po::value<string>(),"write the environment as a tile file and exit")
+    ("tile-cache-mb",po::value<double>()->default_value(64),"memory cap of the tiles read from a tile file in megabytes")
+    ("render",po::value<string>(),"draw obstacles, path and expanded states to a .ppm, .pgm or .png image")
+    ("render-pixels",po::value<int>()->default_value(1024),"longest side of the rendered image; larger maps are scaled down")
+    ("stats",po::value<string>(),"write the counters and phase times of every query to this file as JSON lines")
+    ("trace",po::value<string>(),"write the phases of every query to this file as Chrome trace events")
+    ("serve",po::value<string>()->implicit_value("-"),"answer json line queries on this unix socket, or on stdin and stdout if none is given")
+    ("map,m",po::value<vector<string> >(),"another [NAME=]FILE map to serve, named after the file by default")
+    ("env,e",po::value<string>()->required(),"input environment json file, or tile file read on demand"); 
   po::variables_map vm;
   po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
   po::notify(vm);
 
+  //answers own stdout when serving on it; everything else printed goes to stderr
+  int answers_fd = 1;
+  if(vm.count("serve") && vm["serve"].as<string>() == "-"){
+    answers_fd = dup(1);
+    dup2(2, 1);
+  }
+
   //open the json
   boost::filesystem::path json_file( vm["env"].as<string>() );
-  ifstream input_json_file;
-  if(boost::filesystem::exists(json_file)){
-     input_json_file.open( json_file.string().c_str() );
-  }
-  else{
-      printf("File \"%s\" does not exist to be read!\n", json_file.string().c_str());
+  int radius = vm["radius"].as<int>();
+  //the load counts towards the first query
+  vector<QueryStats> queries(1, QueryStats(json_file.stem().string()));
+  Environment::Ptr env;
+  {
+    QueryStats::Scope scope( &queries[0] );
+    env = loadEnvironment( json_file, vm, !vm.count("write-tiles") );
   }
 
-  if( input_json_file ){
-    //use the json file to construct the environment
-    Environment::Ptr env = boost::make_shared<Environment>();
-    env->readDescription( input_json_file );
+  if( env ){
+    bool lazy = TileStore::isTileFile( json_file.string() );
 
-    input_json_file.close();
-    if(vm.count("vis")){
+    if(vm.count("write-tiles")){
+        if(!env->writeTiles( vm["write-tiles"].as<string>() ))
+            return 1;
+        cout << "Wrote tiles to " << vm["write-tiles"].as<string>() << endl;
+        return 0;
+    }
+
+    if(vm.count("serve")){
+        //load the other maps, then answer queries until the input or the socket closes
+        int threads = vm.count("threads") ? vm["threads"].as<int>() : int(boost::thread::hardware_concurrency());
+        PlanServer server( threads, vm["cache-mb"].as<double>()*1024*1024 );
+        server.addMap( json_file.stem().string(), env );
+        if(vm.count("map")){
+            BOOST_FOREACH( const string& named_file, vm["map"].as<vector<string> >() ){
+                size_t equals = named_file.find('=');
+                boost::filesystem::path map_file( equals == string::npos ? named_file : named_file.substr(equals+1) );
+                Environment::Ptr map_env = loadEnvironment( map_file, vm, true );
+                if(!map_env)
+                    return 1;
+                server.addMap( equals == string::npos ? map_file.stem().string() : named_file.substr(0, equals), map_env );
+            }
+        }
+        if(vm["serve"].as<string>() == "-"){
+            cerr << "Answering queries on stdin" << endl;
+            server.serveStream( 0, answers_fd );
+        }
+        else if(!server.serveSocket( vm["serve"].as<string>() )){
+            return 1;
+        }
+    }
+    else if(vm.count("vis")){
         boost::filesystem::path parent_dir = json_file.parent_path();
         boost::filesystem::path solution_filename(json_file.stem().string()+"_vis.txt");
         boost::filesystem::path solution_filepath = parent_dir / solution_filename;
@@ -55,30 +219,158 @@ int main(int argc, char** argv){
         ofs << *env; 
         ofs.close();
     }
+    else if(vm.count("queries")){
+        //answer a stream of queries on the same map through the cache
+        ifstream query_file( vm["queries"].as<string>().c_str() );
+        if(!query_file){
+            printf("File \"%s\" does not exist to be read!\n", vm["queries"].as<string>().c_str());
+            return 1;
+        }
+        PathCache cache( vm["cache-mb"].as<double>()*1024*1024 );
+        int sx, sy, gx, gy;
+        while(query_file >> sx >> sy >> gx >> gy){
+            stringstream name;
+            name << sx << "," << sy << "->" << gx << "," << gy;
+            queries.push_back(QueryStats(name.str()));
+            QueryStats::Scope scope( &queries.back() );
+            Path path;
+            bool found = cache.plan(env, Cell(sx,sy), Cell(gx,gy), path);
+            queries.back().setResult(found, found ? path.cost() : -1);
+            if(found)
+                cout << "Query " << Cell(sx,sy) << " -> " << Cell(gx,gy) << ": " << path.numCells() << " cells" << endl;
+            else
+                cout << "Query " << Cell(sx,sy) << " -> " << Cell(gx,gy) << ": No plan found!" << endl;
+        }
+        cout << "Cache: " << cache.getStats() << endl;
+        if(!writeQueryStats(queries, vm))
+            return 1;
+    }
+    else if(vm.count("check-costs")){
+        //the fixed point optimum may only be worse by the rounding of a diagonal step
+        Graph::Ptr float_graph = boost::make_shared<Graph>(env);
+        Graph::Ptr fixed_graph = boost::make_shared<Graph>(env);
+        fixed_graph->setCostMode(Graph::FIXED_POINT);
+        float_graph->setRadius(radius);
+        fixed_graph->setRadius(radius);
+        Path float_path, fixed_path;
+        bool float_result = Planner(env, float_graph).plan(float_path);
+        bool fixed_result = Planner(env, fixed_graph).plan(fixed_path);
+        if(float_result != fixed_result){
+            cout << "Cost check failed: only one cost mode found a plan" << endl;
+            return 1;
+        }
+        if(float_result){
+            double tolerance = float_path.cost() * (M_SQRT2*Graph::STRAIGHT_COST/Graph::DIAGONAL_COST - 1) + 1e-9;
+            double difference = fabs(fixed_path.cost() - float_path.cost());
+            printf("Floating point cost: %f\nFixed point cost: %f\nDifference: %g (tolerance %g)\n",
+                    float_path.cost(), fixed_path.cost(), difference, tolerance);
+            if(difference > tolerance){
+                cout << "Cost check failed!" << endl;
+                return 1;
+            }
+        }
+        cout << "Cost check passed" << endl;
+    }
     else{
-        //plan on the environment
-        Graph::Ptr graph = boost::make_shared<Graph>(env);
-        Planner::Ptr plnr = boost::make_shared<Planner>(env, graph);
+        //plan on a dense grid when the map fits one and no option needs the hashed graph
+        const Cell& start = *env->getStart();
+        const Cell& goal = *env->getGoal();
+        GridPlanner::Ptr grid;
+        if(!vm.count("unbounded") && !vm.count("fixed-point") && !vm.count("max-states") && !vm.count("memory-mb")){
+            QueryStats::Scope scope( &queries[0] );
+            grid = GridPlanner::create( *env->getSnapshot(), radius, start, goal );
+        }
+        Graph::Ptr graph;
+        Planner::Ptr plnr;
+        if(!grid){
+            graph = boost::make_shared<Graph>(env);
+            if(vm.count("fixed-point"))
+                graph->setCostMode(Graph::FIXED_POINT);
+            graph->setRadius(radius);
+            plnr = boost::make_shared<Planner>(env, graph);
+            if(vm.count("max-states"))
+                plnr->setStateBudget( vm["max-states"].as<size_t>() );
+            if(vm.count("memory-mb"))
+                plnr->setMemoryBudget( vm["memory-mb"].as<double>()*1024*1024 );
+        }
 
-        vector<GraphState::Ptr> path;
+        Path path;
+        vector<Cell> expanded;
+        if(vm.count("render")){
+            if(grid)
+                grid->setExpansionLog( &expanded );
+            else
+                plnr->setExpansionLog( &expanded );
+        }
 
         //call planner
-        bool plannerResult = plnr->plan(path);
+        bool plannerResult;
+        {
+          QueryStats::Scope scope( &queries[0] );
+          if(grid){
+              //the grid search has no component check of its own
+              const ConnectivityIndex* connectivity = env->getSnapshot()->getConnectivity(radius);
+              plannerResult = (!connectivity || connectivity->isConnected(start, goal)) && grid->plan(start, goal, path);
+          }
+          else{
+              plannerResult = plnr->plan(path);
+          }
+        }
+        queries[0].setResult(plannerResult, plannerResult ? path.cost() : -1);
+        if(grid)
+            printf("Expanded %zu states on a %dx%d grid\n", grid->getNumExpansions(), grid->getSide(), grid->getSide());
+        else
+            printf("Expanded %zu states\n", plnr->getNumExpansions());
+        if(QueryStats::isEnabled()){
+          cout << "Stats: ";
+          queries[0].writeJson(cout);
+          cout << endl;
+        }
+        if(!writeQueryStats(queries, vm))
+          return 1;
+
+        if(vm.count("render")){
+            //draw what the search saw, whether or not it found a path
+            boost::chrono::steady_clock::time_point begin = boost::chrono::steady_clock::now();
+            pair<Cell, Cell> window = MapRenderer::findWindow( *env->getSnapshot(), path, start, goal );
+            MapRenderer renderer( window.first, window.second, vm["render-pixels"].as<int>() );
+            int threads = vm.count("threads") ? vm["threads"].as<int>() : int(boost::thread::hardware_concurrency());
+            renderer.addObstacles( *env->getSnapshot(), threads );
+            renderer.addExpansions( expanded );
+            renderer.addPath( path );
+            renderer.addEnds( *env->getStart(), *env->getGoal() );
+            if(!renderer.write( vm["render"].as<string>() ))
+                return 1;
+            boost::chrono::duration<double, boost::milli> elapsed = boost::chrono::steady_clock::now() - begin;
+            printf("Rendered %zu expansions to %s (%dx%d, %d cells per pixel) in %.1f ms\n", expanded.size(),
+                   vm["render"].as<string>().c_str(), renderer.getWidth(), renderer.getHeight(), renderer.getCellsPerPixel(), elapsed.count());
+        }
+
+        if(vm.count("max-states") || vm.count("memory-mb")){
+            printf("Peak states: %zu (%zu bytes)\n", plnr->getPeakStates(), plnr->getPeakStates()*Planner::getBytesPerState());
+            if(plannerResult)
+                printf("Path cost %f is %s\n", path.cost(), plnr->isSolutionOptimal() ? "guaranteed optimal" : "not guaranteed optimal");
+        }
+        if(lazy)
+            cout << "Tile cache: " << env->getSnapshot()->getStore()->getStats() << endl;
 
         if(plannerResult){
             //output plan to file
             boost::filesystem::path parent_dir = json_file.parent_path();
-            boost::filesystem::path solution_filename(json_file.stem().string()+"_sol.txt");
+            bool binary = vm.count("binary") || vm.count("check-binary");
+            boost::filesystem::path solution_filename(json_file.stem().string()+(binary ? "_sol.bin" : "_sol.txt"));
             boost::filesystem::path solution_filepath = parent_dir / solution_filename;
 
             printf("Writing out solution to: %s\n", solution_filepath.string().c_str());
-            ofstream ofs;
-            ofs.open( solution_filepath.string().c_str() );
-
-            for(size_t i=0; i<path.size(); i++){
-                ofs << *(path[i]) << endl;
+            PathWriter writer( solution_filepath.string(), binary ? PathWriter::BINARY :
+                               vm.count("waypoints") ? PathWriter::TEXT_WAYPOINTS : PathWriter::TEXT_CELLS );
+            writer.write(path);
+            if(!writer.close()){
+                printf("Failed writing solution to: %s\n", solution_filepath.string().c_str());
+                return 1;
             }
-            ofs.close();
+            if(vm.count("check-binary") && !checkBinarySolution(solution_filepath.string(), path))
+                return 1;
         }
         else{
             //
@@ -87,5 +379,5 @@ int main(int argc, char** argv){
     }
   }
 
-  return 0;
+  return env ? 0 : 1;
 }
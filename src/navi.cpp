@@ -0,0 +1,207 @@
+#include "navi_example/navi.h"
+
+#include <exception>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/make_shared.hpp>
+
+#include "navi_example/Environment.h"
+#include "navi_example/Graph.h"
+#include "navi_example/Path.h"
+#include "navi_example/Planner.h"
+#include "navi_example/TileStore.h"
+
+using namespace std;
+
+struct navi_map{
+  Environment::Ptr env;
+};
+
+namespace {
+/**
+ * @brief memory cap of the tile cache of maps loaded from tile files
+ */
+const size_t TILE_CACHE_BYTES = 64*1024*1024;
+
+Environment::Ptr makeEnvironment(int threads){
+  Environment::Ptr env = boost::make_shared<Environment>();
+  env->setVerbose(false);
+  if(threads > 0)
+    env->setNumThreads(threads);
+  return env;
+}
+
+vector<Cell> toCells(const navi_cell* cells, size_t count){
+  vector<Cell> converted(count);
+  for(size_t i=0; i<count; i++)
+    converted[i] = Cell(cells[i].x, cells[i].y);
+  return converted;
+}
+
+navi_cell toNavi(const Cell& cell){
+  navi_cell converted;
+  converted.x = cell.x;
+  converted.y = cell.y;
+  return converted;
+}
+}
+
+int navi_api_version(void){
+  return NAVI_API_VERSION;
+}
+
+const char* navi_status_string(int status){
+  switch(status){
+    case NAVI_OK: return "ok";
+    case NAVI_INVALID_ARGUMENT: return "invalid argument";
+    case NAVI_UNREACHABLE: return "goal is not reachable from start";
+    case NAVI_NO_PATH: return "no plan found";
+    case NAVI_BUFFER_TOO_SMALL: return "path buffer too small";
+    case NAVI_RADIUS_NOT_LOADED: return "radius is not loaded";
+    case NAVI_NOT_SUPPORTED: return "not supported for tile files";
+    case NAVI_INTERNAL_ERROR: return "internal error";
+    default: return "unknown status";
+  }
+}
+
+navi_map* navi_map_load_file(const char* path, int threads){
+  if(!path)
+    return NULL;
+  try{
+    Environment::Ptr env = makeEnvironment(threads);
+    if(TileStore::isTileFile(path)){
+      if(!env->loadTiles(path, TILE_CACHE_BYTES))
+        return NULL;
+    }
+    else{
+      ifstream json(path);
+      if(!json)
+        return NULL;
+      env->readDescription(json);
+    }
+    navi_map* map = new navi_map;
+    map->env = env;
+    return map;
+  }
+  catch(const exception& error){
+    return NULL;
+  }
+}
+
+navi_map* navi_map_load_buffer(const char* json, size_t size, int threads){
+  if(!json)
+    return NULL;
+  try{
+    Environment::Ptr env = makeEnvironment(threads);
+    env->readDescription(string(json, size));
+    navi_map* map = new navi_map;
+    map->env = env;
+    return map;
+  }
+  catch(const exception& error){
+    return NULL;
+  }
+}
+
+void navi_map_free(navi_map* map){
+  delete map;
+}
+
+navi_status navi_map_get_start(const navi_map* map, navi_cell* start){
+  if(!map || !start)
+    return NAVI_INVALID_ARGUMENT;
+  *start = toNavi(*map->env->getStart());
+  return NAVI_OK;
+}
+
+navi_status navi_map_get_goal(const navi_map* map, navi_cell* goal){
+  if(!map || !goal)
+    return NAVI_INVALID_ARGUMENT;
+  *goal = toNavi(*map->env->getGoal());
+  return NAVI_OK;
+}
+
+uint64_t navi_map_get_version(const navi_map* map){
+  return map ? map->env->getVersion() : 0;
+}
+
+navi_status navi_map_set_radii(navi_map* map, const int* radii, size_t count){
+  if(!map || (!radii && count))
+    return NAVI_INVALID_ARGUMENT;
+  for(size_t i=0; i<count; i++){
+    if(radii[i] < 0)
+      return NAVI_INVALID_ARGUMENT;
+  }
+  if(map->env->getSnapshot()->getStore())
+    return NAVI_NOT_SUPPORTED;
+  try{
+    map->env->setClearanceRadii(vector<int>(radii, radii+count));
+    return NAVI_OK;
+  }
+  catch(const exception& error){
+    return NAVI_INTERNAL_ERROR;
+  }
+}
+
+navi_status navi_map_add_obstacles(navi_map* map, const navi_cell* cells, size_t count){
+  if(!map || (!cells && count))
+    return NAVI_INVALID_ARGUMENT;
+  try{
+    map->env->addObstacles(toCells(cells, count));
+    return NAVI_OK;
+  }
+  catch(const exception& error){
+    return NAVI_INTERNAL_ERROR;
+  }
+}
+
+navi_status navi_map_remove_obstacles(navi_map* map, const navi_cell* cells, size_t count){
+  if(!map || (!cells && count))
+    return NAVI_INVALID_ARGUMENT;
+  try{
+    map->env->removeObstacles(toCells(cells, count));
+    return NAVI_OK;
+  }
+  catch(const exception& error){
+    return NAVI_INTERNAL_ERROR;
+  }
+}
+
+navi_status navi_plan(navi_map* map, navi_cell start, navi_cell goal, int radius, navi_path_mode mode,
+                      navi_cell* path, size_t capacity, size_t* count, double* cost){
+  if(!map || !count || radius < 0 || (!path && capacity))
+    return NAVI_INVALID_ARGUMENT;
+  try{
+    Graph::Ptr graph = boost::make_shared<Graph>(map->env, Cell(start.x, start.y), Cell(goal.x, goal.y));
+    if(!graph->setRadius(radius))
+      return NAVI_RADIUS_NOT_LOADED;
+    Planner planner(map->env, graph);
+    planner.setVerbose(false);
+    Path found;
+    if(!planner.plan(found))
+      return graph->isGoalReachable() ? NAVI_NO_PATH : NAVI_UNREACHABLE;
+
+    //copy straight from the path into the caller's buffer
+    const vector<Cell>& waypoints = found.getWaypoints();
+    *count = (mode == NAVI_PATH_CELLS) ? found.numCells() : waypoints.size();
+    if(cost)
+      *cost = found.cost();
+    if(*count > capacity)
+      return NAVI_BUFFER_TOO_SMALL;
+    if(mode == NAVI_PATH_CELLS){
+      size_t i = 0;
+      for(Path::CellIterator cell_it = found.cellsBegin(); cell_it != found.cellsEnd(); ++cell_it)
+        path[i++] = toNavi(*cell_it);
+    }
+    else{
+      for(size_t i=0; i<waypoints.size(); i++)
+        path[i] = toNavi(waypoints[i]);
+    }
+    return NAVI_OK;
+  }
+  catch(const exception& error){
+    return NAVI_INTERNAL_ERROR;
+  }
+}
@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/chrono.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include "navi_example/Environment.h"
+#include "navi_example/Graph.h"
+#include "navi_example/Planner.h"
+#include "navi_example/QueryStats.h"
+#include "navi_example/TileStore.h"
+
+using namespace std;
+
+typedef boost::chrono::steady_clock Clock;
+
+/**
+ * @brief results of all runs on one map
+ */
+struct MapResult{
+    string name;
+    vector<double> load_ms;
+    vector<double> plan_ms;
+    size_t expansions;
+    bool found;
+    double cost;
+    /**
+     * @brief cost of the committed solution, negative if there is none
+     */
+    double reference_cost;
+    bool cost_ok;
+    long peak_rss_kb;
+};
+
+static double median(vector<double> values){
+    sort(values.begin(), values.end());
+    size_t middle = values.size()/2;
+    return (values.size() % 2) ? values[middle] : (values[middle-1] + values[middle]) / 2;
+}
+
+/**
+ * @brief resets the peak resident set size of the process, if the kernel allows it
+ */
+static void resetPeakRss(){
+    ofstream clear_refs("/proc/self/clear_refs");
+    if(clear_refs)
+        clear_refs << "5";
+}
+
+/**
+ * @brief peak resident set size of the process in kilobytes
+ *
+ * since the last reset, or since the start where resetting is not allowed
+ */
+static long peakRssKb(){
+    ifstream status("/proc/self/status");
+    string line;
+    while(getline(status, line)){
+        if(line.compare(0, 6, "VmHWM:") == 0)
+            return atol(line.c_str() + 6);
+    }
+    return -1;
+}
+
+/**
+ * @brief cost of a solution file of "x, y" cells, one step per line
+ * @return the cost, or -1 if the file cannot be read
+ */
+static double solutionCost(const string& filename){
+    ifstream solution(filename.c_str());
+    if(!solution)
+        return -1;
+    double cost = 0;
+    int x, y, last_x = 0, last_y = 0;
+    char comma;
+    bool first = true;
+    while(solution >> x >> comma >> y){
+        if(!first)
+            cost += (x != last_x && y != last_y) ? M_SQRT2 : (x != last_x || y != last_y) ? 1 : 0;
+        first = false;
+        last_x = x;
+        last_y = y;
+    }
+    return cost;
+}
+
+/**
+ * @brief loads and plans on one map several times
+ */
+static MapResult benchmark(const boost::filesystem::path& file, int runs, int threads){
+    MapResult result;
+    result.name = file.stem().string();
+    result.expansions = 0;
+    result.found = false;
+    result.cost = -1;
+    resetPeakRss();
+    for(int run=0; run<runs; run++){
+        //counts nothing unless built with NAVI_INSTRUMENT, and then measures its overhead too
+        QueryStats stats(result.name);
+        QueryStats::Scope scope(&stats);
+        Clock::time_point begin = Clock::now();
+        Environment::Ptr env = boost::make_shared<Environment>();
+        env->setVerbose(false);
+        if(threads > 0)
+            env->setNumThreads(threads);
+        if(TileStore::isTileFile(file.string())){
+            env->loadTiles(file.string(), size_t(64)*1024*1024);
+        }
+        else{
+            ifstream json(file.string().c_str());
+            env->readDescription(json);
+        }
+        result.load_ms.push_back(QueryStats::millisecondsSince(begin));
+
+        begin = Clock::now();
+        Graph::Ptr graph = boost::make_shared<Graph>(env);
+        Planner planner(env, graph);
+        planner.setVerbose(false);
+        Path path;
+        result.found = planner.plan(path);
+        result.plan_ms.push_back(QueryStats::millisecondsSince(begin));
+        result.expansions = planner.getNumExpansions();
+        result.cost = result.found ? path.cost() : -1;
+    }
+    result.peak_rss_kb = peakRssKb();
+
+    //a path costlier than the committed solution is a regression; some committed ones are not optimal
+    boost::filesystem::path solution = file.parent_path() / (result.name + "_sol.txt");
+    result.reference_cost = solutionCost(solution.string());
+    result.cost_ok = result.reference_cost < 0 || (result.found && result.cost < result.reference_cost + 1e-3);
+    return result;
+}
+
+static void writeJson(ostream& os, const vector<MapResult>& results, int runs){
+    os << "{\n  \"runs\": " << runs << ",\n  \"maps\": [";
+    for(size_t i=0; i<results.size(); i++){
+        const MapResult& result = results[i];
+        char line[512];
+        snprintf(line, sizeof(line),
+                 "%s\n    {\"name\": \"%s\", \"load_ms\": {\"median\": %.3f, \"min\": %.3f}, \"plan_ms\": {\"median\": %.3f, \"min\": %.3f}, "
+                 "\"expansions\": %zu, \"found\": %s, \"cost\": %.4f, \"reference_cost\": %.4f, \"cost_ok\": %s, \"peak_rss_kb\": %ld}",
+                 i ? "," : "", result.name.c_str(),
+                 median(result.load_ms), *min_element(result.load_ms.begin(), result.load_ms.end()),
+                 median(result.plan_ms), *min_element(result.plan_ms.begin(), result.plan_ms.end()),
+                 result.expansions, result.found ? "true" : "false", result.cost, result.reference_cost,
+                 result.cost_ok ? "true" : "false", result.peak_rss_kb);
+        os << line;
+    }
+    os << "\n  ]\n}\n";
+}
+
+/**
+ * @brief compares one timing against the baseline
+ * @return whether it got slower by more than the threshold
+ */
+static bool isSlower(const string& name, const string& phase, double now, double before, double threshold, double min_ms){
+    double change = before > 0 ? (now - before) / before * 100 : 0;
+    bool slower = now - before > min_ms && change > threshold;
+    printf("  %-10s %-5s %10.3f ms -> %10.3f ms  %+7.1f%%%s\n", name.c_str(), phase.c_str(), before, now, change, slower ? "  REGRESSION" : "");
+    return slower;
+}
+
+/**
+ * @brief End to end benchmark
+ *
+ * Loads and plans every map several times, reporting the median and best
+ * times of the load and plan phases, the expansions, the peak resident
+ * memory and the path cost, which must be no worse than the committed
+ * *_sol.txt solution. The results can be written as JSON and compared
+ * against an earlier JSON result.
+ */
+int main(int argc, char** argv){
+  namespace po = boost::program_options;
+  po::options_description desc("End to End Benchmark Usage");
+  desc.add_options()
+    ("data,d",po::value<string>()->default_value("DataSets"),"directory whose *.dat maps are benchmarked")
+    ("env,e",po::value<vector<string> >(),"additional json or tile map to benchmark")
+    ("runs,n",po::value<int>()->default_value(5),"runs per map")
+    ("threads,t",po::value<int>()->default_value(0),"threads for loading, defaults to the number of cores")
+    ("json,j",po::value<string>(),"write the results as JSON to this file")
+    ("baseline,b",po::value<string>(),"JSON results of an earlier run to compare against")
+    ("threshold",po::value<double>()->default_value(10),"percent a median may grow before it counts as a regression")
+    ("min-ms",po::value<double>()->default_value(1),"growth in milliseconds below which timings are treated as noise");
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  //the data set maps in name order, then the extra ones
+  vector<boost::filesystem::path> files;
+  boost::filesystem::path data( vm["data"].as<string>() );
+  if(boost::filesystem::is_directory(data)){
+    for(boost::filesystem::directory_iterator file_it(data); file_it != boost::filesystem::directory_iterator(); ++file_it){
+      if(file_it->path().extension() == ".dat")
+        files.push_back(file_it->path());
+    }
+    sort(files.begin(), files.end());
+  }
+  if(vm.count("env")){
+    BOOST_FOREACH( const string& file, vm["env"].as<vector<string> >() )
+      files.push_back(file);
+  }
+  if(files.empty()){
+    printf("No maps to benchmark\n");
+    return 1;
+  }
+
+  int runs = max(1, vm["runs"].as<int>());
+  vector<MapResult> results;
+  bool ok = true;
+  printf("%-10s %12s %12s %11s %8s %12s %12s %10s\n", "map", "load ms", "plan ms", "expansions", "found", "cost", "reference", "rss kb");
+  for(size_t i=0; i<files.size(); i++){
+    if(!boost::filesystem::exists(files[i])){
+      printf("File \"%s\" does not exist to be read!\n", files[i].string().c_str());
+      return 1;
+    }
+    MapResult result = benchmark(files[i], runs, vm["threads"].as<int>());
+    printf("%-10s %12.3f %12.3f %11zu %8s %12.4f %12.4f %10ld%s\n", result.name.c_str(), median(result.load_ms), median(result.plan_ms),
+           result.expansions, result.found ? "yes" : "no", result.cost, result.reference_cost, result.peak_rss_kb,
+           result.cost_ok ? "" : "  COST MISMATCH");
+    ok = ok && result.cost_ok;
+    results.push_back(result);
+  }
+
+  if(vm.count("json")){
+    ofstream json( vm["json"].as<string>().c_str() );
+    writeJson(json, results, runs);
+    if(!json){
+      printf("File \"%s\" could not be written!\n", vm["json"].as<string>().c_str());
+      return 1;
+    }
+  }
+
+  if(vm.count("baseline")){
+    //a baseline missing any field is as unreadable as one that is not JSON
+    try{
+      boost::property_tree::ptree baseline;
+      boost::property_tree::read_json(vm["baseline"].as<string>(), baseline);
+      double threshold = vm["threshold"].as<double>();
+      double min_ms = vm["min-ms"].as<double>();
+      printf("Against baseline %s (threshold %.1f%%):\n", vm["baseline"].as<string>().c_str(), threshold);
+      BOOST_FOREACH( const boost::property_tree::ptree::value_type& map, baseline.get_child("maps") ){
+        string name = map.second.get<string>("name");
+        vector<MapResult>::const_iterator result_it = results.begin();
+        while(result_it != results.end() && result_it->name != name)
+          ++result_it;
+        if(result_it == results.end())
+          continue;
+        ok = !isSlower(name, "load", median(result_it->load_ms), map.second.get<double>("load_ms.median"), threshold, min_ms) && ok;
+        ok = !isSlower(name, "plan", median(result_it->plan_ms), map.second.get<double>("plan_ms.median"), threshold, min_ms) && ok;
+        size_t expansions = map.second.get<size_t>("expansions");
+        if(result_it->expansions > expansions){
+          printf("  %-10s expansions %zu -> %zu  REGRESSION\n", name.c_str(), expansions, result_it->expansions);
+          ok = false;
+        }
+        double cost = map.second.get<double>("cost");
+        if(fabs(result_it->cost - cost) > 1e-3){
+          printf("  %-10s cost %.4f -> %.4f  REGRESSION\n", name.c_str(), cost, result_it->cost);
+          ok = false;
+        }
+      }
+    }
+    catch(const boost::property_tree::ptree_error& error){
+      printf("Baseline \"%s\" could not be read: %s\n", vm["baseline"].as<string>().c_str(), error.what());
+      return 1;
+    }
+  }
+
+  printf(ok ? "Benchmark passed\n" : "Benchmark failed\n");
+  return ok ? 0 : 1;
+}
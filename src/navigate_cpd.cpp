@@ -0,0 +1,166 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <boost/chrono.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/program_options.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "navi_example/Environment.h"
+#include "navi_example/Graph.h"
+#include "navi_example/LatencyHistogram.h"
+#include "navi_example/MapRenderer.h"
+#include "navi_example/PathDatabase.h"
+#include "navi_example/Planner.h"
+#include "navi_example/QueryStats.h"
+#include "navi_example/TileStore.h"
+
+using namespace std;
+
+typedef boost::chrono::steady_clock Clock;
+
+/**
+ * @brief nanoseconds elapsed since a time point
+ */
+static boost::uint64_t nanosecondsSince(Clock::time_point begin){
+    return boost::chrono::duration_cast<boost::chrono::nanoseconds>(Clock::now() - begin).count();
+}
+
+/**
+ * @brief prints the percentiles of query latencies in microseconds
+ */
+static void printLatencies(const char* name, const LatencyHistogram& histogram){
+    printf("%-8s p50 %10.3f us  p99 %10.3f us  max %10.3f us  mean %10.3f us\n", name,
+           histogram.getValueAtPercentile(50)/1e3, histogram.getValueAtPercentile(99)/1e3,
+           histogram.getMax()/1e3, histogram.getMean()/1e3);
+}
+
+/**
+ * @brief Compressed path database tool
+ *
+ * Builds the first move tables of a window of a map on all threads and
+ * writes them next to the map, or reads them back with -r. Then answers
+ * random queries inside the window both from the database and with
+ * Planner confined to the same window, and reports the latencies of each
+ * and whether the path costs agree.
+ */
+int main(int argc, char** argv){
+  namespace po = boost::program_options;
+  po::options_description desc("Path Database Usage");
+  desc.add_options()
+    ("env,e",po::value<string>()->required(),"input environment json or tile file")
+    ("output,o",po::value<string>(),"database file, the map file with a .cpd extension by default")
+    ("window,w",po::value<string>(),"cells covered as X0,Y0,X1,Y1, the whole map by default")
+    ("size",po::value<int>(),"cover a square of this side centered on the map's start instead")
+    ("read,r","read the database from the file instead of building it")
+    ("queries,n",po::value<int>()->default_value(1000),"random queries to compare against Planner")
+    ("seed,s",po::value<unsigned int>()->default_value(1),"random seed for the queries")
+    ("threads,t",po::value<int>()->default_value(int(boost::thread::hardware_concurrency())),"threads building the database");
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  boost::filesystem::path file(vm["env"].as<string>());
+  if(!boost::filesystem::exists(file)){
+    printf("File \"%s\" does not exist to be read!\n", file.string().c_str());
+    return 1;
+  }
+  Environment::Ptr env = boost::make_shared<Environment>();
+  env->setVerbose(false);
+  if(TileStore::isTileFile(file.string())){
+    if(!env->loadTiles(file.string(), size_t(64)*1024*1024))
+      return 1;
+  }
+  else{
+    ifstream json(file.string().c_str());
+    env->readDescription(json);
+  }
+  string output = vm.count("output") ? vm["output"].as<string>() : boost::filesystem::path(file).replace_extension(".cpd").string();
+
+  PathDatabase database;
+  Clock::time_point begin = Clock::now();
+  if(vm.count("read")){
+    if(!database.read(output, env))
+      return 1;
+    printf("Read %zu cells from %s in %.1f ms\n", database.getNumCells(), output.c_str(), QueryStats::millisecondsSince(begin));
+  }
+  else{
+    pair<Cell, Cell> window = MapRenderer::findWindow(*env->getSnapshot(), Path(), *env->getStart(), *env->getGoal());
+    if(vm.count("window")){
+      if(sscanf(vm["window"].as<string>().c_str(), "%d,%d,%d,%d", &window.first.x, &window.first.y, &window.second.x, &window.second.y) != 4 ||
+          window.first.x > window.second.x || window.first.y > window.second.y){
+        printf("Window \"%s\" is not X0,Y0,X1,Y1\n", vm["window"].as<string>().c_str());
+        return 1;
+      }
+    }
+    else if(vm.count("size")){
+      Cell center = *env->getStart();
+      int size = max(1, vm["size"].as<int>());
+      window.first = Cell(center.x - size/2, center.y - size/2);
+      window.second = Cell(window.first.x + size-1, window.first.y + size-1);
+    }
+    int threads = max(1, vm["threads"].as<int>());
+    if(!database.build(env, window.first, window.second, threads))
+      return 1;
+    double build_ms = QueryStats::millisecondsSince(begin);
+    if(!database.write(output))
+      return 1;
+    printf("Built first moves of %zu cells in (%d,%d)-(%d,%d) in %.1f ms with %d %s\n", database.getNumCells(),
+           window.first.x, window.first.y, window.second.x, window.second.y, build_ms, threads, threads == 1 ? "thread" : "threads");
+  }
+  double cells = double(database.getNumCells());
+  printf("Database: %zu runs (%.2f per cell), %zu bytes (%.2f per cell, %.1fx smaller than 3 bits per pair) in %s\n",
+         database.getNumRuns(), database.getNumRuns()/max(cells, 1.0), database.getBytes(), database.getBytes()/max(cells, 1.0),
+         cells*cells*3/8/max(double(database.getBytes()), 1.0), output.c_str());
+
+  if(database.getNumCells() == 0)
+    return 0;
+
+  //queries between random free cells of the window, planned with the search kept to the window too
+  int queries = vm["queries"].as<int>();
+  boost::random::mt19937 rng(vm["seed"].as<unsigned int>());
+  boost::random::uniform_int_distribution<size_t> pick(0, database.getNumCells()-1);
+  LatencyHistogram database_ns, planner_ns;
+  int unreachable = 0, mismatches = 0;
+  double database_cost = 0, planner_cost = 0;
+  for(int query=0; query<queries; query++){
+    Cell start = database.getCell(pick(rng)), goal = database.getCell(pick(rng));
+    Path database_path, planner_path;
+    begin = Clock::now();
+    bool database_found = database.plan(start, goal, database_path);
+    database_ns.record(nanosecondsSince(begin));
+
+    begin = Clock::now();
+    Graph::Ptr graph = boost::make_shared<Graph>(env, start, goal);
+    graph->setBounds(database.getMinCell(), database.getMaxCell());
+    Planner planner(env, graph);
+    planner.setVerbose(false);
+    bool planner_found = planner.plan(planner_path);
+    planner_ns.record(nanosecondsSince(begin));
+
+    if(!database_found && !planner_found){
+      unreachable++;
+      continue;
+    }
+    if(database_found != planner_found || fabs(database_path.cost() - planner_path.cost()) > 1e-6*max(1.0, planner_path.cost())){
+      if(mismatches++ < 5)
+        printf("(%d, %d) to (%d, %d): database cost %.4f, planner cost %.4f\n", start.x, start.y, goal.x, goal.y,
+               database_found ? database_path.cost() : -1, planner_found ? planner_path.cost() : -1);
+    }
+    database_cost += database_found ? database_path.cost() : 0;
+    planner_cost += planner_found ? planner_path.cost() : 0;
+  }
+  printf("%d queries, %d unreachable, %d cost mismatches, total cost %.3f (database) %.3f (planner)\n",
+         queries, unreachable, mismatches, database_cost, planner_cost);
+  printLatencies("database", database_ns);
+  printLatencies("planner", planner_ns);
+  printf("speedup  p50 %.1fx, mean %.1fx\n",
+         database_ns.getValueAtPercentile(50) ? double(planner_ns.getValueAtPercentile(50))/database_ns.getValueAtPercentile(50) : 0.0,
+         database_ns.getMean() > 0 ? planner_ns.getMean()/database_ns.getMean() : 0.0);
+  return mismatches ? 1 : 0;
+}
@@ -0,0 +1,94 @@
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+#include <boost/chrono.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "navi_example/MapGenerator.h"
+#include "navi_example/MapSnapshot.h"
+#include "navi_example/QueryStats.h"
+#include "navi_example/TileStore.h"
+
+using namespace std;
+
+typedef boost::chrono::steady_clock Clock;
+
+/**
+ * @brief Synthetic map generator
+ *
+ * Writes a random, maze, rooms or city map of the given size as a json
+ * description like the data sets, or as a tile file, which loads without
+ * parsing and is read on demand. The same seed and options always give
+ * the same map.
+ */
+int main(int argc, char** argv){
+  namespace po = boost::program_options;
+  po::options_description desc("Map Generator Usage");
+  desc.add_options()
+    ("output,o",po::value<string>()->required(),"file to write")
+    ("style",po::value<string>()->default_value("random"),"random, maze, rooms or city")
+    ("width,W",po::value<int>(),"width in cells")
+    ("height,H",po::value<int>(),"height in cells")
+    ("cells,c",po::value<double>()->default_value(1e6),"total cells of a square map, when width and height are not given")
+    ("seed,s",po::value<unsigned long long>()->default_value(1),"random seed")
+    ("density,d",po::value<double>()->default_value(0.3),"random: share of occupied cells")
+    ("corridor",po::value<int>()->default_value(1),"maze: corridor width")
+    ("room",po::value<int>()->default_value(30),"rooms: inner side of a room")
+    ("door",po::value<int>()->default_value(3),"rooms: door width")
+    ("loops",po::value<double>()->default_value(0.3),"rooms: share of extra doors beyond a spanning tree")
+    ("block",po::value<int>()->default_value(40),"city: side of a block")
+    ("street",po::value<int>()->default_value(8),"city: street width")
+    ("tiles","write a tile file instead of json")
+    ("threads,t",po::value<int>()->default_value(int(boost::thread::hardware_concurrency())),"threads generating the map");
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  MapGenerator::Options options;
+  if(!MapGenerator::parseStyle(vm["style"].as<string>(), options.style)){
+    printf("Unknown style \"%s\", expected random, maze, rooms or city\n", vm["style"].as<string>().c_str());
+    return 1;
+  }
+  int side = int(sqrt(vm["cells"].as<double>()) + 0.5);
+  options.width = vm.count("width") ? vm["width"].as<int>() : side;
+  options.height = vm.count("height") ? vm["height"].as<int>() : side;
+  options.seed = vm["seed"].as<unsigned long long>();
+  options.density = vm["density"].as<double>();
+  options.corridor = vm["corridor"].as<int>();
+  options.room = vm["room"].as<int>();
+  options.door = vm["door"].as<int>();
+  options.loops = vm["loops"].as<double>();
+  options.block = vm["block"].as<int>();
+  options.street = vm["street"].as<int>();
+  MapGenerator generator(options);
+  if(!generator.isValid())
+    return 1;
+
+  string output = vm["output"].as<string>();
+  int threads = max(1, vm["threads"].as<int>());
+  Clock::time_point begin = Clock::now();
+  size_t obstacles;
+  if(vm.count("tiles")){
+    MapSnapshot::TileMap tiles;
+    generator.generate(threads, tiles);
+    MapSnapshot snapshot(0, tiles);
+    obstacles = snapshot.getNumObstacles();
+    double generate_ms = QueryStats::millisecondsSince(begin);
+    if(!TileStore::write(output, generator.getStart(), generator.getGoal(), snapshot))
+      return 1;
+    printf("Generated %zu tiles in %.1f ms\n", tiles.size(), generate_ms);
+  }
+  else if(!generator.writeJson(output, threads, obstacles)){
+    return 1;
+  }
+
+  double cells = double(options.width)*options.height;
+  printf("Wrote %s map of %dx%d cells, %zu obstacles (%.1f%%), start (%d, %d), goal (%d, %d) to %s (%.1f MB) in %.1f ms with %d %s\n",
+         vm["style"].as<string>().c_str(), options.width, options.height, obstacles, 100*obstacles/cells,
+         generator.getStart().x, generator.getStart().y, generator.getGoal().x, generator.getGoal().y, output.c_str(),
+         boost::filesystem::file_size(output)/1e6, QueryStats::millisecondsSince(begin), threads, threads == 1 ? "thread" : "threads");
+  return 0;
+}
@@ -0,0 +1,463 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <boost/bind.hpp>
+#include <boost/chrono.hpp>
+#include <boost/function.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/program_options.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+
+#include "navi_example/Environment.h"
+#include "navi_example/Graph.h"
+#include "navi_example/OpenList.h"
+#include "navi_example/Path.h"
+#include "navi_example/Planner.h"
+#include "navi_example/SearchState.h"
+
+using namespace std;
+
+typedef boost::chrono::steady_clock Clock;
+
+/**
+ * @brief keeps results alive so the measured calls are not optimised away
+ */
+static volatile size_t sink;
+
+/**
+ * @brief Hardware counters of this thread, read through perf_event_open
+ *
+ * Counts user space only, so it works with perf_event_paranoid up to 2.
+ * Counters the kernel or the machine does not offer read as unavailable.
+ */
+class PerfCounters{
+  public:
+    enum{ CYCLES, INSTRUCTIONS, CACHE_MISSES, BRANCH_MISSES, NUM_COUNTERS };
+
+    PerfCounters(){
+        const boost::uint64_t configs[NUM_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                       PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for(int i=0; i<NUM_COUNTERS; i++){
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds_[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+    }
+    ~PerfCounters(){
+        for(int i=0; i<NUM_COUNTERS; i++){
+            if(fds_[i] >= 0)
+                close(fds_[i]);
+        }
+    }
+    void start(){
+        for(int i=0; i<NUM_COUNTERS; i++){
+            if(fds_[i] >= 0){
+                ioctl(fds_[i], PERF_EVENT_IOC_RESET, 0);
+                ioctl(fds_[i], PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+    /**
+     * @brief stops counting and reads the counts, -1 where unavailable
+     */
+    void stop(double counts[NUM_COUNTERS]){
+        for(int i=0; i<NUM_COUNTERS; i++){
+            boost::uint64_t value;
+            counts[i] = -1;
+            if(fds_[i] < 0)
+                continue;
+            ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+            if(read(fds_[i], &value, sizeof(value)) == sizeof(value))
+                counts[i] = double(value);
+        }
+    }
+    bool available() const {
+        return fds_[CYCLES] >= 0;
+    }
+  private:
+    int fds_[NUM_COUNTERS];
+};
+
+/**
+ * @brief one kernel: runs a number of iterations and returns how many operations it made
+ */
+struct Kernel{
+    string name;
+    boost::function<size_t(int)> run;
+    int iterations;
+};
+
+/**
+ * @brief builds a map from a list of obstacles
+ */
+static Environment::Ptr makeEnvironment(const vector<Cell>& obstacles){
+    Environment::Ptr env = boost::make_shared<Environment>();
+    env->setVerbose(false);
+    env->addObstacles(obstacles);
+    return env;
+}
+
+/**
+ * @brief a square of side size with about density of its cells occupied
+ */
+static vector<Cell> randomObstacles(boost::random::mt19937& rng, int size, double density){
+    vector<Cell> obstacles;
+    boost::random::uniform_int_distribution<int> coordinate(0, size-1);
+    for(size_t i=0; i<size_t(size*size*density); i++)
+        obstacles.push_back(Cell(coordinate(rng), coordinate(rng)));
+    return obstacles;
+}
+
+/**
+ * @brief a horizontal corridor from x=0 to x=length along y=0, closed at the far end
+ */
+static vector<Cell> corridor(int length){
+    vector<Cell> obstacles;
+    for(int x=-1; x<=length+1; x++){
+        obstacles.push_back(Cell(x, 1));
+        obstacles.push_back(Cell(x, -1));
+    }
+    obstacles.push_back(Cell(length+1, 0));
+    return obstacles;
+}
+
+/**
+ * @brief the walls of a square room from (0,0) to (length,length)
+ */
+static vector<Cell> room(int length){
+    vector<Cell> obstacles;
+    for(int i=-2; i<=length+2; i++){
+        obstacles.push_back(Cell(i, -2));
+        obstacles.push_back(Cell(i, length+2));
+        obstacles.push_back(Cell(-2, i));
+        obstacles.push_back(Cell(length+2, i));
+    }
+    return obstacles;
+}
+
+static size_t collisionChecks(Environment::Ptr env, const vector<Cell>* cells, int iterations){
+    size_t free_cells = 0;
+    //held for the whole run, as a planner holds it for a query
+    MapSnapshot::ConstPtr snapshot = env->getSnapshot();
+    for(int i=0; i<iterations; i++){
+        for(size_t j=0; j<cells->size(); j++)
+            free_cells += snapshot->isCollisionFree((*cells)[j]);
+    }
+    sink = free_cells;
+    return size_t(iterations)*cells->size();
+}
+
+static size_t forcedChecks(Graph::Ptr graph, const vector<GraphState::Ptr>* states, const vector<Direction>* dirs, bool collect, int iterations){
+    size_t forced = 0;
+    vector<GraphState::Ptr> succs;
+    vector<double> costs;
+    for(int i=0; i<iterations; i++){
+        for(size_t j=0; j<states->size(); j++){
+            if(collect){
+                succs.clear();
+                costs.clear();
+                forced += graph->getForced((*states)[j], (*dirs)[j], succs, costs);
+            }
+            else{
+                forced += graph->hasForced((*states)[j], (*dirs)[j]);
+            }
+        }
+    }
+    sink = forced;
+    return size_t(iterations)*states->size();
+}
+
+static size_t jumps(Graph::Ptr graph, GraphState::Ptr from, Direction dir, bool diagonal, int iterations){
+    size_t found = 0;
+    GraphState::Ptr jump;
+    double cost;
+    for(int i=0; i<iterations; i++){
+        if(diagonal)
+            found += graph->jumpDiagonally(from, dir, jump, cost, true);
+        else
+            found += graph->jumpHorizontallyVertically(from, dir, jump, cost, true);
+    }
+    sink = found;
+    return iterations;
+}
+
+/**
+ * @brief random search states, with g+h whole numbers so both open lists accept them
+ */
+static vector<SearchState::Ptr> randomStates(boost::random::mt19937& rng, size_t count){
+    vector<SearchState::Ptr> states(count);
+    boost::random::uniform_int_distribution<int> coordinate(0, 1 << 20);
+    boost::random::uniform_int_distribution<int> cost(1000, 1000000);
+    for(size_t i=0; i<count; i++){
+        states[i] = boost::make_shared<SearchState>();
+        states[i]->setGraphState(boost::make_shared<GraphState>(Cell(coordinate(rng), coordinate(rng))));
+        states[i]->g = cost(rng);
+        states[i]->h = 0;
+    }
+    return states;
+}
+
+static size_t openListPushPop(bool buckets, const vector<SearchState::Ptr>* states, int iterations){
+    size_t popped = 0;
+    for(int i=0; i<iterations; i++){
+        OpenList::Ptr list = buckets ? OpenList::Ptr(boost::make_shared<BucketOpenList>()) : OpenList::Ptr(boost::make_shared<BinaryHeapOpenList>());
+        for(size_t j=0; j<states->size(); j++)
+            list->push((*states)[j]);
+        while(!list->empty()){
+            list->pop();
+            popped++;
+        }
+    }
+    sink = popped;
+    return 2*popped;
+}
+
+static size_t openListDecreaseKey(bool buckets, const vector<SearchState::Ptr>* states, int iterations){
+    size_t decreased = 0;
+    for(int i=0; i<iterations; i++){
+        OpenList::Ptr list = buckets ? OpenList::Ptr(boost::make_shared<BucketOpenList>()) : OpenList::Ptr(boost::make_shared<BinaryHeapOpenList>());
+        vector<double> original(states->size());
+        for(size_t j=0; j<states->size(); j++){
+            original[j] = (*states)[j]->g;
+            list->push((*states)[j]);
+        }
+        //only the decreaseKey calls are counted, though filling the list is timed with them
+        //lower every 16th key by a fixed step, as a search does when it finds a shorter way
+        for(size_t j=0; j<states->size(); j+=16, decreased++){
+            (*states)[j]->g -= 500;
+            list->decreaseKey((*states)[j]);
+        }
+        for(size_t j=0; j<states->size(); j++)
+            (*states)[j]->g = original[j];
+    }
+    sink = decreased;
+    return decreased;
+}
+
+static size_t stateTable(const vector<SearchState::Ptr>* states, const vector<SearchState::Ptr>* misses, bool find, int iterations){
+    size_t found = 0, ops = 0;
+    for(int i=0; i<iterations; i++){
+        Planner::HashTable table;
+        for(size_t j=0; j<states->size(); j++)
+            table[(*states)[j]] = make_pair((*states)[j], true);
+        if(!find){
+            ops += states->size();
+            continue;
+        }
+        for(size_t j=0; j<states->size(); j++){
+            found += table.count((*states)[j]);
+            found += table.count((*misses)[j]);
+        }
+        ops += 2*states->size();
+    }
+    sink = found;
+    return ops;
+}
+
+static size_t unwinds(Planner* planner, SearchState::Ptr goal, size_t length, int iterations){
+    Path path;
+    for(int i=0; i<iterations; i++)
+        planner->unwind(goal, path);
+    sink = path.getWaypoints().size();
+    return size_t(iterations)*length;
+}
+
+static size_t interpolations(const Path* path, int iterations){
+    size_t cells = 0, checksum = 0;
+    for(int i=0; i<iterations; i++){
+        for(Path::CellIterator cell_it = path->cellsBegin(); cell_it != path->cellsEnd(); ++cell_it, cells++)
+            checksum += cell_it->x;
+    }
+    sink = checksum;
+    return cells;
+}
+
+/**
+ * @brief Microbenchmarks of the hot functions
+ *
+ * Every kernel runs on fixed inputs made from the seed, a few times; the
+ * fastest repetition is reported in nanoseconds per operation, with the
+ * hardware counters of that repetition per operation when perf_event_open
+ * is allowed.
+ */
+int main(int argc, char** argv){
+  namespace po = boost::program_options;
+  po::options_description desc("Microbenchmark Usage");
+  desc.add_options()
+    ("filter,f",po::value<string>()->default_value(""),"only run kernels whose name contains this")
+    ("reps,n",po::value<int>()->default_value(5),"repetitions per kernel, the fastest is reported")
+    ("scale,s",po::value<double>()->default_value(1),"multiplies the iterations of every kernel")
+    ("seed",po::value<unsigned int>()->default_value(1),"random seed for the inputs");
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  boost::random::mt19937 rng( vm["seed"].as<unsigned int>() );
+  vector<Kernel> kernels;
+
+  //collision checks on a random map: cells in rows, random cells on it, and cells far off it
+  const int MAP_SIZE = 1024;
+  Environment::Ptr random_env = makeEnvironment(randomObstacles(rng, MAP_SIZE, 0.3));
+  vector<Cell> row_cells, random_cells, outside_cells;
+  boost::random::uniform_int_distribution<int> on_map(0, MAP_SIZE-1), off_map(1 << 20, 1 << 24);
+  for(int i=0; i<4096; i++){
+    row_cells.push_back(Cell(i % MAP_SIZE, i / MAP_SIZE));
+    random_cells.push_back(Cell(on_map(rng), on_map(rng)));
+    outside_cells.push_back(Cell(off_map(rng), off_map(rng)));
+  }
+  Kernel kernel;
+  kernel.name = "isCollisionFree/row";
+  kernel.run = boost::bind(&collisionChecks, random_env, &row_cells, _1);
+  kernel.iterations = 100;
+  kernels.push_back(kernel);
+  kernel.name = "isCollisionFree/random";
+  kernel.run = boost::bind(&collisionChecks, random_env, &random_cells, _1);
+  kernels.push_back(kernel);
+  kernel.name = "isCollisionFree/outside";
+  kernel.run = boost::bind(&collisionChecks, random_env, &outside_cells, _1);
+  kernels.push_back(kernel);
+
+  //forced neighbour checks at random cells and directions of the same map
+  Graph::Ptr random_graph = boost::make_shared<Graph>(random_env, Cell(0,0), Cell(MAP_SIZE-1, MAP_SIZE-1));
+  vector<GraphState::Ptr> forced_states;
+  vector<Direction> forced_dirs;
+  boost::random::uniform_int_distribution<int> step(-1, 1);
+  while(forced_states.size() < 4096){
+    int dx = step(rng), dy = step(rng);
+    if(!dx && !dy)
+      continue;
+    forced_states.push_back(boost::make_shared<GraphState>(random_cells[forced_states.size()]));
+    forced_dirs.push_back(Cell(dx, dy) - Cell(0, 0));
+  }
+  kernel.name = "hasForced";
+  kernel.run = boost::bind(&forcedChecks, random_graph, &forced_states, &forced_dirs, false, _1);
+  kernel.iterations = 20;
+  kernels.push_back(kernel);
+  kernel.name = "getForced";
+  kernel.run = boost::bind(&forcedChecks, random_graph, &forced_states, &forced_dirs, true, _1);
+  kernels.push_back(kernel);
+
+  //jumps along corridors and across empty rooms; the goal is off the way so nothing shortcuts to it
+  const int LENGTHS[] = {16, 256, 4096};
+  const int STRAIGHT_ITERATIONS[] = {10000, 750, 50};
+  const int DIAGONAL_ITERATIONS[] = {4000, 200, 2};
+  for(int i=0; i<3; i++){
+    int length = LENGTHS[i];
+    char name[64];
+    Environment::Ptr corridor_env = makeEnvironment(corridor(length));
+    Graph::Ptr corridor_graph = boost::make_shared<Graph>(corridor_env, Cell(0,0), Cell(-1000,-1000));
+    snprintf(name, sizeof(name), "jumpHorizontallyVertically/%d", length);
+    kernel.name = name;
+    kernel.run = boost::bind(&jumps, corridor_graph, boost::make_shared<GraphState>(Cell(0,0)), Cell(1,0) - Cell(0,0), false, _1);
+    kernel.iterations = STRAIGHT_ITERATIONS[i];
+    kernels.push_back(kernel);
+
+    Environment::Ptr room_env = makeEnvironment(room(length));
+    Graph::Ptr room_graph = boost::make_shared<Graph>(room_env, Cell(0,0), Cell(length, length));
+    snprintf(name, sizeof(name), "jumpDiagonally/%d", length);
+    kernel.name = name;
+    kernel.run = boost::bind(&jumps, room_graph, boost::make_shared<GraphState>(Cell(0,0)), Cell(1,1) - Cell(0,0), true, _1);
+    kernel.iterations = DIAGONAL_ITERATIONS[i];
+    kernels.push_back(kernel);
+  }
+
+  //open lists and the closed list on random states
+  vector<SearchState::Ptr> states = randomStates(rng, 10000);
+  vector<SearchState::Ptr> missing = randomStates(rng, 10000);
+  vector<SearchState::Ptr> few_states(states.begin(), states.begin() + 1000);
+  kernel.iterations = 5;
+  kernel.name = "BinaryHeapOpenList/push+pop";
+  kernel.run = boost::bind(&openListPushPop, false, &states, _1);
+  kernels.push_back(kernel);
+  kernel.name = "BucketOpenList/push+pop";
+  kernel.run = boost::bind(&openListPushPop, true, &states, _1);
+  kernels.push_back(kernel);
+  kernel.name = "BinaryHeapOpenList/decreaseKey";
+  kernel.run = boost::bind(&openListDecreaseKey, false, &few_states, _1);
+  kernel.iterations = 20;
+  kernels.push_back(kernel);
+  kernel.name = "BucketOpenList/decreaseKey";
+  kernel.run = boost::bind(&openListDecreaseKey, true, &few_states, _1);
+  kernels.push_back(kernel);
+  kernel.name = "HashTable/insert";
+  kernel.run = boost::bind(&stateTable, &states, &missing, false, _1);
+  kernels.push_back(kernel);
+  kernel.name = "HashTable/find";
+  kernel.run = boost::bind(&stateTable, &states, &missing, true, _1);
+  kernels.push_back(kernel);
+
+  //unwinding a chain of states, and walking the cells of the path it gives
+  const size_t CHAIN = 1000;
+  SearchState::Ptr chain;
+  for(size_t i=0; i<CHAIN; i++){
+    SearchState::Ptr next = boost::make_shared<SearchState>();
+    next->setGraphState(boost::make_shared<GraphState>(Cell(int(i)*10, int(i%2)*10)));
+    next->parent_ = chain;
+    chain = next;
+  }
+  Planner planner(random_env, random_graph);
+  planner.setVerbose(false);
+  Path unwound;
+  planner.unwind(chain, unwound);
+  kernel.name = "Planner::unwind";
+  kernel.run = boost::bind(&unwinds, &planner, chain, CHAIN, _1);
+  kernel.iterations = 50;
+  kernels.push_back(kernel);
+  kernel.name = "Path::CellIterator";
+  kernel.run = boost::bind(&interpolations, &unwound, _1);
+  kernel.iterations = 10;
+  kernels.push_back(kernel);
+
+  PerfCounters counters;
+  if(!counters.available())
+    printf("Hardware counters are not available here, only times are reported\n");
+  printf("%-32s %12s %10s %10s %10s %10s\n", "kernel", "ns/op", "cycles/op", "instr/op", "cmiss/op", "bmiss/op");
+  string filter = vm["filter"].as<string>();
+  int reps = max(1, vm["reps"].as<int>());
+  for(size_t k=0; k<kernels.size(); k++){
+    if(kernels[k].name.find(filter) == string::npos)
+      continue;
+    int iterations = max(1, int(kernels[k].iterations * vm["scale"].as<double>()));
+    kernels[k].run(1);
+    double best_ns = -1;
+    double best_counts[PerfCounters::NUM_COUNTERS];
+    for(int rep=0; rep<reps; rep++){
+      double counts[PerfCounters::NUM_COUNTERS];
+      counters.start();
+      Clock::time_point begin = Clock::now();
+      size_t ops = kernels[k].run(iterations);
+      double ns = boost::chrono::duration<double, boost::nano>(Clock::now() - begin).count();
+      counters.stop(counts);
+      ops = max(ops, size_t(1));
+      if(best_ns < 0 || ns/ops < best_ns){
+        best_ns = ns/ops;
+        for(int c=0; c<PerfCounters::NUM_COUNTERS; c++)
+          best_counts[c] = counts[c] < 0 ? -1 : counts[c]/ops;
+      }
+    }
+    printf("%-32s %12.1f", kernels[k].name.c_str(), best_ns);
+    for(int c=0; c<PerfCounters::NUM_COUNTERS; c++){
+      if(best_counts[c] < 0)
+        printf(" %10s", "-");
+      else
+        printf(" %10.2f", best_counts[c]);
+    }
+    printf("\n");
+  }
+  return 0;
+}
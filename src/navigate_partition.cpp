@@ -0,0 +1,296 @@
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <boost/chrono.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/program_options.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "navi_example/Environment.h"
+#include "navi_example/Graph.h"
+#include "navi_example/LatencyHistogram.h"
+#include "navi_example/MapRenderer.h"
+#include "navi_example/PartitionCoordinator.h"
+#include "navi_example/PartitionWorker.h"
+#include "navi_example/Planner.h"
+#include "navi_example/QueryStats.h"
+#include "navi_example/TileStore.h"
+
+using namespace std;
+
+typedef boost::chrono::steady_clock Clock;
+
+/**
+ * @brief reads X0,Y0,X1,Y1
+ */
+static bool parseWindow(const string& text, pair<Cell, Cell>& window){
+    return sscanf(text.c_str(), "%d,%d,%d,%d", &window.first.x, &window.first.y, &window.second.x, &window.second.y) == 4 &&
+           window.first.x <= window.second.x && window.first.y <= window.second.y;
+}
+
+/**
+ * @brief the cells worth partitioning: the tiles of a tile file or the obstacles of a map, with a free ring around them
+ */
+static pair<Cell, Cell> findMapWindow(Environment::Ptr env){
+    MapSnapshot::ConstPtr snapshot = env->getSnapshot();
+    TileStore::Ptr store = snapshot->getStore();
+    if(!store || store->getMinTile().x > store->getMaxTile().x)
+        return MapRenderer::findWindow(*snapshot, Path(), *env->getStart(), *env->getGoal());
+    //only the tile index is needed, no tile is read
+    Cell low(min(env->getStart()->x, env->getGoal()->x), min(env->getStart()->y, env->getGoal()->y));
+    Cell high(max(env->getStart()->x, env->getGoal()->x), max(env->getStart()->y, env->getGoal()->y));
+    low = Cell(min(low.x, store->getMinTile().x << ObstacleTile::BITS), min(low.y, store->getMinTile().y << ObstacleTile::BITS));
+    high = Cell(max(high.x, ((store->getMaxTile().x+1) << ObstacleTile::BITS) - 1), max(high.y, ((store->getMaxTile().y+1) << ObstacleTile::BITS) - 1));
+    return make_pair(Cell(low.x-1, low.y-1), Cell(high.x+1, high.y+1));
+}
+
+/**
+ * @brief loads a map, reading a tile file only as far as the tiles of a window
+ */
+static Environment::Ptr loadMap(const string& file, const pair<Cell, Cell>* window){
+    Environment::Ptr env = boost::make_shared<Environment>();
+    env->setVerbose(false);
+    if(TileStore::isTileFile(file)){
+        //the partition, the ring of tiles its fence reads and some slack
+        size_t tiles = 4096;
+        if(window)
+            tiles = size_t((window->second.x - window->first.x)/ObstacleTile::SIZE + 4) * ((window->second.y - window->first.y)/ObstacleTile::SIZE + 4);
+        if(!env->loadTiles(file, tiles*sizeof(ObstacleTile)))
+            return Environment::Ptr();
+    }
+    else{
+        ifstream json(file.c_str());
+        env->readDescription(json);
+    }
+    return env;
+}
+
+/**
+ * @brief runs one partition worker: precomputes its distances, then serves them
+ */
+static int runWorker(const string& file, const pair<Cell, Cell>& window, int port, int threads){
+    Environment::Ptr env = loadMap(file, &window);
+    if(!env)
+        return 1;
+    PartitionWorker worker(env, window.first, window.second);
+    Clock::time_point begin = Clock::now();
+    worker.precompute(threads);
+    size_t count = worker.getTransitions().size(), connected = 0;
+    for(size_t i=0; i<count; i++){
+        for(size_t j=i+1; j<count; j++)
+            connected += worker.getDistance(i, j) >= 0;
+    }
+    TileStore::Ptr store = env->getSnapshot()->getStore();
+    printf("Partition (%d,%d)-(%d,%d): %zu transitions, %zu connected pairs in %.1f ms, %zu tiles read; serving on port %d\n",
+           window.first.x, window.first.y, window.second.x, window.second.y, count, connected, QueryStats::millisecondsSince(begin),
+           store ? store->getStats().faults : size_t(0), port);
+    fflush(stdout);
+    return worker.serve(port) ? 0 : 1;
+}
+
+/**
+ * @brief Distributed planning over partition worker processes
+ *
+ * With --worker, serves one partition of a map as a PartitionWorker. Else
+ * splits the map into squares, starts a worker process per square on
+ * loopback ports (or uses the workers given with --connect, which may run
+ * on other machines), builds the boundary graph from what they precomputed
+ * and plans the map's own query and -n random ones through it. --check
+ * plans every query on the whole map too and compares the costs.
+ */
+int main(int argc, char** argv){
+  namespace po = boost::program_options;
+  po::options_description desc("Partitioned Planning Usage");
+  desc.add_options()
+    ("env,e",po::value<string>()->required(),"input environment json or tile file; tile files keep each worker to its partition's tiles")
+    ("worker","serve the partition given by --window on --port")
+    ("window,w",po::value<string>(),"the partition of a worker as X0,Y0,X1,Y1")
+    ("port,p",po::value<int>()->default_value(7400),"port of a worker, or the first port of the workers started")
+    ("size",po::value<int>()->default_value(512),"side of the partitions to start workers for")
+    ("connect",po::value<string>(),"HOST:PORT,... of running workers to use instead of starting them")
+    ("queries,n",po::value<int>()->default_value(0),"random queries to plan after the map's own")
+    ("seed,s",po::value<unsigned int>()->default_value(1),"random seed for the queries")
+    ("check","also plan every query on the whole map and compare the costs")
+    ("timeout",po::value<double>()->default_value(600),"seconds to wait for the workers to be ready")
+    ("threads,t",po::value<int>()->default_value(int(boost::thread::hardware_concurrency())),"threads precomputing each partition");
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  string file = vm["env"].as<string>();
+  if(!boost::filesystem::exists(file)){
+    printf("File \"%s\" does not exist to be read!\n", file.c_str());
+    return 1;
+  }
+  int threads = max(1, vm["threads"].as<int>());
+  if(vm.count("worker")){
+    pair<Cell, Cell> window;
+    if(!vm.count("window") || !parseWindow(vm["window"].as<string>(), window)){
+      printf("A worker needs its partition as --window X0,Y0,X1,Y1\n");
+      return 1;
+    }
+    return runWorker(file, window, vm["port"].as<int>(), threads);
+  }
+
+  Environment::Ptr env = loadMap(file, NULL);
+  if(!env)
+    return 1;
+  pair<Cell, Cell> window = findMapWindow(env);
+
+  //the workers to use, started here unless given
+  vector<pair<string, int> > addresses;
+  vector<pid_t> children;
+  if(vm.count("connect")){
+    stringstream list(vm["connect"].as<string>());
+    string address;
+    while(getline(list, address, ',')){
+      size_t colon = address.rfind(':');
+      if(colon == string::npos){
+        printf("Worker \"%s\" is not HOST:PORT\n", address.c_str());
+        return 1;
+      }
+      addresses.push_back(make_pair(address.substr(0, colon), atoi(address.substr(colon+1).c_str())));
+    }
+  }
+  else{
+    int size = max(int(ObstacleTile::SIZE), vm["size"].as<int>());
+    int port = vm["port"].as<int>();
+    //as few partitions as fit the side, all about the same size
+    int width = window.second.x - window.first.x + 1, height = window.second.y - window.first.y + 1;
+    int columns = (width + size-1)/size, rows = (height + size-1)/size;
+    vector<pair<Cell, Cell> > partitions;
+    for(int row=0; row<rows; row++){
+      for(int column=0; column<columns; column++){
+        partitions.push_back(make_pair(Cell(window.first.x + column*width/columns, window.first.y + row*height/rows),
+                                       Cell(window.first.x + (column+1)*width/columns - 1, window.first.y + (row+1)*height/rows - 1)));
+      }
+    }
+    int worker_threads = max(1, threads/int(partitions.size()));
+    for(size_t i=0; i<partitions.size(); i++){
+      ostringstream partition, worker_port, worker_threads_text;
+      partition << partitions[i].first.x << "," << partitions[i].first.y << "," << partitions[i].second.x << "," << partitions[i].second.y;
+      worker_port << port + int(i);
+      worker_threads_text << worker_threads;
+      pid_t pid = fork();
+      if(pid == 0){
+        execl("/proc/self/exe", argv[0], "-e", file.c_str(), "--worker", "-w", partition.str().c_str(),
+              "-p", worker_port.str().c_str(), "-t", worker_threads_text.str().c_str(), (char*)NULL);
+        _exit(127);
+      }
+      if(pid < 0){
+        printf("Could not start a worker\n");
+        break;
+      }
+      children.push_back(pid);
+      addresses.push_back(make_pair(string("127.0.0.1"), port + int(i)));
+    }
+    printf("Started %zu workers for (%d,%d)-(%d,%d) in %dx%d partitions on ports %d-%d\n", children.size(),
+           window.first.x, window.first.y, window.second.x, window.second.y, columns, rows, port, port + int(children.size()) - 1);
+    fflush(stdout);
+  }
+
+  int status = 0;
+  PartitionCoordinator coordinator;
+  Clock::time_point begin = Clock::now();
+  for(size_t i=0; i<addresses.size() && status == 0; i++){
+    if(!coordinator.addWorker(addresses[i].first, addresses[i].second, vm["timeout"].as<double>()))
+      status = 1;
+  }
+  if(status == 0){
+    printf("Boundary graph of %zu partitions: %zu nodes, %zu edges, ready in %.1f ms\n", coordinator.getNumWorkers(),
+           coordinator.getNumNodes(), coordinator.getNumEdges(), QueryStats::millisecondsSince(begin));
+
+    //the map's query, then random free cells of the window
+    vector<pair<Cell, Cell> > queries(1, make_pair(*env->getStart(), *env->getGoal()));
+    boost::random::mt19937 rng(vm["seed"].as<unsigned int>());
+    boost::random::uniform_int_distribution<int> pick_x(window.first.x, window.second.x), pick_y(window.first.y, window.second.y);
+    MapSnapshot::ConstPtr snapshot = env->getSnapshot();
+    while(int(queries.size()) <= vm["queries"].as<int>()){
+      Cell start(pick_x(rng), pick_y(rng)), goal(pick_x(rng), pick_y(rng));
+      if(snapshot->isCollisionFree(start) && snapshot->isCollisionFree(goal))
+        queries.push_back(make_pair(start, goal));
+    }
+
+    LatencyHistogram latencies;
+    int found = 0, direct = 0, compared = 0;
+    double worst_ratio = 1, total_cost = 0, total_optimal = 0;
+    for(size_t i=0; i<queries.size(); i++){
+      Path path;
+      begin = Clock::now();
+      bool result = coordinator.plan(queries[i].first, queries[i].second, path);
+      double elapsed = QueryStats::millisecondsSince(begin);
+      latencies.record(boost::uint64_t(elapsed*1e6));
+      found += result;
+      direct += coordinator.getStats().direct;
+      if(i == 0){
+        printf("(%d, %d) to (%d, %d): %s", queries[i].first.x, queries[i].first.y, queries[i].second.x, queries[i].second.y,
+               result ? "" : "no plan found");
+        if(result)
+          printf("cost %.4f, %zu waypoints", path.cost(), path.getWaypoints().size());
+        printf(" in %.1f ms\n", elapsed);
+        cout << "Stats: " << coordinator.getStats() << endl;
+      }
+      if(!vm.count("check"))
+        continue;
+      //the joined segments must make one path of free cells
+      const vector<Cell>& waypoints = path.getWaypoints();
+      for(size_t j=0; result && j<waypoints.size(); j++){
+        bool straight = j == 0 || waypoints[j].x == waypoints[j-1].x || waypoints[j].y == waypoints[j-1].y ||
+                        abs(waypoints[j].x - waypoints[j-1].x) == abs(waypoints[j].y - waypoints[j-1].y);
+        if(!straight){
+          printf("(%d, %d) to (%d, %d): waypoints (%d, %d) and (%d, %d) are not in line\n", queries[i].first.x, queries[i].first.y,
+                 queries[i].second.x, queries[i].second.y, waypoints[j-1].x, waypoints[j-1].y, waypoints[j].x, waypoints[j].y);
+          status = 1;
+          result = false;
+        }
+      }
+      for(Path::CellIterator cell_it = path.cellsBegin(); result && cell_it != path.cellsEnd(); ++cell_it){
+        if(!snapshot->isCollisionFree(*cell_it)){
+          printf("(%d, %d) to (%d, %d): the path crosses the obstacle at (%d, %d)\n", queries[i].first.x, queries[i].first.y,
+                 queries[i].second.x, queries[i].second.y, cell_it->x, cell_it->y);
+          status = 1;
+          result = false;
+        }
+      }
+      Path optimal;
+      Graph::Ptr graph = boost::make_shared<Graph>(env, queries[i].first, queries[i].second);
+      Planner planner(env, graph);
+      planner.setVerbose(false);
+      bool optimal_found = planner.plan(optimal);
+      if(optimal_found != result){
+        printf("(%d, %d) to (%d, %d): partitioned %s, whole map %s\n", queries[i].first.x, queries[i].first.y,
+               queries[i].second.x, queries[i].second.y, result ? "found" : "not found", optimal_found ? "found" : "not found");
+        status = 1;
+        continue;
+      }
+      if(!result)
+        continue;
+      compared++;
+      total_cost += path.cost();
+      total_optimal += optimal.cost();
+      worst_ratio = max(worst_ratio, path.cost()/max(optimal.cost(), 1e-9));
+    }
+    printf("%zu queries, %d found, %d within one partition; p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", queries.size(), found, direct,
+           latencies.getValueAtPercentile(50)/1e6, latencies.getValueAtPercentile(99)/1e6, latencies.getMax()/1e6);
+    if(compared)
+      printf("Cost against the whole map: %.4f overall, %.4f worst query\n", total_cost/max(total_optimal, 1e-9), worst_ratio);
+  }
+
+  for(size_t i=0; i<children.size(); i++)
+    kill(children[i], SIGTERM);
+  for(size_t i=0; i<children.size(); i++)
+    waitpid(children[i], NULL, 0);
+  return status;
+}
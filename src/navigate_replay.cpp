@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/chrono.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/program_options.hpp>
+#include <boost/random/exponential_distribution.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "navi_example/Environment.h"
+#include "navi_example/Graph.h"
+#include "navi_example/LatencyHistogram.h"
+#include "navi_example/MapRenderer.h"
+#include "navi_example/Planner.h"
+#include "navi_example/TileStore.h"
+
+using namespace std;
+
+typedef boost::chrono::steady_clock Clock;
+
+/**
+ * @brief one line of a query log
+ */
+struct Query{
+    /**
+     * @brief when the query arrived, in milliseconds from any fixed point
+     */
+    double arrival_ms;
+    string map;
+    Cell start;
+    Cell goal;
+};
+
+/**
+ * @brief what one replay thread measured
+ */
+struct WorkerResult{
+    /**
+     * @brief microseconds from when the query was due until it was answered
+     */
+    LatencyHistogram response;
+    /**
+     * @brief microseconds from when the query was taken up until it was answered
+     */
+    LatencyHistogram service;
+    size_t found;
+    size_t not_found;
+    size_t errors;
+    Clock::time_point last_done;
+};
+
+/**
+ * @brief the replay shared by all threads
+ */
+struct Replay{
+    vector<Query> queries;
+    /**
+     * @brief when each query is due, in the same order
+     */
+    vector<Clock::time_point> due;
+    boost::unordered_map<string, Environment::Ptr> maps;
+    int radius;
+    bool fixed_point;
+    /**
+     * @brief next query to take up, guarded by mutex
+     */
+    size_t next;
+    boost::mutex mutex;
+};
+
+static double microseconds(Clock::duration duration){
+    return boost::chrono::duration<double, boost::micro>(duration).count();
+}
+
+/**
+ * @brief reads "arrival_ms map sx sy gx gy" lines, skipping blank lines and # comments
+ * @return false if a line cannot be read
+ */
+static bool readLog(const string& filename, vector<Query>& queries){
+    ifstream log(filename.c_str());
+    if(!log){
+        printf("File \"%s\" does not exist to be read!\n", filename.c_str());
+        return false;
+    }
+    string line;
+    for(int number=1; getline(log, line); number++){
+        if(line.find_first_not_of(" \t\r") == string::npos || line[line.find_first_not_of(" \t")] == '#')
+            continue;
+        istringstream fields(line);
+        Query query;
+        if(!(fields >> query.arrival_ms >> query.map >> query.start.x >> query.start.y >> query.goal.x >> query.goal.y)){
+            printf("Line %d of \"%s\" is not \"arrival_ms map sx sy gx gy\"\n", number, filename.c_str());
+            return false;
+        }
+        queries.push_back(query);
+    }
+    //replayed in arrival order, whatever order they were logged in
+    stable_sort(queries.begin(), queries.end(), boost::bind(&Query::arrival_ms, _1) < boost::bind(&Query::arrival_ms, _2));
+    return true;
+}
+
+/**
+ * @brief writes a log of random queries between free cells of the maps, arriving as a Poisson process
+ */
+static bool writeLog(const string& filename, const boost::unordered_map<string, Environment::Ptr>& maps, int count, double rate, unsigned int seed){
+    ofstream log(filename.c_str());
+    if(!log){
+        printf("File \"%s\" could not be opened for writing!\n", filename.c_str());
+        return false;
+    }
+    boost::random::mt19937 rng(seed);
+    boost::random::exponential_distribution<double> gap(rate/1000);
+    vector<string> names;
+    for(boost::unordered_map<string, Environment::Ptr>::const_iterator map_it = maps.begin(); map_it != maps.end(); ++map_it)
+        names.push_back(map_it->first);
+    sort(names.begin(), names.end());
+    boost::random::uniform_int_distribution<size_t> pick(0, names.size()-1);
+
+    log << "# arrival_ms map sx sy gx gy\n";
+    double arrival_ms = 0;
+    for(int i=0; i<count; i++){
+        const string& name = names[pick(rng)];
+        Environment::Ptr env = maps.find(name)->second;
+        //anywhere around the obstacles and the map's own start and goal
+        MapSnapshot::ConstPtr snapshot = env->getSnapshot();
+        pair<Cell, Cell> window = MapRenderer::findWindow(*snapshot, Path(), *env->getStart(), *env->getGoal());
+        boost::random::uniform_int_distribution<int> x(window.first.x, window.second.x), y(window.first.y, window.second.y);
+        Cell ends[2];
+        for(int end=0; end<2; end++){
+            do{
+                ends[end] = Cell(x(rng), y(rng));
+            } while(!snapshot->isCollisionFree(ends[end]));
+        }
+        char line[128];
+        snprintf(line, sizeof(line), "%.3f %s %d %d %d %d\n", arrival_ms, name.c_str(), ends[0].x, ends[0].y, ends[1].x, ends[1].y);
+        log << line;
+        arrival_ms += gap(rng);
+    }
+    log.close();
+    return !log.fail();
+}
+
+/**
+ * @brief replay thread: answers the next query once it is due, until none are left
+ *
+ * The load is open loop: queries are due at their own time whether or not
+ * earlier ones were answered, and the response time counts from then. A
+ * query that waits because every thread is busy is therefore charged for
+ * the wait, rather than the wait being left out as a closed loop does.
+ */
+static void replayQueries(Replay* replay, WorkerResult* result){
+    while(true){
+        size_t i;
+        {
+            boost::mutex::scoped_lock lock(replay->mutex);
+            i = replay->next++;
+        }
+        if(i >= replay->queries.size())
+            return;
+        const Query& query = replay->queries[i];
+        boost::this_thread::sleep_until(replay->due[i]);
+        Clock::time_point began = Clock::now();
+
+        boost::unordered_map<string, Environment::Ptr>::const_iterator map_it = replay->maps.find(query.map);
+        if(map_it == replay->maps.end()){
+            result->errors++;
+            continue;
+        }
+        Graph::Ptr graph = boost::make_shared<Graph>(map_it->second, query.start, query.goal);
+        if(replay->fixed_point)
+            graph->setCostMode(Graph::FIXED_POINT);
+        graph->setRadius(replay->radius);
+        Planner planner(map_it->second, graph);
+        planner.setVerbose(false);
+        Path path;
+        if(planner.plan(path))
+            result->found++;
+        else
+            result->not_found++;
+
+        result->last_done = Clock::now();
+        result->response.record(microseconds(result->last_done - replay->due[i]));
+        result->service.record(microseconds(result->last_done - began));
+    }
+}
+
+static void printLatencies(const string& name, const LatencyHistogram& histogram){
+    printf("%-10s %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n", name.c_str(),
+           histogram.getMin()/1e3, histogram.getValueAtPercentile(50)/1e3, histogram.getValueAtPercentile(90)/1e3,
+           histogram.getValueAtPercentile(99)/1e3, histogram.getValueAtPercentile(99.9)/1e3,
+           histogram.getMax()/1e3, histogram.getMean()/1e3);
+}
+
+/**
+ * @brief Query log replay
+ *
+ * Loads the maps once, then plans the queries of a log on several threads
+ * sharing them, each query starting when it is due: at its logged arrival
+ * time divided by --speed, or at a fixed --rate. Reports the throughput and
+ * the percentiles of the response time, counted from when a query was due,
+ * and of the service time, counted from when a thread took it up. The two
+ * differ by the time queries waited for a free thread.
+ */
+int main(int argc, char** argv){
+  namespace po = boost::program_options;
+  po::options_description desc("Query Log Replay Usage");
+  desc.add_options()
+    ("env,e",po::value<vector<string> >()->required(),"[NAME=]FILE map the log refers to by NAME, the file name by default")
+    ("log,l",po::value<string>(),"query log of \"arrival_ms map sx sy gx gy\" lines")
+    ("threads,t",po::value<int>()->default_value(int(boost::thread::hardware_concurrency())),"threads planning queries")
+    ("speed,s",po::value<double>()->default_value(1),"replay this many times faster than logged")
+    ("rate",po::value<double>(),"ignore the logged times and start this many queries per second")
+    ("radius,r",po::value<int>()->default_value(0),"robot radius in cells; obstacles are inflated by it")
+    ("fixed-point,f","plan with integer octile costs and a bucket open list")
+    ("histogram",po::value<string>(),"write the response time percentiles to this file in HdrHistogram's text format, in ms")
+    ("make-log",po::value<string>(),"write a log of random queries to this file instead, arriving at --rate per second (default 100)")
+    ("count,n",po::value<int>()->default_value(1000),"number of queries of a made log")
+    ("seed",po::value<unsigned int>()->default_value(1),"random seed of a made log");
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  //load every map once; all threads plan on the same Environment
+  Replay replay;
+  replay.radius = vm["radius"].as<int>();
+  replay.fixed_point = vm.count("fixed-point");
+  BOOST_FOREACH( const string& named_file, vm["env"].as<vector<string> >() ){
+    size_t equals = named_file.find('=');
+    boost::filesystem::path file( equals == string::npos ? named_file : named_file.substr(equals+1) );
+    if(!boost::filesystem::exists(file)){
+      printf("File \"%s\" does not exist to be read!\n", file.string().c_str());
+      return 1;
+    }
+    Environment::Ptr env = boost::make_shared<Environment>();
+    env->setVerbose(false);
+    if(TileStore::isTileFile(file.string())){
+      if(!env->loadTiles(file.string(), size_t(64)*1024*1024))
+        return 1;
+    }
+    else{
+      ifstream json(file.string().c_str());
+      env->readDescription(json);
+    }
+    if(replay.radius > 0)
+      env->setClearanceRadii(vector<int>(1, replay.radius));
+    replay.maps[equals == string::npos ? file.stem().string() : named_file.substr(0, equals)] = env;
+  }
+
+  if(vm.count("make-log")){
+    double rate = vm.count("rate") ? vm["rate"].as<double>() : 100;
+    if(!writeLog(vm["make-log"].as<string>(), replay.maps, vm["count"].as<int>(), rate, vm["seed"].as<unsigned int>()))
+      return 1;
+    printf("Wrote %d queries at %.1f per second to %s\n", vm["count"].as<int>(), rate, vm["make-log"].as<string>().c_str());
+    return 0;
+  }
+  if(!vm.count("log")){
+    printf("Nothing to replay, give a query log with -l or make one with --make-log\n");
+    return 1;
+  }
+  if(!readLog(vm["log"].as<string>(), replay.queries))
+    return 1;
+  if(replay.queries.empty()){
+    printf("The log has no queries\n");
+    return 1;
+  }
+
+  //schedule every query up front, a little ahead so the threads are waiting for the first
+  int threads = max(1, vm["threads"].as<int>());
+  double speed = vm["speed"].as<double>();
+  Clock::time_point begin = Clock::now() + boost::chrono::milliseconds(10);
+  for(size_t i=0; i<replay.queries.size(); i++){
+    double offset_us = vm.count("rate") ? i*1e6/vm["rate"].as<double>() : (replay.queries[i].arrival_ms - replay.queries[0].arrival_ms)*1e3/speed;
+    replay.due.push_back(begin + boost::chrono::duration_cast<Clock::duration>(boost::chrono::duration<double, boost::micro>(offset_us)));
+  }
+  replay.next = 0;
+
+  vector<WorkerResult> results(threads);
+  boost::thread_group workers;
+  for(int i=0; i<threads; i++){
+    results[i].found = results[i].not_found = results[i].errors = 0;
+    results[i].last_done = begin;
+    workers.create_thread(boost::bind(&replayQueries, &replay, &results[i]));
+  }
+  workers.join_all();
+
+  WorkerResult total;
+  total.found = total.not_found = total.errors = 0;
+  total.last_done = begin;
+  for(int i=0; i<threads; i++){
+    total.response.merge(results[i].response);
+    total.service.merge(results[i].service);
+    total.found += results[i].found;
+    total.not_found += results[i].not_found;
+    total.errors += results[i].errors;
+    total.last_done = max(total.last_done, results[i].last_done);
+  }
+
+  double elapsed = boost::chrono::duration<double>(total.last_done - begin).count();
+  double offered = boost::chrono::duration<double>(replay.due.back() - begin).count();
+  size_t answered = total.found + total.not_found;
+  printf("Replayed %zu queries on %d %s in %.3f s: %.1f queries/s (offered %.1f/s)\n", replay.queries.size(), threads,
+         threads == 1 ? "thread" : "threads", elapsed, answered/max(elapsed, 1e-9), replay.queries.size()/max(offered, 1e-9));
+  printf("%zu found, %zu without a path", total.found, total.not_found);
+  if(total.errors)
+    printf(", %zu on unknown maps", total.errors);
+  printf("\n%-10s %10s %10s %10s %10s %10s %10s %10s\n", "ms", "min", "p50", "p90", "p99", "p99.9", "max", "mean");
+  printLatencies("response", total.response);
+  printLatencies("service", total.service);
+
+  if(vm.count("histogram")){
+    ofstream histogram(vm["histogram"].as<string>().c_str());
+    total.response.writePercentiles(histogram, 1e3);
+    if(!histogram){
+      printf("File \"%s\" could not be written!\n", vm["histogram"].as<string>().c_str());
+      return 1;
+    }
+  }
+  return total.errors ? 1 : 0;
+}
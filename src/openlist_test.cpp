@@ -0,0 +1,87 @@
+#include <cstdio>
+#include <vector>
+
+#include <boost/make_shared.hpp>
+
+#include "navi_example/OpenList.h"
+#include "navi_example/SearchState.h"
+
+using namespace std;
+
+/**
+ * @brief a state at its own cell with the given g+h
+ */
+static SearchState::Ptr makeState(int x, double f){
+    SearchState::Ptr state = boost::make_shared<SearchState>();
+    state->setGraphState(boost::make_shared<GraphState>(Cell(x, 0)));
+    state->g = f;
+    state->h = 0;
+    return state;
+}
+
+static int failures = 0;
+
+static void expect(bool ok, const char* list, const char* what){
+    if(!ok){
+        printf("FAILED %s: %s\n", list, what);
+        failures++;
+    }
+}
+
+/**
+ * @brief removeWorst on a list without outdated entries: f = {5, 1, 9, 3} gives 9, then 5
+ */
+static void checkLargestKey(OpenList::Ptr list, const char* name){
+    double keys[] = {5, 1, 9, 3};
+    for(int i=0; i<4; i++)
+        list->push(makeState(i, keys[i]));
+    SearchState::Ptr worst = list->removeWorst();
+    expect(worst && worst->g == 9, name, "removeWorst of {5, 1, 9, 3} is 9");
+    worst = list->removeWorst();
+    expect(worst && worst->g == 5, name, "removeWorst of {5, 1, 3} is 5");
+    expect(list->size() == 2, name, "two states left after two removeWorst");
+    expect(list->pop()->g == 1, name, "pop after removeWorst gives the smallest key");
+}
+
+/**
+ * @brief removeWorst after decreaseKey left outdated entries behind
+ *
+ * A at 300, B at 400, C at 500, D at 450 and E at 510, then A lowered to
+ * 260 and E removed as the worst, then A lowered again to 250: the bucket
+ * list holds [A260 outdated, B400, C500, D450, A250], with the key of E
+ * just past its end. removeWorst must give C, D, B and A, never an empty
+ * pointer while states are live.
+ */
+static void checkOutdatedEntries(OpenList::Ptr list, const char* name){
+    SearchState::Ptr a = makeState(0, 300);
+    list->push(a);
+    list->push(makeState(1, 400));
+    list->push(makeState(2, 500));
+    list->push(makeState(3, 450));
+    list->push(makeState(4, 510));
+    a->g = 260;
+    list->decreaseKey(a);
+    SearchState::Ptr worst = list->removeWorst();
+    expect(worst && worst->g == 510, name, "removeWorst gives the largest key past an outdated entry");
+    a->g = 250;
+    list->decreaseKey(a);
+    double expected[] = {500, 450, 400, 250};
+    for(int i=0; i<4; i++){
+        worst = list->removeWorst();
+        expect(bool(worst), name, "removeWorst gives a state while states are live");
+        if(!worst)
+            return;
+        expect(worst->g == expected[i], name, "removeWorst skips outdated entries and gives the largest key");
+    }
+    expect(list->empty(), name, "empty after removing every live state");
+}
+
+int main(int argc, char** argv){
+    checkLargestKey(boost::make_shared<BinaryHeapOpenList>(), "BinaryHeapOpenList");
+    checkLargestKey(boost::make_shared<BucketOpenList>(), "BucketOpenList");
+    checkOutdatedEntries(boost::make_shared<BinaryHeapOpenList>(), "BinaryHeapOpenList");
+    checkOutdatedEntries(boost::make_shared<BucketOpenList>(), "BucketOpenList");
+    if(failures == 0)
+        printf("All open list checks passed\n");
+    return failures == 0 ? 0 : 1;
+}
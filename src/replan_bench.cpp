@@ -0,0 +1,256 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/chrono.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/program_options.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+
+#include "navi_example/Environment.h"
+#include "navi_example/Graph.h"
+#include "navi_example/Planner.h"
+#include "navi_example/DStarLite.h"
+#include "navi_example/MapRenderer.h"
+#include "navi_example/PathIndex.h"
+#include "navi_example/QueryStats.h"
+
+using namespace std;
+
+typedef boost::chrono::steady_clock Clock;
+
+/**
+ * @brief plans from scratch with Jump Point Search
+ * @return the path cost, or -1 if no path was found
+ */
+static double planFromScratch(Environment::Ptr env, const Cell& start, const Cell& goal, double& milliseconds){
+    Clock::time_point begin = Clock::now();
+    Graph::Ptr graph = boost::make_shared<Graph>(env, start, goal);
+    Planner planner(env, graph);
+    planner.setVerbose(false);
+    Path path;
+    bool found = planner.plan(path);
+    milliseconds = QueryStats::millisecondsSince(begin);
+    return found ? path.cost() : -1;
+}
+
+/**
+ * @brief counts the cells of a path that are occupied
+ */
+static size_t countBlocked(Environment::Ptr env, const Path& path){
+    size_t blocked = 0;
+    MapSnapshot::ConstPtr snapshot = env->getSnapshot();
+    for(Path::CellIterator cell_it = path.cellsBegin(); cell_it != path.cellsEnd(); ++cell_it)
+        blocked += !snapshot->isCollisionFree(*cell_it);
+    return blocked;
+}
+
+/**
+ * @brief stores many paths in a PathIndex and revalidates them after each change
+ *
+ * Plans random queries, then drops a block of obstacles onto a random
+ * stored path per trial. The paths the block invalidates are found with
+ * the index and repaired locally, and for comparison planned from
+ * scratch; the previous block is removed again between trials.
+ */
+static int benchPathIndex(Environment::Ptr env, int num_paths, int trials, int block, int margin, boost::random::mt19937& rng){
+  pair<Cell, Cell> window = MapRenderer::findWindow(*env->getSnapshot(), Path(), *env->getStart(), *env->getGoal());
+  boost::random::uniform_int_distribution<int> x(window.first.x, window.second.x), y(window.first.y, window.second.y);
+  PathIndex index;
+  index.setRepairMargin(margin);
+  vector<PathIndex::PathId> ids;
+  double plan_all_ms = 0, scratch_ms;
+  MapSnapshot::ConstPtr snapshot = env->getSnapshot();
+  while(int(ids.size()) < num_paths){
+    Cell ends[2];
+    for(int end=0; end<2; end++){
+      do{
+        ends[end] = Cell(x(rng), y(rng));
+      } while(!snapshot->isCollisionFree(ends[end]));
+    }
+    Clock::time_point begin = Clock::now();
+    Graph::Ptr graph = boost::make_shared<Graph>(env, ends[0], ends[1]);
+    Planner planner(env, graph);
+    planner.setVerbose(false);
+    Path path;
+    bool found = planner.plan(path);
+    plan_all_ms += QueryStats::millisecondsSince(begin);
+    if(found && path.numCells() > 2)
+      ids.push_back(index.add(path));
+  }
+  printf("planned %d paths in %.3f ms, %zu index postings\n", num_paths, plan_all_ms, index.getStats().postings);
+
+  double total_find_ms = 0, total_repair_ms = 0, total_scratch_ms = 0;
+  size_t broken = 0;
+  vector<Cell> last_block;
+  for(int trial=0; trial<trials; trial++){
+    env->removeObstacles(last_block);
+    //drop a block onto an inner cell of a random stored path
+    boost::random::uniform_int_distribution<size_t> pick_path(0, ids.size()-1);
+    const Path& target = *index.find(ids[pick_path(rng)]);
+    boost::random::uniform_int_distribution<size_t> pick_cell(1, target.numCells()-2);
+    Path::CellIterator cell_it = target.cellsBegin();
+    advance(cell_it, pick_cell(rng));
+    vector<Cell> delta;
+    snapshot = env->getSnapshot();
+    for(int dx=-block/2; dx<block-block/2; dx++){
+      for(int dy=-block/2; dy<block-block/2; dy++){
+        Cell cell(cell_it->x+dx, cell_it->y+dy);
+        if(snapshot->isCollisionFree(cell))
+          delta.push_back(cell);
+      }
+    }
+    env->addObstacles(delta);
+    last_block = delta;
+
+    Clock::time_point begin = Clock::now();
+    size_t checks_before = index.getStats().segment_checks;
+    vector<PathIndex::PathId> invalid;
+    index.findInvalid(delta, invalid);
+    double find_ms = QueryStats::millisecondsSince(begin);
+
+    double repaired_cost = 0, scratch_cost = 0;
+    vector<bool> repaired(invalid.size());
+    begin = Clock::now();
+    for(size_t i=0; i<invalid.size(); i++){
+      repaired[i] = index.repair(invalid[i], env);
+      if(repaired[i])
+        repaired_cost += index.find(invalid[i])->cost();
+    }
+    double repair_ms = QueryStats::millisecondsSince(begin);
+    //paths that could not be mended are left blocked on purpose
+    for(size_t i=0; i<invalid.size(); i++){
+      const Path& path = *index.find(invalid[i]);
+      if(!repaired[i])
+        continue;
+      broken += countBlocked(env, path);
+      double cost = planFromScratch(env, path.getWaypoints().front(), path.getWaypoints().back(), scratch_ms);
+      scratch_cost += max(0.0, cost);
+      total_scratch_ms += scratch_ms;
+    }
+    printf("trial %d (add %zu cells): %zu of %zu paths invalid, found in %.3f ms (%zu segment checks), repaired in %.3f ms (cost %.3f), scratch cost %.3f\n",
+            trial, delta.size(), invalid.size(), ids.size(), find_ms, index.getStats().segment_checks-checks_before,
+            repair_ms, repaired_cost, scratch_cost);
+    total_find_ms += find_ms;
+    total_repair_ms += repair_ms;
+  }
+  cout << "index: " << index.getStats() << endl;
+  printf("total: find %.3f ms + repair %.3f ms, scratch for the invalid paths %.3f ms, replanning every path %.3f ms per change\n",
+          total_find_ms, total_repair_ms, total_scratch_ms, plan_all_ms);
+  if(broken){
+    printf("%zu cells of repaired paths are occupied\n", broken);
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Replanning benchmark
+ *
+ * Moves the robot along its path and drops small blocks of obstacles onto
+ * the path ahead of it, alternating with removing the previous block.
+ * After every change the path is repaired with DStarLite and, for
+ * comparison, planned from scratch with Planner. With --paths, many
+ * stored paths are revalidated through a PathIndex instead.
+ */
+int main(int argc, char** argv){
+  namespace po = boost::program_options;
+  po::options_description desc("Replanning Benchmark Usage");
+  desc.add_options()
+    ("env,e",po::value<string>()->required(),"input environment json file")
+    ("trials,n",po::value<int>()->default_value(10),"number of map changes")
+    ("block,b",po::value<int>()->default_value(3),"side length of the square of cells changed per trial")
+    ("advance,a",po::value<int>()->default_value(20),"cells the robot moves along its path between changes")
+    ("seed,s",po::value<unsigned int>()->default_value(1),"random seed for placing the changes")
+    ("paths,p",po::value<int>(),"store this many random paths in a PathIndex and repair the ones each change blocks")
+    ("margin,m",po::value<int>()->default_value(32),"cells around the blocked stretch a path repair may search");
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  ifstream input_json_file( vm["env"].as<string>().c_str() );
+  if(!input_json_file){
+    printf("File \"%s\" does not exist to be read!\n", vm["env"].as<string>().c_str());
+    return 1;
+  }
+  Environment::Ptr env = boost::make_shared<Environment>();
+  env->readDescription( input_json_file );
+
+  Cell start = *(env->getStart());
+  Cell goal = *(env->getGoal());
+  int block = vm["block"].as<int>();
+  boost::random::mt19937 rng( vm["seed"].as<unsigned int>() );
+  if(vm.count("paths"))
+    return benchPathIndex(env, vm["paths"].as<int>(), vm["trials"].as<int>(), block, vm["margin"].as<int>(), rng);
+
+  double scratch_ms, dstar_ms;
+  double scratch_cost = planFromScratch(env, start, goal, scratch_ms);
+
+  Clock::time_point begin = Clock::now();
+  DStarLite dstar(env, start, goal);
+  Path path;
+  bool found = dstar.plan(path);
+  dstar_ms = QueryStats::millisecondsSince(begin);
+  printf("initial: scratch %.3f ms (cost %.3f), D* Lite %.3f ms (cost %.3f, %zu expansions)\n",
+          scratch_ms, scratch_cost, dstar_ms, found ? path.cost() : -1, dstar.getNumExpansions());
+  if(!found)
+    return 1;
+
+  double total_scratch_ms = 0, total_dstar_ms = 0;
+  vector<Cell> last_block;
+  for(int trial=0; trial<vm["trials"].as<int>(); trial++){
+    //move the robot along its current path
+    Path::CellIterator cell_it = path.cellsBegin();
+    for(int i=0; i<vm["advance"].as<int>() && !(*cell_it == goal); i++)
+      ++cell_it;
+    start = *cell_it;
+    dstar.moveStart(start);
+
+    vector<Cell> delta;
+    const char* kind;
+    if(trial%2 == 1){
+      //free the block dropped in the previous trial
+      delta = last_block;
+      env->removeObstacles(delta);
+      kind = "remove";
+    }
+    else{
+      //drop a block onto a random cell of the path ahead
+      size_t remaining = path.numCells() - distance(path.cellsBegin(), cell_it);
+      if(remaining < 3)
+        break;
+      boost::random::uniform_int_distribution<size_t> pick(1, remaining-2);
+      advance(cell_it, pick(rng));
+      MapSnapshot::ConstPtr snapshot = env->getSnapshot();
+      for(int dx=-block/2; dx<block-block/2; dx++){
+        for(int dy=-block/2; dy<block-block/2; dy++){
+          Cell cell(cell_it->x+dx, cell_it->y+dy);
+          if(!(cell == start) && !(cell == goal) && snapshot->isCollisionFree(cell))
+            delta.push_back(cell);
+        }
+      }
+      env->addObstacles(delta);
+      last_block = delta;
+      kind = "add";
+    }
+
+    begin = Clock::now();
+    size_t expansions_before = dstar.getNumExpansions();
+    dstar.updateCells(delta);
+    found = dstar.plan(path);
+    dstar_ms = QueryStats::millisecondsSince(begin);
+    scratch_cost = planFromScratch(env, start, goal, scratch_ms);
+
+    printf("trial %d (%s %zu cells): scratch %.3f ms (cost %.3f), D* Lite %.3f ms (cost %.3f, %zu expansions)\n",
+            trial, kind, delta.size(), scratch_ms, scratch_cost, dstar_ms, found ? path.cost() : -1,
+            dstar.getNumExpansions()-expansions_before);
+    total_scratch_ms += scratch_ms;
+    total_dstar_ms += dstar_ms;
+    if(!found)
+      break;
+  }
+  printf("total: scratch %.3f ms, D* Lite %.3f ms, speedup %.1fx\n",
+          total_scratch_ms, total_dstar_ms, total_dstar_ms > 0 ? total_scratch_ms/total_dstar_ms : 0);
+  return 0;
+}
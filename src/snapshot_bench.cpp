@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/chrono.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/program_options.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "navi_example/Environment.h"
+
+using namespace std;
+
+typedef boost::chrono::steady_clock Clock;
+
+/**
+ * @brief what one reader thread measured
+ */
+struct ReaderResult{
+    /**
+     * @brief number of collision checks made
+     */
+    size_t checks;
+    /**
+     * @brief microseconds from an update being requested until this reader first saw it
+     */
+    vector<double> visibility_us;
+    ReaderResult() : checks(0) {}
+};
+
+/**
+ * @brief checks random cells against the latest snapshot until told to stop
+ */
+static void readerLoop(Environment::Ptr env, int min_x, int min_y, int max_x, int max_y, unsigned int seed,
+                       boost::atomic<bool>* stop, ReaderResult* result){
+    boost::random::mt19937 rng(seed);
+    boost::random::uniform_int_distribution<int> pick_x(min_x, max_x), pick_y(min_y, max_y);
+    size_t seen = env->getVersion();
+    size_t blocked = 0;
+    while(!stop->load()){
+        MapSnapshot::ConstPtr snapshot = env->getSnapshot();
+        if(snapshot->getVersion() != seen){
+            seen = snapshot->getVersion();
+            result->visibility_us.push_back(
+                boost::chrono::duration<double, boost::micro>(Clock::now() - snapshot->getSubmitTime()).count());
+        }
+        //a batch of checks against one version, like a short search would make
+        for(int i=0; i<1024; i++)
+            blocked += !snapshot->isCollisionFree(Cell(pick_x(rng), pick_y(rng)));
+        result->checks += 1024;
+    }
+    //keep the checks from being optimized away
+    if(blocked == size_t(-1))
+        printf("\n");
+}
+
+/**
+ * @brief value at a fraction of the way through a sorted copy
+ */
+static double percentile(vector<double> values, double fraction){
+    if(values.empty())
+        return 0;
+    sort(values.begin(), values.end());
+    return values[min(values.size()-1, size_t(fraction*values.size()))];
+}
+
+/**
+ * @brief Snapshot isolation benchmark
+ *
+ * Reader threads make collision checks against the latest published map
+ * while a writer thread keeps adding and removing blocks of obstacles.
+ * Reports reader throughput, the time from an update being requested
+ * until readers see it, and the writer's publish latency.
+ */
+int main(int argc, char** argv){
+  namespace po = boost::program_options;
+  po::options_description desc("Snapshot Benchmark Usage");
+  desc.add_options()
+    ("env,e",po::value<string>()->required(),"input environment json file")
+    ("readers,r",po::value<int>()->default_value(4),"number of reader threads")
+    ("updates,u",po::value<int>()->default_value(200),"number of map updates published")
+    ("interval,i",po::value<int>()->default_value(1000),"microseconds between updates")
+    ("block,b",po::value<int>()->default_value(8),"side length of the square of cells changed per update")
+    ("seed,s",po::value<unsigned int>()->default_value(1),"random seed");
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  ifstream input_json_file( vm["env"].as<string>().c_str() );
+  if(!input_json_file){
+    printf("File \"%s\" does not exist to be read!\n", vm["env"].as<string>().c_str());
+    return 1;
+  }
+  Environment::Ptr env = boost::make_shared<Environment>();
+  env->readDescription( input_json_file );
+
+  //readers and writer work inside the box spanned by start and goal
+  Cell start = *(env->getStart());
+  Cell goal = *(env->getGoal());
+  int min_x = min(start.x, goal.x), max_x = max(start.x, goal.x);
+  int min_y = min(start.y, goal.y), max_y = max(start.y, goal.y);
+
+  int num_readers = vm["readers"].as<int>();
+  unsigned int seed = vm["seed"].as<unsigned int>();
+  boost::atomic<bool> stop(false);
+  vector<ReaderResult> results(num_readers);
+  boost::thread_group readers;
+  for(int i=0; i<num_readers; i++)
+    readers.create_thread(boost::bind(&readerLoop, env, min_x, min_y, max_x, max_y, seed+i+1, &stop, &results[i]));
+
+  boost::random::mt19937 rng(seed);
+  boost::random::uniform_int_distribution<int> pick_x(min_x, max_x), pick_y(min_y, max_y);
+  int block = vm["block"].as<int>();
+  vector<Cell> last_block;
+  vector<double> publish_us;
+  Clock::time_point begin = Clock::now();
+  for(int update=0; update<vm["updates"].as<int>(); update++){
+    boost::this_thread::sleep_for(boost::chrono::microseconds(vm["interval"].as<int>()));
+    if(update%2 == 1){
+      env->removeObstacles(last_block);
+    }
+    else{
+      last_block.clear();
+      Cell corner(pick_x(rng), pick_y(rng));
+      MapSnapshot::ConstPtr snapshot = env->getSnapshot();
+      for(int dx=0; dx<block; dx++)
+        for(int dy=0; dy<block; dy++)
+          if(snapshot->isCollisionFree(Cell(corner.x+dx, corner.y+dy)))
+            last_block.push_back(Cell(corner.x+dx, corner.y+dy));
+      env->addObstacles(last_block);
+    }
+    publish_us.push_back(env->getLastPublishMicroseconds());
+  }
+  double seconds = boost::chrono::duration<double>(Clock::now() - begin).count();
+  stop.store(true);
+  readers.join_all();
+
+  size_t checks = 0;
+  vector<double> visibility_us;
+  for(int i=0; i<num_readers; i++){
+    checks += results[i].checks;
+    visibility_us.insert(visibility_us.end(), results[i].visibility_us.begin(), results[i].visibility_us.end());
+  }
+  printf("readers: %d threads, %.1f M checks/s\n", num_readers, checks/seconds/1e6);
+  printf("visibility: p50 %.1f us, p99 %.1f us, max %.1f us (%zu observations)\n",
+          percentile(visibility_us, 0.5), percentile(visibility_us, 0.99), percentile(visibility_us, 1.0),
+          visibility_us.size());
+  printf("publish: p50 %.1f us, p99 %.1f us, max %.1f us (%zu updates)\n",
+          percentile(publish_us, 0.5), percentile(publish_us, 0.99), percentile(publish_us, 1.0),
+          publish_us.size());
+  return 0;
+}